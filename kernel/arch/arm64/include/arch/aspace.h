@@ -71,6 +71,9 @@ private:
                          pte_t attrs, uint index_shift, uint page_size_shift,
                          volatile pte_t* page_table) TA_REQ(lock_);
 
+    zx_status_t SplitBlock(vaddr_t vaddr, uint index_shift, uint page_size_shift,
+                           vaddr_t index, volatile pte_t* page_table) TA_REQ(lock_);
+
     void MmuParamsFromFlags(uint mmu_flags,
                             pte_t* attrs, vaddr_t* vaddr_base,
                             uint* top_size_shift, uint* top_index_shift,
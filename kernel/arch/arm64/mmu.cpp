@@ -511,6 +511,53 @@ void ArmArchVmAspace::FlushTLBEntry(vaddr_t vaddr, bool terminal) {
     }
 }
 
+// Replace the block mapping at page_table[index] with a table of next level
+// entries that map the same range with the same attributes, so that part of the
+// block can be unmapped or reprotected. |vaddr| is the start of the block.
+// NOTE: caller must DSB afterwards to ensure TLB entries are flushed
+zx_status_t ArmArchVmAspace::SplitBlock(vaddr_t vaddr, uint index_shift, uint page_size_shift,
+                                        vaddr_t index, volatile pte_t* page_table) {
+    pte_t pte = page_table[index];
+
+    DEBUG_ASSERT(index_shift > page_size_shift);
+    DEBUG_ASSERT((pte & MMU_PTE_DESCRIPTOR_MASK) == MMU_PTE_L012_DESCRIPTOR_BLOCK);
+
+    LTRACEF("vaddr %#" PRIxPTR ", index shift %u, pte %p[%#" PRIxPTR "] = %#" PRIx64 "\n",
+            vaddr, index_shift, page_table, index, pte);
+
+    paddr_t table_paddr;
+    zx_status_t status = AllocPageTable(&table_paddr, page_size_shift);
+    if (status != ZX_OK) {
+        return status;
+    }
+    volatile pte_t* table = static_cast<volatile pte_t*>(paddr_to_physmap(table_paddr));
+
+    const uint next_shift = index_shift - (page_size_shift - 3);
+    const pte_t desc = (next_shift > page_size_shift) ? MMU_PTE_L012_DESCRIPTOR_BLOCK
+                                                      : MMU_PTE_L3_DESCRIPTOR_PAGE;
+    const pte_t attrs = pte & ~(MMU_PTE_OUTPUT_ADDR_MASK | MMU_PTE_DESCRIPTOR_MASK);
+    const paddr_t paddr = pte & MMU_PTE_OUTPUT_ADDR_MASK;
+    const size_t count = 1UL << (page_size_shift - 3);
+    for (size_t i = 0; i < count; i++) {
+        table[i] = (paddr + (i << next_shift)) | attrs | desc;
+    }
+
+    // ensure that the new table is observable from hardware page table walkers
+    __dmb(ARM_MB_ISHST);
+
+    // break before make: the block has to be gone from the TLB before the table
+    // takes its place
+    page_table[index] = MMU_PTE_DESCRIPTOR_INVALID;
+    __dmb(ARM_MB_ISHST);
+    FlushTLBEntry(vaddr, true);
+    __dsb(ARM_MB_ISH);
+
+    page_table[index] = table_paddr | MMU_PTE_L012_DESCRIPTOR_TABLE;
+    __dmb(ARM_MB_ISHST);
+
+    return ZX_OK;
+}
+
 // NOTE: caller must DSB afterwards to ensure TLB entries are flushed
 ssize_t ArmArchVmAspace::UnmapPageTable(vaddr_t vaddr, vaddr_t vaddr_rel,
                                         size_t size, uint index_shift,
@@ -539,6 +586,15 @@ ssize_t ArmArchVmAspace::UnmapPageTable(vaddr_t vaddr, vaddr_t vaddr_rel,
 
         pte = page_table[index];
 
+        // only part of a block is going away, so break it up first. if that fails the
+        // whole block is unmapped below, and faults will bring the rest back in.
+        if (index_shift > page_size_shift && chunk_size != block_size &&
+            (pte & MMU_PTE_DESCRIPTOR_MASK) == MMU_PTE_L012_DESCRIPTOR_BLOCK &&
+            SplitBlock(vaddr - vaddr_rem, index_shift, page_size_shift, index,
+                       page_table) == ZX_OK) {
+            pte = page_table[index];
+        }
+
         if (index_shift > page_size_shift &&
             (pte & MMU_PTE_DESCRIPTOR_MASK) == MMU_PTE_L012_DESCRIPTOR_TABLE) {
             page_table_paddr = pte & MMU_PTE_OUTPUT_ADDR_MASK;
@@ -703,6 +759,20 @@ int ArmArchVmAspace::ProtectPageTable(vaddr_t vaddr_in, vaddr_t vaddr_rel_in,
         index = vaddr_rel >> index_shift;
         pte = page_table[index];
 
+        // only part of a block is changing, so break it up first. if that fails, unmap
+        // the whole block rather than change more than was asked for, and let faults
+        // bring it back in.
+        if (index_shift > page_size_shift && chunk_size != block_size &&
+            (pte & MMU_PTE_DESCRIPTOR_MASK) == MMU_PTE_L012_DESCRIPTOR_BLOCK) {
+            if (SplitBlock(vaddr - vaddr_rem, index_shift, page_size_shift, index,
+                           page_table) != ZX_OK) {
+                page_table[index] = MMU_PTE_DESCRIPTOR_INVALID;
+                __dmb(ARM_MB_ISHST);
+                FlushTLBEntry(vaddr - vaddr_rem, true);
+            }
+            pte = page_table[index];
+        }
+
         if (index_shift > page_size_shift &&
             (pte & MMU_PTE_DESCRIPTOR_MASK) == MMU_PTE_L012_DESCRIPTOR_TABLE) {
             page_table_paddr = pte & MMU_PTE_OUTPUT_ADDR_MASK;
@@ -0,0 +1,145 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <arch/ops.h>
+#include <kernel/align.h>
+#include <kernel/lockdep.h>
+#include <kernel/spinlock.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// CpuMagazines keeps a small stack of free items for each cpu in front of an
+// allocator whose own lock is comparatively expensive, so that most
+// allocations and frees only touch the current cpu's magazine.  Items move
+// between a magazine and the backing allocator |Batch| at a time, and a
+// magazine holds at most |Max| of them.
+//
+// Only pointers are stored, so the items themselves are never written.
+//
+// A thread may migrate between looking up the current cpu and taking that
+// magazine's spinlock.  That is harmless: it then works on another cpu's
+// magazine, which costs some cache locality but is still correct, since every
+// magazine is only ever touched under its own lock.
+template <typename T, size_t Batch, size_t Max = Batch * 2>
+class CpuMagazines {
+public:
+    static_assert(Batch > 0 && Batch <= Max, "");
+
+    static constexpr size_t kBatch = Batch;
+
+    // Counts summed across every magazine.
+    struct Stats {
+        size_t cached;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t spills;
+    };
+
+    // Takes the most recently freed item from the current cpu's magazine.
+    // Returns nullptr if it is empty, in which case the caller should go to
+    // the backing allocator and Fill() the magazine.
+    T* Get() {
+        Magazine& mag = Current();
+        Guard<SpinLock, IrqSave> guard{&mag.lock};
+        if (mag.count == 0) {
+            mag.misses++;
+            return nullptr;
+        }
+        mag.hits++;
+        return mag.items[--mag.count];
+    }
+
+    // Puts |item| in the current cpu's magazine.  If that makes the magazine
+    // overflow, its oldest |Batch| items are moved to |spill| to make room and
+    // true is returned; the caller must hand those back to the backing
+    // allocator.
+    bool Put(T* item, T* (&spill)[Batch]) {
+        Magazine& mag = Current();
+        Guard<SpinLock, IrqSave> guard{&mag.lock};
+        if (mag.count < Max) {
+            mag.items[mag.count++] = item;
+            return false;
+        }
+        mag.spills++;
+        memcpy(spill, mag.items, sizeof(spill));
+        memmove(mag.items, mag.items + Batch, (mag.count - Batch) * sizeof(mag.items[0]));
+        mag.count -= Batch;
+        mag.items[mag.count++] = item;
+        return true;
+    }
+
+    // Moves items off the end of |items| into the current cpu's magazine for
+    // as long as it has room.  Returns how many of the |count| are left over,
+    // still at the start of |items|, for the caller to hand back.
+    size_t Fill(T** items, size_t count) {
+        Magazine& mag = Current();
+        Guard<SpinLock, IrqSave> guard{&mag.lock};
+        while (count > 0 && mag.count < Max) {
+            mag.items[mag.count++] = items[--count];
+        }
+        return count;
+    }
+
+    // Empties every magazine, calling |func| on each item.  |func| is called
+    // without any magazine lock held.
+    template <typename F>
+    void Drain(F func) {
+        for (auto& mag : magazines_) {
+            T* items[Max];
+            size_t count;
+            {
+                Guard<SpinLock, IrqSave> guard{&mag.lock};
+                count = mag.count;
+                memcpy(items, mag.items, count * sizeof(items[0]));
+                mag.count = 0;
+            }
+            for (size_t i = 0; i < count; i++) {
+                func(items[i]);
+            }
+        }
+    }
+
+    // Number of items sitting in magazines.  Reads the counts without their
+    // locks, so the total may be slightly out of date.
+    size_t CachedCount() const TA_NO_THREAD_SAFETY_ANALYSIS {
+        size_t count = 0;
+        for (const auto& mag : magazines_) {
+            count += mag.count;
+        }
+        return count;
+    }
+
+    Stats GetStats() {
+        Stats stats = {};
+        for (auto& mag : magazines_) {
+            Guard<SpinLock, IrqSave> guard{&mag.lock};
+            stats.cached += mag.count;
+            stats.hits += mag.hits;
+            stats.misses += mag.misses;
+            stats.spills += mag.spills;
+        }
+        return stats;
+    }
+
+private:
+    // The statistics live in the magazine so that keeping them doesn't bounce
+    // a shared cache line between cpus.
+    struct Magazine {
+        DECLARE_SPINLOCK(Magazine) lock;
+        T* items[Max] TA_GUARDED(lock);
+        size_t count TA_GUARDED(lock) = 0;
+        uint64_t hits TA_GUARDED(lock) = 0;
+        uint64_t misses TA_GUARDED(lock) = 0;
+        uint64_t spills TA_GUARDED(lock) = 0;
+    } __CPU_ALIGN;
+
+    Magazine& Current() { return magazines_[arch_curr_cpu_num()]; }
+
+    Magazine magazines_[SMP_MAX_CPUS];
+};
@@ -24,8 +24,12 @@ __BEGIN_CDECLS
 // The val field holds either 0 or a pointer to the thread_t holding the mutex.
 // If one or more threads are blocking and queued up, MUTEX_FLAG_QUEUED is ORed in as well.
 // NOTE: MUTEX_FLAG_QUEUED is only manipulated under the THREAD_LOCK.
+// The owner_cpu field records which cpu the holder was on when it acquired the mutex.
+// Contending threads read it without synchronization to guess whether the holder is still
+// running, and so worth spinning for; the holder may since have been switched out.
 typedef struct TA_CAP("mutex") mutex {
     uint32_t magic;
+    cpu_num_t owner_cpu;
     uintptr_t val;
     wait_queue_t wait;
 } mutex_t;
@@ -46,6 +50,7 @@ static inline thread_t* mutex_holder(const mutex_t* m) {
 #define MUTEX_INITIAL_VALUE(m)                      \
     {                                               \
         .magic = MUTEX_MAGIC,                       \
+        .owner_cpu = INVALID_CPU,                   \
         .val = 0,                                   \
         .wait = WAIT_QUEUE_INITIAL_VALUE((m).wait), \
     }
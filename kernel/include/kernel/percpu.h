@@ -18,9 +18,6 @@
 __BEGIN_CDECLS
 
 struct percpu {
-    // per cpu timer queue
-    struct list_node timer_queue;
-
     // per cpu preemption timer; ZX_TIME_INFINITE means not set
     zx_time_t preempt_timer_deadline;
 
@@ -31,6 +28,22 @@ struct percpu {
     struct list_node run_queue[NUM_PRIORITIES];
     uint32_t run_queue_bitmap;
 
+    // deadline threads with budget left in their current period, sorted by absolute
+    // deadline. always served ahead of run_queue.
+    struct list_node deadline_run_queue;
+
+    // number of threads sitting in the run queues, not counting the running thread.
+    // written under thread_lock, may be read without it as a load hint.
+    uint32_t run_queue_len;
+
+    // the thread running on this cpu. written under thread_lock on every context switch,
+    // read without it by other cpus as a hint; see mutex_acquire().
+    thread_t* running_thread;
+
+    // cpus that share a cluster or last level cache with this one, including itself.
+    // covers every cpu until the system topology is known; guarded by thread_lock.
+    cpu_mask_t cluster_mask;
+
 #if WITH_LOCK_DEP
     // state for runtime lock validation when in irq context
     lockdep_state_t lock_state;
@@ -34,6 +34,14 @@ void sched_inherit_priority(thread_t* t, int pri, bool* local_resched) TA_REQ(th
 // pri should be 0 <= to <= MAX_PRIORITY.
 void sched_change_priority(thread_t* t, int pri) TA_REQ(thread_lock);
 
+// set the deadline parameters of a thread: it is given |capacity| of cpu time every |period|,
+// to be used within |deadline| of the start of each period. a zero |period| returns the
+// thread to plain priority scheduling. This function might reschedule.
+// fails with ZX_ERR_NO_RESOURCES if the deadline threads together would need more cpu time
+// than the active cpus have.
+zx_status_t sched_change_deadline(thread_t* t, zx_duration_t capacity, zx_duration_t deadline,
+                                  zx_duration_t period) TA_REQ(thread_lock);
+
 // return true if the thread was placed on the current cpu's run queue
 // this usually means the caller should locally reschedule soon
 bool sched_unblock(thread_t* t) __WARN_UNUSED_RESULT TA_REQ(thread_lock);
@@ -114,6 +114,25 @@ typedef struct thread {
     int priority_boost;
     int inherited_priority;
 
+    // deadline scheduling parameters, set with thread_set_deadline(). a nonzero
+    // deadline_period gives the thread deadline_capacity of cpu time every period,
+    // due within deadline_relative of the period's start. while it has budget left it
+    // runs ahead of all priority scheduled threads, earliest deadline first. once the
+    // budget is spent it falls back to its priority until the next period.
+    zx_duration_t deadline_capacity;
+    zx_duration_t deadline_relative;
+    zx_duration_t deadline_period;
+
+    // the current period: when it started, when it is due, how much of the capacity
+    // is left, and up to when the thread has been charged for running.
+    zx_time_t deadline_period_start;
+    zx_time_t deadline_abs;
+    zx_duration_t deadline_budget;
+    zx_time_t deadline_charged_to;
+
+    // fires at the end of a period the thread ran out of budget in, to hand it the next one.
+    timer_t deadline_timer;
+
     // current cpu the thread is either running on or in the ready queue, undefined otherwise
     cpu_num_t curr_cpu;
     cpu_num_t last_cpu;      // last cpu the thread ran on, INVALID_CPU if it's never run
@@ -239,6 +258,8 @@ void thread_construct_first(thread_t* t, const char* name);
 thread_t* thread_create_idle_thread(uint cpu_num);
 void thread_set_name(const char* name);
 void thread_set_priority(thread_t* t, int priority);
+zx_status_t thread_set_deadline(thread_t* t, zx_duration_t capacity, zx_duration_t deadline,
+                                zx_duration_t period);
 void thread_set_user_callback(thread_t* t, thread_user_callback_t cb);
 thread_t* thread_create(const char* name, thread_start_routine entry, void* arg, int priority);
 thread_t* thread_create_etc(thread_t* t, const char* name, thread_start_routine entry, void* arg,
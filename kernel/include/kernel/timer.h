@@ -7,9 +7,9 @@
 
 #pragma once
 
+#include <fbl/intrusive_wavl_tree.h>
 #include <kernel/spinlock.h>
 #include <kernel/timer_slack.h>
-#include <list.h>
 #include <sys/types.h>
 #include <zircon/compiler.h>
 #include <zircon/types.h>
@@ -25,7 +25,12 @@ typedef void (*timer_callback)(struct timer*, zx_time_t now, void* arg);
 
 typedef struct timer {
     int magic;
-    struct list_node node;
+
+    // The timer's place in its cpu's queue, which is ordered by scheduled_time and
+    // then by queue_seq. queue_cpu is only meaningful while the timer is queued.
+    fbl::WAVLTreeNodeState<struct timer*> node;
+    uint64_t queue_seq;
+    uint queue_cpu;
 
     zx_time_t scheduled_time;
     zx_duration_t slack; // Stores the applied slack adjustment from
@@ -40,7 +45,9 @@ typedef struct timer {
 #define TIMER_INITIAL_VALUE(t)              \
     {                                       \
         .magic = TIMER_MAGIC,               \
-        .node = LIST_INITIAL_CLEARED_VALUE, \
+        .node = {},                         \
+        .queue_seq = 0,                     \
+        .queue_cpu = 0,                     \
         .scheduled_time = 0,                \
         .slack = 0,                         \
         .callback = NULL,                   \
@@ -279,6 +279,7 @@ static int cmd_threadq(int argc, const cmd_args* argv, uint32_t flags) {
             for (uint p = 0; p < NUM_PRIORITIES; p++) {
                 printf(" %2zu", list_length(&cpu->run_queue[p]));
             }
+            printf(" dl %2zu", list_length(&cpu->deadline_run_queue));
             printf("\n");
         }
     });
@@ -16,19 +16,82 @@
 
 #include <kernel/mutex.h>
 
+#include <arch/ops.h>
 #include <assert.h>
 #include <debug.h>
 #include <err.h>
 #include <inttypes.h>
+#include <kernel/cmdline.h>
+#include <kernel/percpu.h>
 #include <kernel/sched.h>
 #include <kernel/thread.h>
 #include <kernel/thread_lock.h>
+#include <lib/counters.h>
 #include <lib/ktrace.h>
+#include <lk/init.h>
+#include <platform.h>
 #include <trace.h>
+#include <zircon/time.h>
 #include <zircon/types.h>
 
 #define LOCAL_TRACE 0
 
+// Counts contended acquisitions that got the mutex by spinning.
+KCOUNTER(mutex_spin_acquired_count, "kernel.mutex.spin_acquired");
+// Counts contended acquisitions that had to block.
+KCOUNTER(mutex_blocked_count, "kernel.mutex.blocked");
+
+// The longest a contending thread spins waiting for a running holder to release the mutex
+// before blocking. 0 turns spinning off. Set from the kernel command line at init.
+static zx_duration_t mutex_spin_max_duration = ZX_USEC(150);
+
+static void mutex_init_spin(uint level) {
+    // Be sure to update kernel_cmdline.md if the default changes.
+    mutex_spin_max_duration = cmdline_get_uint64("kernel.mutex.spin-max-ns",
+                                                 ZX_USEC(150));
+}
+
+LK_INIT_HOOK(mutex_spin, mutex_init_spin, LK_INIT_LEVEL_THREADING);
+
+// Spin while the holder of |m| is running on another cpu, in the hope that it releases the
+// mutex shortly, and try to take it when it does. Gives up once the holder stops running,
+// another thread queues on the mutex (the release will hand it straight to that thread), or
+// mutex_spin_max_duration passes. Returns true if the mutex was acquired.
+//
+// The holder's thread_t may be freed under us once it drops the mutex, so it is never
+// dereferenced here: the holder counts as running while the cpu it acquired the mutex on
+// says it is running that very thread.
+static bool mutex_spin(mutex_t* m, thread_t* ct) {
+    if (mutex_spin_max_duration <= 0) {
+        return false;
+    }
+
+    zx_time_t deadline = zx_time_add_duration(current_time(), mutex_spin_max_duration);
+    for (;;) {
+        uintptr_t oldval = mutex_val(m);
+        if (oldval == 0) {
+            if (atomic_cmpxchg_u64(&m->val, &oldval, (uintptr_t)ct)) {
+                return true;
+            }
+            continue;
+        }
+        if (oldval & MUTEX_FLAG_QUEUED) {
+            return false;
+        }
+
+        cpu_num_t cpu = atomic_load_u32(&m->owner_cpu);
+        if (!is_valid_cpu_num(cpu) ||
+            __atomic_load_n(&percpu[cpu].running_thread, __ATOMIC_RELAXED) !=
+                (thread_t*)oldval) {
+            return false;
+        }
+        if (current_time() >= deadline) {
+            return false;
+        }
+        arch_spinloop_pause();
+    }
+}
+
 /**
  * @brief  Initialize a mutex_t
  */
@@ -75,6 +138,7 @@ retry:
     oldval = 0;
     if (likely(atomic_cmpxchg_u64(&m->val, &oldval, (uintptr_t)ct))) {
         // acquired it cleanly
+        atomic_store_relaxed_u32(&m->owner_cpu, arch_curr_cpu_num());
         ct->mutexes_held++;
         return;
     }
@@ -85,6 +149,15 @@ retry:
               ct, ct->name, m);
 #endif
 
+    // the holder may be about to release it, which is far cheaper to wait out than a block
+    // and wakeup
+    if (mutex_spin(m, ct)) {
+        kcounter_add(mutex_spin_acquired_count, 1);
+        atomic_store_relaxed_u32(&m->owner_cpu, arch_curr_cpu_num());
+        ct->mutexes_held++;
+        return;
+    }
+
     {
         // we contended with someone else, will probably need to block
         Guard<spin_lock_t, IrqSave> guard{ThreadLock::Get()};
@@ -117,8 +190,10 @@ retry:
 
         // someone must have woken us up, we should own the mutex now
         DEBUG_ASSERT(ct == mutex_holder(m));
+        kcounter_add(mutex_blocked_count, 1);
 
         // record that we hold it
+        atomic_store_relaxed_u32(&m->owner_cpu, arch_curr_cpu_num());
         ct->mutexes_held++;
     }
 }
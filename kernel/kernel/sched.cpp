@@ -13,8 +13,12 @@
 #include <kernel/mp.h>
 #include <kernel/percpu.h>
 #include <kernel/thread.h>
+#include <kernel/thread_lock.h>
+#include <lib/counters.h>
 #include <lib/ktrace.h>
+#include <lib/system-topology.h>
 #include <list.h>
+#include <lk/init.h>
 #include <platform.h>
 #include <printf.h>
 #include <string.h>
@@ -53,6 +57,13 @@
 // threads get 10ms to run before they use up their time slice and the scheduler is invoked
 #define THREAD_INITIAL_TIME_SLICE ZX_MSEC(10)
 
+// counts threads placed on a cpu other than the one they last ran on
+KCOUNTER(sched_migrate_count, "kernel.sched.migrate");
+// counts threads pulled off another cpu's run queue by a cpu that was about to go idle
+KCOUNTER(sched_steal_count, "kernel.sched.steal");
+// counts deadline threads that used up their budget before the end of a period
+KCOUNTER(sched_deadline_throttle_count, "kernel.sched.deadline_throttle");
+
 static bool local_migrate_if_needed(thread_t* curr_thread);
 
 // compute the effective priority of a thread
@@ -121,6 +132,81 @@ static void deboost_thread(thread_t* t, bool quantum_expiration) {
     compute_effec_priority(t);
 }
 
+// deadline scheduling
+//
+// A thread with deadline parameters is handed a budget of deadline_capacity at the start
+// of each period. While it has budget left it sits in the cpu's deadline run queue, which
+// is served earliest deadline first ahead of all the priority queues. Once the budget is
+// spent it is queued by priority like any other thread until its next period starts.
+//
+// Deadline threads are admitted only while their capacity/period shares add up to no more
+// than the active cpus, kept in 1/kDeadlineShareScale parts of a cpu.
+static constexpr uint64_t kDeadlineShareScale = 1u << 20;
+static uint64_t deadline_total_share TA_GUARDED(thread_lock);
+
+static bool thread_is_deadline(const thread_t* t) {
+    return t->deadline_period != 0;
+}
+
+// the part of a cpu a thread with these parameters needs, rounded up
+static uint64_t deadline_share(zx_duration_t capacity, zx_duration_t period) {
+    if (period == 0) {
+        return 0;
+    }
+    unsigned __int128 scaled = static_cast<unsigned __int128>(capacity) * kDeadlineShareScale;
+    return static_cast<uint64_t>((scaled + period - 1) / period);
+}
+
+// true if the thread belongs in the deadline run queue rather than the priority queues.
+// this only changes while the thread is running or off the run queues.
+static bool deadline_runnable(const thread_t* t) {
+    return thread_is_deadline(t) && t->deadline_budget > 0;
+}
+
+// start a new period if the current one is over. a thread that slept through one or
+// more periods starts its next one now rather than catching up on the ones it missed.
+static void deadline_replenish(thread_t* t, zx_time_t now) {
+    zx_time_t period_end = zx_time_add_duration(t->deadline_period_start, t->deadline_period);
+    if (now < period_end) {
+        return;
+    }
+    t->deadline_period_start = now;
+    t->deadline_abs = zx_time_add_duration(now, t->deadline_relative);
+    t->deadline_budget = t->deadline_capacity;
+}
+
+static void deadline_replenish_handler(timer_t* timer, zx_time_t now, void* arg);
+
+// charge the thread's budget for the time it has been running since it was last charged.
+// must only be called while the thread is off the run queues.
+static void deadline_charge(thread_t* t, zx_time_t now) TA_REQ(thread_lock) {
+    DEBUG_ASSERT(t->state != THREAD_READY);
+
+    zx_time_t since = MAX(t->last_started_running, t->deadline_charged_to);
+    if (now > since && t->deadline_budget > 0) {
+        zx_duration_t used = zx_time_sub_time(now, since);
+        t->deadline_budget = zx_duration_sub_duration(t->deadline_budget,
+                                                      MIN(used, t->deadline_budget));
+
+        // left to its priority, a throttled thread might not be back on a cpu until well
+        // into its next period, so hand it the next budget on time
+        if (t->deadline_budget == 0) {
+            timer_cancel(&t->deadline_timer);
+            timer_set_oneshot(&t->deadline_timer,
+                              zx_time_add_duration(t->deadline_period_start, t->deadline_period),
+                              deadline_replenish_handler, t);
+        }
+    }
+    t->deadline_charged_to = now;
+}
+
+// charge the current thread for its time so far, before it goes back in a run queue or blocks
+static void charge_current_thread(thread_t* t) TA_REQ(thread_lock) {
+    if (unlikely(thread_is_deadline(t))) {
+        deadline_charge(t, current_time());
+    }
+}
+
 // pick a 'random' cpu out of the passed in mask of cpus
 static cpu_mask_t rand_cpu(cpu_mask_t mask) {
     if (unlikely(mask == 0)) {
@@ -152,6 +238,57 @@ static cpu_mask_t rand_cpu(cpu_mask_t mask) {
     }
 }
 
+// an estimate of how much work is queued up on a cpu: the threads waiting in its run
+// queue plus the one it's running, if any
+static uint32_t cpu_load(cpu_num_t cpu) TA_REQ(thread_lock) {
+    uint32_t load = __atomic_load_n(&percpu[cpu].run_queue_len, __ATOMIC_RELAXED);
+    if (!mp_is_cpu_idle(cpu)) {
+        load++;
+    }
+    return load;
+}
+
+// the cpus sharing a cluster or last level cache with |cpu|, or none if |cpu| is invalid
+static cpu_mask_t cluster_mask(cpu_num_t cpu) TA_REQ(thread_lock) {
+    return is_valid_cpu_num(cpu) ? percpu[cpu].cluster_mask : 0;
+}
+
+// pick the least loaded cpu out of the passed in mask of cpus.
+// ties go to the last cpu the thread ran on, since its cache may still be warm, then to
+// cpus sharing a cache with it, and against the current cpu, since it's busy running
+// whoever is waking the thread up.
+static cpu_mask_t least_loaded_cpu(cpu_mask_t mask, cpu_num_t last_cpu,
+                                   cpu_num_t curr_cpu) TA_REQ(thread_lock) {
+    mask &= mp_get_active_mask();
+    if (unlikely(mask == 0)) {
+        return 0;
+    }
+
+    const cpu_mask_t last_cluster = cluster_mask(last_cpu);
+    cpu_num_t best_cpu = INVALID_CPU;
+    int best_score = INT_MAX;
+    while (mask != 0) {
+        cpu_num_t cpu = lowest_cpu_set(mask);
+        mask &= ~cpu_num_to_mask(cpu);
+
+        int score = static_cast<int>(cpu_load(cpu)) * 4;
+        if (cpu == last_cpu) {
+            score -= 2;
+        } else if (last_cluster & cpu_num_to_mask(cpu)) {
+            score--;
+        }
+        if (cpu == curr_cpu) {
+            score++;
+        }
+        if (score < best_score) {
+            best_score = score;
+            best_cpu = cpu;
+        }
+    }
+
+    return cpu_num_to_mask(best_cpu);
+}
+
 // find a cpu to wake up
 static cpu_mask_t find_cpu_mask(thread_t* t) TA_REQ(thread_lock) {
     // get the last cpu the thread ran on
@@ -182,29 +319,26 @@ static cpu_mask_t find_cpu_mask(thread_t* t) TA_REQ(thread_lock) {
             return last_ran_cpu_mask;
         }
 
+        // prefer an idle cpu that shares a cache with the last one it ran on, then one
+        // sharing a cache with the waker, so producer/consumer pairs stay close together
+        cpu_mask_t near_mask = idle_cpu_mask & cluster_mask(t->last_cpu);
+        if (near_mask == 0) {
+            near_mask = idle_cpu_mask & cluster_mask(arch_curr_cpu_num());
+        }
+        if (near_mask != 0) {
+            return rand_cpu(near_mask);
+        }
+
         // pick an idle_cpu
         DEBUG_ASSERT((idle_cpu_mask & mp_get_active_mask()) == idle_cpu_mask);
         return rand_cpu(idle_cpu_mask);
     }
 
-    // no idle cpus in our affinity mask
-
-    // if the last cpu it ran on is in the affinity mask and not the current cpu, pick that
-    if ((last_ran_cpu_mask & cpu_affinity & active_cpu_mask) &&
-        last_ran_cpu_mask != curr_cpu_mask) {
-        return last_ran_cpu_mask;
-    }
-
-    // fall back to picking a cpu out of the affinity mask, preferring something other
-    // than the local cpu.
+    // no idle cpus in our affinity mask, so pick the one with the least queued work.
     // the affinity mask hard pins the thread to the cpus in the mask, so it's not possible
     // to pick a cpu outside of that list.
-    cpu_mask_t mask = cpu_affinity & ~(curr_cpu_mask);
-    if (mask == 0) {
-        return curr_cpu_mask; // local cpu is the only choice
-    }
-
-    mask = rand_cpu(mask);
+    cpu_mask_t mask = least_loaded_cpu(cpu_affinity & active_cpu_mask, t->last_cpu,
+                                       arch_curr_cpu_num());
     if (mask == 0) {
         return curr_cpu_mask; // local cpu is the only choice
     }
@@ -213,42 +347,68 @@ static cpu_mask_t find_cpu_mask(thread_t* t) TA_REQ(thread_lock) {
 }
 
 // run queue manipulation
-static void insert_in_run_queue_head(cpu_num_t cpu, thread_t* t) TA_REQ(thread_lock) {
+static void run_queue_add(struct percpu* c, thread_t* t, bool head) TA_REQ(thread_lock) {
     DEBUG_ASSERT(!list_in_list(&t->queue_node));
 
-    list_add_head(&percpu[cpu].run_queue[t->effec_priority], &t->queue_node);
-    percpu[cpu].run_queue_bitmap |= (1u << t->effec_priority);
+    if (unlikely(thread_is_deadline(t))) {
+        deadline_replenish(t, current_time());
+        if (t->deadline_budget > 0) {
+            // keep the queue sorted by deadline, with |head| deciding which side of any
+            // equal deadlines the thread lands on
+            thread_t* entry;
+            list_for_every_entry (&c->deadline_run_queue, entry, thread_t, queue_node) {
+                if (head ? entry->deadline_abs >= t->deadline_abs
+                         : entry->deadline_abs > t->deadline_abs) {
+                    list_add_before(&entry->queue_node, &t->queue_node);
+                    c->run_queue_len++;
+                    return;
+                }
+            }
+            list_add_tail(&c->deadline_run_queue, &t->queue_node);
+            c->run_queue_len++;
+            return;
+        }
+    }
 
-    // mark the cpu as busy since the run queue now has at least one item in it
-    mp_set_cpu_busy(cpu);
+    if (head) {
+        list_add_head(&c->run_queue[t->effec_priority], &t->queue_node);
+    } else {
+        list_add_tail(&c->run_queue[t->effec_priority], &t->queue_node);
+    }
+    c->run_queue_bitmap |= (1u << t->effec_priority);
+    c->run_queue_len++;
 }
 
-static void insert_in_run_queue_tail(cpu_num_t cpu, thread_t* t) TA_REQ(thread_lock) {
-    DEBUG_ASSERT(!list_in_list(&t->queue_node));
+static void run_queue_remove(struct percpu* c, thread_t* t, int prio_queue) TA_REQ(thread_lock) {
+    list_delete(&t->queue_node);
+    c->run_queue_len--;
 
-    list_add_tail(&percpu[cpu].run_queue[t->effec_priority], &t->queue_node);
-    percpu[cpu].run_queue_bitmap |= (1u << t->effec_priority);
+    if (deadline_runnable(t)) {
+        return;
+    }
+
+    // clear the queue bitmap if that was the last entry
+    if (list_is_empty(&c->run_queue[prio_queue])) {
+        c->run_queue_bitmap &= ~(1u << prio_queue);
+    }
+}
+
+static void insert_in_run_queue_head(cpu_num_t cpu, thread_t* t) TA_REQ(thread_lock) {
+    run_queue_add(&percpu[cpu], t, true);
 
     // mark the cpu as busy since the run queue now has at least one item in it
     mp_set_cpu_busy(cpu);
 }
 
-// remove the thread from the run queue it's in
-static void remove_from_run_queue(thread_t* t, int prio_queue) TA_REQ(thread_lock) {
-    DEBUG_ASSERT(t->state == THREAD_READY);
-    DEBUG_ASSERT(is_valid_cpu_num(t->curr_cpu));
-
-    list_delete(&t->queue_node);
+static void insert_in_run_queue_tail(cpu_num_t cpu, thread_t* t) TA_REQ(thread_lock) {
+    run_queue_add(&percpu[cpu], t, false);
 
-    // clear the old cpu's queue bitmap if that was the last entry
-    struct percpu* c = &percpu[t->curr_cpu];
-    if (list_is_empty(&c->run_queue[prio_queue])) {
-        c->run_queue_bitmap &= ~(1u << prio_queue);
-    }
+    // mark the cpu as busy since the run queue now has at least one item in it
+    mp_set_cpu_busy(cpu);
 }
 
 // using the per cpu run queue bitmap, find the highest populated queue
-static uint highest_run_queue(const struct percpu* c) TA_REQ(thread_lock) {
+static uint highest_run_queue(const struct percpu* c) {
     return HIGHEST_PRIORITY - __builtin_clz(c->run_queue_bitmap) -
            (sizeof(c->run_queue_bitmap) * CHAR_BIT - NUM_PRIORITIES);
 }
@@ -258,10 +418,30 @@ static thread_t* sched_get_top_thread(cpu_num_t cpu) TA_REQ(thread_lock) {
     // queued up on the passed in cpu.
 
     struct percpu* c = &percpu[cpu];
+
+    // deadline threads with budget left go ahead of everything else, earliest deadline first,
+    // except that they don't take the cpu away from a real time thread that still wants it
+    thread_t* current_thread = get_current_thread();
+    bool keep_real_time = cpu == arch_curr_cpu_num() && current_thread->state == THREAD_READY &&
+                          (current_thread->flags & THREAD_FLAG_REAL_TIME);
+    thread_t* newthread = nullptr;
+    if (likely(!keep_real_time)) {
+        newthread = list_remove_head_type(&c->deadline_run_queue, thread_t, queue_node);
+    }
+    if (unlikely(newthread != nullptr)) {
+        c->run_queue_len--;
+
+        DEBUG_ASSERT(newthread->curr_cpu == cpu);
+        LOCAL_KTRACE2("sched_get_top_deadline", (uint32_t)newthread->user_tid,
+                      (uint32_t)newthread->deadline_budget);
+        return newthread;
+    }
+
     if (likely(c->run_queue_bitmap)) {
         uint highest_queue = highest_run_queue(c);
 
-        thread_t* newthread = list_remove_head_type(&c->run_queue[highest_queue], thread_t, queue_node);
+        newthread = list_remove_head_type(&c->run_queue[highest_queue], thread_t, queue_node);
+        c->run_queue_len--;
 
         DEBUG_ASSERT(newthread);
         DEBUG_ASSERT_MSG(newthread->cpu_affinity & cpu_num_to_mask(cpu),
@@ -282,6 +462,86 @@ static thread_t* sched_get_top_thread(cpu_num_t cpu) TA_REQ(thread_lock) {
     return &c->idle_thread;
 }
 
+// returns the cpu in |mask| with the most threads waiting in its run queue, or INVALID_CPU
+// if none of them have more than one
+static cpu_num_t busiest_cpu_in(cpu_mask_t mask) TA_REQ(thread_lock) {
+    cpu_num_t busiest_cpu = INVALID_CPU;
+    // a cpu with a single waiting thread will get to it soon enough, and taking it would
+    // only move the wait (and the cache misses) here
+    uint32_t busiest_len = 1;
+
+    while (mask != 0) {
+        cpu_num_t i = lowest_cpu_set(mask);
+        mask &= ~cpu_num_to_mask(i);
+
+        uint32_t len = __atomic_load_n(&percpu[i].run_queue_len, __ATOMIC_RELAXED);
+        if (len > busiest_len) {
+            busiest_len = len;
+            busiest_cpu = i;
+        }
+    }
+    return busiest_cpu;
+}
+
+// called when |cpu| has nothing left to run: look for the cpu with the most threads waiting
+// and pull one that's allowed to run here off its run queue.
+// returns null if there was nothing worth stealing.
+static thread_t* sched_steal_thread(cpu_num_t cpu) TA_REQ(thread_lock) {
+    // look within our own cluster first so stolen threads keep their cache warm
+    const cpu_mask_t candidates = mp_get_active_mask() & ~cpu_num_to_mask(cpu);
+    cpu_num_t busiest_cpu = busiest_cpu_in(candidates & cluster_mask(cpu));
+    if (busiest_cpu == INVALID_CPU) {
+        busiest_cpu = busiest_cpu_in(candidates & ~cluster_mask(cpu));
+    }
+    if (busiest_cpu == INVALID_CPU) {
+        return nullptr;
+    }
+
+    struct percpu* c = &percpu[busiest_cpu];
+    cpu_mask_t cpu_mask = cpu_num_to_mask(cpu);
+    thread_t* stolen = nullptr;
+
+    // a deadline thread waiting behind another is the most urgent thing to take, so look
+    // there first, earliest deadline first
+    thread_t* t;
+    list_for_every_entry (&c->deadline_run_queue, t, thread_t, queue_node) {
+        if (t->cpu_affinity & cpu_mask) {
+            list_delete(&t->queue_node);
+            c->run_queue_len--;
+            stolen = t;
+            break;
+        }
+    }
+
+    uint32_t bitmap = (stolen == nullptr) ? c->run_queue_bitmap : 0;
+    while (bitmap != 0 && stolen == nullptr) {
+        int prio = HIGHEST_PRIORITY - __builtin_clz(bitmap) -
+                   static_cast<int>(sizeof(bitmap) * CHAR_BIT - NUM_PRIORITIES);
+        bitmap &= ~(1u << prio);
+
+        // walk from the tail, those threads have the longest wait ahead of them on that cpu
+        t = list_peek_tail_type(&c->run_queue[prio], thread_t, queue_node);
+        while (t != nullptr) {
+            if ((t->cpu_affinity & cpu_mask) && !thread_is_idle(t)) {
+                run_queue_remove(c, t, prio);
+                stolen = t;
+                break;
+            }
+            t = list_prev_type(&c->run_queue[prio], &t->queue_node, thread_t, queue_node);
+        }
+    }
+
+    if (stolen != nullptr) {
+        DEBUG_ASSERT(stolen->state == THREAD_READY);
+        DEBUG_ASSERT(stolen->curr_cpu == busiest_cpu);
+        stolen->curr_cpu = cpu;
+        mp_set_cpu_busy(cpu);
+        kcounter_add(sched_steal_count, 1);
+        LOCAL_KTRACE2("sched_steal", (uint32_t)stolen->user_tid, busiest_cpu);
+    }
+    return stolen;
+}
+
 void sched_init_thread(thread_t* t, int priority) {
     t->base_priority = priority;
     t->priority_boost = 0;
@@ -303,10 +563,10 @@ void sched_block() {
     sched_resched_internal();
 }
 
-// find a cpu to run the thread on, put it in the run queue for that cpu, and accumulate a list
-// of cpus we'll need to reschedule, including the local cpu.
-static void find_cpu_and_insert(thread_t* t, bool* local_resched,
-                                cpu_mask_t* accum_cpu_mask) TA_REQ(thread_lock) {
+// find a cpu to run the thread on and accumulate a list of cpus we'll need to reschedule,
+// including the local cpu.
+static cpu_num_t find_cpu(thread_t* t, bool* local_resched,
+                          cpu_mask_t* accum_cpu_mask) TA_REQ(thread_lock) {
     // find a core to run it on
     cpu_mask_t cpu = find_cpu_mask(t);
     cpu_num_t cpu_num;
@@ -320,6 +580,19 @@ static void find_cpu_and_insert(thread_t* t, bool* local_resched,
         *accum_cpu_mask |= cpu_num_to_mask(cpu_num);
     }
 
+    return cpu_num;
+}
+
+// find a cpu to run the thread on, put it in the run queue for that cpu, and accumulate a list
+// of cpus we'll need to reschedule, including the local cpu.
+static void find_cpu_and_insert(thread_t* t, bool* local_resched,
+                                cpu_mask_t* accum_cpu_mask) TA_REQ(thread_lock) {
+    cpu_num_t cpu_num = find_cpu(t, local_resched, accum_cpu_mask);
+
+    if (t->last_cpu != INVALID_CPU && t->last_cpu != cpu_num) {
+        kcounter_add(sched_migrate_count, 1);
+    }
+
     t->curr_cpu = cpu_num;
     if (t->remaining_time_slice > 0) {
         insert_in_run_queue_head(cpu_num, t);
@@ -404,6 +677,8 @@ void sched_yield() {
 
     LOCAL_KTRACE0("sched_yield");
 
+    charge_current_thread(current_thread);
+
     // consume the rest of the time slice, deboost ourself, and go to the end of a queue
     current_thread->remaining_time_slice = 0;
     deboost_thread(current_thread, false);
@@ -429,6 +704,7 @@ void sched_preempt() {
     DEBUG_ASSERT(current_thread->last_cpu == current_thread->curr_cpu);
     LOCAL_KTRACE0("sched_preempt");
 
+    charge_current_thread(current_thread);
     current_thread->state = THREAD_READY;
 
     // idle thread doesn't go in the run queue
@@ -468,6 +744,7 @@ void sched_reschedule() {
     DEBUG_ASSERT(current_thread->last_cpu == current_thread->curr_cpu);
     LOCAL_KTRACE0("sched_reschedule");
 
+    charge_current_thread(current_thread);
     current_thread->state = THREAD_READY;
 
     // idle thread doesn't go in the run queue
@@ -496,6 +773,9 @@ static void migrate_current_thread(thread_t* current_thread) TA_REQ(thread_lock)
     cpu_mask_t accum_cpu_mask = 0;
 
     // current thread, so just shove ourself into another cpu's queue and reschedule locally
+    if (current_thread->state != THREAD_READY) {
+        charge_current_thread(current_thread);
+    }
     current_thread->state = THREAD_READY;
     find_cpu_and_insert(current_thread, &local_resched, &accum_cpu_mask);
     if (accum_cpu_mask) {
@@ -590,9 +870,19 @@ void sched_migrate(thread_t* t) {
 
         // it's sitting in a run queue somewhere, so pull it out of that one and find a new home
         DEBUG_ASSERT_MSG(list_in_list(&t->queue_node), "thread %p name %s curr_cpu %u\n", t, t->name, t->curr_cpu);
-        remove_from_run_queue(t, t->effec_priority);
+        {
+            cpu_num_t old_cpu = t->curr_cpu;
+            cpu_num_t new_cpu = find_cpu(t, &local_resched, &accum_cpu_mask);
+            if (new_cpu != old_cpu) {
+                kcounter_add(sched_migrate_count, 1);
+            }
 
-        find_cpu_and_insert(t, &local_resched, &accum_cpu_mask);
+            run_queue_remove(&percpu[old_cpu], t, t->effec_priority);
+            t->curr_cpu = new_cpu;
+            run_queue_add(&percpu[new_cpu], t, t->remaining_time_slice > 0);
+
+            mp_set_cpu_busy(new_cpu);
+        }
         break;
     default:
         // the other states do not matter, exit
@@ -627,20 +917,21 @@ static void sched_priority_changed(thread_t* t, int old_prio,
     case THREAD_READY:
         // it's sitting in a run queue somewhere, remove and add back to the proper queue on that cpu
         DEBUG_ASSERT_MSG(list_in_list(&t->queue_node), "thread %p name %s curr_cpu %u\n", t, t->name, t->curr_cpu);
-        remove_from_run_queue(t, old_prio);
+        {
+            struct percpu* c = &percpu[t->curr_cpu];
 
-        // insert ourself into the new queue
-        if (t->effec_priority > old_prio) {
-            insert_in_run_queue_head(t->curr_cpu, t);
+            run_queue_remove(c, t, old_prio);
+            // boosted threads go to the head of their new queue, deboosted ones to the tail
+            run_queue_add(c, t, t->effec_priority > old_prio);
+        }
 
+        if (t->effec_priority > old_prio) {
             // we may now be higher priority than the current thread on this cpu, reschedule
             if (t->curr_cpu == arch_curr_cpu_num()) {
                 *local_resched = true;
             } else {
                 *accum_cpu_mask |= cpu_num_to_mask(t->curr_cpu);
             }
-        } else {
-            insert_in_run_queue_tail(t->curr_cpu, t);
         }
 
         break;
@@ -731,17 +1022,138 @@ void sched_change_priority(thread_t* t, int pri) {
     }
 }
 
+zx_status_t sched_change_deadline(thread_t* t, zx_duration_t capacity, zx_duration_t deadline,
+                                  zx_duration_t period) {
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+
+    if (unlikely(t->state == THREAD_DEATH)) {
+        return ZX_ERR_BAD_STATE;
+    }
+
+    // nothing to do for a thread that is staying out of deadline scheduling
+    if (period == 0 && !thread_is_deadline(t)) {
+        return ZX_OK;
+    }
+
+    // swap the thread's old share of the cpus for the new one, if there's room for it
+    const uint64_t total_share = deadline_total_share -
+                                 deadline_share(t->deadline_capacity, t->deadline_period) +
+                                 deadline_share(capacity, period);
+    const uint64_t available = __builtin_popcount(mp_get_active_mask()) * kDeadlineShareScale;
+    if (total_share > available) {
+        return ZX_ERR_NO_RESOURCES;
+    }
+    deadline_total_share = total_share;
+
+    // the new parameters start a new period, so any pending replenish is moot
+    timer_cancel(&t->deadline_timer);
+
+    // take the thread off its run queue while the parameters change, since they decide
+    // which queue it belongs in
+    struct percpu* c = (t->state == THREAD_READY) ? &percpu[t->curr_cpu] : nullptr;
+    if (c != nullptr) {
+        run_queue_remove(c, t, t->effec_priority);
+    }
+
+    // start a fresh period with the full capacity
+    zx_time_t now = current_time();
+    t->deadline_capacity = capacity;
+    t->deadline_relative = deadline;
+    t->deadline_period = period;
+    t->deadline_period_start = now;
+    t->deadline_abs = zx_time_add_duration(now, deadline);
+    t->deadline_budget = (period != 0) ? capacity : 0;
+    t->deadline_charged_to = now;
+
+    if (c != nullptr) {
+        run_queue_add(c, t, false);
+    }
+
+    // let the thread's cpu reconsider what it should be running
+    bool local_resched = false;
+    cpu_mask_t accum_cpu_mask = 0;
+    if (t->state == THREAD_READY || t->state == THREAD_RUNNING) {
+        if (t->curr_cpu == arch_curr_cpu_num()) {
+            local_resched = true;
+        } else {
+            accum_cpu_mask = cpu_num_to_mask(t->curr_cpu);
+        }
+    }
+
+    if (accum_cpu_mask) {
+        mp_reschedule(accum_cpu_mask, 0);
+    }
+    if (local_resched) {
+        sched_reschedule();
+    }
+    return ZX_OK;
+}
+
+// hands a throttled deadline thread its next budget once its period is over
+static void deadline_replenish_handler(timer_t* timer, zx_time_t now, void* arg) {
+    thread_t* t = static_cast<thread_t*>(arg);
+
+    DEBUG_ASSERT(t->magic == THREAD_MAGIC);
+
+    // sched_change_deadline and thread exit cancel this timer while holding the thread_lock
+    if (timer_trylock_or_cancel(timer, &thread_lock)) {
+        return;
+    }
+
+    // a blocked thread picks up its budget when it wakes up
+    if (deadline_runnable(t) || (t->state != THREAD_READY && t->state != THREAD_RUNNING)) {
+        spin_unlock(&thread_lock);
+        return;
+    }
+
+    // requeueing a waiting thread replenishes it and moves it to the deadline run queue. a
+    // running one is replenished when its cpu reschedules and puts it back in a run queue.
+    if (t->state == THREAD_READY) {
+        struct percpu* c = &percpu[t->curr_cpu];
+        run_queue_remove(c, t, t->effec_priority);
+        run_queue_add(c, t, false);
+    }
+
+    if (t->curr_cpu == arch_curr_cpu_num()) {
+        sched_reschedule();
+    } else {
+        mp_reschedule(cpu_num_to_mask(t->curr_cpu), 0);
+    }
+
+    spin_unlock(&thread_lock);
+}
+
 // preemption timer that is set whenever a thread is scheduled
 void sched_preempt_timer_tick(zx_time_t now) {
-    // if the preemption timer went off on the idle or a real time thread, ignore it
     thread_t* current_thread = get_current_thread();
-    if (unlikely(thread_is_real_time_or_idle(current_thread))) {
-        return;
-    }
 
     LOCAL_KTRACE2("sched_preempt_timer_tick", (uint32_t)current_thread->user_tid,
                   current_thread->remaining_time_slice);
 
+    // a deadline thread that has spent its budget drops back to its priority until its
+    // next period, which may mean giving way to other threads. this applies to real
+    // time threads too, so it has to come before they are let off below.
+    if (unlikely(deadline_runnable(current_thread))) {
+        {
+            Guard<spin_lock_t, NoIrqSave> guard{ThreadLock::Get()};
+            deadline_charge(current_thread, now);
+        }
+        if (current_thread->deadline_budget == 0) {
+            kcounter_add(sched_deadline_throttle_count, 1);
+            timer_preempt_reset(zx_time_add_duration(now, THREAD_INITIAL_TIME_SLICE));
+            thread_preempt_set_pending();
+            return;
+        }
+    }
+
+    // otherwise, if the preemption timer went off on the idle or a real time thread, ignore it
+    if (unlikely(thread_is_real_time_or_idle(current_thread))) {
+        if (deadline_runnable(current_thread)) {
+            timer_preempt_reset(zx_time_add_duration(now, current_thread->deadline_budget));
+        }
+        return;
+    }
+
     // did this tick complete the time slice?
     DEBUG_ASSERT(now > current_thread->last_started_running);
     zx_duration_t delta = zx_time_sub_time(now, current_thread->last_started_running);
@@ -759,6 +1171,9 @@ void sched_preempt_timer_tick(zx_time_t now) {
         // the timer tick must have fired early, reschedule and continue
         zx_time_t deadline = zx_time_add_duration(current_thread->last_started_running,
                                                   current_thread->remaining_time_slice);
+        if (deadline_runnable(current_thread)) {
+            deadline = MIN(deadline, zx_time_add_duration(now, current_thread->deadline_budget));
+        }
         timer_preempt_reset(deadline);
     }
 }
@@ -787,9 +1202,30 @@ void sched_resched_internal() {
 
     CPU_STATS_INC(reschedules);
 
+    // a thread that is blocking or exiting hasn't been charged for its time yet
+    if (current_thread->state != THREAD_READY) {
+        charge_current_thread(current_thread);
+    }
+
+    // an exiting deadline thread gives back its share of the cpus
+    if (unlikely(current_thread->state == THREAD_DEATH && thread_is_deadline(current_thread))) {
+        timer_cancel(&current_thread->deadline_timer);
+        deadline_total_share -= deadline_share(current_thread->deadline_capacity,
+                                               current_thread->deadline_period);
+        current_thread->deadline_period = 0;
+    }
+
     // pick a new thread to run
     thread_t* newthread = sched_get_top_thread(cpu);
 
+    // rather than going idle, see if another cpu has work queued up that we could be doing
+    if (thread_is_idle(newthread) && mp_is_cpu_active(cpu)) {
+        thread_t* stolen = sched_steal_thread(cpu);
+        if (stolen != nullptr) {
+            newthread = stolen;
+        }
+    }
+
     DEBUG_ASSERT(newthread);
 
     newthread->state = THREAD_RUNNING;
@@ -831,6 +1267,7 @@ void sched_resched_internal() {
     }
     newthread->last_cpu = cpu;
     newthread->curr_cpu = cpu;
+    percpu[cpu].running_thread = newthread;
 
     // if we selected the idle thread the cpu's run queue must be empty, so mark the
     // cpu as idle
@@ -859,10 +1296,13 @@ void sched_resched_internal() {
             (oldthread->effec_priority << 16) | (newthread->effec_priority << 24)),
            (uint32_t)(uintptr_t)oldthread, (uint32_t)(uintptr_t)newthread);
 
-    if (thread_is_real_time_or_idle(newthread)) {
-        if (!thread_is_real_time_or_idle(oldthread)) {
-            // if we're switching from a non real time to a real time, cancel
-            // the preemption timer.
+    if (thread_is_real_time_or_idle(newthread) && deadline_runnable(newthread)) {
+        // a real time deadline thread still has to be stopped when its budget runs out
+        timer_preempt_reset(zx_time_add_duration(now, newthread->deadline_budget));
+    } else if (thread_is_real_time_or_idle(newthread)) {
+        if (!thread_is_real_time_or_idle(oldthread) || thread_is_deadline(oldthread)) {
+            // if we're switching from a thread that had the preemption timer armed
+            // to a real time one, cancel it.
             TRACE_CONTEXT_SWITCH("stop preempt, cpu %u, old %p (%s), new %p (%s)\n",
                                  cpu, oldthread, oldthread->name, newthread, newthread->name);
             timer_preempt_cancel();
@@ -875,7 +1315,12 @@ void sched_resched_internal() {
         // make sure the time slice is reasonable
         DEBUG_ASSERT(newthread->remaining_time_slice > 0 && newthread->remaining_time_slice < ZX_SEC(1));
 
-        timer_preempt_reset(zx_time_add_duration(now, newthread->remaining_time_slice));
+        // deadline threads are also stopped when their budget for this period runs out
+        zx_duration_t slice = newthread->remaining_time_slice;
+        if (deadline_runnable(newthread)) {
+            slice = MIN(slice, newthread->deadline_budget);
+        }
+        timer_preempt_reset(zx_time_add_duration(now, slice));
     }
 
     // set some optional target debug leds
@@ -900,8 +1345,55 @@ void sched_resched_internal() {
 
 void sched_init_early() {
     // initialize the run queues
-    for (unsigned int cpu = 0; cpu < SMP_MAX_CPUS; cpu++)
+    for (unsigned int cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        percpu[cpu].cluster_mask = CPU_MASK_ALL;
         for (unsigned int i = 0; i < NUM_PRIORITIES; i++) {
             list_initialize(&percpu[cpu].run_queue[i]);
         }
+        list_initialize(&percpu[cpu].deadline_run_queue);
+    }
+}
+
+// once the platform has published the system topology, record which cpus share a cluster
+// or cache with each other so placement and stealing can favor them
+static void sched_init_topology(uint level) {
+    cpu_mask_t masks[SMP_MAX_CPUS] = {};
+
+    for (const system_topology::Node* processor :
+         system_topology::GetSystemTopology().processors()) {
+        // the processor's parent is the closest cluster or cache it belongs to, so its
+        // siblings are every processor under that parent
+        const system_topology::Node* parent = processor->parent;
+        if (parent == nullptr) {
+            continue;
+        }
+
+        cpu_mask_t mask = 0;
+        for (const system_topology::Node* sibling : parent->children) {
+            if (sibling->entity_type != ZBI_TOPOLOGY_ENTITY_PROCESSOR) {
+                continue;
+            }
+            for (int i = 0; i < sibling->entity.processor.logical_id_count; i++) {
+                cpu_num_t cpu = sibling->entity.processor.logical_ids[i];
+                if (is_valid_cpu_num(cpu)) {
+                    mask |= cpu_num_to_mask(cpu);
+                }
+            }
+        }
+        for (int i = 0; i < processor->entity.processor.logical_id_count; i++) {
+            cpu_num_t cpu = processor->entity.processor.logical_ids[i];
+            if (is_valid_cpu_num(cpu)) {
+                masks[cpu] = mask;
+            }
+        }
+    }
+
+    Guard<spin_lock_t, IrqSave> guard{ThreadLock::Get()};
+    for (cpu_num_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        if (masks[cpu] != 0) {
+            percpu[cpu].cluster_mask = masks[cpu];
+        }
+    }
 }
+
+LK_INIT_HOOK(sched_topology, sched_init_topology, LK_INIT_LEVEL_PLATFORM);
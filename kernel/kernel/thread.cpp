@@ -88,6 +88,7 @@ static void init_thread_struct(thread_t* t, const char* name) {
     t->magic = THREAD_MAGIC;
     strlcpy(t->name, name, sizeof(t->name));
     wait_queue_init(&t->retcode_wait_queue);
+    timer_init(&t->deadline_timer);
     init_thread_lock_state(t);
 }
 
@@ -530,6 +531,9 @@ void thread_forget(thread_t* t) {
         __UNUSED thread_t* current_thread = get_current_thread();
         DEBUG_ASSERT(current_thread != t);
 
+        // a thread given deadline parameters before it ever ran still holds a share of the cpus
+        sched_change_deadline(t, 0, 0, 0);
+
         list_delete(&t->thread_list_node);
     }
 
@@ -982,6 +986,7 @@ void thread_construct_first(thread_t* t, const char* name) {
 
     arch_thread_construct_first(t);
     set_current_thread(t);
+    percpu[cpu].running_thread = t;
 
     Guard<spin_lock_t, IrqSave> guard{ThreadLock::Get()};
     list_add_head(&thread_list, &t->thread_list_node);
@@ -1047,6 +1052,31 @@ void thread_set_priority(thread_t* t, int priority) {
     sched_change_priority(t, priority);
 }
 
+/**
+ * @brief  Set the deadline scheduling parameters of a thread
+ *
+ * The thread is guaranteed |capacity| of cpu time every |period|, completed within
+ * |deadline| of the start of the period, ahead of any priority scheduled thread.
+ * Passing a zero |period| returns the thread to priority scheduling.
+ *
+ * @param t  Thread to adjust
+ * @param capacity  Cpu time granted each period
+ * @param deadline  Time from the start of each period by which |capacity| is due
+ * @param period  Length of each period
+ *
+ * @return ZX_ERR_NO_RESOURCES if the cpus can't provide the capacity on top of what
+ * the other deadline threads already have.
+ */
+zx_status_t thread_set_deadline(thread_t* t, zx_duration_t capacity, zx_duration_t deadline,
+                                zx_duration_t period) {
+    DEBUG_ASSERT(t->magic == THREAD_MAGIC);
+    DEBUG_ASSERT(period == 0 || (capacity > 0 && capacity <= deadline && deadline <= period));
+
+    Guard<spin_lock_t, IrqSave> guard{ThreadLock::Get()};
+
+    return sched_change_deadline(t, capacity, deadline, period);
+}
+
 /**
  * @brief  Become an idle thread
  *
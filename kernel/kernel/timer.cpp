@@ -60,6 +60,49 @@ namespace {
 spin_lock_t timer_lock __CPU_ALIGN_EXCLUSIVE = SPIN_LOCK_INITIAL_VALUE;
 DECLARE_SINGLETON_LOCK_WRAPPER(TimerLock, timer_lock);
 
+// Timers are kept in a tree ordered by scheduled_time, so that setting, canceling and
+// finding a timer's neighbors for coalescing are all O(log n). Timers coalesced onto
+// the same scheduled_time are ordered by queue_seq, the order they were queued in.
+struct TimerKey {
+    zx_time_t scheduled_time;
+    uint64_t seq;
+};
+
+struct TimerKeyTraits {
+    static TimerKey GetKey(const timer_t& timer) {
+        return {timer.scheduled_time, timer.queue_seq};
+    }
+    static bool LessThan(const TimerKey& a, const TimerKey& b) {
+        return a.scheduled_time < b.scheduled_time ||
+               (a.scheduled_time == b.scheduled_time && a.seq < b.seq);
+    }
+    static bool EqualTo(const TimerKey& a, const TimerKey& b) {
+        return a.scheduled_time == b.scheduled_time && a.seq == b.seq;
+    }
+};
+
+struct TimerNodeTraits {
+    static fbl::WAVLTreeNodeState<timer_t*>& node_state(timer_t& timer) {
+        return timer.node;
+    }
+};
+
+using TimerTree = fbl::WAVLTree<TimerKey, timer_t*, TimerKeyTraits, TimerNodeTraits>;
+
+struct TimerQueue {
+    TimerTree timers;
+    uint64_t next_seq = 0;
+} __CPU_ALIGN;
+
+// per cpu timer queues, guarded by timer_lock
+TimerQueue timer_queues[SMP_MAX_CPUS];
+
+// Returns the timer at the head of |cpu|'s queue, or nullptr if it is empty.
+timer_t* timer_queue_head(uint cpu) TA_REQ(TimerLock::Get()) {
+    TimerTree& timers = timer_queues[cpu].timers;
+    return timers.is_empty() ? nullptr : &timers.front();
+}
+
 } // anonymous namespace
 
 void timer_init(timer_t* timer) {
@@ -82,118 +125,72 @@ static void update_platform_timer(uint cpu, zx_time_t new_deadline) {
 }
 
 static void insert_timer_in_queue(uint cpu, timer_t* timer,
-                                  zx_time_t earliest_deadline, zx_time_t latest_deadline) {
+                                  zx_time_t earliest_deadline, zx_time_t latest_deadline)
+    TA_REQ(TimerLock::Get()) {
 
     DEBUG_ASSERT(arch_ints_disabled());
     LTRACEF("timer %p, cpu %u, scheduled %" PRIi64 "\n", timer, cpu, timer->scheduled_time);
 
-    // For inserting the timer we consider several cases. In general we
-    // want to coalesce with the current timer unless we can prove that
-    // either that:
-    //  1- there is no slack overlap with current timer OR
-    //  2- the next timer is a better fit.
+    TimerQueue& queue = timer_queues[cpu];
+
+    // In general we want to coalesce with an existing timer unless we can prove
+    // that either:
+    //  1- there is no slack overlap with it OR
+    //  2- another timer is a better fit.
     //
-    // In diagrams that follow
-    // - Let |e| be the current (existing) timer deadline
+    // Only the two timers either side of the new one can be the best fit, so
+    // those are the only ones considered. In diagrams that follow
     // - Let |t| be the deadline of the timer we are inserting
-    // - Let |n| be the next timer deadline if any
-    // - Let |x| be the end of the list (not a timer)
+    // - Let |p| be the deadline of the latest timer before |t|, if any
+    // - Let |n| be the deadline of the earliest timer at or after |t|, if any
     // - Let |(| and |)| the earliest_deadline and latest_deadline.
     //
-    timer_t* entry;
-
-    list_for_every_entry (&percpu[cpu].timer_queue, entry, timer_t, node) {
-        if (entry->scheduled_time > latest_deadline) {
-            // New timer latest is earlier than the current timer.
-            // Just add upfront as is, without slack.
-            //
-            //   ---------t---)--e-------------------------------> time
-            //
-            timer->slack = 0ll;
-            list_add_before(&entry->node, &timer->node);
-            return;
-        }
-
-        if (entry->scheduled_time >= timer->scheduled_time) {
-            //  New timer slack overlaps and is to the left (or equal). We
-            //  coalesce with current by scheduling late.
-            //
-            //  --------(----t---e-)----------------------------> time
-            //
-            timer->slack = zx_time_sub_time(entry->scheduled_time, timer->scheduled_time);
-            timer->scheduled_time = entry->scheduled_time;
-            kcounter_add(timer_coalesced_counter, 1);
-            list_add_after(&entry->node, &timer->node);
-            return;
-        }
-
-        if (entry->scheduled_time < earliest_deadline) {
-            // new timer earliest is later than the current timer. This case
-            // is handled in a future iteration.
-            //
-            //   ----------------e--(---t-----------------------> time
-            //
-            continue;
-        }
-
-        // New timer is to the right of current timer and there is overlap
-        // with the current timer, but could the next timer (if any) be
-        // a better fit?
+    const zx_time_t deadline = timer->scheduled_time;
+    auto next = queue.timers.lower_bound({deadline, 0});
+    auto prev = next;
+    --prev;
+
+    const timer_t* target = nullptr;
+    if (prev.IsValid() && prev->scheduled_time >= earliest_deadline) {
+        // There is overlap with the previous timer, so coalesce by scheduling
+        // early, unless the next timer is a better fit. It is if it is exactly
+        // on the deadline, or there is overlap with it and it is closer.
         //
-        //  -------------(--e---t-----?-------------------> time
+        //  --------------(-p---t---n-)-----------------------> time
         //
-
-        const timer_t* next =
-            list_next_type(&percpu[cpu].timer_queue, &entry->node, timer_t, node);
-
-        if (next != NULL) {
-            if (next->scheduled_time <= timer->scheduled_time) {
-                // The new timer is to the right of the next timer. There is no
-                // chance the current timer is a better fit.
-                //
-                //  -------------(--e---n---t----------------------> time
-                //
-                continue;
-            }
-
-            if (next->scheduled_time < latest_deadline) {
-                // There is slack overlap with the next timer, and also with the
-                // current timer. Which coalescing is a better match?
-                //
-                //  --------------(-e---t---n-)-----------------------> time
-                //
-                zx_duration_t delta_entry =
-                    zx_time_sub_time(timer->scheduled_time, entry->scheduled_time);
-                zx_duration_t delta_next =
-                    zx_time_sub_time(next->scheduled_time, timer->scheduled_time);
-                if (delta_next < delta_entry) {
-                    // New timer is closer to the next timer, handle it in the
-                    // next iteration.
-                    continue;
-                }
+        target = &*prev;
+        if (next.IsValid() &&
+            (next->scheduled_time == deadline || next->scheduled_time < latest_deadline)) {
+            zx_duration_t delta_prev = zx_time_sub_time(deadline, prev->scheduled_time);
+            zx_duration_t delta_next = zx_time_sub_time(next->scheduled_time, deadline);
+            if (delta_next < delta_prev) {
+                target = &*next;
             }
         }
-
-        // Handles the remaining cases, note that there is overlap with
-        // the current timer.
-        //
-        //  1- this is the last timer (next == NULL) or
-        //  2- there is no overlap with the next timer, or
-        //  3- there is overlap with both current and next but
-        //     current is closer.
+    } else if (next.IsValid() && next->scheduled_time <= latest_deadline) {
+        // New timer slack overlaps only with the next timer. We coalesce with it
+        // by scheduling late.
         //
-        //  So we coalesce by scheduling early.
+        //  ------p-(----t---n-)----------------------------> time
         //
-        timer->slack = zx_time_sub_time(entry->scheduled_time, timer->scheduled_time);
-        timer->scheduled_time = entry->scheduled_time;
+        target = &*next;
+    }
+
+    if (target != nullptr) {
+        timer->slack = zx_time_sub_time(target->scheduled_time, deadline);
+        timer->scheduled_time = target->scheduled_time;
         kcounter_add(timer_coalesced_counter, 1);
-        list_add_after(&entry->node, &timer->node);
-        return;
+    } else {
+        // No overlap with either neighbor. Just add as is, without slack.
+        //
+        //   ------p--(--t--)--n-----------------------------> time
+        //
+        timer->slack = 0;
     }
 
-    // Walked off the end of the list and there was no overlap.
-    timer->slack = 0;
-    list_add_tail(&percpu[cpu].timer_queue, &timer->node);
+    timer->queue_seq = queue.next_seq++;
+    timer->queue_cpu = cpu;
+    queue.timers.insert(timer);
 }
 
 void timer_set(timer_t* timer, zx_time_t deadline, TimerSlack slack,
@@ -206,7 +203,7 @@ void timer_set(timer_t* timer, zx_time_t deadline, TimerSlack slack,
     DEBUG_ASSERT(slack.mode() <= TIMER_SLACK_EARLY);
     DEBUG_ASSERT(slack.amount() >= 0);
 
-    if (list_in_list(&timer->node)) {
+    if (timer->node.InContainer()) {
         panic("timer %p already in list\n", timer);
     }
 
@@ -261,7 +258,7 @@ void timer_set(timer_t* timer, zx_time_t deadline, TimerSlack slack,
     insert_timer_in_queue(cpu, timer, earliest_deadline, latest_deadline);
     kcounter_add(timer_created_counter, 1);
 
-    if (list_peek_head_type(&percpu[cpu].timer_queue, timer_t, node) == timer) {
+    if (timer_queue_head(cpu) == timer) {
         // we just modified the head of the timer queue
         update_platform_timer(cpu, deadline);
     }
@@ -316,14 +313,15 @@ bool timer_cancel(timer_t* timer) {
     bool callback_not_running;
 
     // if the timer is in a queue, remove it and adjust hardware timers if needed
-    if (list_in_list(&timer->node)) {
+    if (timer->node.InContainer()) {
         callback_not_running = true;
 
         // save a copy of the old head of the queue so later we can see if we modified the head
-        timer_t* oldhead = list_peek_head_type(&percpu[cpu].timer_queue, timer_t, node);
+        uint timer_cpu = timer->queue_cpu;
+        timer_t* oldhead = timer_queue_head(timer_cpu);
 
         // remove our timer from the queue
-        list_delete(&timer->node);
+        timer_queues[timer_cpu].timers.erase(*timer);
         kcounter_add(timer_canceled_counter, 1);
 
         // TODO(cpu): if  after removing |timer| there is one other single timer with
@@ -332,9 +330,9 @@ bool timer_cancel(timer_t* timer) {
 
         // see if we've just modified the head of this cpu's timer queue.
         // if we modified another cpu's queue, we'll just let it fire and sort itself out
-        if (unlikely(oldhead == timer)) {
+        if (unlikely(timer_cpu == cpu && oldhead == timer)) {
             // timer we're canceling was at head of queue, see if we should update platform timer
-            timer_t* newhead = list_peek_head_type(&percpu[cpu].timer_queue, timer_t, node);
+            timer_t* newhead = timer_queue_head(cpu);
             if (newhead) {
                 update_platform_timer(cpu, newhead->scheduled_time);
             } else if (percpu[cpu].next_timer_deadline == ZX_TIME_INFINITE) {
@@ -385,7 +383,7 @@ void timer_tick(zx_time_t now) {
 
     for (;;) {
         // see if there's an event to process
-        timer = list_peek_head_type(&percpu[cpu].timer_queue, timer_t, node);
+        timer = timer_queue_head(cpu);
         if (likely(timer == 0)) {
             break;
         }
@@ -400,7 +398,7 @@ void timer_tick(zx_time_t now) {
         DEBUG_ASSERT_MSG(timer && timer->magic == TIMER_MAGIC,
                          "ASSERT: timer failed magic check: timer %p, magic 0x%x\n",
                          timer, (uint)timer->magic);
-        list_delete(&timer->node);
+        timer_queues[cpu].timers.erase(*timer);
 
         // mark the timer busy
         timer->active_cpu = cpu;
@@ -428,7 +426,7 @@ void timer_tick(zx_time_t now) {
 
     // get the deadline of the event at the head of the queue (if any)
     zx_time_t deadline = ZX_TIME_INFINITE;
-    timer = list_peek_head_type(&percpu[cpu].timer_queue, timer_t, node);
+    timer = timer_queue_head(cpu);
     if (timer) {
         deadline = timer->scheduled_time;
 
@@ -466,12 +464,12 @@ void timer_transition_off_cpu(uint old_cpu) {
     Guard<spin_lock_t, IrqSave> guard{TimerLock::Get()};
     uint cpu = arch_curr_cpu_num();
 
-    timer_t* old_head = list_peek_head_type(&percpu[cpu].timer_queue, timer_t, node);
+    timer_t* old_head = timer_queue_head(cpu);
 
-    timer_t *entry = NULL, *tmp_entry = NULL;
     // Move all timers from old_cpu to this cpu
-    list_for_every_entry_safe (&percpu[old_cpu].timer_queue, entry, tmp_entry, timer_t, node) {
-        list_delete(&entry->node);
+    TimerTree& old_timers = timer_queues[old_cpu].timers;
+    while (!old_timers.is_empty()) {
+        timer_t* entry = old_timers.pop_front();
         // We lost the original asymmetric slack information so when we combine them
         // with the other timer queue they are not coalesced again.
         // TODO(cpu): figure how important this case is.
@@ -481,7 +479,7 @@ void timer_transition_off_cpu(uint old_cpu) {
         // created.
     }
 
-    timer_t* new_head = list_peek_head_type(&percpu[cpu].timer_queue, timer_t, node);
+    timer_t* new_head = timer_queue_head(cpu);
     if (new_head != NULL && new_head != old_head) {
         // we just modified the head of the timer queue
         update_platform_timer(cpu, new_head->scheduled_time);
@@ -502,7 +500,7 @@ void timer_thaw_percpu(void) {
     percpu[cpu].next_timer_deadline = ZX_TIME_INFINITE;
     zx_time_t deadline = percpu[cpu].preempt_timer_deadline;
 
-    timer_t* t = list_peek_head_type(&percpu[cpu].timer_queue, timer_t, node);
+    timer_t* t = timer_queue_head(cpu);
     if (t) {
         if (t->scheduled_time < deadline) {
             deadline = t->scheduled_time;
@@ -516,7 +514,6 @@ void timer_thaw_percpu(void) {
 
 void timer_queue_init(void) {
     for (uint i = 0; i < SMP_MAX_CPUS; i++) {
-        list_initialize(&percpu[i].timer_queue);
         percpu[i].preempt_timer_deadline = ZX_TIME_INFINITE;
         percpu[i].next_timer_deadline = ZX_TIME_INFINITE;
     }
@@ -530,18 +527,20 @@ static void dump_timer_queues(char* buf, size_t len) {
     Guard<spin_lock_t, IrqSave> guard{TimerLock::Get()};
 
     for (uint i = 0; i < SMP_MAX_CPUS; i++) {
-        if (mp_is_cpu_online(i)) {
+        if (mp_is_cpu_online(i) && ptr < len) {
             ptr += snprintf(buf + ptr, len - ptr, "cpu %u:\n", i);
 
-            timer_t* t;
             zx_time_t last = now;
-            list_for_every_entry (&percpu[i].timer_queue, t, timer_t, node) {
-                zx_duration_t delta_now = zx_time_sub_time(t->scheduled_time, now);
-                zx_duration_t delta_last = zx_time_sub_time(t->scheduled_time, last);
+            for (const timer_t& t : timer_queues[i].timers) {
+                if (ptr >= len) {
+                    break;
+                }
+                zx_duration_t delta_now = zx_time_sub_time(t.scheduled_time, now);
+                zx_duration_t delta_last = zx_time_sub_time(t.scheduled_time, last);
                 ptr += snprintf(buf + ptr, len - ptr,
                                 "\ttime %" PRIi64 " delta_now %" PRIi64 " delta_last %" PRIi64 " func %p arg %p\n",
-                                t->scheduled_time, delta_now, delta_last, t->callback, t->arg);
-                last = t->scheduled_time;
+                                t.scheduled_time, delta_now, delta_last, t.callback, t.arg);
+                last = t.scheduled_time;
             }
         }
     }
@@ -337,7 +337,9 @@ static int cmd_counters(int argc, const cmd_args* argv, uint32_t flags) {
     return 0;
 }
 
-LK_INIT_HOOK(kcounters, counters_init, LK_INIT_LEVEL_PLATFORM_EARLY);
+// The pmm counts page allocations, and the platform starts allocating pages
+// in platform_early_init(), so the counters need to be wired up before that.
+LK_INIT_HOOK(kcounters, counters_init, LK_INIT_LEVEL_EARLIEST);
 
 STATIC_COMMAND_START
 STATIC_COMMAND("counters", "view system counters", &cmd_counters)
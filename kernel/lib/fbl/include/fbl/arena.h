@@ -52,6 +52,11 @@ public:
         return count_;
     }
 
+    // Returns the number of bytes of memory committed to this arena.
+    size_t DiagnosticCommittedBytes() const {
+        return control_.CommittedBytes() + data_.CommittedBytes();
+    }
+
 private:
     Arena(const Arena&) = delete;
     Arena& operator=(const Arena&) = delete;
@@ -101,6 +106,11 @@ private:
         // Pop will only return values <= |end|-|slot_size| (besides nullptr).
         char* end() const { return end_; }
 
+        // The number of bytes between |start| and |committed|.
+        size_t CommittedBytes() const {
+            return static_cast<size_t>(committed_ - start_);
+        }
+
         // Dumps information about the Pool using printf().
         void Dump() const;
 
@@ -14,7 +14,9 @@
 #include <string.h>
 
 #include <debug.h>
+#include <arch/ops.h>
 #include <err.h>
+#include <kernel/align.h>
 #include <kernel/mutex.h>
 #include <kernel/spinlock.h>
 #include <kernel/thread.h>
@@ -109,6 +111,16 @@
 //   Exception: to avoid OS free/alloc churn when right on the edge, the heap
 //   will try to hold onto one entirely-free, non-large OS allocation instead of
 //   returning it to the OS. See cached_os_alloc.
+//
+// Per-cpu caches:
+//   Small allocations (those that land in the first CACHE_BUCKETS buckets) are
+//   served from a per-cpu cache of blocks without taking the heap lock. The
+//   cached blocks keep their allocated headers, so as far as the free buckets
+//   and coalescing are concerned they are still in use, and are chained
+//   through their first payload word. An empty cache list is refilled with
+//   CACHE_BATCH blocks carved under the heap lock, and a full one flushes
+//   CACHE_BATCH blocks back to the free buckets. cmpct_trim() drains every
+//   cache first so that the blocks can be coalesced and returned to the OS.
 
 #if defined(DEBUG) || LK_DEBUGLEVEL > 2
 #define CMPCT_DEBUG
@@ -117,6 +129,9 @@
 #define LOCAL_TRACE 0
 
 KCOUNTER_MAX(max_allocation, "kernel.heap.max_allocation");
+KCOUNTER(cache_hits, "kernel.heap.cache.hits");
+KCOUNTER(cache_refills, "kernel.heap.cache.refills");
+KCOUNTER(cache_flushes, "kernel.heap.cache.flushes");
 
 // Use HEAP_ENABLE_TESTS to enable internal testing. The tests are not useful
 // when the target system is up. By that time we have done hundreds of allocations
@@ -197,10 +212,36 @@ struct heap {
     uint32_t free_list_bits[BUCKET_WORDS];
 };
 
+// Buckets below this index are cached per cpu. Bucket 23 holds 256 byte
+// areas, so this covers allocations of up to 256 bytes.
+#define CACHE_BUCKETS 24
+#define CACHE_MAX_SIZE 256
+
+// How many blocks a cache list holds before it flushes, and how many blocks
+// move between a cache list and the free buckets at a time.
+#define CACHE_MAX_BLOCKS 32
+#define CACHE_BATCH 8
+
+// Overlays the payload of a cached block.
+typedef struct cache_block {
+    struct cache_block* next;
+} cache_block_t;
+
+struct cpu_cache {
+    // Guards this cpu's lists. Taken with interrupts disabled, and never held
+    // while the heap lock is acquired.
+    spin_lock_t lock;
+
+    cache_block_t* lists[CACHE_BUCKETS];
+    size_t counts[CACHE_BUCKETS];
+} __CPU_ALIGN;
+
 // Heap static vars.
 static struct heap theheap;
+static struct cpu_cache cpu_caches[SMP_MAX_CPUS];
 
 static ssize_t heap_grow(size_t len);
+static void cache_drain_all(void);
 
 static void lock(void) TA_ACQ(theheap.lock) {
     mutex_acquire(&theheap.lock);
@@ -240,6 +281,18 @@ void cmpct_dump(bool panic_time) TA_NO_THREAD_SAFETY_ANALYSIS {
         }
     }
 
+    dprintf(INFO, "\tcpu caches:\n");
+    for (uint cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        size_t blocks = 0;
+        for (int i = 0; i < CACHE_BUCKETS; i++) {
+            blocks += cpu_caches[cpu].counts[i];
+        }
+        // Racy when not holding the cache locks, but only informational.
+        if (blocks != 0) {
+            dprintf(INFO, "\tcpu %u: %zu blocks\n", cpu, blocks);
+        }
+    }
+
     if (!panic_time) {
         unlock();
     }
@@ -810,7 +863,9 @@ void cmpct_test(void) {}
 void cmpct_trim(void) {
     // Look at free list entries that are at least as large as one page plus a
     // header. They might be at the start or the end of a block, so we can trim
-    // them and free the page(s).
+    // them and free the page(s). Cached blocks go back to the free buckets
+    // first, so that they can be coalesced into those entries.
+    cache_drain_all();
     lock();
     for (int bucket = size_to_index_freeing(PAGE_SIZE);
          bucket < NUMBER_OF_BUCKETS;
@@ -900,24 +955,11 @@ void cmpct_trim(void) {
     unlock();
 }
 
-void* cmpct_alloc(size_t size) {
-    if (size == 0u) {
-        return NULL;
-    }
-
-    kcounter_max(max_allocation, size);
-
-    // Large allocations are no longer allowed. See ZX-1318 for details.
-    if (size > (HEAP_LARGE_ALLOC_BYTES - sizeof(header_t))) {
-        return NULL;
-    }
-
-    size_t rounded_up;
-    int start_bucket = size_to_index_allocating(size, &rounded_up);
-
-    rounded_up += sizeof(header_t);
-
-    lock();
+// Carves an area of |rounded_up| bytes (including the header) out of the
+// free buckets, growing the heap if needed. |size| is what the caller asked
+// for, and is only used to decide whether to split off the rest of the area.
+static void* alloc_locked(int start_bucket, size_t size, size_t rounded_up)
+    TA_REQ(theheap.lock) {
     int bucket = find_nonempty_bucket(start_bucket);
     if (bucket == -1) {
         // Grow heap by at least 12% if we can.
@@ -928,7 +970,6 @@ void* cmpct_alloc(size_t size) {
         // we succeed or get too small.
         while (heap_grow(growby) < 0) {
             if (growby <= rounded_up) {
-                unlock();
                 return NULL;
             }
             growby = MAX(growby >> 1, rounded_up);
@@ -952,15 +993,217 @@ void* cmpct_alloc(size_t size) {
     } else {
         unlink_free(head, bucket);
     }
-    void* result =
-        create_allocation_header(head, 0, head->header.size, head->header.left);
+    return create_allocation_header(head, 0, head->header.size,
+                                    head->header.left);
+}
+
+// Frees an allocated area to the free buckets, coalescing it with its free
+// neighbors.
+static void free_locked(header_t* header) TA_REQ(theheap.lock) {
+    size_t size = header->size;
+    header_t* left = header->left;
+    if (left != NULL && is_tagged_as_free(left)) {
+        // Coalesce with left free object.
+        unlink_free_unknown_bucket((free_t*)left);
+        header_t* right = right_header(header);
+        if (is_tagged_as_free(right)) {
+            // Coalesce both sides.
+            unlink_free_unknown_bucket((free_t*)right);
+            header_t* right_right = right_header(right);
+            FixLeftPointer(right_right, left);
+            free_memory(left, left->left, left->size + size + right->size);
+        } else {
+            // Coalesce only left.
+            FixLeftPointer(right, left);
+            free_memory(left, left->left, left->size + size);
+        }
+    } else {
+        header_t* right = right_header(header);
+        if (is_tagged_as_free(right)) {
+            // Coalesce only right.
+            header_t* right_right = right_header(right);
+            unlink_free_unknown_bucket((free_t*)right);
+            FixLeftPointer(right_right, header);
+            free_memory(header, left, size + right->size);
+        } else {
+            free_memory(header, left, size);
+        }
+    }
+}
+
+// Frees a chain of cached blocks to the free buckets.
+static void free_cache_blocks(cache_block_t* block) {
+    if (block == NULL) {
+        return;
+    }
+    lock();
+    while (block != NULL) {
+        cache_block_t* next = block->next;
+        free_locked((header_t*)block - 1);
+        block = next;
+    }
+    unlock();
+}
+
+// The caller must have interrupts disabled, so that it stays on this cpu.
+static struct cpu_cache* current_cache(void) {
+    return &cpu_caches[arch_curr_cpu_num()];
+}
+
+// Pops a block from this cpu's cache, refilling the cache from the free
+// buckets if it is empty. Returns NULL if the heap is out of memory.
+static void* cache_alloc(int bucket, size_t size, size_t rounded_up) {
+    spin_lock_saved_state_t state;
+    arch_interrupt_save(&state, ARCH_DEFAULT_SPIN_LOCK_FLAG_INTERRUPTS);
+    struct cpu_cache* cache = current_cache();
+    spin_lock(&cache->lock);
+    cache_block_t* block = cache->lists[bucket];
+    if (block != NULL) {
+        cache->lists[bucket] = block->next;
+        cache->counts[bucket]--;
+    }
+    spin_unlock(&cache->lock);
+    arch_interrupt_restore(state, ARCH_DEFAULT_SPIN_LOCK_FLAG_INTERRUPTS);
+
+    if (block != NULL) {
+        kcounter_add(cache_hits, 1);
+        return block;
+    }
+
+    // Carve a batch, keep the first block for the caller and cache the rest.
+    // The thread may have moved to another cpu by the time they are cached,
+    // which does no harm.
+    kcounter_add(cache_refills, 1);
+    cache_block_t* batch = NULL;
+    size_t batch_count = 0;
+    lock();
+    void* result = alloc_locked(bucket, size, rounded_up);
+    if (result != NULL) {
+        for (; batch_count < CACHE_BATCH - 1; batch_count++) {
+            cache_block_t* extra =
+                (cache_block_t*)alloc_locked(bucket, size, rounded_up);
+            if (extra == NULL) {
+                break;
+            }
+            extra->next = batch;
+            batch = extra;
+        }
+    }
+    unlock();
+
+    if (batch != NULL) {
+        cache_block_t* tail = batch;
+        while (tail->next != NULL) {
+            tail = tail->next;
+        }
+        arch_interrupt_save(&state, ARCH_DEFAULT_SPIN_LOCK_FLAG_INTERRUPTS);
+        cache = current_cache();
+        spin_lock(&cache->lock);
+        tail->next = cache->lists[bucket];
+        cache->lists[bucket] = batch;
+        cache->counts[bucket] += batch_count;
+        spin_unlock(&cache->lock);
+        arch_interrupt_restore(state, ARCH_DEFAULT_SPIN_LOCK_FLAG_INTERRUPTS);
+    }
+    return result;
+}
+
+// Pushes an allocated block with a usable size of at most CACHE_MAX_SIZE onto
+// this cpu's cache, first flushing a batch to the free buckets if the cache
+// is full.
+static void cache_free(header_t* header) {
+    int bucket = size_to_index_freeing(header->size - sizeof(header_t));
+    DEBUG_ASSERT(bucket < CACHE_BUCKETS);
+    cache_block_t* block = (cache_block_t*)(header + 1);
 #ifdef CMPCT_DEBUG
-    check_free_fill(result, size);
-    memset(result, ALLOC_FILL, size);
-    memset(((char*)result) + size, PADDING_FILL,
-           rounded_up - size - sizeof(header_t));
+    memset(block, FREE_FILL, header->size - sizeof(header_t));
+#endif
+
+    cache_block_t* flush = NULL;
+    spin_lock_saved_state_t state;
+    arch_interrupt_save(&state, ARCH_DEFAULT_SPIN_LOCK_FLAG_INTERRUPTS);
+    struct cpu_cache* cache = current_cache();
+    spin_lock(&cache->lock);
+    if (cache->counts[bucket] >= CACHE_MAX_BLOCKS) {
+        // Flush the most recently freed blocks rather than walking the list
+        // for the oldest; the block being freed stays on top either way.
+        flush = cache->lists[bucket];
+        cache_block_t* last = flush;
+        for (int i = 1; i < CACHE_BATCH; i++) {
+            last = last->next;
+        }
+        cache->lists[bucket] = last->next;
+        last->next = NULL;
+        cache->counts[bucket] -= CACHE_BATCH;
+    }
+    block->next = cache->lists[bucket];
+    cache->lists[bucket] = block;
+    cache->counts[bucket]++;
+    spin_unlock(&cache->lock);
+    arch_interrupt_restore(state, ARCH_DEFAULT_SPIN_LOCK_FLAG_INTERRUPTS);
+
+    if (flush != NULL) {
+        kcounter_add(cache_flushes, 1);
+        free_cache_blocks(flush);
+    }
+}
+
+// Returns every cached block on every cpu to the free buckets.
+static void cache_drain_all(void) {
+    for (uint cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        struct cpu_cache* cache = &cpu_caches[cpu];
+        cache_block_t* drained = NULL;
+        spin_lock_saved_state_t state;
+        spin_lock_irqsave(&cache->lock, state);
+        for (int i = 0; i < CACHE_BUCKETS; i++) {
+            cache_block_t* block = cache->lists[i];
+            while (block != NULL) {
+                cache_block_t* next = block->next;
+                block->next = drained;
+                drained = block;
+                block = next;
+            }
+            cache->lists[i] = NULL;
+            cache->counts[i] = 0;
+        }
+        spin_unlock_irqrestore(&cache->lock, state);
+        free_cache_blocks(drained);
+    }
+}
+
+void* cmpct_alloc(size_t size) {
+    if (size == 0u) {
+        return NULL;
+    }
+
+    kcounter_max(max_allocation, size);
+
+    // Large allocations are no longer allowed. See ZX-1318 for details.
+    if (size > (HEAP_LARGE_ALLOC_BYTES - sizeof(header_t))) {
+        return NULL;
+    }
+
+    size_t rounded_up;
+    int start_bucket = size_to_index_allocating(size, &rounded_up);
+
+    rounded_up += sizeof(header_t);
+
+    void* result;
+    if (start_bucket < CACHE_BUCKETS) {
+        result = cache_alloc(start_bucket, size, rounded_up);
+    } else {
+        lock();
+        result = alloc_locked(start_bucket, size, rounded_up);
+        unlock();
+    }
+#ifdef CMPCT_DEBUG
+    if (result != NULL) {
+        check_free_fill(result, size);
+        memset(result, ALLOC_FILL, size);
+        memset(((char*)result) + size, PADDING_FILL,
+               rounded_up - size - sizeof(header_t));
+    }
 #endif
-    unlock();
     return result;
 }
 
@@ -1006,36 +1249,12 @@ void cmpct_free(void* payload) {
     }
     header_t* header = (header_t*)payload - 1;
     DEBUG_ASSERT(!is_tagged_as_free(header)); // Double free!
-    size_t size = header->size;
-    lock();
-    header_t* left = header->left;
-    if (left != NULL && is_tagged_as_free(left)) {
-        // Coalesce with left free object.
-        unlink_free_unknown_bucket((free_t*)left);
-        header_t* right = right_header(header);
-        if (is_tagged_as_free(right)) {
-            // Coalesce both sides.
-            unlink_free_unknown_bucket((free_t*)right);
-            header_t* right_right = right_header(right);
-            FixLeftPointer(right_right, left);
-            free_memory(left, left->left, left->size + size + right->size);
-        } else {
-            // Coalesce only left.
-            FixLeftPointer(right, left);
-            free_memory(left, left->left, left->size + size);
-        }
-    } else {
-        header_t* right = right_header(header);
-        if (is_tagged_as_free(right)) {
-            // Coalesce only right.
-            header_t* right_right = right_header(right);
-            unlink_free_unknown_bucket((free_t*)right);
-            FixLeftPointer(right_right, header);
-            free_memory(header, left, size + right->size);
-        } else {
-            free_memory(header, left, size);
-        }
+    if (header->size - sizeof(header_t) <= CACHE_MAX_SIZE) {
+        cache_free(header);
+        return;
     }
+    lock();
+    free_locked(header);
     unlock();
 }
 
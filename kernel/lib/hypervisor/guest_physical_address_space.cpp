@@ -10,6 +10,7 @@
 #include <kernel/range_check.h>
 #include <ktl/move.h>
 #include <vm/fault.h>
+#include <vm/page_source.h>
 #include <vm/vm_object_physical.h>
 
 static constexpr uint kPfFlags = VMM_PF_FLAG_WRITE | VMM_PF_FLAG_SW_FAULT;
@@ -116,24 +117,41 @@ zx_status_t GuestPhysicalAddressSpace::GetPage(zx_gpaddr_t guest_paddr, zx_paddr
 }
 
 zx_status_t GuestPhysicalAddressSpace::PageFault(zx_gpaddr_t guest_paddr) {
-    fbl::RefPtr<VmMapping> mapping = FindMapping(RootVmar(), guest_paddr);
-    if (!mapping) {
-        return ZX_ERR_NOT_FOUND;
-    }
+    PageRequest page_request;
+    for (;;) {
+        fbl::RefPtr<VmMapping> mapping = FindMapping(RootVmar(), guest_paddr);
+        if (!mapping) {
+            return ZX_ERR_NOT_FOUND;
+        }
 
-    // In order to avoid re-faulting if the guest changes how it accesses guest
-    // physical memory, and to avoid the need for invalidation of the guest
-    // physical address space on x86 (through the use of INVEPT), we fault the
-    // page with the maximum allowable permissions of the mapping.
-    uint pf_flags = VMM_PF_FLAG_GUEST | VMM_PF_FLAG_HW_FAULT;
-    if (mapping->arch_mmu_flags() & ARCH_MMU_FLAG_PERM_WRITE) {
-        pf_flags |= VMM_PF_FLAG_WRITE;
-    }
-    if (mapping->arch_mmu_flags() & ARCH_MMU_FLAG_PERM_EXECUTE) {
-        pf_flags |= VMM_PF_FLAG_INSTRUCTION;
+        // In order to avoid re-faulting if the guest changes how it accesses guest
+        // physical memory, and to avoid the need for invalidation of the guest
+        // physical address space on x86 (through the use of INVEPT), we fault the
+        // page with the maximum allowable permissions of the mapping.
+        uint pf_flags = VMM_PF_FLAG_GUEST | VMM_PF_FLAG_HW_FAULT;
+        if (mapping->arch_mmu_flags() & ARCH_MMU_FLAG_PERM_WRITE) {
+            pf_flags |= VMM_PF_FLAG_WRITE;
+        }
+        if (mapping->arch_mmu_flags() & ARCH_MMU_FLAG_PERM_EXECUTE) {
+            pf_flags |= VMM_PF_FLAG_INSTRUCTION;
+        }
+
+        zx_status_t status;
+        {
+            Guard<fbl::Mutex> guard{guest_aspace_->lock()};
+            status = mapping->PageFault(guest_paddr, pf_flags, &page_request);
+        }
+        if (status != ZX_ERR_SHOULD_WAIT) {
+            return status;
+        }
+
+        // The page has to come from a pager. Wait for it, then look the mapping up
+        // again, as it may have changed in the meantime.
+        status = page_request.Wait();
+        if (status != ZX_OK) {
+            return status;
+        }
     }
-    Guard<fbl::Mutex> guard{guest_aspace_->lock()};
-    return mapping->PageFault(guest_paddr, pf_flags);
 }
 
 zx_status_t GuestPhysicalAddressSpace::CreateGuestPtr(zx_gpaddr_t guest_paddr, size_t len,
@@ -11,8 +11,13 @@
 
 #include <arch/ops.h>
 #include <arch/user_copy.h>
+#include <fbl/algorithm.h>
 #include <hypervisor/ktrace.h>
+#include <kernel/align.h>
 #include <kernel/cmdline.h>
+#include <kernel/lockdep.h>
+#include <kernel/spinlock.h>
+#include <lib/counters.h>
 #include <lib/ktrace.h>
 #include <lk/init.h>
 #include <object/thread_dispatcher.h>
@@ -75,88 +80,398 @@ static void ktrace_report_probes(void) {
     }
 }
 
-typedef struct ktrace_state {
-    // where the next record will be written
-    int offset;
+// The trace buffer is carved into a small metadata area followed by one ring
+// per cpu.  Name records, which have no timestamp, are appended to the
+// metadata area with the version and tick rate records.  Every other record
+// goes to the ring of the cpu that emits it, so cpus tracing at the same time
+// never contend for the same cache lines.  Readers see the metadata area
+// followed by the records of all the rings merged in timestamp order, the
+// same single stream of records the buffer has always held.
+
+// Largest record that can be written, the most KTRACE_LEN() can encode.
+static constexpr uint32_t kMaxRecordSize = 0xF << 3;
+
+// Upper limit on the size of the metadata area.
+static constexpr uint32_t kMaxMetaSize = 1024 * 1024;
+
+// A record never straddles the end of a ring; when one won't fit, the rest of
+// the ring is skipped and this tag is left where the record would have been.
+static constexpr uint32_t kWrapTag = 0;
+
+KCOUNTER(ktrace_overwritten, "kernel.ktrace.overwritten_bytes");
+KCOUNTER(ktrace_names_dropped, "kernel.ktrace.names_dropped");
+KCOUNTER(ktrace_records_dropped, "kernel.ktrace.records_dropped");
+
+struct ktrace_cpu_buffer {
+    DECLARE_SPINLOCK(ktrace_cpu_buffer) lock;
+
+    // this cpu's slice of the trace buffer
+    uint8_t* base;
+    uint32_t size;
 
+    // where the next record will be written, and where the oldest one is
+    uint32_t head TA_GUARDED(lock);
+    uint32_t tail TA_GUARDED(lock);
+
+    // bytes ever written to and retired from the ring, skipped space
+    // included, so a reader can tell when its position has been overwritten
+    uint64_t head_seq TA_GUARDED(lock);
+    uint64_t tail_seq TA_GUARDED(lock);
+
+    // bytes of records in the ring, skipped space not included
+    uint32_t live TA_GUARDED(lock);
+
+    // set once the ring has filled up when not overwriting; this cpu records
+    // nothing more until the rings are emptied, while the others carry on
+    bool full TA_GUARDED(lock);
+} __CPU_ALIGN;
+
+typedef struct ktrace_state {
     // mask of groups we allow, 0 == tracing disabled
     int grpmask;
 
-    // total size of the trace buffer
-    uint32_t bufsize;
+    // nonzero if a full ring overwrites its oldest records rather than
+    // stopping tracing
+    int circular;
+
+    // where the next metadata record will be written
+    int meta_offset;
 
-    // offset where tracing was stopped, 0 if tracing active
+    // usable size of the metadata area
+    uint32_t meta_size;
+
+    // size of the metadata area when tracing was stopped, 0 if tracing active
     uint32_t marker;
 
+    // nonzero if the rings were rewound while stopped; they are emptied when
+    // tracing starts again, so the stopped trace can still be read until then
+    int rewind_pending;
+
+    // number of per-cpu rings in use
+    uint32_t num_cpus;
+
     // raw trace buffer
     uint8_t* buffer;
 } ktrace_state_t;
 
 static ktrace_state_t KTRACE_STATE;
+static ktrace_cpu_buffer ktrace_cpu_buffers[SMP_MAX_CPUS];
+
+// Where a reader has got to in one cpu's ring.
+typedef struct ktrace_cpu_cursor {
+    uint64_t seq;
+    uint32_t offset;
+
+    // the next record from this ring, copied out, if has_record is set
+    bool has_record;
+    uint8_t record[kMaxRecordSize] __ALIGNED(8);
+} ktrace_cpu_cursor_t;
+
+// The merge is kept between calls to ktrace_read_user() so that reading the
+// buffer front to back in chunks carries on where the last chunk ended
+// rather than merging from the start every time.
+typedef struct ktrace_reader {
+    // whether the merge has been started since the last rewind
+    bool valid;
+
+    // size of the metadata area when the merge was started; the merged
+    // records follow it in the stream
+    uint32_t meta_size;
+
+    // stream offset of record[pos]
+    uint32_t offset;
+
+    // the record being copied out, and how much of it has been
+    uint32_t len;
+    uint32_t pos;
+    uint8_t record[kMaxRecordSize] __ALIGNED(8);
+
+    ktrace_cpu_cursor_t cpus[SMP_MAX_CPUS];
+} ktrace_reader_t;
+
+static fbl::Mutex reader_lock;
+static ktrace_reader_t reader TA_GUARDED(reader_lock);
+
+static uint32_t ktrace_meta_used(ktrace_state_t* ks) {
+    // The offset can end up pointing past the end, so clip it to the actual
+    // size to be safe.
+    uint32_t n = atomic_load(&ks->meta_offset);
+    return n > ks->meta_size ? ks->meta_size : n;
+}
 
-ssize_t ktrace_read_user(void* ptr, uint32_t off, size_t len) {
+// Drops the oldest record in |cb|, or the skipped space at the end of the
+// ring if that comes first.
+static void ktrace_retire_oldest(ktrace_cpu_buffer* cb) TA_REQ(cb->lock) {
+    uint32_t tag = *reinterpret_cast<uint32_t*>(cb->base + cb->tail);
+    uint32_t len;
+    if (tag == kWrapTag) {
+        len = cb->size - cb->tail;
+    } else {
+        len = KTRACE_LEN(tag);
+        cb->live -= len;
+        kcounter_add(ktrace_overwritten, len);
+    }
+    cb->tail += len;
+    if (cb->tail == cb->size) {
+        cb->tail = 0;
+    }
+    cb->tail_seq += len;
+}
+
+// Reserves space for a record in the current cpu's ring and fills in its
+// header.  Returns nullptr if the ring is full and not overwriting.
+static ktrace_header_t* ktrace_reserve(uint32_t tag, uint32_t tid) {
     ktrace_state_t* ks = &KTRACE_STATE;
+    const uint32_t len = KTRACE_LEN(tag);
+    DEBUG_ASSERT(len >= KTRACE_HDRSIZE);
 
-    // Buffer size is limited by the marker if set,
-    // otherwise limited by offset (last written point).
-    // Offset can end up pointing past the end, so clip
-    // it to the actual buffer size to be safe.
-    uint32_t max;
-    if (ks->marker) {
-        max = ks->marker;
-    } else {
-        max = ks->offset;
-        if (max > ks->bufsize) {
-            max = ks->bufsize;
+    ktrace_cpu_buffer* cb = &ktrace_cpu_buffers[arch_curr_cpu_num()];
+    Guard<SpinLock, IrqSave> guard{&cb->lock};
+    if (cb->full) {
+        kcounter_add(ktrace_records_dropped, 1);
+        return nullptr;
+    }
+
+    const uint32_t skip = (cb->size - cb->head < len) ? cb->size - cb->head : 0;
+    while (cb->size - static_cast<uint32_t>(cb->head_seq - cb->tail_seq) < skip + len) {
+        if (!atomic_load(&ks->circular)) {
+            // if we arrive at the end, stop this cpu only; the others may
+            // still have plenty of room
+            cb->full = true;
+            kcounter_add(ktrace_records_dropped, 1);
+            return nullptr;
+        }
+        ktrace_retire_oldest(cb);
+    }
+
+    if (skip) {
+        *reinterpret_cast<uint32_t*>(cb->base + cb->head) = kWrapTag;
+        cb->head = 0;
+        cb->head_seq += skip;
+    }
+
+    ktrace_header_t* hdr = reinterpret_cast<ktrace_header_t*>(cb->base + cb->head);
+    hdr->ts = ktrace_timestamp();
+    hdr->tag = tag;
+    hdr->tid = tid;
+
+    cb->head += len;
+    if (cb->head == cb->size) {
+        cb->head = 0;
+    }
+    cb->head_seq += len;
+    cb->live += len;
+    return hdr;
+}
+
+// Copies the next record in |cpu|'s ring into its cursor.  If the ring has
+// wrapped past the cursor, the records that were lost are skipped.
+static void ktrace_fetch(uint32_t cpu) TA_REQ(reader_lock) {
+    ktrace_cpu_buffer* cb = &ktrace_cpu_buffers[cpu];
+    ktrace_cpu_cursor_t* cur = &reader.cpus[cpu];
+
+    Guard<SpinLock, IrqSave> guard{&cb->lock};
+
+    if (cur->seq < cb->tail_seq) {
+        cur->seq = cb->tail_seq;
+        cur->offset = cb->tail;
+    }
+    if (cur->seq == cb->head_seq) {
+        cur->has_record = false;
+        return;
+    }
+
+    // skipped space is always followed by a record
+    uint32_t tag = *reinterpret_cast<uint32_t*>(cb->base + cur->offset);
+    if (tag == kWrapTag) {
+        cur->seq += cb->size - cur->offset;
+        cur->offset = 0;
+        tag = *reinterpret_cast<uint32_t*>(cb->base);
+    }
+
+    uint32_t len = KTRACE_LEN(tag);
+    memcpy(cur->record, cb->base + cur->offset, len);
+    cur->offset += len;
+    if (cur->offset == cb->size) {
+        cur->offset = 0;
+    }
+    cur->seq += len;
+    cur->has_record = true;
+}
+
+// Starts the merge over from the oldest record in each ring.
+static void ktrace_restart_merge(uint32_t meta_size) TA_REQ(reader_lock) {
+    ktrace_state_t* ks = &KTRACE_STATE;
+    reader.valid = true;
+    reader.meta_size = meta_size;
+    reader.offset = meta_size;
+    reader.len = 0;
+    reader.pos = 0;
+    for (uint32_t cpu = 0; cpu < ks->num_cpus; cpu++) {
+        reader.cpus[cpu].seq = 0;
+        reader.cpus[cpu].offset = 0;
+        ktrace_fetch(cpu);
+    }
+}
+
+// Moves the earliest of the rings' next records into the reader.  Rings
+// that had nothing left when last looked at are not looked at again until
+// the merge restarts, so records written while tracing is still running may
+// not be seen.
+static bool ktrace_next_record() TA_REQ(reader_lock) {
+    ktrace_state_t* ks = &KTRACE_STATE;
+    ktrace_cpu_cursor_t* next = nullptr;
+    uint32_t next_cpu = 0;
+    for (uint32_t cpu = 0; cpu < ks->num_cpus; cpu++) {
+        ktrace_cpu_cursor_t* cur = &reader.cpus[cpu];
+        if (!cur->has_record) {
+            continue;
+        }
+        if (next == nullptr ||
+            reinterpret_cast<ktrace_header_t*>(cur->record)->ts <
+                reinterpret_cast<ktrace_header_t*>(next->record)->ts) {
+            next = cur;
+            next_cpu = cpu;
         }
     }
+    if (next == nullptr) {
+        return false;
+    }
+
+    reader.len = KTRACE_LEN(reinterpret_cast<ktrace_header_t*>(next->record)->tag);
+    reader.pos = 0;
+    memcpy(reader.record, next->record, reader.len);
+    ktrace_fetch(next_cpu);
+    return true;
+}
+
+ssize_t ktrace_read_user(void* ptr, uint32_t off, size_t len) {
+    ktrace_state_t* ks = &KTRACE_STATE;
+    if (ks->buffer == nullptr) {
+        return 0;
+    }
+
+    fbl::AutoLock lock(&reader_lock);
+
+    // Once tracing has stopped, the metadata area is limited by the marker
+    // so it can be read back in full even after a rewind.
+    uint32_t meta_size = ks->marker ? ks->marker : ktrace_meta_used(ks);
 
     // null read is a query for trace buffer size
     if (ptr == nullptr) {
-        return max;
+        size_t total = meta_size;
+        for (uint32_t cpu = 0; cpu < ks->num_cpus; cpu++) {
+            ktrace_cpu_buffer* cb = &ktrace_cpu_buffers[cpu];
+            Guard<SpinLock, IrqSave> cpu_guard{&cb->lock};
+            total += cb->live;
+        }
+        return total;
     }
 
-    // constrain read to available buffer
-    if (off >= max) {
-        return 0;
+    uint8_t* dst = static_cast<uint8_t*>(ptr);
+    size_t done = 0;
+
+    // the metadata area is copied out as is
+    if (off < meta_size) {
+        done = fbl::min(len, static_cast<size_t>(meta_size - off));
+        if (arch_copy_to_user(dst, ks->buffer + off, done) != ZX_OK) {
+            return ZX_ERR_INVALID_ARGS;
+        }
+        off += static_cast<uint32_t>(done);
     }
-    if (len > (max - off)) {
-        len = max - off;
+
+    // followed by the merged records of the rings
+    if (!reader.valid || reader.meta_size != meta_size || off < reader.offset) {
+        ktrace_restart_merge(meta_size);
     }
+    while (done < len) {
+        if (reader.pos == reader.len && !ktrace_next_record()) {
+            break;
+        }
+        uint32_t avail = reader.len - reader.pos;
+        if (reader.offset < off) {
+            uint32_t skip = fbl::min(avail, off - reader.offset);
+            reader.pos += skip;
+            reader.offset += skip;
+            continue;
+        }
+        uint32_t n = static_cast<uint32_t>(fbl::min(static_cast<size_t>(avail), len - done));
+        if (arch_copy_to_user(dst + done, reader.record + reader.pos, n) != ZX_OK) {
+            return ZX_ERR_INVALID_ARGS;
+        }
+        reader.pos += n;
+        reader.offset += n;
+        off += n;
+        done += n;
+    }
+    return done;
+}
 
-    if (arch_copy_to_user(ptr, ks->buffer + off, len) != ZX_OK) {
-        return ZX_ERR_INVALID_ARGS;
+// Empties every ring and forgets where the reader had got to.
+static void ktrace_reset_rings(ktrace_state_t* ks) TA_REQ(reader_lock) {
+    for (uint32_t cpu = 0; cpu < ks->num_cpus; cpu++) {
+        ktrace_cpu_buffer* cb = &ktrace_cpu_buffers[cpu];
+        Guard<SpinLock, IrqSave> cpu_guard{&cb->lock};
+        cb->head = 0;
+        cb->tail = 0;
+        cb->head_seq = 0;
+        cb->tail_seq = 0;
+        cb->live = 0;
+        cb->full = false;
     }
-    return len;
+    reader.valid = false;
+}
+
+static void ktrace_start(ktrace_state_t* ks, uint32_t options, int circular) {
+    {
+        fbl::AutoLock lock(&reader_lock);
+        if (ks->rewind_pending) {
+            ktrace_reset_rings(ks);
+            ks->rewind_pending = 0;
+        }
+        ks->marker = 0;
+    }
+    options = KTRACE_GRP_TO_MASK(options);
+    atomic_store(&ks->circular, circular);
+    atomic_store(&ks->grpmask, options ? options : KTRACE_GRP_TO_MASK(KTRACE_GRP_ALL));
+    ktrace_report_live_processes();
+    ktrace_report_live_threads();
 }
 
 zx_status_t ktrace_control(uint32_t action, uint32_t options, void* ptr) {
     ktrace_state_t* ks = &KTRACE_STATE;
     switch (action) {
     case KTRACE_ACTION_START:
-        options = KTRACE_GRP_TO_MASK(options);
-        ks->marker = 0;
-        atomic_store(&ks->grpmask, options ? options : KTRACE_GRP_TO_MASK(KTRACE_GRP_ALL));
-        ktrace_report_live_processes();
-        ktrace_report_live_threads();
+        ktrace_start(ks, options, 0);
+        break;
+    case KTRACE_ACTION_START_CIRCULAR:
+        ktrace_start(ks, options, 1);
         break;
     case KTRACE_ACTION_STOP: {
         atomic_store(&ks->grpmask, 0);
-        uint32_t n = ks->offset;
-        if (n > ks->bufsize) {
-            ks->marker = ks->bufsize;
-        } else {
-            ks->marker = n;
+        fbl::AutoLock lock(&reader_lock);
+        if (!ks->marker) {
+            ks->marker = ktrace_meta_used(ks);
         }
         break;
     }
-    case KTRACE_ACTION_REWIND:
-        // roll back to just after the metadata
-        atomic_store(&ks->offset, KTRACE_RECSIZE * 2);
+    case KTRACE_ACTION_REWIND: {
+        // roll back to just after the metadata, and empty the rings, unless
+        // tracing is stopped and what it recorded may still be read
+        {
+            fbl::AutoLock lock(&reader_lock);
+            atomic_store(&ks->meta_offset, KTRACE_RECSIZE * 2);
+            if (ks->marker) {
+                ks->rewind_pending = 1;
+            } else {
+                ktrace_reset_rings(ks);
+            }
+        }
         ktrace_report_syscalls(kt_syscall_info);
         ktrace_report_probes();
         ktrace_report_vcpu_meta();
         break;
+    }
     case KTRACE_ACTION_NEW_PROBE: {
         fbl::AutoLock lock(&probe_list_lock);
         ktrace_probe_info_t* probe;
@@ -185,6 +500,7 @@ void ktrace_init(unsigned level) {
 
     uint32_t mb = cmdline_get_uint32("ktrace.bufsize", KTRACE_DEFAULT_BUFSIZE);
     uint32_t grpmask = cmdline_get_uint32("ktrace.grpmask", KTRACE_DEFAULT_GRPMASK);
+    bool circular = cmdline_get_bool("ktrace.circular", false);
 
     if (mb == 0) {
         dprintf(INFO, "ktrace: disabled\n");
@@ -193,19 +509,38 @@ void ktrace_init(unsigned level) {
 
     mb *= (1024*1024);
 
+    // A sixteenth of the buffer goes to metadata, the rest is shared out
+    // among the cpus.
+    uint32_t meta = fbl::min(mb / 16, kMaxMetaSize);
+    uint32_t num_cpus = arch_max_num_cpus();
+    uint32_t ring_size = ROUNDDOWN((mb - meta) / num_cpus, 8);
+    if (ring_size < PAGE_SIZE) {
+        dprintf(INFO, "ktrace: buffer too small for %u cpus\n", num_cpus);
+        return;
+    }
+
     zx_status_t status;
+    uint8_t* buffer;
     VmAspace* aspace = VmAspace::kernel_aspace();
-    if ((status = aspace->Alloc("ktrace", mb, (void**)&ks->buffer, 0, VmAspace::VMM_FLAG_COMMIT,
+    if ((status = aspace->Alloc("ktrace", mb, (void**)&buffer, 0, VmAspace::VMM_FLAG_COMMIT,
                                 ARCH_MMU_FLAG_PERM_READ | ARCH_MMU_FLAG_PERM_WRITE)) < 0) {
         dprintf(INFO, "ktrace: cannot alloc buffer %d\n", status);
         return;
     }
 
-    // The last packet written can overhang the end of the buffer,
-    // so we reduce the reported size by the max size of a record
-    ks->bufsize = mb - 256;
+    // The last name record written can overhang the end of the metadata
+    // area, so we reduce its reported size by the max size of a record
+    ks->meta_size = meta - 256;
+    ks->num_cpus = num_cpus;
+    for (uint32_t cpu = 0; cpu < num_cpus; cpu++) {
+        ktrace_cpu_buffers[cpu].base = buffer + meta + cpu * ring_size;
+        ktrace_cpu_buffers[cpu].size = ring_size;
+    }
+    atomic_store(&ks->circular, circular ? 1 : 0);
+    ks->buffer = buffer;
 
-    dprintf(INFO, "ktrace: buffer at %p (%u bytes)\n", ks->buffer, mb);
+    dprintf(INFO, "ktrace: buffer at %p (%u bytes, %u per cpu%s)\n",
+            ks->buffer, mb, ring_size, circular ? ", circular" : "");
 
     // register all static probes
     {
@@ -227,7 +562,7 @@ void ktrace_init(unsigned level) {
     rec[1].b = (uint32_t)(n >> 32);
 
     // enable tracing
-    atomic_store(&ks->offset, KTRACE_RECSIZE * 2);
+    atomic_store(&ks->meta_offset, KTRACE_RECSIZE * 2);
     ktrace_report_syscalls(kt_syscall_info);
     ktrace_report_probes();
     atomic_store(&ks->grpmask, KTRACE_GRP_TO_MASK(grpmask));
@@ -249,16 +584,7 @@ void ktrace_tiny(uint32_t tag, uint32_t arg) {
     ktrace_state_t* ks = &KTRACE_STATE;
     if (tag & atomic_load(&ks->grpmask)) {
         tag = (tag & 0xFFFFFFF0) | 2;
-        int off;
-        if ((off = atomic_add(&ks->offset, KTRACE_HDRSIZE)) >= (int)ks->bufsize) {
-            // if we arrive at the end, stop
-            atomic_store(&ks->grpmask, 0);
-        } else {
-            ktrace_header_t* hdr = (ktrace_header_t*) (ks->buffer + off);
-            hdr->ts = ktrace_timestamp();
-            hdr->tag = tag;
-            hdr->tid = arg;
-        }
+        ktrace_reserve(tag, arg);
     }
 }
 
@@ -268,18 +594,8 @@ void* ktrace_open(uint32_t tag) {
         return nullptr;
     }
 
-    int off;
-    if ((off = atomic_add(&ks->offset, KTRACE_LEN(tag))) >= (int)ks->bufsize) {
-        // if we arrive at the end, stop
-        atomic_store(&ks->grpmask, 0);
-        return nullptr;
-    }
-
-    ktrace_header_t* hdr = (ktrace_header_t*) (ks->buffer + off);
-    hdr->ts = ktrace_timestamp();
-    hdr->tag = tag;
-    hdr->tid = (uint32_t)get_current_thread()->user_tid;
-    return hdr + 1;
+    ktrace_header_t* hdr = ktrace_reserve(tag, (uint32_t)get_current_thread()->user_tid);
+    return hdr ? hdr + 1 : nullptr;
 }
 
 void ktrace_name_etc(uint32_t tag, uint32_t id, uint32_t arg, const char* name, bool always) {
@@ -291,9 +607,14 @@ void ktrace_name_etc(uint32_t tag, uint32_t id, uint32_t arg, const char* name,
         tag = (tag & 0xFFFFFFF0) | ((KTRACE_NAMESIZE + len + 1 + 7) >> 3);
 
         int off;
-        if ((off = atomic_add(&ks->offset, KTRACE_LEN(tag))) >= (int)ks->bufsize) {
-            // if we arrive at the end, stop
-            atomic_store(&ks->grpmask, 0);
+        if ((off = atomic_add(&ks->meta_offset, KTRACE_LEN(tag))) >= (int)ks->meta_size) {
+            // if we arrive at the end, stop, unless the rings are meant to
+            // keep going, in which case the name is lost
+            if (atomic_load(&ks->circular)) {
+                kcounter_add(ktrace_names_dropped, 1);
+            } else {
+                atomic_store(&ks->grpmask, 0);
+            }
         } else {
             ktrace_rec_name_t* rec = (ktrace_rec_name_t*) (ks->buffer + off);
             rec->tag = tag;
@@ -12,6 +12,8 @@
 #include <lib/console.h>
 #include <platform.h>
 #include <pretty/sizes.h>
+#include <vm/compression.h>
+#include <vm/page.h>
 #include <vm/pmm.h>
 #include <zircon/errors.h>
 #include <zircon/time.h>
@@ -41,6 +43,10 @@ static uint64_t oom_sleep_duration_ns TA_GUARDED(oom_mutex);
 // If the PMM has fewer than this many bytes free, start killing processes.
 static uint64_t oom_redline_bytes TA_GUARDED(oom_mutex);
 
+// If the PMM has fewer than this many bytes free, start compressing memory
+// that hasn't been used in a while.
+static uint64_t oom_reclaim_bytes TA_GUARDED(oom_mutex);
+
 // True if the thread should print the current free value when it runs.
 static bool oom_printing TA_GUARDED(oom_mutex);
 
@@ -54,7 +60,28 @@ static int oom_loop(void* arg) {
 
     size_t last_free_bytes = total_bytes;
     while (true) {
-        const size_t free_bytes = pmm_count_free_pages() * PAGE_SIZE;
+        size_t free_bytes = pmm_count_free_pages() * PAGE_SIZE;
+
+        // Compress memory that has gone cold, so that free memory doesn't get
+        // down to the redline while there is still some to be had that way.
+        uint64_t reclaim_bytes;
+        uint64_t redline_bytes;
+        {
+            AutoLock lock(&oom_mutex);
+            reclaim_bytes = oom_reclaim_bytes;
+            redline_bytes = oom_redline_bytes;
+        }
+        if (free_bytes < reclaim_bytes) {
+            const size_t target_pages = (reclaim_bytes - free_bytes) / PAGE_SIZE;
+            const size_t reclaimed = vm_reclaim_pages(target_pages, VM_PAGE_OBJECT_MAX_AGE);
+            // Below the redline, anything untouched since the last scan goes
+            // too before it comes to killing processes.
+            if (free_bytes + reclaimed * PAGE_SIZE < redline_bytes &&
+                reclaimed < target_pages) {
+                vm_reclaim_pages(target_pages - reclaimed, 1);
+            }
+            free_bytes = pmm_count_free_pages() * PAGE_SIZE;
+        }
 
         bool lowmem = false;
         bool printing = false;
@@ -131,7 +158,7 @@ static void start_thread_locked() TA_REQ(oom_mutex) {
 }
 
 void oom_init(bool enable, uint64_t sleep_duration_ns, size_t redline_bytes,
-              oom_lowmem_callback_t* lowmem_callback) {
+              size_t reclaim_bytes, oom_lowmem_callback_t* lowmem_callback) {
     DEBUG_ASSERT(sleep_duration_ns > 0);
     DEBUG_ASSERT(redline_bytes > 0);
     DEBUG_ASSERT(lowmem_callback != nullptr);
@@ -141,6 +168,7 @@ void oom_init(bool enable, uint64_t sleep_duration_ns, size_t redline_bytes,
     oom_lowmem_callback = lowmem_callback;
     oom_sleep_duration_ns = sleep_duration_ns;
     oom_redline_bytes = redline_bytes;
+    oom_reclaim_bytes = reclaim_bytes;
     oom_printing = false;
     oom_simulate_lowmem = false;
     if (enable) {
@@ -202,6 +230,9 @@ static int cmd_oom(int argc, const cmd_args* argv, uint32_t flags) {
         char buf[MAX_FORMAT_SIZE_LEN];
         format_size_fixed(buf, sizeof(buf), oom_redline_bytes, 'M');
         printf("  redline: %s (%" PRIu64 " bytes)\n", buf, oom_redline_bytes);
+
+        format_size_fixed(buf, sizeof(buf), oom_reclaim_bytes, 'M');
+        printf("  reclaim line: %s (%" PRIu64 " bytes)\n", buf, oom_reclaim_bytes);
     } else if (strcmp(argv[1].str, "print") == 0) {
         oom_printing = !oom_printing;
         printf("OOM print is now %s\n", oom_printing ? "on" : "off");
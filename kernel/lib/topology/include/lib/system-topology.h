@@ -50,7 +50,7 @@ public:
     zx_status_t Update(zbi_topology_node_t* nodes, size_t count);
 
     // Provides iterable container of pointers to all processor nodes.
-    IterableProcessors processors() {
+    IterableProcessors processors() const {
         return processors_;
     }
 
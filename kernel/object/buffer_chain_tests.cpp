@@ -138,9 +138,51 @@ static bool copy_in_copy_out() {
     END_TEST;
 }
 
+// CopyIn at an offset past the first buffer, as gathering a message from
+// several segments does.
+static bool copy_in_at_offset() {
+    BEGIN_TEST;
+
+    constexpr size_t kSize = BufferChain::kContig + 2 * BufferChain::kRawDataSize;
+    fbl::AllocChecker ac;
+    auto buf = ktl::unique_ptr<char[]>(new (&ac) char[kSize]);
+    ASSERT_TRUE(ac.check(), "");
+    ktl::unique_ptr<UserMemory> mem = UserMemory::Create(kSize);
+    auto mem_in = make_user_in_ptr(mem->in());
+    auto mem_out = make_user_out_ptr(mem->out());
+
+    BufferChain* bc = BufferChain::Alloc(kSize);
+    ASSERT_NE(nullptr, bc, "");
+
+    memset(buf.get(), 'A', kSize);
+    ASSERT_EQ(ZX_OK, mem_out.copy_array_to_user(buf.get(), kSize), "");
+    ASSERT_EQ(ZX_OK, bc->CopyIn(mem_in, 0, kSize), "");
+
+    // Write a run of 'C' that starts in the second buffer and ends in the third.
+    memset(buf.get(), 'C', kSize);
+    ASSERT_EQ(ZX_OK, mem_out.copy_array_to_user(buf.get(), kSize), "");
+    const size_t offset = BufferChain::kContig + BufferChain::kRawDataSize - 3;
+    const size_t size = 5;
+    ASSERT_EQ(ZX_OK, bc->CopyIn(mem_in, offset, size), "");
+
+    memset(buf.get(), 0, kSize);
+    ASSERT_EQ(ZX_OK, mem_out.copy_array_to_user(buf.get(), kSize), "");
+    ASSERT_EQ(ZX_OK, bc->CopyOut(mem_out, 0, kSize), "");
+    ASSERT_EQ(ZX_OK, mem_in.copy_array_from_user(buf.get(), kSize), "");
+    for (size_t i = 0; i < kSize; ++i) {
+        const char expected = (i >= offset && i < offset + size) ? 'C' : 'A';
+        ASSERT_EQ(expected, buf[i], "");
+    }
+
+    BufferChain::Free(bc);
+
+    END_TEST;
+}
+
 }  // namespace
 
 UNITTEST_START_TESTCASE(buffer_chain_tests)
 UNITTEST("alloc_free_basic", alloc_free_basic)
 UNITTEST("copy_in_copy_out", copy_in_copy_out)
+UNITTEST("copy_in_at_offset", copy_in_at_offset)
 UNITTEST_END_TESTCASE(buffer_chain_tests, "buffer_chain", "BufferChain tests");
@@ -16,6 +16,7 @@
 #include <object/handle.h>
 #include <object/job_dispatcher.h>
 #include <object/process_dispatcher.h>
+#include <object/slab.h>
 #include <object/vm_object_dispatcher.h>
 #include <pretty/sizes.h>
 #include <zircon/types.h>
@@ -60,7 +61,7 @@ static void DumpProcessListKeyMap() {
 }
 
 static const char* ObjectTypeToString(zx_obj_type_t type) {
-    static_assert(ZX_OBJ_TYPE_LAST == 29, "need to update switch below");
+    static_assert(ZX_OBJ_TYPE_LAST == 30, "need to update switch below");
 
     switch (type) {
         case ZX_OBJ_TYPE_PROCESS: return "process";
@@ -87,6 +88,7 @@ static const char* ObjectTypeToString(zx_obj_type_t type) {
         case ZX_OBJ_TYPE_PMT: return "pmt";
         case ZX_OBJ_TYPE_SUSPEND_TOKEN: return "suspend-token";
         case ZX_OBJ_TYPE_PAGER: return "pager";
+        case ZX_OBJ_TYPE_RING: return "ring";
         default: return "???";
     }
 }
@@ -115,7 +117,7 @@ static uint32_t BuildHandleStats(const ProcessDispatcher& pd,
 // buffer as strings.
 static void FormatHandleTypeCount(const ProcessDispatcher& pd,
                                   char *buf, size_t buf_len) {
-    static_assert(ZX_OBJ_TYPE_LAST == 29, "need to update table below");
+    static_assert(ZX_OBJ_TYPE_LAST == 30, "need to update table below");
 
     uint32_t types[ZX_OBJ_TYPE_LAST] = {0};
     uint32_t handle_count = BuildHandleStats(pd, types, sizeof(types));
@@ -132,7 +134,7 @@ static void FormatHandleTypeCount(const ProcessDispatcher& pd,
              types[ZX_OBJ_TYPE_PORT],
              types[ZX_OBJ_TYPE_SOCKET],
              types[ZX_OBJ_TYPE_TIMER],
-             types[ZX_OBJ_TYPE_FIFO],
+             types[ZX_OBJ_TYPE_FIFO] + types[ZX_OBJ_TYPE_RING],
              types[ZX_OBJ_TYPE_INTERRUPT] + types[ZX_OBJ_TYPE_PCI_DEVICE] +
              types[ZX_OBJ_TYPE_LOG] + types[ZX_OBJ_TYPE_RESOURCE] +
              types[ZX_OBJ_TYPE_GUEST] + types[ZX_OBJ_TYPE_VCPU] +
@@ -750,6 +752,7 @@ static int cmd_diagnostics(int argc, const cmd_args* argv, uint32_t flags) {
         printf("%s asd  <pid>|kernel : dump process/kernel address space\n",
                argv[0].str);
         printf("%s htinfo            : handle table info\n", argv[0].str);
+        printf("%s slabs             : kernel object slab usage\n", argv[0].str);
         return -1;
     }
 
@@ -818,6 +821,10 @@ static int cmd_diagnostics(int argc, const cmd_args* argv, uint32_t flags) {
         if (argc != 2)
             goto usage;
         DumpHandleTable();
+    } else if (strcmp(argv[1].str, "slabs") == 0) {
+        if (argc != 2)
+            goto usage;
+        Slab::DumpAll();
     } else {
         printf("unrecognized subcommand '%s'\n", argv[1].str);
         goto usage;
@@ -23,7 +23,10 @@ FutexContext::~FutexContext() {
 
     // All of the threads should have removed themselves from wait queues
     // by the time the process has exited.
-    DEBUG_ASSERT(futex_table_.is_empty());
+    for (Shard& shard : shards_) {
+        Guard<fbl::Mutex> guard{&shard.lock};
+        DEBUG_ASSERT(shard.futex_table.is_empty());
+    }
 }
 
 zx_status_t FutexContext::FutexWait(user_in_ptr<const zx_futex_t> value_ptr,
@@ -47,7 +50,8 @@ zx_status_t FutexContext::FutexWait(user_in_ptr<const zx_futex_t> value_ptr,
     // If a FutexWake() operation could occur between them, a userland mutex
     // operation built on top of futexes would have a race condition that
     // could miss wakeups.
-    Guard<fbl::Mutex> guard{&lock_};
+    Shard* shard = ShardFor(futex_key);
+    Guard<fbl::Mutex> guard{&shard->lock};
 
     int value;
     zx_status_t result = value_ptr.copy_from_user(&value);
@@ -62,9 +66,9 @@ zx_status_t FutexContext::FutexWait(user_in_ptr<const zx_futex_t> value_ptr,
     node.set_hash_key(futex_key);
     node.SetAsSingletonList();
 
-    QueueNodesLocked(&node);
+    QueueNodesLocked(shard, &node);
 
-    // Block current thread.  This releases lock_ and does not reacquire it.
+    // Block current thread.  This releases the shard's lock and does not reacquire it.
     result = node.BlockThread(guard.take(), deadline, slack);
     if (result == ZX_OK) {
         DEBUG_ASSERT(!node.IsInQueue());
@@ -78,9 +82,23 @@ zx_status_t FutexContext::FutexWait(user_in_ptr<const zx_futex_t> value_ptr,
     //
     // We need to ensure that the thread's node is removed from the wait
     // queue, because FutexWake() probably didn't do that.
-    Guard<fbl::Mutex> guard2{&lock_};
-    if (UnqueueNodeLocked(&node)) {
-        return result;
+    //
+    // FutexRequeue() may have moved the node to another futex, which may
+    // live in another shard, so find the shard from the node's current key.
+    // The key only changes while the locks of both the old and new shards
+    // are held, so once we hold the lock of the shard the key selects, the
+    // key cannot change under us.
+    for (;;) {
+        const uintptr_t key = node.GetKey();
+        Shard* node_shard = ShardFor(key);
+        Guard<fbl::Mutex> guard2{&node_shard->lock};
+        if (node.GetKey() != key) {
+            continue;
+        }
+        if (UnqueueNodeLocked(node_shard, &node)) {
+            return result;
+        }
+        break;
     }
     // The current thread was not found on the wait queue.  This means
     // that, although we hit the deadline (or were suspended/killed), we
@@ -119,9 +137,10 @@ zx_status_t FutexContext::FutexWake(user_in_ptr<const zx_futex_t> value_ptr,
 
     AutoReschedDisable resched_disable; // Must come before the Guard.
     resched_disable.Disable();
-    Guard<fbl::Mutex> guard{&lock_};
+    Shard* shard = ShardFor(futex_key);
+    Guard<fbl::Mutex> guard{&shard->lock};
 
-    FutexNode* node = futex_table_.erase(futex_key);
+    FutexNode* node = shard->futex_table.erase(futex_key);
     if (!node) {
         // nothing blocked on this futex if we can't find it
         return ZX_OK;
@@ -133,7 +152,7 @@ zx_status_t FutexContext::FutexWake(user_in_ptr<const zx_futex_t> value_ptr,
 
     if (remaining_waiters) {
         DEBUG_ASSERT(remaining_waiters->GetKey() == futex_key);
-        futex_table_.insert(remaining_waiters);
+        shard->futex_table.insert(remaining_waiters);
     }
 
     return ZX_OK;
@@ -159,24 +178,47 @@ zx_status_t FutexContext::FutexRequeue(user_in_ptr<const zx_futex_t> wake_ptr,
         return ZX_ERR_INVALID_ARGS;
     }
 
+    uintptr_t wake_key = reinterpret_cast<uintptr_t>(wake_ptr.get());
+    uintptr_t requeue_key = reinterpret_cast<uintptr_t>(requeue_ptr.get());
+    if (wake_key == requeue_key) return ZX_ERR_INVALID_ARGS;
+    if (wake_key % sizeof(int) || requeue_key % sizeof(int))
+        return ZX_ERR_INVALID_ARGS;
+
+    // Both futexes' shards are locked for the whole operation, so that
+    // waiters move from one futex to the other atomically.  GuardMultiple
+    // takes the two locks in address order.
+    Shard* wake_shard = ShardFor(wake_key);
+    Shard* requeue_shard = ShardFor(requeue_key);
+
     AutoReschedDisable resched_disable; // Must come before the Guard.
-    Guard<fbl::Mutex> guard{&lock_};
+    if (wake_shard == requeue_shard) {
+        Guard<fbl::Mutex> guard{&wake_shard->lock};
+        return RequeueLocked(wake_ptr, current_value, &resched_disable,
+                             wake_shard, wake_key, wake_count,
+                             requeue_shard, requeue_key, requeue_count);
+    }
+    GuardMultiple<2, fbl::Mutex> guard{&wake_shard->lock, &requeue_shard->lock};
+    return RequeueLocked(wake_ptr, current_value, &resched_disable,
+                         wake_shard, wake_key, wake_count,
+                         requeue_shard, requeue_key, requeue_count);
+}
 
+zx_status_t FutexContext::RequeueLocked(user_in_ptr<const zx_futex_t> wake_ptr,
+                                        zx_futex_t current_value,
+                                        AutoReschedDisable* resched_disable,
+                                        Shard* wake_shard, uintptr_t wake_key,
+                                        uint32_t wake_count,
+                                        Shard* requeue_shard, uintptr_t requeue_key,
+                                        uint32_t requeue_count) {
     int value;
     zx_status_t result = wake_ptr.copy_from_user(&value);
     if (result != ZX_OK) return result;
     if (value != current_value) return ZX_ERR_BAD_STATE;
 
-    uintptr_t wake_key = reinterpret_cast<uintptr_t>(wake_ptr.get());
-    uintptr_t requeue_key = reinterpret_cast<uintptr_t>(requeue_ptr.get());
-    if (wake_key == requeue_key) return ZX_ERR_INVALID_ARGS;
-    if (wake_key % sizeof(int) || requeue_key % sizeof(int))
-        return ZX_ERR_INVALID_ARGS;
-
     // This must happen before RemoveFromHead() calls set_hash_key() on
-    // nodes below, because operations on futex_table_ look at the GetKey
-    // field of the list head nodes for wake_key and requeue_key.
-    FutexNode* node = futex_table_.erase(wake_key);
+    // nodes below, because operations on the futex tables look at the
+    // GetKey field of the list head nodes for wake_key and requeue_key.
+    FutexNode* node = wake_shard->futex_table.erase(wake_key);
     if (!node) {
         // nothing blocked on this futex if we can't find it
         return ZX_OK;
@@ -184,7 +226,7 @@ zx_status_t FutexContext::FutexRequeue(user_in_ptr<const zx_futex_t> wake_ptr,
 
     // This must come before WakeThreads() to be useful, but we want to
     // avoid doing it before copy_from_user() in case that faults.
-    resched_disable.Disable();
+    resched_disable->Disable();
 
     if (wake_count > 0) {
         node = FutexNode::WakeThreads(node, wake_count, wake_key);
@@ -200,14 +242,14 @@ zx_status_t FutexContext::FutexRequeue(user_in_ptr<const zx_futex_t> wake_ptr,
 
             // now requeue our nodes to requeue_ptr mutex
             DEBUG_ASSERT(requeue_head->GetKey() == requeue_key);
-            QueueNodesLocked(requeue_head);
+            QueueNodesLocked(requeue_shard, requeue_head);
         }
     }
 
     // add any remaining nodes back to wake_key futex
     if (node != nullptr) {
         DEBUG_ASSERT(node->GetKey() == wake_key);
-        futex_table_.insert(node);
+        wake_shard->futex_table.insert(node);
     }
 
     return ZX_OK;
@@ -218,8 +260,8 @@ zx_status_t FutexContext::FutexGetOwner(user_in_ptr<const zx_futex_t> wake_ptr,
     return koid.copy_to_user(ZX_KOID_INVALID);
 }
 
-void FutexContext::QueueNodesLocked(FutexNode* head) {
-    DEBUG_ASSERT(lock_.lock().IsHeld());
+void FutexContext::QueueNodesLocked(Shard* shard, FutexNode* head) {
+    DEBUG_ASSERT(shard->lock.lock().IsHeld());
 
     FutexNode::HashTable::iterator iter;
 
@@ -227,15 +269,15 @@ void FutexContext::QueueNodesLocked(FutexNode* head) {
     // succeeds, then the current thread is first to block on this futex and we
     // are finished.  If the insert fails, then there is already a thread
     // waiting on this futex.  Add ourselves to that thread's list.
-    if (!futex_table_.insert_or_find(head, &iter))
+    if (!shard->futex_table.insert_or_find(head, &iter))
         iter->AppendList(head);
 }
 
 // This attempts to unqueue a thread (which may or may not be waiting on a
 // futex), given its FutexNode.  This returns whether the FutexNode was
 // found and removed from a futex wait queue.
-bool FutexContext::UnqueueNodeLocked(FutexNode* node) {
-    DEBUG_ASSERT(lock_.lock().IsHeld());
+bool FutexContext::UnqueueNodeLocked(Shard* shard, FutexNode* node) {
+    DEBUG_ASSERT(shard->lock.lock().IsHeld());
 
     if (!node->IsInQueue())
         return false;
@@ -246,10 +288,10 @@ bool FutexContext::UnqueueNodeLocked(FutexNode* node) {
     // FutexRequeue(), so we need to re-get the hash table key here.
     uintptr_t futex_key = node->GetKey();
 
-    FutexNode* old_head = futex_table_.erase(futex_key);
+    FutexNode* old_head = shard->futex_table.erase(futex_key);
     DEBUG_ASSERT(old_head);
     FutexNode* new_head = FutexNode::RemoveNodeFromList(old_head, node);
     if (new_head)
-        futex_table_.insert(new_head);
+        shard->futex_table.insert(new_head);
     return true;
 }
@@ -83,8 +83,7 @@ FutexNode* FutexNode::WakeThreads(FutexNode* node, uint32_t count,
     FutexNode* const list_end = node->queue_prev_;
     for (uint32_t i = 0; i < count; i++) {
         DEBUG_ASSERT(node->GetKey() == old_hash_key);
-        // Clear this field to avoid any possible confusion.
-        node->set_hash_key(0);
+        // Keep the key: a racing timeout uses it to find our shard lock.
 
         const bool is_last_node = (node == list_end);
         FutexNode* next = node->queue_next_;
@@ -177,12 +176,12 @@ void FutexNode::WakeThread() {
     // cases to consider:
     //  1) The thread's wait times out, or the thread is killed or
     //     suspended.  In those cases, FutexWait() will reacquire the
-    //     FutexContext lock.  We are currently holding that lock, so
+    //     shard lock.  We are currently holding that lock, so
     //     FutexWait() will not race with us.
     //  2) The thread is woken by our wait_queue_wake_one() call.  In
-    //     this case, FutexWait() will *not* reacquire the FutexContext
-    //     lock.  To handle this correctly, we must not access |this|
-    //     after wait_queue_wake_one().
+    //     this case, FutexWait() will *not* reacquire the shard lock.
+    //     To handle this correctly, we must not access |this| after
+    //     wait_queue_wake_one().
 
     // We must do this before we wake the thread, to handle case 2.
     MarkAsNotInQueue();
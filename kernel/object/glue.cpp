@@ -19,9 +19,13 @@
 
 #include <lib/oom.h>
 
+#include <object/channel_dispatcher.h>
 #include <object/diagnostics.h>
+#include <object/event_dispatcher.h>
+#include <object/event_pair_dispatcher.h>
 #include <object/excp_port.h>
 #include <object/job_dispatcher.h>
+#include <object/message_packet.h>
 #include <object/port_dispatcher.h>
 #include <object/process_dispatcher.h>
 
@@ -62,14 +66,33 @@ static void oom_lowmem(size_t shortfall_bytes) {
     }
 }
 
+// How many objects each of the slabs below reserves room for.  Objects
+// made past that come from the heap.
+static constexpr size_t kObjectSlabCount = 32 * 1024u;
+
+template <typename T>
+static void init_object_slab(const char* name) {
+    zx_status_t status = T::InitSlab(name, kObjectSlabCount);
+    if (status != ZX_OK) {
+        printf("WARNING: could not set up the %s slab: %d\n", name, status);
+    }
+}
+
 static void object_glue_init(uint level) TA_NO_THREAD_SAFETY_ANALYSIS {
     Handle::Init();
     root_job = JobDispatcher::CreateRootJob();
     PortDispatcher::Init();
+    MessagePacket::Init();
+    // The kinds of object that are made and destroyed most often.
+    init_object_slab<ChannelDispatcher>("channels");
+    init_object_slab<EventDispatcher>("events");
+    init_object_slab<EventPairDispatcher>("eventpairs");
+    init_object_slab<PortObserver>("port-observers");
     // Be sure to update kernel_cmdline.md if any of these defaults change.
     oom_init(cmdline_get_bool("kernel.oom.enable", true),
              ZX_SEC(cmdline_get_uint64("kernel.oom.sleep-sec", 1)),
              cmdline_get_uint64("kernel.oom.redline-mb", 50) * MB,
+             cmdline_get_uint64("kernel.oom.reclaim-mb", 100) * MB,
              oom_lowmem);
 }
 
@@ -7,10 +7,15 @@
 #include <object/handle.h>
 
 #include <object/dispatcher.h>
-#include <fbl/arena.h>
+#include <arch/ops.h>
 #include <fbl/mutex.h>
+#include <kernel/align.h>
+#include <kernel/lockdep.h>
+#include <kernel/mutex.h>
+#include <kernel/thread.h>
 #include <lib/counters.h>
 #include <pow2.h>
+#include <string.h>
 
 namespace {
 
@@ -49,12 +54,29 @@ static_assert(((3 << 30) ^ kHandleGenerationMask ^ kHandleIndexMask) ==
                   0xffffffffu,
               "Masks do not agree");
 
+// Reader sections count themselves on their own cpu, in
+// readers[cpu].count[reader_epoch % 2], trying again if the epoch moved
+// while they did.  WaitForReaders() advances the epoch, so later sections
+// count in the other slot, then waits for the old slot to drain on every
+// cpu.
+struct ReaderCount {
+    fbl::atomic<uint32_t> count[2];
+} __CPU_ALIGN;
+ReaderCount readers[SMP_MAX_CPUS];
+fbl::atomic<uint32_t> reader_epoch;
+
+// One WaitForReaders() runs at a time, so the sections it has to wait for
+// are all in the slot it drains.
+struct HandleReaderWait {};
+DECLARE_MUTEX(HandleReaderWait) reader_wait_lock;
+
 }  // namespace
 
-fbl::Arena Handle::arena_;
+Slab Handle::slab_;
+fbl::atomic<size_t> Handle::outstanding_;
 
-void Handle::Init() TA_NO_THREAD_SAFETY_ANALYSIS {
-    arena_.Init("handles", sizeof(Handle), kMaxHandleCount);
+void Handle::Init() {
+    slab_.Init("handles", sizeof(Handle), kMaxHandleCount);
 }
 
 void Handle::set_process_id(zx_koid_t pid) {
@@ -65,7 +87,7 @@ void Handle::set_process_id(zx_koid_t pid) {
 // Returns a new |base_value| based on the value stored in the free
 // arena slot pointed to by |addr|. The new value will be different
 // from the last |base_value| used by this slot.
-uint32_t Handle::GetNewBaseValue(void* addr) TA_REQ(ArenaLock::Get()) {
+uint32_t Handle::GetNewBaseValue(void* addr) {
     // Get the index of this slot within the arena.
     uint32_t handle_index = HandleToIndex(reinterpret_cast<Handle*>(addr));
     DEBUG_ASSERT((handle_index & ~kHandleIndexMask) == 0);
@@ -83,33 +105,28 @@ uint32_t Handle::GetNewBaseValue(void* addr) TA_REQ(ArenaLock::Get()) {
     return (handle_index | new_gen);
 }
 
-// Allocate space for a Handle from the arena, but don't instantiate the
+// Allocate space for a Handle from the slab, but don't instantiate the
 // object.  |base_value| gets the value for Handle::base_value_.  |what|
 // says whether this is allocation or duplication, for the error message.
 void* Handle::Alloc(const fbl::RefPtr<Dispatcher>& dispatcher,
                     const char* what, uint32_t* base_value) {
-    size_t outstanding_handles;
-    {
-        Guard<fbl::Mutex> guard{ArenaLock::Get()};
-        void* addr = arena_.Alloc();
-        outstanding_handles = arena_.DiagnosticCount();
-        if (likely(addr)) {
-            if (outstanding_handles > kHighHandleCount) {
-                // TODO: Avoid calling this for every handle after
-                // kHighHandleCount; printfs are slow and we're
-                // holding the mutex.
-                printf("WARNING: High handle count: %zu handles\n",
-                       outstanding_handles);
-            }
-            dispatcher->increment_handle_count();
-            *base_value = GetNewBaseValue(addr);
-            return addr;
-        }
+    void* addr = slab_.Alloc();
+    if (unlikely(!addr)) {
+        printf("WARNING: Could not allocate %s handle (%zu outstanding)\n",
+               what, outstanding_.load(fbl::memory_order_relaxed));
+        return nullptr;
     }
 
-    printf("WARNING: Could not allocate %s handle (%zu outstanding)\n",
-           what, outstanding_handles);
-    return nullptr;
+    size_t outstanding_handles = outstanding_.fetch_add(1, fbl::memory_order_relaxed) + 1;
+    if (outstanding_handles > kHighHandleCount) {
+        // TODO: Avoid calling this for every handle after
+        // kHighHandleCount; printfs are slow.
+        printf("WARNING: High handle count: %zu handles\n",
+               outstanding_handles);
+    }
+    dispatcher->increment_handle_count();
+    *base_value = GetNewBaseValue(addr);
+    return addr;
 }
 
 HandleOwner Handle::Make(fbl::RefPtr<Dispatcher> dispatcher,
@@ -156,7 +173,7 @@ Handle::Handle(Handle* rhs, zx_rights_t rights, uint32_t base_value)
 // Destroys, but does not free, the Handle, and fixes up its memory to protect
 // against stale pointers to it. Also stashes the Handle's base_value for reuse
 // the next time this slot is allocated.
-void Handle::TearDown() TA_EXCL(ArenaLock::Get()) {
+void Handle::TearDown() {
     uint32_t old_base_value = base_value();
 
     // Calling the handle dtor can cause many things to happen, so it is
@@ -179,7 +196,48 @@ void Handle::TearDown() TA_EXCL(ArenaLock::Get()) {
     DEBUG_ASSERT(process_id() == 0);
 }
 
+Handle::Reader::Reader() {
+    thread_preempt_disable();
+    cpu_ = arch_curr_cpu_num();
+    // The epoch may advance between reading it and counting ourselves, and
+    // the waiter that advanced it won't look at the slot we picked, so check
+    // that it didn't before going on.
+    for (;;) {
+        const uint32_t epoch = reader_epoch.load();
+        index_ = epoch % 2;
+        readers[cpu_].count[index_].fetch_add(1);
+        if (reader_epoch.load() == epoch)
+            break;
+        readers[cpu_].count[index_].fetch_sub(1, fbl::memory_order_release);
+    }
+}
+
+Handle::Reader::~Reader() {
+    readers[cpu_].count[index_].fetch_sub(1, fbl::memory_order_release);
+    thread_preempt_reenable();
+}
+
+// A handle is taken out of its process, clearing its process_id(), before
+// it can be deleted.  A section that counted itself and then saw the epoch
+// unchanged may have found the handle and is waited for here.  One that
+// sees the epoch this advances to began after process_id() was cleared, so
+// its lookup can't return the handle.
+void Handle::WaitForReaders() {
+    Guard<fbl::Mutex> guard{&reader_wait_lock};
+    const uint32_t index = reader_epoch.fetch_add(1) % 2;
+    for (cpu_num_t cpu = 0; cpu < arch_max_num_cpus(); cpu++) {
+        while (readers[cpu].count[index].load() != 0) {
+            arch_spinloop_pause();
+        }
+    }
+}
+
 void Handle::Delete() {
+    // Sections are short and can't be preempted, so this waits for at most
+    // one lookup per cpu.  Handles that only move between processes never
+    // get here.
+    WaitForReaders();
+
     fbl::RefPtr<Dispatcher> disp = dispatcher();
 
     if (disp->is_waitable())
@@ -187,12 +245,9 @@ void Handle::Delete() {
 
     TearDown();
 
-    bool zero_handles = false;
-    {
-        Guard<fbl::Mutex> guard{ArenaLock::Get()};
-        zero_handles = disp->decrement_handle_count();
-        arena_.Free(this);
-    }
+    bool zero_handles = disp->decrement_handle_count();
+    slab_.Free(this);
+    outstanding_.fetch_sub(1, fbl::memory_order_relaxed);
 
     if (zero_handles)
         disp->on_zero_handles();
@@ -202,29 +257,22 @@ void Handle::Delete() {
     kcounter_add(handle_count_live, -1);
 }
 
-Handle* Handle::FromU32(uint32_t value) TA_NO_THREAD_SAFETY_ANALYSIS {
+Handle* Handle::FromU32(uint32_t value) {
     uintptr_t handle_addr = IndexToHandle(value & kHandleIndexMask);
-    {
-        Guard<fbl::Mutex> guard{ArenaLock::Get()};
-        if (unlikely(!arena_.in_range(handle_addr)))
-            return nullptr;
-    }
+    if (unlikely(!slab_.in_range(handle_addr)))
+        return nullptr;
     auto handle = reinterpret_cast<Handle*>(handle_addr);
     return likely(handle->base_value() == value) ? handle : nullptr;
 }
 
 uint32_t Handle::Count(const fbl::RefPtr<const Dispatcher>& dispatcher) {
-    // Handle::ArenaLock also guards Dispatcher::handle_count_.
-    Guard<fbl::Mutex> guard{ArenaLock::Get()};
     return dispatcher->current_handle_count();
 }
 
 size_t Handle::diagnostics::OutstandingHandles() {
-    Guard<fbl::Mutex> guard{ArenaLock::Get()};
-    return arena_.DiagnosticCount();
+    return outstanding_.load(fbl::memory_order_relaxed);
 }
 
 void Handle::diagnostics::DumpTableInfo() {
-    Guard<fbl::Mutex> guard{ArenaLock::Get()};
-    arena_.Dump();
+    slab_.DumpArena();
 }
@@ -0,0 +1,73 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <object/handle.h>
+
+#include <fbl/ref_ptr.h>
+#include <lib/unittest/unittest.h>
+#include <object/event_dispatcher.h>
+
+namespace {
+
+// Make and delete more handles than a cpu's slot cache holds, so slots
+// move between the caches and the arena, and check that the dispatcher's
+// handle count balances.
+static bool make_and_delete_many() {
+    BEGIN_TEST;
+    constexpr size_t kCount = 100;
+
+    fbl::RefPtr<Dispatcher> event;
+    zx_rights_t rights;
+    ASSERT_EQ(ZX_OK, EventDispatcher::Create(0u, &event, &rights), "");
+
+    HandleOwner handles[kCount];
+    for (auto& handle : handles) {
+        handle = Handle::Make(event, rights);
+        ASSERT_TRUE(handle, "");
+    }
+    EXPECT_EQ(kCount, Handle::Count(event), "");
+
+    for (auto& handle : handles) {
+        EXPECT_EQ(handle.get(), Handle::FromU32(handle->base_value()), "");
+    }
+
+    for (auto& handle : handles) {
+        handle.reset(nullptr);
+    }
+    EXPECT_EQ(0u, Handle::Count(event), "");
+    END_TEST;
+}
+
+// A deleted handle's value must not find whatever next uses its slot.
+static bool reused_slot_gets_new_value() {
+    BEGIN_TEST;
+
+    fbl::RefPtr<Dispatcher> event;
+    zx_rights_t rights;
+    ASSERT_EQ(ZX_OK, EventDispatcher::Create(0u, &event, &rights), "");
+
+    HandleOwner handle = Handle::Make(event, rights);
+    ASSERT_TRUE(handle, "");
+    Handle* const old_addr = handle.get();
+    const uint32_t old_value = handle->base_value();
+    handle.reset(nullptr);
+    EXPECT_NULL(Handle::FromU32(old_value), "");
+
+    handle = Handle::Make(event, rights);
+    ASSERT_TRUE(handle, "");
+    if (handle.get() == old_addr) {
+        EXPECT_NE(old_value, handle->base_value(), "");
+    }
+    EXPECT_NULL(Handle::FromU32(old_value), "");
+    END_TEST;
+}
+
+} // namespace
+
+UNITTEST_START_TESTCASE(handle_tests)
+UNITTEST("make_and_delete_many", make_and_delete_many)
+UNITTEST("reused_slot_gets_new_value", reused_slot_gets_new_value)
+UNITTEST_END_TESTCASE(handle_tests, "handle", "Handle tests");
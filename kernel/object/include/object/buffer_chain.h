@@ -134,7 +134,8 @@ public:
 
     // Copies |size| bytes from |src| to this chain starting at offset |dst_offset|.
     //
-    // |dst_offset| must be in the range [0, kContig).
+    // |dst_offset| may be anywhere in the chain, though offsets past the first
+    // buffer cost a walk along the chain to find.
     zx_status_t CopyIn(user_in_ptr<const void> src, size_t dst_offset, size_t size) {
         return CopyInCommon(src, dst_offset, size);
     }
@@ -184,11 +185,14 @@ private:
     // |PTR_IN| is a user_in_ptr-like type.
     template <typename PTR_IN>
     zx_status_t CopyInCommon(PTR_IN src, size_t dst_offset, size_t size) {
-        DEBUG_ASSERT(dst_offset < buffers_.front().size());
         size_t copy_offset = dst_offset;
         size_t rem = size;
         const auto end = buffers_.end();
         for (auto iter = buffers_.begin(); rem > 0 && iter != end; ++iter) {
+            if (copy_offset >= iter->size()) {
+                copy_offset -= iter->size();
+                continue;
+            }
             const size_t copy_len = fbl::min(rem, iter->size() - copy_offset);
             char* dst = iter->data() + copy_offset;
             const zx_status_t status = src.copy_array_from_user(dst, copy_len);
@@ -11,6 +11,7 @@
 #include <kernel/event.h>
 #include <object/dispatcher.h>
 #include <object/message_packet.h>
+#include <object/slab.h>
 
 #include <zircon/rights.h>
 #include <zircon/types.h>
@@ -22,7 +23,8 @@
 #include <ktl/unique_ptr.h>
 
 class ChannelDispatcher final :
-    public PeeredDispatcher<ChannelDispatcher, ZX_DEFAULT_CHANNEL_RIGHTS> {
+    public PeeredDispatcher<ChannelDispatcher, ZX_DEFAULT_CHANNEL_RIGHTS>,
+    public SlabAllocated<ChannelDispatcher> {
 public:
     class MessageWaiter;
 
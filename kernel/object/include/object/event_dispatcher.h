@@ -11,11 +11,13 @@
 
 #include <fbl/canary.h>
 #include <object/dispatcher.h>
+#include <object/slab.h>
 
 #include <sys/types.h>
 
 class EventDispatcher final :
-    public SoloDispatcher<EventDispatcher, ZX_DEFAULT_EVENT_RIGHTS, ZX_EVENT_SIGNALED> {
+    public SoloDispatcher<EventDispatcher, ZX_DEFAULT_EVENT_RIGHTS, ZX_EVENT_SIGNALED>,
+    public SlabAllocated<EventDispatcher> {
 public:
     static zx_status_t Create(uint32_t options, fbl::RefPtr<Dispatcher>* dispatcher,
                               zx_rights_t* rights);
@@ -13,10 +13,12 @@
 #include <fbl/mutex.h>
 #include <fbl/ref_ptr.h>
 #include <object/dispatcher.h>
+#include <object/slab.h>
 #include <sys/types.h>
 
 class EventPairDispatcher final :
-    public PeeredDispatcher<EventPairDispatcher, ZX_DEFAULT_EVENTPAIR_RIGHTS, ZX_EVENT_SIGNALED> {
+    public PeeredDispatcher<EventPairDispatcher, ZX_DEFAULT_EVENTPAIR_RIGHTS, ZX_EVENT_SIGNALED>,
+    public SlabAllocated<EventPairDispatcher> {
 public:
     static zx_status_t Create(fbl::RefPtr<Dispatcher>* dispatcher0,
                               fbl::RefPtr<Dispatcher>* dispatcher1,
@@ -13,8 +13,10 @@
 #include <object/futex_node.h>
 
 // FutexContext is a class that encapsulates support for futex operations.
-// FutexContext uses a hash table keyed on the futex address (a pointer to integer in userspace)
-// to contain all active futexes.
+// FutexContext uses hash tables keyed on the futex address (a pointer to integer in userspace)
+// to contain all active futexes.  The futexes are spread by address over a fixed number of
+// shards, each a hash table with its own lock, so that threads using unrelated futexes do not
+// contend with each other.
 // A futex is considered active if there is one or more threads blocked on the futex.
 // After no threads are left blocked on a futex it is removed from the hash table.
 // The value in the futex hash table is the FutexNode object associated with the head
@@ -79,14 +81,35 @@ private:
     FutexContext(const FutexContext&) = delete;
     FutexContext& operator=(const FutexContext&) = delete;
 
-    void QueueNodesLocked(FutexNode* head) TA_REQ(lock_);
+    static constexpr size_t kNumShards = 16;
 
-    bool UnqueueNodeLocked(FutexNode* node) TA_REQ(lock_);
+    struct Shard {
+        // protects futex_table
+        DECLARE_MUTEX(Shard) lock;
 
-    // protects futex_table_
-    DECLARE_MUTEX(FutexContext) lock_;
+        // Hash table for the futexes in this shard.
+        // Key is futex address, value is the FutexNode for the head of futex's blocked thread
+        // list.
+        FutexNode::HashTable futex_table TA_GUARDED(lock);
+    };
+
+    Shard* ShardFor(uintptr_t futex_key) {
+        return &shards_[FutexNode::GetHash(futex_key) % kNumShards];
+    }
+
+    static void QueueNodesLocked(Shard* shard, FutexNode* head) TA_REQ(shard->lock);
+
+    static bool UnqueueNodeLocked(Shard* shard, FutexNode* node) TA_REQ(shard->lock);
+
+    // The body of FutexRequeue(), run with the locks of both futexes' shards held (they are
+    // the same shard if both keys land in it).  The analysis cannot follow which locks the
+    // caller took, hence TA_NO_THREAD_SAFETY_ANALYSIS.
+    static zx_status_t RequeueLocked(user_in_ptr<const zx_futex_t> wake_ptr,
+                                     zx_futex_t current_value,
+                                     AutoReschedDisable* resched_disable,
+                                     Shard* wake_shard, uintptr_t wake_key, uint32_t wake_count,
+                                     Shard* requeue_shard, uintptr_t requeue_key,
+                                     uint32_t requeue_count) TA_NO_THREAD_SAFETY_ANALYSIS;
 
-    // Hash table for futexes in this context.
-    // Key is futex address, value is the FutexNode for the head of futex's blocked thread list.
-    FutexNode::HashTable futex_table_ TA_GUARDED(lock_);
+    Shard shards_[kNumShards];
 };
@@ -11,6 +11,7 @@
 #include <kernel/wait.h>
 #include <list.h>
 #include <zircon/types.h>
+#include <fbl/atomic.h>
 #include <fbl/intrusive_hash_table.h>
 #include <fbl/mutex.h>
 
@@ -47,11 +48,11 @@ public:
     zx_status_t BlockThread(Guard<fbl::Mutex>&& adopt_guard, zx_time_t deadline, TimerSlack slack);
 
     void set_hash_key(uintptr_t key) {
-        hash_key_ = key;
+        hash_key_.store(key, fbl::memory_order_relaxed);
     }
 
     // Trait implementation for fbl::HashTable
-    uintptr_t GetKey() const { return hash_key_; }
+    uintptr_t GetKey() const { return hash_key_.load(fbl::memory_order_relaxed); }
     static size_t GetHash(uintptr_t key) { return (key >> 3); }
 
 private:
@@ -64,11 +65,13 @@ private:
 
     // hash_key_ contains the futex address.  This field has two roles:
     //  * It is used by FutexWait() to determine which queue to remove the
-    //    thread from when a wait operation times out.
+    //    thread from when a wait operation times out.  FutexWait() reads it
+    //    before it holds the lock of the shard the key selects, so it is
+    //    atomic, and FutexWait() checks it again once it has that lock.
     //  * Additionally, when this FutexNode is the head of a futex wait
     //    queue, this field is used by the HashTable (because it uses
     //    intrusive SinglyLinkedLists).
-    uintptr_t hash_key_;
+    fbl::atomic<uintptr_t> hash_key_;
 
     // Used for waking the thread corresponding to the FutexNode.
     WaitQueue wait_queue_;
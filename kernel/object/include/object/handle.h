@@ -6,13 +6,13 @@
 
 #pragma once
 
-#include <fbl/arena.h>
 #include <fbl/atomic.h>
 #include <fbl/intrusive_double_list.h>
 #include <fbl/macros.h>
 #include <fbl/mutex.h>
 #include <fbl/ref_ptr.h>
-#include <kernel/lockdep.h>
+#include <kernel/cpu.h>
+#include <object/slab.h>
 #include <stdint.h>
 #include <zircon/types.h>
 
@@ -79,10 +79,6 @@ private:
 // A Handle is how a specific process refers to a specific Dispatcher.
 class Handle final : public fbl::DoublyLinkedListable<Handle*> {
 public:
-    // The handle arena's mutex. This is public since it protects
-    // other things like |Dispatcher::handle_count_|.
-    DECLARE_SINGLETON_MUTEX(ArenaLock);
-
     // Returns the Dispatcher to which this instance points.
     const fbl::RefPtr<Dispatcher>& dispatcher() const { return dispatcher_; }
 
@@ -136,6 +132,23 @@ public:
         fbl::RefPtr<Dispatcher> dispatcher, zx_rights_t rights);
     static HandleOwner Dup(Handle* source, zx_rights_t rights);
 
+    // While in scope, keeps any Handle found through FromU32() from being
+    // torn down, without taking a lock, so that lookups from many threads
+    // don't contend.  Sections must be short and must not block: they run
+    // with preemption disabled, and Delete() waits for every section that
+    // began before it to end.
+    class Reader {
+    public:
+        Reader();
+        ~Reader();
+
+    private:
+        DISALLOW_COPY_ASSIGN_AND_MOVE(Reader);
+
+        cpu_num_t cpu_;
+        uint32_t index_;
+    };
+
 private:
     DISALLOW_COPY_ASSIGN_AND_MOVE(Handle);
 
@@ -153,9 +166,12 @@ private:
     // Handle should never be destroyed by anything other than Delete,
     // which uses TearDown to do the actual destruction.
     ~Handle() = default;
-    void TearDown() TA_EXCL(ArenaLock::Get());
+    void TearDown();
     void Delete();
 
+    // Waits for every Reader section that was running when it was called.
+    static void WaitForReaders();
+
     // Only HandleOwner is allowed to call Delete.
     friend class HandleOwner;
 
@@ -167,18 +183,23 @@ private:
     const zx_rights_t rights_;
     const uint32_t base_value_;
 
-    // The handle arena.
-    static fbl::Arena TA_GUARDED(ArenaLock::Get()) arena_;
+    // The handle slab.  Its arena's memory doubles as the handle table:
+    // base_value() holds the slot's index.
+    static Slab slab_;
+
+    // The number of live handles.
+    static fbl::atomic<size_t> outstanding_;
 
-    // NOTE! This can return an invalid address.  It must be checked
-    // against the arena bounds before being cast to a Handle*.
-    static uintptr_t IndexToHandle(uint32_t index) TA_NO_THREAD_SAFETY_ANALYSIS {
-        return reinterpret_cast<uintptr_t>(arena_.start()) + index * sizeof(Handle);
+    // NOTE! This can return an invalid address.  It must be checked with
+    // slab_.in_range(), not just the slab's fixed bounds, before being cast
+    // to a Handle*.
+    static uintptr_t IndexToHandle(uint32_t index) {
+        return slab_.start() + index * sizeof(Handle);
     }
 
-    static uint32_t HandleToIndex(Handle* handle) TA_NO_THREAD_SAFETY_ANALYSIS {
+    static uint32_t HandleToIndex(Handle* handle) {
         return static_cast<uint32_t>(
-            handle - reinterpret_cast<Handle*>(arena_.start()));
+            handle - reinterpret_cast<Handle*>(slab_.start()));
     }
 };
 
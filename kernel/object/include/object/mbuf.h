@@ -11,6 +11,9 @@
 #include <lib/user_copy/user_ptr.h>
 #include <zircon/types.h>
 #include <fbl/intrusive_single_list.h>
+#include <fbl/ref_ptr.h>
+
+class VmObject;
 
 // MBufChain is a container for storing a stream of bytes or a sequence of datagrams.
 //
@@ -36,6 +39,17 @@ public:
     // Returns an error on failure.
     zx_status_t WriteDatagram(user_in_ptr<const void> src, size_t len, size_t* written);
 
+    // Writes up to |len| bytes of stream data from |vmo| starting at |offset| and sets |written|
+    // to number of bytes written.
+    //
+    // When |offset| is page aligned, the whole pages written are moved out of |vmo| and loaned to
+    // the chain instead of being copied, leaving that range of |vmo| empty.  The rest, and the
+    // bytes of VMOs whose pages can't be moved, are copied.
+    //
+    // Returns an error on failure.
+    zx_status_t WriteStreamVmo(const fbl::RefPtr<VmObject>& vmo, uint64_t offset, size_t len,
+                               size_t* written);
+
     // Reads upto |len| bytes from chain into |dst|.
     //
     // When |datagram| is false, the data in the chain is treated as a stream (no boundaries).
@@ -47,6 +61,26 @@ public:
     // Returns number of bytes read.
     size_t Read(user_out_ptr<void> dst, size_t len, bool datagram);
 
+    // Reads upto |len| bytes of stream data from the chain into a new VMO, starting at its offset
+    // 0, and sets |nread| to the number of bytes read.
+    //
+    // Whole pages loaned by WriteStreamVmo() are handed on without copying when the read starts
+    // on a page boundary within them and |len| is at least a page; the read then stops at the end
+    // of the loan.  Anything else is copied, up to the start of the next such loan.
+    //
+    // Returns an error on failure.
+    zx_status_t ReadVmo(size_t len, fbl::RefPtr<VmObject>* vmo, size_t* nread);
+
+    // The two halves of ReadVmo(), for callers with more to do that can fail before the bytes
+    // are taken out of the chain.  PeekVmo() makes the VMO and sets |npeeked| but leaves the
+    // chain as it is.  ConsumeVmo() must follow with nothing else done to the chain in
+    // between, passing the VMO and count PeekVmo() returned; it finishes filling the VMO and
+    // takes the bytes out of the chain.
+    //
+    // Both return an error on failure, leaving the chain as it was.
+    zx_status_t PeekVmo(size_t len, fbl::RefPtr<VmObject>* vmo, size_t* npeeked);
+    zx_status_t ConsumeVmo(const fbl::RefPtr<VmObject>& vmo, size_t len);
+
     bool is_full() const;
     bool is_empty() const;
 
@@ -66,8 +100,8 @@ public:
 private:
     // An MBuf is a small fixed-size chainable memory buffer.
     struct MBuf : public fbl::SinglyLinkedListable<MBuf*> {
-        // 8 for the linked list and 4 for the explicit uint32_t fields.
-        static constexpr size_t kHeaderSize = 8 + (4 * 4);
+        // 8 for the linked list, 8 for the loaned VMO and 4 for the explicit uint32_t fields.
+        static constexpr size_t kHeaderSize = 8 + 8 + (4 * 4);
         // 16 is for the malloc header.
         static constexpr size_t kMallocSize = 2048 - 16;
         static constexpr size_t kPayloadSize = kMallocSize - kHeaderSize;
@@ -84,8 +118,10 @@ private:
         // Always 0 in ZX_SOCKET_STREAM mode.
         uint32_t pkt_len_ = 0u;
         uint32_t unused_;
+        // When set, the bytes of this MBuf are at [off_, off_ + len_) of |vmo_|, which
+        // holds the whole pages loaned by a writer, rather than in |data_|.
+        fbl::RefPtr<VmObject> vmo_;
         char data_[kPayloadSize] = {0};
-        // TODO: maybe union data_ with char* blocks for large messages
     };
     static_assert(sizeof(MBuf) == MBuf::kMallocSize, "");
 
@@ -94,6 +130,13 @@ private:
     MBuf* AllocMBuf();
     void FreeMBuf(MBuf* buf);
 
+    // Returns the loan at the front of the chain if a read of |len| bytes hands on its pages
+    // rather than copying them, or null.
+    MBuf* FrontLoan(size_t len);
+
+    // Adds |buf| to the end of the chain.
+    void AppendMBuf(MBuf* buf);
+
     fbl::SinglyLinkedList<MBuf*> freelist_;
     fbl::SinglyLinkedList<MBuf*> tail_;
     MBuf* head_ = nullptr;
@@ -37,6 +37,10 @@ using MessagePacketPtr = ktl::unique_ptr<MessagePacket, internal::MessagePacketD
 
 class MessagePacket final : public fbl::DoublyLinkedListable<MessagePacketPtr> {
 public:
+    // Sets up the allocator for small messages.  Until this is called, every
+    // message is built on a BufferChain.
+    static void Init();
+
     // Creates a message packet containing the provided data and space for
     // |num_handles| handles. The handles array is uninitialized and must
     // be completely overwritten by clients.
@@ -45,11 +49,20 @@ public:
     static zx_status_t Create(const void* data, uint32_t data_size,
                               uint32_t num_handles, MessagePacketPtr* msg);
 
+    // Creates a message packet whose data is gathered from the |num_iovecs|
+    // segments described by |iovecs|, in order.
+    static zx_status_t CreateIovec(user_in_ptr<const zx_channel_iovec_t> iovecs,
+                                   uint32_t num_iovecs, uint32_t num_handles,
+                                   MessagePacketPtr* msg);
+
     uint32_t data_size() const { return data_size_; }
 
     // Copies the packet's |data_size()| bytes to |buf|.
     // Returns an error if |buf| points to a bad user address.
     zx_status_t CopyDataTo(user_out_ptr<void> buf) const {
+        if (!buffer_chain_) {
+            return buf.copy_array_to_user(payload(), data_size_);
+        }
         return buffer_chain_->CopyOut(buf, payload_offset_, data_size_);
     }
 
@@ -66,14 +79,12 @@ public:
             return 0;
         }
         // The first few bytes of the payload are a zx_txid_t.
-        void* payload_start = buffer_chain_->buffers()->front().data() + payload_offset_;
-        return *reinterpret_cast<zx_txid_t*>(payload_start);
+        return *reinterpret_cast<const zx_txid_t*>(payload());
     }
 
     void set_txid(zx_txid_t txid) {
         if (data_size_ >= sizeof(zx_txid_t)) {
-            void* payload_start = buffer_chain_->buffers()->front().data() + payload_offset_;
-            *(reinterpret_cast<zx_txid_t*>(payload_start)) = txid;
+            *(reinterpret_cast<zx_txid_t*>(payload())) = txid;
         }
     }
 
@@ -82,6 +93,9 @@ private:
     // Create method to create a MessagePacket.  This, in turn, guarantees that
     // when a user creates a MessagePacket, they end up with the proper
     // MessagePacket::UPtr type for managing the message packet's life cycle.
+    //
+    // |chain| is null for small messages, which live in a single block from the
+    // small message allocator.
     MessagePacket(BufferChain* chain, uint32_t data_size, uint32_t payload_offset,
                   uint16_t num_handles, Handle** handles)
         : buffer_chain_(chain), handles_(handles), data_size_(data_size),
@@ -106,6 +120,16 @@ private:
     static zx_status_t CreateCommon(uint32_t data_size, uint32_t num_handles,
                                     MessagePacketPtr* msg);
 
+    // The payload always starts in the same contiguous block as the packet
+    // itself, whether that's a small message block or the first buffer of
+    // |buffer_chain_|.
+    const char* payload() const {
+        return reinterpret_cast<const char*>(this) + payload_offset_;
+    }
+    char* payload() {
+        return reinterpret_cast<char*>(this) + payload_offset_;
+    }
+
     BufferChain* buffer_chain_;
     Handle** const handles_;
     const uint32_t data_size_;
@@ -14,14 +14,24 @@
 #include <vm/page_source.h>
 
 // Wrapper which maintains the object layer state of a PageSource.
-class PageSourceWrapper : public PageSourceCallback,
+//
+// Requests are delivered to the pager as packets on |port_|. There is only ever one
+// request outstanding per source, so a single packet is embedded here and reused; the
+// port hands it back through PortAllocator::Free() once it has been dequeued.
+class PageSourceWrapper : public PageSourceCallback, public PortAllocator,
                           public fbl::DoublyLinkedListable<fbl::unique_ptr<PageSourceWrapper>> {
 public:
     PageSourceWrapper(PagerDispatcher* dispatcher, fbl::RefPtr<PortDispatcher> port, uint64_t key);
     virtual ~PageSourceWrapper();
 
+    // PageSourceCallback implementation.
+    zx_status_t SendRequest(uint64_t offset, uint64_t len) override;
     void OnClose() override;
 
+    // PortAllocator implementation. Alloc() is never used.
+    PortPacket* Alloc() override { return nullptr; }
+    void Free(PortPacket* port_packet) override;
+
 private:
     PagerDispatcher* const pager_;
     const fbl::RefPtr<PortDispatcher> port_;
@@ -33,6 +43,11 @@ private:
     // The PageSource this is wrapping.
     fbl::RefPtr<PageSource> src_ TA_GUARDED(mtx_);
 
+    // The request packet, and whether the port has it. The wrapper cannot be released
+    // while the port has the packet.
+    PortPacket packet_ TA_GUARDED(mtx_);
+    bool packet_busy_ TA_GUARDED(mtx_) = false;
+
     friend PagerDispatcher;
 };
 
@@ -8,6 +8,7 @@
 
 #include <object/dispatcher.h>
 #include <object/semaphore.h>
+#include <object/slab.h>
 #include <object/state_observer.h>
 
 #include <zircon/rights.h>
@@ -112,7 +113,7 @@ struct PortInterruptPacket final : public fbl::DoublyLinkedListable<PortInterrup
 // Observers are weakly contained in state trackers until |remove_| member
 // is false at the end of one of OnInitialize(), OnStateChange() or OnCancel()
 // callbacks.
-class PortObserver final : public StateObserver {
+class PortObserver final : public StateObserver, public SlabAllocated<PortObserver> {
 public:
     PortObserver(uint32_t type, const Handle* handle, fbl::RefPtr<PortDispatcher> port,
                  uint64_t key, zx_signals_t signals);
@@ -154,8 +155,9 @@ private:
 // |packets_| linked list and case 4 uses |interrupt_packets_| linked list.
 //
 // The threads that wish to receive notifications block on Dequeue() (which
-// maps to zx_port_wait()) and will receive packets from any of the four sources
-// depending on what kind of object the port has been 'bound' to.
+// maps to zx_port_wait()) or DequeueMany() (zx_port_wait_many()) and will
+// receive packets from any of the four sources depending on what kind of
+// object the port has been 'bound' to.
 //
 // When a packet from any of the sources arrives to the port, one waiting
 // thread unblocks and gets the packet. In all cases |sema_| is used to signal
@@ -178,6 +180,11 @@ public:
     zx_status_t QueueUser(const zx_port_packet_t& packet);
     bool QueueInterruptPacket(PortInterruptPacket* port_packet, zx_time_t timestamp);
     zx_status_t Dequeue(zx_time_t deadline, TimerSlack slack, zx_port_packet_t* packet);
+    // Like Dequeue(), but once there is a packet also takes up to |count| - 1 more
+    // that are already queued, without waiting for them.  The number of packets
+    // written to |packets| is returned in |actual|.
+    zx_status_t DequeueMany(zx_time_t deadline, TimerSlack slack, zx_port_packet_t* packets,
+                            size_t count, size_t* actual);
     bool RemoveInterruptPacket(PortInterruptPacket* port_packet);
 
     // Decides who is going to destroy the observer. If it returns the
@@ -194,6 +201,10 @@ public:
     // When |handle| is null, ephemeral PortPackets are removed from the queue but not freed.
     bool CancelQueued(const void* handle, uint64_t key);
 
+    // Removes |port_packet| from the queue if it is still there, without freeing it.
+    // Returns true if it was removed.
+    bool CancelQueued(PortPacket* port_packet);
+
 private:
     friend class ExceptionPort;
 
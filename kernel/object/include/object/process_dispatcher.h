@@ -242,6 +242,10 @@ public:
     uintptr_t get_debug_addr() const;
     zx_status_t set_debug_addr(uintptr_t addr);
 
+    // The numa node VMOs created by this process allocate from first.
+    uint32_t get_numa_node() const;
+    zx_status_t set_numa_node(uint32_t node);
+
     // Checks the |condition| against the parent job's policy.
     //
     // Must be called by syscalls before performing an action represented by an
@@ -307,6 +311,11 @@ private:
     void SetStateLocked(State) TA_REQ(get_lock());
     void FinishDeadTransition();
 
+    // Maps |handle_value| to the Handle it names if this process owns it,
+    // without any policy check.  The Handle may only be used while holding
+    // handle_table_lock_ or inside a Handle::Reader section.
+    Handle* LookupHandle(zx_handle_t handle_value) const;
+
     // Kill all threads
     void KillAllThreadsLocked() TA_REQ(get_lock());
 
@@ -361,6 +370,9 @@ private:
     // See third_party/ulib/musl/ldso/dynlink.c.
     uintptr_t debug_addr_ TA_GUARDED(get_lock()) = 0;
 
+    // See ZX_PROP_NUMA_NODE.
+    uint32_t numa_node_ TA_GUARDED(get_lock()) = ZX_NUMA_NODE_ANY;
+
     // This is a cache of aspace()->vdso_code_address().
     uintptr_t vdso_code_address_ = 0;
 
@@ -20,6 +20,9 @@ public:
     static zx_status_t Create(const zx_profile_info_t& info,
                               fbl::RefPtr<Dispatcher>* dispatcher,
                               zx_rights_t* rights);
+    static zx_status_t Create(const zx_profile_deadline_info_t& info,
+                              fbl::RefPtr<Dispatcher>* dispatcher,
+                              zx_rights_t* rights);
 
     ~ProfileDispatcher() final;
     zx_obj_type_t get_type() const final { return ZX_OBJ_TYPE_PROFILE; }
@@ -27,8 +30,14 @@ public:
     zx_status_t ApplyProfile(fbl::RefPtr<ThreadDispatcher> thread);
 
 private:
-    explicit ProfileDispatcher(const zx_profile_info_t& info);
+    static zx_status_t Make(const zx_profile_info_t& info,
+                            const zx_profile_deadline_t& deadline,
+                            fbl::RefPtr<Dispatcher>* dispatcher,
+                            zx_rights_t* rights);
+    ProfileDispatcher(const zx_profile_info_t& info, const zx_profile_deadline_t& deadline);
 
     fbl::Canary<fbl::magic("PROF")> canary_;
     const zx_profile_info_t info_;
+    // Only meaningful when info_.type is ZX_PROFILE_INFO_DEADLINE.
+    const zx_profile_deadline_t deadline_;
 };
@@ -0,0 +1,65 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <stdint.h>
+
+#include <object/dispatcher.h>
+#include <object/vm_object_dispatcher.h>
+
+#include <zircon/rights.h>
+#include <zircon/syscalls/ring.h>
+#include <zircon/types.h>
+
+#include <fbl/canary.h>
+#include <fbl/ref_ptr.h>
+
+// One end of a single-producer, single-consumer ring of fixed size elements
+// kept in a VMO that both ends map.  The ends move elements by updating the
+// head and tail indices in the VMO's control block; the kernel never touches
+// the elements themselves.  It only keeps the READABLE and WRITABLE signals
+// in step with the indices, and only when asked to by Notify(), which the
+// ends call when the ring goes from empty to non-empty or from full to
+// non-full, and before they wait.
+class RingDispatcher final : public PeeredDispatcher<RingDispatcher, ZX_DEFAULT_RING_RIGHTS> {
+public:
+    static zx_status_t Create(size_t elem_count, size_t elem_size, uint32_t options,
+                              fbl::RefPtr<Dispatcher>* producer,
+                              fbl::RefPtr<Dispatcher>* consumer,
+                              zx_rights_t* rights);
+
+    ~RingDispatcher() final;
+
+    zx_obj_type_t get_type() const final { return ZX_OBJ_TYPE_RING; }
+
+    // The VMO holding the control block and elements; both ends share it.
+    const fbl::RefPtr<VmObjectDispatcher>& vmo() const { return vmo_; }
+
+    // Bring READABLE on the consumer and WRITABLE on the producer up to
+    // date with the indices in the control block.
+    zx_status_t Notify();
+
+    // PeeredDispatcher implementation.
+    void on_zero_handles_locked() TA_REQ(get_lock());
+    void OnPeerZeroHandlesLocked() TA_REQ(get_lock());
+
+private:
+    RingDispatcher(fbl::RefPtr<PeerHolder<RingDispatcher>> holder, bool is_producer,
+                   uint32_t elem_count, fbl::RefPtr<VmObjectDispatcher> vmo,
+                   const zx_ring_header_t* header);
+    void Init(fbl::RefPtr<RingDispatcher> other);
+
+    fbl::Canary<fbl::magic("RING")> canary_;
+    const bool is_producer_;
+    const uint32_t elem_count_;
+    const fbl::RefPtr<VmObjectDispatcher> vmo_;
+
+    // The control block, through the physmap.  Each end holds a pin on its
+    // page for as long as it lives, so this stays valid however userspace
+    // treats the VMO.
+    const zx_ring_header_t* const header_;
+};
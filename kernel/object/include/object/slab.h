@@ -0,0 +1,159 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <fbl/alloc_checker.h>
+#include <fbl/arena.h>
+#include <fbl/intrusive_double_list.h>
+#include <fbl/macros.h>
+#include <fbl/mutex.h>
+#include <fbl/type_support.h>
+#include <kernel/cpu_magazine.h>
+#include <kernel/lockdep.h>
+#include <new>
+#include <stdint.h>
+#include <zircon/types.h>
+
+// A Slab hands out fixed size slots for one kind of object.  The slots are
+// carved out of an fbl::Arena, and each cpu keeps a magazine of free slots so
+// that most allocations and frees don't need the arena's lock.  The memory of
+// a free slot in a magazine is left alone, which the handle table relies on.
+//
+// Every slab that has been initialized shows up in "k zx slabs".
+class Slab : public fbl::DoublyLinkedListable<Slab*> {
+public:
+    Slab() = default;
+    ~Slab();
+
+    // Reserves address space for |max_count| objects of |object_size| bytes.
+    zx_status_t Init(const char* name, size_t object_size, size_t max_count);
+
+    bool ready() const { return object_size_ != 0; }
+    size_t object_size() const { return object_size_; }
+
+    // Returns a slot of object_size() bytes, or nullptr if the slab is full or
+    // hasn't been initialized.
+    void* Alloc();
+
+    // Returns a slot obtained from Alloc().
+    void Free(void* addr);
+
+    // Hands every slot sitting in a magazine back to the arena.
+    void Drain();
+
+    // Whether |addr| is anywhere in the memory reserved for this slab.  The
+    // bounds are fixed once Init() has run.
+    bool owns(const void* addr) const {
+        uintptr_t a = reinterpret_cast<uintptr_t>(addr);
+        return a >= start_ && a < end_;
+    }
+
+    // Whether |addr| lies in the part of the arena that has been handed out at
+    // some point, and so is backed by memory.  Unlike the bounds above, that
+    // part grows as slots are first handed out.  Slots are never given back
+    // to it, so this may be called without the arena's lock: at worst it
+    // misses a slot that is being handed out right now.
+    bool in_range(uintptr_t addr) const TA_NO_THREAD_SAFETY_ANALYSIS {
+        return arena_.in_range(addr);
+    }
+
+    // The lowest address a slot can have.
+    uintptr_t start() const { return start_; }
+
+    // Prints the usage of every initialized slab.
+    static void DumpAll();
+
+    // Dumps the arena backing this slab.
+    void DumpArena();
+
+private:
+    DISALLOW_COPY_ASSIGN_AND_MOVE(Slab);
+
+    // Free slots are moved between the magazines and the arena 16 at a time,
+    // and a cpu keeps at most 32.  Slots in a magazine count as allocated as
+    // far as the arena is concerned.
+    using Magazines = CpuMagazines<void, 16>;
+
+    void DrainLocked() TA_REQ(lock_);
+    void Dump();
+
+    using GlobalList = fbl::DoublyLinkedList<Slab*>;
+    DECLARE_SINGLETON_MUTEX(AllSlabsLock);
+    static GlobalList all_slabs_ TA_GUARDED(AllSlabsLock::Get());
+
+    char name_[ZX_MAX_NAME_LEN] = {};
+    size_t object_size_ = 0;
+    size_t max_count_ = 0;
+    uintptr_t start_ = 0;
+    uintptr_t end_ = 0;
+
+    DECLARE_MUTEX(Slab) lock_;
+    fbl::Arena arena_ TA_GUARDED(lock_);
+
+    Magazines magazines_;
+};
+
+// A Slab for objects of type T.
+template <typename T>
+class TypedSlab {
+public:
+    zx_status_t Init(const char* name, size_t max_count) {
+        return slab_.Init(name, sizeof(T), max_count);
+    }
+
+    template <typename... Args>
+    T* New(Args&&... args) {
+        void* addr = slab_.Alloc();
+        return addr ? new (addr) T(fbl::forward<Args>(args)...) : nullptr;
+    }
+
+    void Delete(T* obj) {
+        obj->~T();
+        slab_.Free(obj);
+    }
+
+    Slab* slab() { return &slab_; }
+
+private:
+    Slab slab_;
+};
+
+// Deriving from SlabAllocated<T> makes new (&ac) T(...) and delete take T's
+// memory from a Slab once InitSlab() has run.  Objects made before then, or
+// while the slab is full, come from the heap instead, so InitSlab()'s
+// |max_count| bounds how much address space the slab reserves rather than how
+// many objects there can be.
+template <typename T>
+class SlabAllocated {
+public:
+    static zx_status_t InitSlab(const char* name, size_t max_count) {
+        return slab_.Init(name, sizeof(T), max_count);
+    }
+
+    static void* operator new(size_t size, fbl::AllocChecker* ac) noexcept {
+        void* addr = size <= sizeof(T) ? slab_.Alloc() : nullptr;
+        if (addr != nullptr) {
+            ac->arm(size, true);
+            return addr;
+        }
+        return ::operator new(size, ac);
+    }
+
+    static void operator delete(void* obj) {
+        if (slab_.owns(obj)) {
+            slab_.Free(obj);
+        } else {
+            ::operator delete(obj);
+        }
+    }
+
+private:
+    static Slab slab_;
+};
+
+template <typename T>
+Slab SlabAllocated<T>::slab_;
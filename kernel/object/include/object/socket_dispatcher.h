@@ -35,6 +35,11 @@ public:
     // Socket methods.
     zx_status_t Write(user_in_ptr<const void> src, size_t len, size_t* written);
 
+    // Writes up to |len| bytes from |vmo| starting at |offset|, loaning whole pages to the
+    // socket rather than copying them where possible.  Only stream sockets support this.
+    zx_status_t WriteVmo(fbl::RefPtr<VmObject> vmo, uint64_t offset, size_t len,
+                         size_t* written);
+
     zx_status_t WriteControl(user_in_ptr<const void> src, size_t len);
 
     // Shut this endpoint of the socket down for reading, writing, or both.
@@ -44,6 +49,12 @@ public:
 
     zx_status_t Read(user_out_ptr<void> dst, size_t len, size_t* nread);
 
+    // Reads up to |len| bytes into a new VMO, handing on pages loaned by WriteVmo() rather
+    // than copying them where possible, and returns a handle to it in |h|.  The number of
+    // bytes read is written to |nread| if it is set.  On failure nothing is read.  Only
+    // stream sockets support this.
+    zx_status_t ReadVmo(size_t len, user_out_ptr<size_t> nread, HandleOwner* h);
+
     zx_status_t ReadControl(user_out_ptr<void> dst, size_t len, size_t* nread);
 
     // On success, the share queue takes ownership of |h|. On failure,
@@ -79,6 +90,11 @@ private:
                      ktl::unique_ptr<ControlMsg> control_msg);
     void Init(fbl::RefPtr<SocketDispatcher> other);
     zx_status_t WriteSelfLocked(user_in_ptr<const void> src, size_t len, size_t* nwritten) TA_REQ(get_lock());
+    zx_status_t WriteVmoSelfLocked(const fbl::RefPtr<VmObject>& vmo, uint64_t offset, size_t len,
+                                   size_t* nwritten) TA_REQ(get_lock());
+    void UpdateStateAfterWriteLocked(bool was_empty, size_t nwritten) TA_REQ(get_lock());
+    zx_status_t CheckReadableLocked() TA_REQ(get_lock());
+    void UpdateStateAfterReadLocked(bool was_full, size_t nread) TA_REQ(get_lock());
     zx_status_t WriteControlSelfLocked(user_in_ptr<const void> src, size_t len) TA_REQ(get_lock());
     zx_status_t UserSignalSelfLocked(uint32_t clear_mask, uint32_t set_mask) TA_REQ(get_lock());
     zx_status_t ShutdownOtherLocked(uint32_t how) TA_REQ(get_lock());
@@ -159,6 +159,7 @@ public:
                            size_t buffer_len);
     // Profile support
     zx_status_t SetPriority(int32_t priority);
+    zx_status_t SetDeadline(zx_duration_t capacity, zx_duration_t deadline, zx_duration_t period);
 
     // For ChannelDispatcher use.
     ChannelDispatcher::MessageWaiter* GetMessageWaiter() { return &channel_waiter_; }
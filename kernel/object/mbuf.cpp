@@ -6,7 +6,10 @@
 
 #include <object/mbuf.h>
 
+#include <ktl/move.h>
 #include <lib/user_copy/user_ptr.h>
+#include <vm/vm_object.h>
+#include <vm/vm_object_paged.h>
 
 #include <fbl/algorithm.h>
 #include <fbl/alloc_checker.h>
@@ -19,6 +22,9 @@ constexpr size_t MBufChain::MBuf::kPayloadSize;
 constexpr size_t MBufChain::kSizeMax;
 
 size_t MBufChain::MBuf::rem() const {
+    // Nothing more can be added to a loan.
+    if (vmo_)
+        return 0;
     return kPayloadSize - (off_ + len_);
 }
 
@@ -48,9 +54,14 @@ size_t MBufChain::Read(user_out_ptr<void> dst, size_t len, bool datagram) {
     size_t pos = 0;
     while (pos < len && !tail_.is_empty()) {
         MBuf& cur = tail_.front();
-        char* src = cur.data_ + cur.off_;
         size_t copy_len = MIN(cur.len_, len - pos);
-        if (dst.byte_offset(pos).copy_array_to_user(src, copy_len) != ZX_OK)
+        zx_status_t status;
+        if (cur.vmo_) {
+            status = cur.vmo_->ReadUser(dst.byte_offset(pos), cur.off_, copy_len);
+        } else {
+            status = dst.byte_offset(pos).copy_array_to_user(cur.data_ + cur.off_, copy_len);
+        }
+        if (status != ZX_OK)
             return pos;
         pos += copy_len;
         cur.off_ += static_cast<uint32_t>(copy_len);
@@ -112,15 +123,8 @@ zx_status_t MBufChain::WriteDatagram(user_in_ptr<const void> src, size_t len,
     bufs.front().pkt_len_ = static_cast<uint32_t>(len);
 
     // Successfully built the packet mbufs. Put it on the socket.
-    while (!bufs.is_empty()) {
-        auto next = bufs.pop_front();
-        if (head_ == nullptr) {
-            tail_.push_front(next);
-        } else {
-            tail_.insert_after(tail_.make_iterator(*head_), next);
-        }
-        head_ = next;
-    }
+    while (!bufs.is_empty())
+        AppendMBuf(bufs.pop_front());
 
     *written = len;
     size_ += len;
@@ -129,10 +133,10 @@ zx_status_t MBufChain::WriteDatagram(user_in_ptr<const void> src, size_t len,
 
 zx_status_t MBufChain::WriteStream(user_in_ptr<const void> src, size_t len, size_t* written) {
     if (head_ == nullptr) {
-        head_ = AllocMBuf();
-        if (head_ == nullptr)
+        auto buf = AllocMBuf();
+        if (buf == nullptr)
             return ZX_ERR_SHOULD_WAIT;
-        tail_.push_front(head_);
+        AppendMBuf(buf);
     }
 
     size_t pos = 0;
@@ -141,8 +145,7 @@ zx_status_t MBufChain::WriteStream(user_in_ptr<const void> src, size_t len, size
             auto next = AllocMBuf();
             if (next == nullptr)
                 break;
-            tail_.insert_after(tail_.make_iterator(*head_), next);
-            head_ = next;
+            AppendMBuf(next);
         }
         void* dst = head_->data_ + head_->off_ + head_->len_;
         size_t copy_len = fbl::min(head_->rem(), len - pos);
@@ -165,6 +168,225 @@ zx_status_t MBufChain::WriteStream(user_in_ptr<const void> src, size_t len, size
     return ZX_OK;
 }
 
+// Moves the whole pages in [offset, offset + len) of |src| to the start of |dst|, which must be
+// empty, so |dst| holds exactly those bytes and nothing done to |src| afterwards shows up in it.
+// On failure the pages are given back to |src|.
+static zx_status_t MovePages(VmObject* src, uint64_t offset, size_t len, VmObject* dst) {
+    list_node pages = LIST_INITIAL_VALUE(pages);
+    zx_status_t status = src->TakePages(offset, len, &pages);
+    if (status != ZX_OK)
+        return status;
+    status = dst->SupplyPages(0, len, &pages);
+    if (status != ZX_OK) {
+        // |dst| was empty, so whatever it did take is the front of the range.
+        const uint64_t added = len - list_length(&pages) * PAGE_SIZE;
+        list_node moved = LIST_INITIAL_VALUE(moved);
+        if (added > 0 && dst->TakePages(0, added, &moved) != ZX_OK)
+            pmm_free(&moved);
+        list_splice_after(&pages, moved.prev);
+        if (src->SupplyPages(offset, len, &moved) != ZX_OK)
+            pmm_free(&moved);
+        return status;
+    }
+    return ZX_OK;
+}
+
+// Moves the whole pages in [offset, offset + len) of |src| into a new VMO of their own.
+static zx_status_t MovePagesToNewVmo(VmObject* src, uint64_t offset, size_t len,
+                                     fbl::RefPtr<VmObject>* out) {
+    fbl::RefPtr<VmObject> vmo;
+    zx_status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0u, len, &vmo);
+    if (status != ZX_OK)
+        return status;
+    status = MovePages(src, offset, len, vmo.get());
+    if (status != ZX_OK)
+        return status;
+
+    *out = ktl::move(vmo);
+    return ZX_OK;
+}
+
+zx_status_t MBufChain::WriteStreamVmo(const fbl::RefPtr<VmObject>& vmo, uint64_t offset,
+                                      size_t len, size_t* written) {
+    if (size_ >= kSizeMax)
+        return ZX_ERR_SHOULD_WAIT;
+    len = fbl::min(len, kSizeMax - size_);
+
+    // Only whole pages are loaned; whatever is left of the last one is copied.
+    size_t pos = 0;
+    const size_t loan_len = ROUNDDOWN(len, PAGE_SIZE);
+    if (IS_PAGE_ALIGNED(offset) && loan_len > 0) {
+        auto buf = AllocMBuf();
+        if (buf == nullptr)
+            return ZX_ERR_SHOULD_WAIT;
+        zx_status_t status = MovePagesToNewVmo(vmo.get(), offset, loan_len, &buf->vmo_);
+        if (status == ZX_OK) {
+            buf->len_ = static_cast<uint32_t>(loan_len);
+            AppendMBuf(buf);
+            size_ += loan_len;
+            pos = loan_len;
+        } else {
+            FreeMBuf(buf);
+            // VMOs whose pages can't be moved, such as physical ones or ones with clones, are
+            // copied instead.
+            if (status != ZX_ERR_NOT_SUPPORTED && status != ZX_ERR_BAD_STATE)
+                return status;
+        }
+    }
+
+    while (pos < len) {
+        if (head_ == nullptr || head_->rem() == 0) {
+            auto next = AllocMBuf();
+            if (next == nullptr)
+                break;
+            AppendMBuf(next);
+        }
+        void* dst = head_->data_ + head_->off_ + head_->len_;
+        size_t copy_len = fbl::min(head_->rem(), len - pos);
+        zx_status_t status = vmo->Read(dst, offset + pos, copy_len);
+        if (status != ZX_OK) {
+            if (pos == 0)
+                return status;
+            break;
+        }
+        pos += copy_len;
+        head_->len_ += static_cast<uint32_t>(copy_len);
+        size_ += copy_len;
+    }
+
+    if (pos == 0)
+        return ZX_ERR_SHOULD_WAIT;
+
+    *written = pos;
+    return ZX_OK;
+}
+
+// Copies |len| bytes from |src| to |dst| through a small buffer on the stack.
+static zx_status_t CopyVmoToVmo(VmObject* src, uint64_t src_offset,
+                                VmObject* dst, uint64_t dst_offset, size_t len) {
+    char buf[256];
+    while (len > 0) {
+        size_t copy_len = fbl::min(sizeof(buf), len);
+        zx_status_t status = src->Read(buf, src_offset, copy_len);
+        if (status != ZX_OK)
+            return status;
+        status = dst->Write(buf, dst_offset, copy_len);
+        if (status != ZX_OK)
+            return status;
+        src_offset += copy_len;
+        dst_offset += copy_len;
+        len -= copy_len;
+    }
+    return ZX_OK;
+}
+
+MBufChain::MBuf* MBufChain::FrontLoan(size_t len) {
+    // Only whole pages of a loan are handed on, which also keeps what's left of it page
+    // aligned for the next read.
+    MBuf& front = tail_.front();
+    if (front.vmo_ && IS_PAGE_ALIGNED(front.off_) && len >= PAGE_SIZE)
+        return &front;
+    return nullptr;
+}
+
+zx_status_t MBufChain::ReadVmo(size_t len, fbl::RefPtr<VmObject>* vmo, size_t* nread) {
+    fbl::RefPtr<VmObject> out;
+    size_t n;
+    zx_status_t status = PeekVmo(len, &out, &n);
+    if (status != ZX_OK)
+        return status;
+    status = ConsumeVmo(out, n);
+    if (status != ZX_OK)
+        return status;
+
+    *vmo = ktl::move(out);
+    *nread = n;
+    return ZX_OK;
+}
+
+zx_status_t MBufChain::PeekVmo(size_t len, fbl::RefPtr<VmObject>* vmo, size_t* npeeked) {
+    len = fbl::min(len, size_);
+    if (len == 0)
+        return ZX_ERR_SHOULD_WAIT;
+
+    // A failed write can leave an empty mbuf in front of a loan.
+    while (tail_.front().len_ == 0) {
+        if (head_ == &tail_.front())
+            head_ = nullptr;
+        FreeMBuf(tail_.pop_front());
+    }
+
+    MBuf* loan = FrontLoan(len);
+    if (loan != nullptr) {
+        size_t n = fbl::min(ROUNDDOWN(len, PAGE_SIZE), static_cast<size_t>(loan->len_));
+        if (loan->off_ == 0 && n == loan->len_) {
+            *vmo = loan->vmo_;
+        } else {
+            // ConsumeVmo() moves the pages over, once there's no going back.
+            zx_status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0u, n, vmo);
+            if (status != ZX_OK)
+                return status;
+        }
+        *npeeked = n;
+        return ZX_OK;
+    }
+
+    fbl::RefPtr<VmObject> out;
+    zx_status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0u, ROUNDUP(len, PAGE_SIZE),
+                                               &out);
+    if (status != ZX_OK)
+        return status;
+
+    size_t pos = 0;
+    for (auto& cur : tail_) {
+        if (pos >= len)
+            break;
+        // Leave a loan that can be handed on whole to the next read.
+        if (pos > 0 && cur.vmo_ && IS_PAGE_ALIGNED(cur.off_))
+            break;
+        size_t copy_len = fbl::min(static_cast<size_t>(cur.len_), len - pos);
+        if (cur.vmo_) {
+            status = CopyVmoToVmo(cur.vmo_.get(), cur.off_, out.get(), pos, copy_len);
+        } else {
+            status = out->Write(cur.data_ + cur.off_, pos, copy_len);
+        }
+        if (status != ZX_OK) {
+            if (pos == 0)
+                return status;
+            break;
+        }
+        pos += copy_len;
+    }
+
+    *vmo = ktl::move(out);
+    *npeeked = pos;
+    return ZX_OK;
+}
+
+zx_status_t MBufChain::ConsumeVmo(const fbl::RefPtr<VmObject>& vmo, size_t len) {
+    MBuf* loan = FrontLoan(len);
+    if (loan != nullptr && loan->vmo_ != vmo) {
+        zx_status_t status = MovePages(loan->vmo_.get(), loan->off_, len, vmo.get());
+        if (status != ZX_OK)
+            return status;
+    }
+
+    while (len > 0) {
+        MBuf& cur = tail_.front();
+        size_t n = fbl::min(static_cast<size_t>(cur.len_), len);
+        cur.off_ += static_cast<uint32_t>(n);
+        cur.len_ -= static_cast<uint32_t>(n);
+        size_ -= n;
+        len -= n;
+        if (cur.len_ == 0) {
+            if (head_ == &cur)
+                head_ = nullptr;
+            FreeMBuf(tail_.pop_front());
+        }
+    }
+    return ZX_OK;
+}
+
 MBufChain::MBuf* MBufChain::AllocMBuf() {
     if (freelist_.is_empty()) {
         fbl::AllocChecker ac;
@@ -177,5 +399,15 @@ MBufChain::MBuf* MBufChain::AllocMBuf() {
 void MBufChain::FreeMBuf(MBuf* buf) {
     buf->off_ = 0u;
     buf->len_ = 0u;
+    buf->vmo_.reset();
     freelist_.push_front(buf);
 }
+
+void MBufChain::AppendMBuf(MBuf* buf) {
+    if (head_ == nullptr) {
+        tail_.push_front(buf);
+    } else {
+        tail_.insert_after(tail_.make_iterator(*head_), buf);
+    }
+    head_ = buf;
+}
@@ -9,6 +9,7 @@
 #include <ktl/unique_ptr.h>
 #include <lib/unittest/unittest.h>
 #include <lib/unittest/user_memory.h>
+#include <vm/vm_object_paged.h>
 
 namespace {
 
@@ -335,6 +336,158 @@ static bool datagram_write_huge_packet() {
     END_TEST;
 }
 
+// Tests loaning pages to the chain with WriteStreamVmo and taking them back out with ReadVmo.
+static bool stream_write_vmo_loan() {
+    BEGIN_TEST;
+    constexpr size_t kLen = 4 * PAGE_SIZE;
+
+    fbl::AllocChecker ac;
+    auto expected_buf = ktl::unique_ptr<char[]>(new (&ac) char[kLen]);
+    ASSERT_TRUE(ac.check(), "");
+    for (size_t i = 0; i < kLen; ++i) {
+        expected_buf[i] = static_cast<char>(i * 3);
+    }
+
+    fbl::RefPtr<VmObject> vmo;
+    ASSERT_EQ(ZX_OK, VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0u, kLen, &vmo), "");
+    ASSERT_EQ(ZX_OK, vmo->Write(expected_buf.get(), 0, kLen), "");
+
+    MBufChain chain;
+    size_t written = 0;
+    ASSERT_EQ(ZX_OK, chain.WriteStreamVmo(vmo, 0, kLen, &written), "");
+    EXPECT_EQ(kLen, written, "");
+    EXPECT_EQ(kLen, chain.size(), "");
+
+    // The pages were moved out, so later writes to |vmo| don't reach the chain.
+    auto zero_buf = ktl::unique_ptr<char[]>(new (&ac) char[kLen]);
+    ASSERT_TRUE(ac.check(), "");
+    memset(zero_buf.get(), 0, kLen);
+    auto actual_buf = ktl::unique_ptr<char[]>(new (&ac) char[kLen]);
+    ASSERT_TRUE(ac.check(), "");
+    ASSERT_EQ(ZX_OK, vmo->Read(actual_buf.get(), 0, kLen), "");
+    EXPECT_EQ(0, memcmp(zero_buf.get(), actual_buf.get(), kLen), "");
+    ASSERT_EQ(ZX_OK, vmo->Write(zero_buf.get(), 0, kLen), "");
+
+    // A read of a page and a half takes a single page, leaving the rest page aligned.
+    fbl::RefPtr<VmObject> out;
+    size_t nread = 0;
+    ASSERT_EQ(ZX_OK, chain.ReadVmo(PAGE_SIZE + PAGE_SIZE / 2, &out, &nread), "");
+    EXPECT_EQ(static_cast<size_t>(PAGE_SIZE), nread, "");
+    EXPECT_EQ(kLen - PAGE_SIZE, chain.size(), "");
+    EXPECT_EQ(static_cast<uint64_t>(PAGE_SIZE), out->size(), "");
+    ASSERT_EQ(ZX_OK, out->Read(actual_buf.get(), 0, PAGE_SIZE), "");
+
+    // The rest comes out in one piece.
+    ASSERT_EQ(ZX_OK, chain.ReadVmo(kLen, &out, &nread), "");
+    EXPECT_EQ(kLen - PAGE_SIZE, nread, "");
+    EXPECT_TRUE(chain.is_empty(), "");
+    ASSERT_EQ(ZX_OK, out->Read(actual_buf.get() + PAGE_SIZE, 0, kLen - PAGE_SIZE), "");
+
+    EXPECT_EQ(0, memcmp(expected_buf.get(), actual_buf.get(), kLen), "");
+    END_TEST;
+}
+
+// Tests that only whole pages are loaned, and that the VMO a read hands out holds nothing past
+// the bytes read.
+static bool stream_write_vmo_partial_page() {
+    BEGIN_TEST;
+    constexpr size_t kLen = 2 * PAGE_SIZE + 100;
+
+    fbl::AllocChecker ac;
+    auto expected_buf = ktl::unique_ptr<char[]>(new (&ac) char[kLen]);
+    ASSERT_TRUE(ac.check(), "");
+    for (size_t i = 0; i < kLen; ++i) {
+        expected_buf[i] = static_cast<char>(i * 7);
+    }
+
+    fbl::RefPtr<VmObject> vmo;
+    ASSERT_EQ(ZX_OK, VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0u, 3 * PAGE_SIZE, &vmo), "");
+    ASSERT_EQ(ZX_OK, vmo->Write(expected_buf.get(), 0, kLen), "");
+
+    MBufChain chain;
+    size_t written = 0;
+    ASSERT_EQ(ZX_OK, chain.WriteStreamVmo(vmo, 0, kLen, &written), "");
+    EXPECT_EQ(kLen, written, "");
+
+    // The last page was copied, so it is still in |vmo|.
+    char actual[100];
+    ASSERT_EQ(ZX_OK, vmo->Read(actual, 2 * PAGE_SIZE, sizeof(actual)), "");
+    EXPECT_EQ(0, memcmp(expected_buf.get() + 2 * PAGE_SIZE, actual, sizeof(actual)), "");
+
+    // Less than a page of a loan is copied out rather than handed on.
+    fbl::RefPtr<VmObject> out;
+    size_t nread = 0;
+    ASSERT_EQ(ZX_OK, chain.ReadVmo(sizeof(actual), &out, &nread), "");
+    EXPECT_EQ(sizeof(actual), nread, "");
+    ASSERT_EQ(ZX_OK, out->Read(actual, 0, sizeof(actual)), "");
+    EXPECT_EQ(0, memcmp(expected_buf.get(), actual, sizeof(actual)), "");
+
+    // What's left of the loan is no longer page aligned, so it's copied too, and the copied tail
+    // comes along with it.
+    ASSERT_EQ(ZX_OK, chain.ReadVmo(kLen, &out, &nread), "");
+    EXPECT_EQ(kLen - sizeof(actual), nread, "");
+    EXPECT_TRUE(chain.is_empty(), "");
+    auto actual_buf = ktl::unique_ptr<char[]>(new (&ac) char[kLen]);
+    ASSERT_TRUE(ac.check(), "");
+    ASSERT_EQ(ZX_OK, out->Read(actual_buf.get(), 0, nread), "");
+    EXPECT_EQ(0, memcmp(expected_buf.get() + sizeof(actual), actual_buf.get(), nread), "");
+    END_TEST;
+}
+
+// Tests that data written by copying, or read from the middle of a page, comes out of ReadVmo by
+// copying, and that reads through Read see loaned pages too.
+static bool stream_write_vmo_copy() {
+    BEGIN_TEST;
+    constexpr size_t kLen = 2 * PAGE_SIZE;
+
+    fbl::AllocChecker ac;
+    auto expected_buf = ktl::unique_ptr<char[]>(new (&ac) char[kLen]);
+    ASSERT_TRUE(ac.check(), "");
+    for (size_t i = 0; i < kLen; ++i) {
+        expected_buf[i] = static_cast<char>(i * 5);
+    }
+
+    fbl::RefPtr<VmObject> vmo;
+    ASSERT_EQ(ZX_OK, VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0u, kLen, &vmo), "");
+    ASSERT_EQ(ZX_OK, vmo->Write(expected_buf.get(), 0, kLen), "");
+
+    MBufChain chain;
+    size_t written = 0;
+    // Not page aligned, so copied.
+    ASSERT_EQ(ZX_OK, chain.WriteStreamVmo(vmo, 16, 100, &written), "");
+    EXPECT_EQ(100U, written, "");
+    // Loaned.
+    ASSERT_EQ(ZX_OK, chain.WriteStreamVmo(vmo, 0, kLen, &written), "");
+    EXPECT_EQ(kLen, written, "");
+    EXPECT_EQ(kLen + 100, chain.size(), "");
+
+    // The copied bytes come out on their own, stopping short of the loan.
+    fbl::RefPtr<VmObject> out;
+    size_t nread = 0;
+    ASSERT_EQ(ZX_OK, chain.ReadVmo(kLen, &out, &nread), "");
+    EXPECT_EQ(100U, nread, "");
+    char actual[100];
+    ASSERT_EQ(ZX_OK, out->Read(actual, 0, sizeof(actual)), "");
+    EXPECT_EQ(0, memcmp(expected_buf.get() + 16, actual, sizeof(actual)), "");
+
+    // Read a few bytes of the loan, so what's left no longer starts on a page boundary.
+    ktl::unique_ptr<UserMemory> mem = UserMemory::Create(kLen);
+    auto mem_in = make_user_in_ptr(mem->in());
+    auto mem_out = make_user_out_ptr(mem->out());
+    ASSERT_EQ(10U, chain.Read(mem_out, 10, false), "");
+    ASSERT_EQ(ZX_OK, mem_in.copy_array_from_user(actual, 10), "");
+    EXPECT_EQ(0, memcmp(expected_buf.get(), actual, 10), "");
+
+    ASSERT_EQ(ZX_OK, chain.ReadVmo(kLen, &out, &nread), "");
+    EXPECT_EQ(kLen - 10, nread, "");
+    EXPECT_TRUE(chain.is_empty(), "");
+    auto actual_buf = ktl::unique_ptr<char[]>(new (&ac) char[kLen]);
+    ASSERT_TRUE(ac.check(), "");
+    ASSERT_EQ(ZX_OK, out->Read(actual_buf.get(), 0, kLen - 10), "");
+    EXPECT_EQ(0, memcmp(expected_buf.get() + 10, actual_buf.get(), kLen - 10), "");
+    END_TEST;
+}
+
 } // namespace
 
 UNITTEST_START_TESTCASE(mbuf_tests)
@@ -351,4 +504,7 @@ UNITTEST("datagram_write_basic", datagram_write_basic)
 UNITTEST("datagram_write_zero", datagram_write_zero)
 UNITTEST("datagram_write_too_much", datagram_write_too_much)
 UNITTEST("datagram_write_huge_packet", datagram_write_huge_packet)
+UNITTEST("stream_write_vmo_loan", stream_write_vmo_loan)
+UNITTEST("stream_write_vmo_partial_page", stream_write_vmo_partial_page)
+UNITTEST("stream_write_vmo_copy", stream_write_vmo_copy)
 UNITTEST_END_TESTCASE(mbuf_tests, "mbuf", "MBuf test");
@@ -8,19 +8,29 @@
 
 #include <err.h>
 #include <fbl/algorithm.h>
+#include <lib/counters.h>
 #include <new>
+#include <object/slab.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 
+KCOUNTER(msg_small_alloc, "kernel.channel.msg.small");
+KCOUNTER(msg_small_full, "kernel.channel.msg.small_full");
+KCOUNTER(msg_chain_alloc, "kernel.channel.msg.chain");
+
 // MessagePackets have special allocation requirements because they can contain a variable number of
 // handles and a variable size payload.
 //
-// To reduce heap fragmentation, MessagePackets are stored in a lists of fixed size buffers
+// Small messages, which is most of them, are stored in a single block from one of a few size
+// classes.  The block holds the MessagePacket object, followed by its handles (if any), and finally
+// its payload data (if any).
+//
+// To reduce heap fragmentation, larger MessagePackets are stored in a lists of fixed size buffers
 // (BufferChains) rather than a contiguous blocks of memory.  These lists and buffers are allocated
 // from the PMM.
 //
-// The first buffer in a MessagePacket's BufferChain contains the MessagePacket object, followed by
-// its handles (if any), and finally its payload data (if any).
+// The first buffer in a MessagePacket's BufferChain is laid out just like a small message block.
 
 // The MessagePacket object, its handles and zx_txid_t must all fit in the first buffer.
 static constexpr size_t kContiguousBytes =
@@ -36,6 +46,49 @@ static inline uint32_t PayloadOffset(uint32_t num_handles) {
     return kHandlesOffset + num_handles * static_cast<uint32_t>(sizeof(Handle*));
 }
 
+namespace {
+
+// Block sizes of the small message size classes.  Anything bigger than the
+// last goes in a BufferChain.
+constexpr size_t kSmallMessageSizes[] = {128, 256, 512, 1024, 2048};
+constexpr size_t kSizeClassCount = fbl::count_of(kSmallMessageSizes);
+
+// Address space reserved for each size class.  A class that fills up hands
+// its messages to BufferChains until some of its blocks are freed.
+constexpr size_t kSizeClassBytes = 16 * MB;
+
+// One Slab per size class, so that most messages are allocated and freed
+// without taking any shared lock.
+Slab size_classes[kSizeClassCount];
+
+// Returns the smallest size class whose blocks hold |size| bytes, or nullptr if
+// a message that size needs a BufferChain.
+Slab* SizeClassFor(size_t size) {
+    for (size_t i = 0; i < kSizeClassCount; i++) {
+        if (size <= kSmallMessageSizes[i]) {
+            return &size_classes[i];
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+// static
+void MessagePacket::Init() {
+    static_assert(sizeof(MessagePacket) <= kSmallMessageSizes[0], "");
+    for (size_t i = 0; i < kSizeClassCount; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "msg-%zu", kSmallMessageSizes[i]);
+        zx_status_t status = size_classes[i].Init(name, kSmallMessageSizes[i],
+                                                  kSizeClassBytes / kSmallMessageSizes[i]);
+        if (status != ZX_OK) {
+            printf("WARNING: could not set up %zu byte message blocks: %d\n",
+                   kSmallMessageSizes[i], status);
+        }
+    }
+}
+
 // Creates a MessagePacket in |msg| sufficient to hold |data_size| bytes and |num_handles|.
 //
 // Note: This method does not write the payload into the MessagePacket.
@@ -50,16 +103,29 @@ inline zx_status_t MessagePacket::CreateCommon(uint32_t data_size, uint32_t num_
     }
 
     const uint32_t payload_offset = PayloadOffset(num_handles);
+    const size_t size = payload_offset + data_size;
+
+    // Small MessagePackets live *inside* a single block that holds the MessagePacket object,
+    // followed by its handles (if any), and finally the payload data.
+    char* data = nullptr;
+    BufferChain* chain = nullptr;
+    Slab* size_class = SizeClassFor(size);
+    if (likely(size_class && size_class->ready())) {
+        data = static_cast<char*>(size_class->Alloc());
+        kcounter_add(data ? msg_small_alloc : msg_small_full, 1);
+    }
 
-    // MessagePackets lives *inside* a list of buffers.  The first buffer holds the MessagePacket
-    // object, followed by its handles (if any), and finally the payload data.
-    BufferChain* chain = BufferChain::Alloc(payload_offset + data_size);
-    if (unlikely(!chain)) {
-        return ZX_ERR_NO_MEMORY;
+    // Larger ones live inside a list of buffers, laid out the same way starting in the first.
+    if (!data) {
+        chain = BufferChain::Alloc(size);
+        if (unlikely(!chain)) {
+            return ZX_ERR_NO_MEMORY;
+        }
+        DEBUG_ASSERT(!chain->buffers()->is_empty());
+        data = chain->buffers()->front().data();
+        kcounter_add(msg_chain_alloc, 1);
     }
-    DEBUG_ASSERT(!chain->buffers()->is_empty());
 
-    char* const data = chain->buffers()->front().data();
     Handle** const handles = reinterpret_cast<Handle**>(data + kHandlesOffset);
 
     // Construct the MessagePacket into the first buffer.
@@ -67,7 +133,7 @@ inline zx_status_t MessagePacket::CreateCommon(uint32_t data_size, uint32_t num_
     static_assert(kMaxMessageHandles <= UINT16_MAX, "");
     msg->reset(new (packet) MessagePacket(chain, data_size, payload_offset,
                                           static_cast<uint16_t>(num_handles), handles));
-    // The MessagePacket now owns the BufferChain and msg owns the MessagePacket.
+    // The MessagePacket now owns its memory and msg owns the MessagePacket.
 
     return ZX_OK;
 }
@@ -80,7 +146,11 @@ zx_status_t MessagePacket::Create(user_in_ptr<const void> data, uint32_t data_si
     if (unlikely(status != ZX_OK)) {
         return status;
     }
-    status = new_msg->buffer_chain_->CopyIn(data, PayloadOffset(num_handles), data_size);
+    if (new_msg->buffer_chain_) {
+        status = new_msg->buffer_chain_->CopyIn(data, PayloadOffset(num_handles), data_size);
+    } else {
+        status = data.copy_array_from_user(new_msg->payload(), data_size);
+    }
     if (unlikely(status != ZX_OK)) {
         return status;
     }
@@ -96,22 +166,102 @@ zx_status_t MessagePacket::Create(const void* data, uint32_t data_size, uint32_t
     if (unlikely(status != ZX_OK)) {
         return status;
     }
-    status = new_msg->buffer_chain_->CopyInKernel(data, PayloadOffset(num_handles), data_size);
+    if (new_msg->buffer_chain_) {
+        status = new_msg->buffer_chain_->CopyInKernel(data, PayloadOffset(num_handles), data_size);
+    } else {
+        memcpy(new_msg->payload(), data, data_size);
+    }
+    if (unlikely(status != ZX_OK)) {
+        return status;
+    }
+    *msg = ktl::move(new_msg);
+    return ZX_OK;
+}
+
+// static
+zx_status_t MessagePacket::CreateIovec(user_in_ptr<const zx_channel_iovec_t> iovecs,
+                                       uint32_t num_iovecs, uint32_t num_handles,
+                                       MessagePacketPtr* msg) {
+    if (unlikely(num_iovecs > ZX_CHANNEL_MAX_MSG_IOVECS)) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+
+    // The segment list can be far too long to copy onto the stack whole, so it is read in
+    // chunks twice: once to size the message and once to fill it in.
+    constexpr uint32_t kChunk = 16;
+    zx_channel_iovec_t chunk[kChunk];
+
+    uint32_t data_size = 0;
+    for (uint32_t i = 0; i < num_iovecs; i += kChunk) {
+        const uint32_t n = fbl::min(kChunk, num_iovecs - i);
+        if (iovecs.element_offset(i).copy_array_from_user(chunk, n) != ZX_OK) {
+            return ZX_ERR_INVALID_ARGS;
+        }
+        for (uint32_t j = 0; j < n; j++) {
+            if (chunk[j].reserved != 0) {
+                return ZX_ERR_INVALID_ARGS;
+            }
+            data_size += fbl::min(chunk[j].capacity, kMaxMessageSize + 1);
+            if (data_size > kMaxMessageSize) {
+                return ZX_ERR_OUT_OF_RANGE;
+            }
+        }
+    }
+
+    MessagePacketPtr new_msg;
+    zx_status_t status = CreateCommon(data_size, num_handles, &new_msg);
     if (unlikely(status != ZX_OK)) {
         return status;
     }
+
+    // Another thread may change the segments between the two passes, so check that they
+    // still fill the message exactly.  Anything else would send uninitialized memory.
+    const uint32_t payload_offset = PayloadOffset(num_handles);
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < num_iovecs; i += kChunk) {
+        const uint32_t n = fbl::min(kChunk, num_iovecs - i);
+        if (iovecs.element_offset(i).copy_array_from_user(chunk, n) != ZX_OK) {
+            return ZX_ERR_INVALID_ARGS;
+        }
+        for (uint32_t j = 0; j < n; j++) {
+            const uint32_t len = chunk[j].capacity;
+            if (len > data_size - offset) {
+                return ZX_ERR_INVALID_ARGS;
+            }
+            auto src = make_user_in_ptr(chunk[j].buffer);
+            if (new_msg->buffer_chain_) {
+                status = new_msg->buffer_chain_->CopyIn(src, payload_offset + offset, len);
+            } else {
+                status = src.copy_array_from_user(new_msg->payload() + offset, len);
+            }
+            if (unlikely(status != ZX_OK)) {
+                return status;
+            }
+            offset += len;
+        }
+    }
+    if (offset != data_size) {
+        return ZX_ERR_INVALID_ARGS;
+    }
+
     *msg = ktl::move(new_msg);
     return ZX_OK;
 }
 
 void MessagePacket::recycle(MessagePacket* packet) {
-    // Grab the buffer chain for this packet
+    // Grab the buffer chain for this packet, and the size of block it would have
+    // come from if it doesn't have one
     BufferChain* chain = packet->buffer_chain_;
+    const size_t size = packet->payload_offset_ + packet->data_size_;
 
     // Manually destruct the packet.  Do not delete it; its memory did not come
-    // from new, it is contained as part of the buffer chain.
+    // from new, it is contained as part of the block or buffer chain.
     packet->~MessagePacket();
 
-    // Now return the buffer chain to where it came from.
-    BufferChain::Free(chain);
+    // Now return the memory to where it came from.
+    if (chain) {
+        BufferChain::Free(chain);
+    } else {
+        SizeClassFor(size)->Free(packet);
+    }
 }
@@ -90,6 +90,62 @@ static bool create_zero() {
     END_TEST;
 }
 
+// Create MessagePackets on either side of each small message size, and many at
+// once, and check their data survives.
+static bool create_small_sizes() {
+    BEGIN_TEST;
+    constexpr size_t kMaxSize = 4096;
+    ktl::unique_ptr<UserMemory> mem = UserMemory::Create(kMaxSize);
+    auto mem_in = make_user_in_ptr(mem->in());
+    auto mem_out = make_user_out_ptr(mem->out());
+
+    fbl::AllocChecker ac;
+    auto buf = ktl::unique_ptr<char[]>(new (&ac) char[kMaxSize]);
+    ASSERT_TRUE(ac.check(), "");
+    auto result_buf = ktl::unique_ptr<char[]>(new (&ac) char[kMaxSize]);
+    ASSERT_TRUE(ac.check(), "");
+    for (size_t i = 0; i < kMaxSize; i++) {
+        buf[i] = static_cast<char>(i * 7);
+    }
+
+    static const uint32_t kSizes[] = {1, 4, 63, 64, 65, 127, 200, 255, 256, 511, 512, 1000,
+                                      1023, 1024, 1900, 2047, 2048, 2049, 3000, 4096};
+    static const uint32_t kHandleCounts[] = {0, 1, 3, 64};
+    for (uint32_t size : kSizes) {
+        for (uint32_t num_handles : kHandleCounts) {
+            MessagePacketPtr mp;
+            ASSERT_EQ(ZX_OK, MessagePacket::Create(buf.get(), size, num_handles, &mp), "");
+            ASSERT_EQ(size, mp->data_size(), "");
+            EXPECT_EQ(num_handles, mp->num_handles(), "");
+
+            memset(result_buf.get(), 0, size);
+            ASSERT_EQ(ZX_OK, mp->CopyDataTo(mem_out), "");
+            ASSERT_EQ(ZX_OK, mem_in.copy_array_from_user(result_buf.get(), size), "");
+            EXPECT_EQ(0, memcmp(buf.get(), result_buf.get(), size), "");
+
+            if (size >= sizeof(zx_txid_t)) {
+                mp->set_txid(0x12345678);
+                EXPECT_EQ(0x12345678u, mp->get_txid(), "");
+            }
+        }
+    }
+
+    // Hold enough small messages at once to move blocks in and out of the
+    // per-cpu caches a few times.
+    constexpr size_t kCount = 200;
+    auto packets = ktl::unique_ptr<MessagePacketPtr[]>(new (&ac) MessagePacketPtr[kCount]);
+    ASSERT_TRUE(ac.check(), "");
+    for (size_t i = 0; i < kCount; i++) {
+        ASSERT_EQ(ZX_OK, MessagePacket::Create(buf.get() + i, 64, 0, &packets[i]), "");
+    }
+    for (size_t i = 0; i < kCount; i++) {
+        ASSERT_EQ(ZX_OK, packets[i]->CopyDataTo(mem_out), "");
+        ASSERT_EQ(ZX_OK, mem_in.copy_array_from_user(result_buf.get(), 64), "");
+        EXPECT_EQ(0, memcmp(buf.get() + i, result_buf.get(), 64), "");
+    }
+    END_TEST;
+}
+
 // Attempt to create a MessagePacket with too many handles.
 static bool create_too_many_handles() {
     BEGIN_TEST;
@@ -147,6 +203,7 @@ UNITTEST_START_TESTCASE(message_packet_tests)
 UNITTEST("create", create)
 UNITTEST("create_void_star", create_void_star)
 UNITTEST("create_zero", create_zero)
+UNITTEST("create_small_sizes", create_small_sizes)
 UNITTEST("create_too_many_handles", create_too_many_handles)
 UNITTEST("create_bad_mem", create_bad_mem)
 UNITTEST("copy_bad_mem", copy_bad_mem)
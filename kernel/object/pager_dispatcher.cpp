@@ -4,6 +4,8 @@
 // license that can be found in the LICENSE file or at
 // https://opensource.org/licenses/MIT
 
+#include <fbl/auto_lock.h>
+#include <inttypes.h>
 #include <object/pager_dispatcher.h>
 #include <trace.h>
 #include <vm/page_source.h>
@@ -66,7 +68,9 @@ void PagerDispatcher::on_zero_handles() {
             inner = src.src_;
         }
 
-        // Call close outside of the lock, since it will call back into ::OnClose.
+        // Call close outside of the lock, since it will call back into ::OnClose. A source
+        // whose packet is being dequeued stays on the list until the port frees the
+        // packet, which Close() will find already closed.
         mtx_.Release();
         if (inner) {
             inner->Close();
@@ -78,19 +82,69 @@ void PagerDispatcher::on_zero_handles() {
 
 PageSourceWrapper::PageSourceWrapper(PagerDispatcher* dispatcher,
                                      fbl::RefPtr<PortDispatcher> port, uint64_t key)
-    : pager_(dispatcher), port_(ktl::move(port)), key_(key) {
+    : pager_(dispatcher), port_(ktl::move(port)), key_(key), packet_(nullptr, this) {
     LTRACEF("%p key %lx\n", this, key_);
 }
 
 PageSourceWrapper::~PageSourceWrapper() {
     LTRACEF("%p\n", this);
     DEBUG_ASSERT(closed_);
+    DEBUG_ASSERT(!packet_busy_);
+}
+
+zx_status_t PageSourceWrapper::SendRequest(uint64_t offset, uint64_t len) {
+    fbl::AutoLock lock(&mtx_);
+    DEBUG_ASSERT(!closed_);
+    DEBUG_ASSERT(!packet_busy_);
+
+    packet_.packet = {};
+    packet_.packet.key = key_;
+    packet_.packet.type = ZX_PKT_TYPE_PAGE_REQUEST;
+    packet_.packet.status = ZX_OK;
+    packet_.packet.page_request.command = ZX_PAGER_VMO_READ;
+    packet_.packet.page_request.offset = offset;
+    packet_.packet.page_request.length = len;
+
+    zx_status_t status = port_->Queue(&packet_, 0, 0);
+    if (status == ZX_OK) {
+        packet_busy_ = true;
+    }
+    LTRACEF("%p offset %#" PRIx64 " len %#" PRIx64 " status %d\n", this, offset, len, status);
+    return status;
+}
+
+void PageSourceWrapper::Free(PortPacket* port_packet) {
+    DEBUG_ASSERT(port_packet == &packet_);
+
+    fbl::RefPtr<PageSource> src;
+    {
+        fbl::AutoLock lock(&mtx_);
+        packet_busy_ = false;
+        if (!closed_) {
+            src = src_;
+        }
+    }
+
+    if (src) {
+        // The pager has the request, so the source can send the next one.
+        src->OnRequestTaken();
+    } else {
+        // OnClose() left the release to us, since the port still had the packet.
+        pager_->ReleaseSource(this);
+    }
 }
 
 void PageSourceWrapper::OnClose() {
     {
         fbl::AutoLock lock(&mtx_);
         closed_ = true;
+        if (packet_busy_ && port_->CancelQueued(&packet_)) {
+            packet_busy_ = false;
+        }
+        if (packet_busy_) {
+            // The packet is being dequeued right now, so Free() is about to be called.
+            return;
+        }
     }
     pager_->ReleaseSource(this);
 }
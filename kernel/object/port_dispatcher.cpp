@@ -12,12 +12,12 @@
 #include <pow2.h>
 
 #include <fbl/alloc_checker.h>
-#include <fbl/arena.h>
 #include <fbl/auto_lock.h>
 #include <lib/counters.h>
 #include <object/excp_port.h>
 #include <object/handle.h>
 #include <object/process_dispatcher.h>
+#include <object/slab.h>
 #include <object/thread_dispatcher.h>
 #include <zircon/compiler.h>
 #include <zircon/rights.h>
@@ -37,16 +37,16 @@ static_assert(sizeof(zx_packet_interrupt_t) == 32, "incorrect size for zx_packet
 KCOUNTER(port_arena_count, "kernel.port.arena.count");
 KCOUNTER(port_full_count, "kernel.port.full.count");
 
-class ArenaPortAllocator final : public PortAllocator {
+class SlabPortAllocator final : public PortAllocator {
 public:
     zx_status_t Init();
-    virtual ~ArenaPortAllocator() = default;
+    virtual ~SlabPortAllocator() = default;
 
     virtual PortPacket* Alloc();
     virtual void Free(PortPacket* port_packet);
 
 private:
-    fbl::TypedArena<PortPacket, fbl::Mutex> arena_;
+    TypedSlab<PortPacket> slab_;
 };
 
 namespace {
@@ -54,15 +54,15 @@ constexpr size_t kMaxPendingPacketCount = 16 * 1024u;
 
 // TODO(maniscalco): Enforce this limit per process via the job policy.
 constexpr size_t kMaxPendingPacketCountPerPort = kMaxPendingPacketCount / 8;
-ArenaPortAllocator port_allocator;
+SlabPortAllocator port_allocator;
 } // namespace.
 
-zx_status_t ArenaPortAllocator::Init() {
-    return arena_.Init("packets", kMaxPendingPacketCount);
+zx_status_t SlabPortAllocator::Init() {
+    return slab_.Init("packets", kMaxPendingPacketCount);
 }
 
-PortPacket* ArenaPortAllocator::Alloc() {
-    PortPacket* packet = arena_.New(nullptr, this);
+PortPacket* SlabPortAllocator::Alloc() {
+    PortPacket* packet = slab_.New(nullptr, this);
     if (packet == nullptr) {
         printf("WARNING: Could not allocate new port packet\n");
         return nullptr;
@@ -71,8 +71,8 @@ PortPacket* ArenaPortAllocator::Alloc() {
     return packet;
 }
 
-void ArenaPortAllocator::Free(PortPacket* port_packet) {
-    arena_.Delete(port_packet);
+void SlabPortAllocator::Free(PortPacket* port_packet) {
+    slab_.Delete(port_packet);
     kcounter_add(port_arena_count, -1);
 }
 
@@ -298,43 +298,67 @@ zx_status_t PortDispatcher::Queue(PortPacket* port_packet, zx_signals_t observed
 
 zx_status_t PortDispatcher::Dequeue(zx_time_t deadline, TimerSlack slack,
                                     zx_port_packet_t* out_packet) {
+    size_t actual;
+    return DequeueMany(deadline, slack, out_packet, 1, &actual);
+}
+
+zx_status_t PortDispatcher::DequeueMany(zx_time_t deadline, TimerSlack slack,
+                                        zx_port_packet_t* out_packets, size_t count,
+                                        size_t* actual) {
     canary_.Assert();
+    DEBUG_ASSERT(count > 0);
 
     while (true) {
+        size_t n = 0;
         if (options_ == ZX_PORT_BIND_TO_INTERRUPT) {
             Guard<SpinLock, IrqSave> guard{&spinlock_};
-            PortInterruptPacket* port_interrupt_packet = interrupt_packets_.pop_front();
-            if (port_interrupt_packet != nullptr) {
+            while (n < count) {
+                PortInterruptPacket* port_interrupt_packet = interrupt_packets_.pop_front();
+                if (port_interrupt_packet == nullptr) {
+                    break;
+                }
+                zx_port_packet_t* out_packet = &out_packets[n++];
                 *out_packet = {};
                 out_packet->key = port_interrupt_packet->key;
                 out_packet->type = ZX_PKT_TYPE_INTERRUPT;
                 out_packet->status = ZX_OK;
                 out_packet->interrupt.timestamp = port_interrupt_packet->timestamp;
-                return ZX_OK;
             }
         }
-        {
-            Guard<fbl::Mutex> guard{get_lock()};
-            PortPacket* port_packet = packets_.pop_front();
-            if (port_packet != nullptr) {
-                --num_packets_;
-                *out_packet = port_packet->packet;
-
-                bool is_ephemeral = port_packet->is_ephemeral();
-                // The reference to the port that the observer holds cannot be the last one
-                // because another reference was used to call Dequeue, so we don't need to
-                // worry about destroying ourselves.
-                port_packet->observer.reset();
-                guard.Release();
-
-                // If the packet is ephemeral, free it outside of the lock. We need to read
-                // is_ephemeral inside the lock because it's possible for a non-ephemeral packet
-                // to get deleted after a call to |MaybeReap| as soon as we release the lock.
-                if (is_ephemeral) {
-                    port_packet->Free();
+        if (n < count) {
+            fbl::DoublyLinkedList<PortPacket*> ephemeral;
+            {
+                Guard<fbl::Mutex> guard{get_lock()};
+                while (n < count) {
+                    PortPacket* port_packet = packets_.pop_front();
+                    if (port_packet == nullptr) {
+                        break;
+                    }
+                    --num_packets_;
+                    out_packets[n++] = port_packet->packet;
+
+                    // We need to read is_ephemeral inside the lock because it's possible for a
+                    // non-ephemeral packet to get deleted after a call to |MaybeReap| as soon as
+                    // we release the lock.
+                    bool is_ephemeral = port_packet->is_ephemeral();
+                    // The reference to the port that the observer holds cannot be the last one
+                    // because another reference was used to call Dequeue, so we don't need to
+                    // worry about destroying ourselves.
+                    port_packet->observer.reset();
+                    if (is_ephemeral) {
+                        ephemeral.push_back(port_packet);
+                    }
                 }
-                return ZX_OK;
             }
+
+            // Free the ephemeral packets outside of the lock.
+            while (!ephemeral.is_empty()) {
+                ephemeral.pop_front()->Free();
+            }
+        }
+        if (n > 0) {
+            *actual = n;
+            return ZX_OK;
         }
 
         {
@@ -435,6 +459,23 @@ bool PortDispatcher::CancelQueued(const void* handle, uint64_t key) {
     return packet_removed;
 }
 
+bool PortDispatcher::CancelQueued(PortPacket* port_packet) {
+    canary_.Assert();
+
+    Guard<fbl::Mutex> guard{get_lock()};
+
+    // The packet can be in a container without being in |packets_|, if it has just been
+    // dequeued and is waiting to be freed.
+    for (auto it = packets_.begin(); it != packets_.end(); ++it) {
+        if (&*it == port_packet) {
+            packets_.erase(it);
+            --num_packets_;
+            return true;
+        }
+    }
+    return false;
+}
+
 void PortDispatcher::LinkExceptionPort(ExceptionPort* eport) {
     canary_.Assert();
 
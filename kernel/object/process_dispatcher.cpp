@@ -16,6 +16,7 @@
 #include <arch/defines.h>
 
 #include <kernel/thread.h>
+#include <vm/pmm.h>
 #include <vm/vm.h>
 #include <vm/vm_aspace.h>
 #include <vm/vm_object.h>
@@ -445,11 +446,18 @@ zx_handle_t ProcessDispatcher::MapHandleToValue(const HandleOwner& handle) const
     return map_handle_to_value(handle.get(), handle_rand_);
 }
 
-Handle* ProcessDispatcher::GetHandleLocked(zx_handle_t handle_value,
-                                           bool skip_policy) {
+Handle* ProcessDispatcher::LookupHandle(zx_handle_t handle_value) const {
     auto handle = map_value_to_handle(handle_value, handle_rand_);
     if (handle && handle->process_id() == get_koid())
         return handle;
+    return nullptr;
+}
+
+Handle* ProcessDispatcher::GetHandleLocked(zx_handle_t handle_value,
+                                           bool skip_policy) {
+    Handle* handle = LookupHandle(handle_value);
+    if (handle)
+        return handle;
 
     // Handle lookup failed.  We potentially generate an exception,
     // depending on the job policy.  Note that we don't use the return
@@ -521,44 +529,56 @@ zx_status_t ProcessDispatcher::RemoveHandles(user_in_ptr<const zx_handle_t> user
     return status;
 }
 
+// The lookups below don't take handle_table_lock_; see Handle::Reader.  The
+// policy check for a bad handle can block, so it happens after the section.
+
 zx_koid_t ProcessDispatcher::GetKoidForHandle(zx_handle_t handle_value) {
-    Guard<fbl::Mutex> guard{&handle_table_lock_};
-    Handle* handle = GetHandleLocked(handle_value);
-    if (!handle)
-        return ZX_KOID_INVALID;
-    return handle->dispatcher()->get_koid();
+    {
+        Handle::Reader reader;
+        Handle* handle = LookupHandle(handle_value);
+        if (handle)
+            return handle->dispatcher()->get_koid();
+    }
+    QueryBasicPolicy(ZX_POL_BAD_HANDLE);
+    return ZX_KOID_INVALID;
 }
 
 zx_status_t ProcessDispatcher::GetDispatcherInternal(zx_handle_t handle_value,
                                                      fbl::RefPtr<Dispatcher>* dispatcher,
                                                      zx_rights_t* rights) {
-    Guard<fbl::Mutex> guard{&handle_table_lock_};
-    Handle* handle = GetHandleLocked(handle_value);
-    if (!handle)
-        return ZX_ERR_BAD_HANDLE;
-
-    *dispatcher = handle->dispatcher();
-    if (rights)
-        *rights = handle->rights();
-    return ZX_OK;
+    {
+        Handle::Reader reader;
+        Handle* handle = LookupHandle(handle_value);
+        if (handle) {
+            *dispatcher = handle->dispatcher();
+            if (rights)
+                *rights = handle->rights();
+            return ZX_OK;
+        }
+    }
+    QueryBasicPolicy(ZX_POL_BAD_HANDLE);
+    return ZX_ERR_BAD_HANDLE;
 }
 
 zx_status_t ProcessDispatcher::GetDispatcherWithRightsInternal(zx_handle_t handle_value,
                                                                zx_rights_t desired_rights,
                                                                fbl::RefPtr<Dispatcher>* dispatcher_out,
                                                                zx_rights_t* out_rights) {
-    Guard<fbl::Mutex> guard{&handle_table_lock_};
-    Handle* handle = GetHandleLocked(handle_value);
-    if (!handle)
-        return ZX_ERR_BAD_HANDLE;
-
-    if (!handle->HasRights(desired_rights))
-        return ZX_ERR_ACCESS_DENIED;
-
-    *dispatcher_out = handle->dispatcher();
-    if (out_rights)
-        *out_rights = handle->rights();
-    return ZX_OK;
+    {
+        Handle::Reader reader;
+        Handle* handle = LookupHandle(handle_value);
+        if (handle) {
+            if (!handle->HasRights(desired_rights))
+                return ZX_ERR_ACCESS_DENIED;
+
+            *dispatcher_out = handle->dispatcher();
+            if (out_rights)
+                *out_rights = handle->rights();
+            return ZX_OK;
+        }
+    }
+    QueryBasicPolicy(ZX_POL_BAD_HANDLE);
+    return ZX_ERR_BAD_HANDLE;
 }
 
 zx_status_t ProcessDispatcher::GetInfo(zx_info_process_t* info) {
@@ -828,6 +848,19 @@ zx_status_t ProcessDispatcher::set_debug_addr(uintptr_t addr) {
     return ZX_OK;
 }
 
+uint32_t ProcessDispatcher::get_numa_node() const {
+    Guard<fbl::Mutex> guard{get_lock()};
+    return numa_node_;
+}
+
+zx_status_t ProcessDispatcher::set_numa_node(uint32_t node) {
+    if (node != ZX_NUMA_NODE_ANY && node >= pmm_numa_node_count())
+        return ZX_ERR_INVALID_ARGS;
+    Guard<fbl::Mutex> guard{get_lock()};
+    numa_node_ = node;
+    return ZX_OK;
+}
+
 zx_status_t ProcessDispatcher::QueryBasicPolicy(uint32_t condition) const {
     auto action = policy_.QueryBasicPolicy(condition);
     if (action & ZX_POL_ACTION_EXCEPTION) {
@@ -863,13 +896,15 @@ const char* StateToString(ProcessDispatcher::State state) {
 }
 
 bool ProcessDispatcher::IsHandleValid(zx_handle_t handle_value) {
-    Guard<fbl::Mutex> guard{&handle_table_lock_};
-    return (GetHandleLocked(handle_value) != nullptr);
+    if (IsHandleValidNoPolicyCheck(handle_value))
+        return true;
+    QueryBasicPolicy(ZX_POL_BAD_HANDLE);
+    return false;
 }
 
 bool ProcessDispatcher::IsHandleValidNoPolicyCheck(zx_handle_t handle_value) {
-    Guard<fbl::Mutex> guard{&handle_table_lock_};
-    return (GetHandleLocked(handle_value, true) != nullptr);
+    Handle::Reader reader;
+    return (LookupHandle(handle_value) != nullptr);
 }
 
 void ProcessDispatcher::OnProcessStartForJobDebugger(ThreadDispatcher *t) {
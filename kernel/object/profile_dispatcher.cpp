@@ -15,15 +15,43 @@
 
 #include <zircon/rights.h>
 
-zx_status_t validate_profile(const zx_profile_info_t& info) {
-    if (info.type != ZX_PROFILE_INFO_SCHEDULER)
+static zx_status_t validate_profile(const zx_profile_info_t& info) {
+    switch (info.type) {
+    case ZX_PROFILE_INFO_SCHEDULER:
+        if ((info.scheduler.priority < LOWEST_PRIORITY) ||
+            (info.scheduler.priority  > HIGHEST_PRIORITY))
+            return ZX_ERR_INVALID_ARGS;
+        return ZX_OK;
+    default:
         return ZX_ERR_NOT_SUPPORTED;
-    if ((info.scheduler.priority < LOWEST_PRIORITY) ||
-        (info.scheduler.priority  > HIGHEST_PRIORITY))
+    }
+}
+
+static zx_status_t validate_profile(const zx_profile_deadline_info_t& info) {
+    if ((info.type != ZX_PROFILE_INFO_DEADLINE) || (info.reserved != 0))
+        return ZX_ERR_INVALID_ARGS;
+    // The capacity has to fit inside the deadline, which has to fit inside the period.
+    if ((info.deadline.capacity <= 0) ||
+        (info.deadline.capacity > info.deadline.deadline) ||
+        (info.deadline.deadline > info.deadline.period))
         return ZX_ERR_INVALID_ARGS;
     return ZX_OK;
 }
 
+zx_status_t ProfileDispatcher::Make(const zx_profile_info_t& info,
+                                    const zx_profile_deadline_t& deadline,
+                                    fbl::RefPtr<Dispatcher>* dispatcher,
+                                    zx_rights_t* rights) {
+    fbl::AllocChecker ac;
+    auto disp = new (&ac) ProfileDispatcher(info, deadline);
+    if (!ac.check())
+        return ZX_ERR_NO_MEMORY;
+
+    *rights = default_rights();
+    *dispatcher = fbl::AdoptRef<Dispatcher>(disp);
+    return ZX_OK;
+}
+
 zx_status_t ProfileDispatcher::Create(const zx_profile_info_t& info,
                                       fbl::RefPtr<Dispatcher>* dispatcher,
                                       zx_rights_t* rights) {
@@ -31,23 +59,39 @@ zx_status_t ProfileDispatcher::Create(const zx_profile_info_t& info,
     if (status != ZX_OK)
         return status;
 
-    fbl::AllocChecker ac;
-    auto disp = new (&ac) ProfileDispatcher(info);
-    if (!ac.check())
-        return ZX_ERR_NO_MEMORY;
+    return Make(info, zx_profile_deadline_t{}, dispatcher, rights);
+}
 
-    *rights = default_rights();
-    *dispatcher = fbl::AdoptRef<Dispatcher>(disp);
-    return ZX_OK;
+zx_status_t ProfileDispatcher::Create(const zx_profile_deadline_info_t& info,
+                                      fbl::RefPtr<Dispatcher>* dispatcher,
+                                      zx_rights_t* rights) {
+    auto status = validate_profile(info);
+    if (status != ZX_OK)
+        return status;
+
+    zx_profile_info_t profile_info = {};
+    profile_info.type = ZX_PROFILE_INFO_DEADLINE;
+    return Make(profile_info, info.deadline, dispatcher, rights);
 }
 
-ProfileDispatcher::ProfileDispatcher(const zx_profile_info_t& info)
-    : info_(info) {}
+ProfileDispatcher::ProfileDispatcher(const zx_profile_info_t& info,
+                                     const zx_profile_deadline_t& deadline)
+    : info_(info), deadline_(deadline) {}
 
 ProfileDispatcher::~ProfileDispatcher() {
 }
 
 zx_status_t ProfileDispatcher::ApplyProfile(fbl::RefPtr<ThreadDispatcher> thread) {
-    // At the moment, the only thing we support is the priority.
-    return thread->SetPriority(info_.scheduler.priority);
+    switch (info_.type) {
+    case ZX_PROFILE_INFO_DEADLINE:
+        return thread->SetDeadline(deadline_.capacity, deadline_.deadline,
+                                   deadline_.period);
+    default: {
+        // A priority profile takes the thread out of deadline scheduling.
+        zx_status_t status = thread->SetDeadline(0, 0, 0);
+        if (status != ZX_OK)
+            return status;
+        return thread->SetPriority(info_.scheduler.priority);
+    }
+    }
 }
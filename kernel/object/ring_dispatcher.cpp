@@ -0,0 +1,189 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <object/ring_dispatcher.h>
+
+#include <arch/ops.h>
+#include <fbl/alloc_checker.h>
+#include <ktl/move.h>
+#include <vm/physmap.h>
+#include <vm/pmm.h>
+#include <vm/vm_object_paged.h>
+#include <zircon/rights.h>
+
+static_assert(ZX_RING_DATA_OFFSET == PAGE_SIZE, "the control block must have its own page");
+static_assert(sizeof(zx_ring_header_t) <= ZX_RING_DATA_OFFSET, "");
+
+static zx_status_t get_paddr(void* context, size_t offset, size_t index, paddr_t pa) {
+    *static_cast<paddr_t*>(context) = pa;
+    return ZX_OK;
+}
+
+// static
+zx_status_t RingDispatcher::Create(size_t elem_count, size_t elem_size, uint32_t options,
+                                   fbl::RefPtr<Dispatcher>* producer,
+                                   fbl::RefPtr<Dispatcher>* consumer,
+                                   zx_rights_t* rights) {
+    if (options != 0)
+        return ZX_ERR_INVALID_ARGS;
+
+    // elem_count and elem_size must be nonzero
+    // elem_count must be a power of two
+    // total size must be <= ZX_RING_MAX_SIZE
+    if (!elem_count || !elem_size || (elem_count & (elem_count - 1)) ||
+        (elem_count > ZX_RING_MAX_SIZE) || (elem_size > ZX_RING_MAX_SIZE) ||
+        ((elem_count * elem_size) > ZX_RING_MAX_SIZE)) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+
+    fbl::RefPtr<VmObject> vmo;
+    zx_status_t status = VmObjectPaged::Create(
+        PMM_ALLOC_FLAG_ANY, 0u, ZX_RING_DATA_OFFSET + ROUNDUP(elem_count * elem_size, PAGE_SIZE),
+        &vmo);
+    if (status != ZX_OK)
+        return status;
+    vmo->set_name("ring", 4);
+
+    // Writing the control block commits its page, so it can be pinned.
+    zx_ring_header_t header = {};
+    header.elem_size = static_cast<uint32_t>(elem_size);
+    header.elem_count = static_cast<uint32_t>(elem_count);
+    status = vmo->Write(&header, 0, sizeof(header));
+    if (status != ZX_OK)
+        return status;
+
+    // Each end takes its own pin on the control block and drops it in its
+    // destructor.
+    status = vmo->Pin(0, PAGE_SIZE);
+    if (status != ZX_OK)
+        return status;
+
+    paddr_t header_pa = 0;
+    status = vmo->Lookup(0, PAGE_SIZE, get_paddr, &header_pa);
+    if (status != ZX_OK) {
+        vmo->Unpin(0, PAGE_SIZE);
+        return status;
+    }
+    auto header_va = static_cast<const zx_ring_header_t*>(paddr_to_physmap(header_pa));
+
+    fbl::RefPtr<Dispatcher> vmo_dispatcher;
+    zx_rights_t vmo_rights;
+    status = VmObjectDispatcher::Create(vmo, &vmo_dispatcher, &vmo_rights);
+    if (status != ZX_OK) {
+        vmo->Unpin(0, PAGE_SIZE);
+        return status;
+    }
+    auto vmo_disp = DownCastDispatcher<VmObjectDispatcher>(&vmo_dispatcher);
+
+    fbl::AllocChecker ac;
+    auto holder0 = fbl::AdoptRef(new (&ac) PeerHolder<RingDispatcher>());
+    if (!ac.check()) {
+        vmo->Unpin(0, PAGE_SIZE);
+        return ZX_ERR_NO_MEMORY;
+    }
+    auto holder1 = holder0;
+
+    auto ring0 = fbl::AdoptRef(new (&ac) RingDispatcher(ktl::move(holder0), true,
+                                                        static_cast<uint32_t>(elem_count),
+                                                        vmo_disp, header_va));
+    if (!ac.check()) {
+        vmo->Unpin(0, PAGE_SIZE);
+        return ZX_ERR_NO_MEMORY;
+    }
+
+    // From here on |ring0| owns the first pin.
+    status = vmo->Pin(0, PAGE_SIZE);
+    if (status != ZX_OK)
+        return status;
+
+    auto ring1 = fbl::AdoptRef(new (&ac) RingDispatcher(ktl::move(holder1), false,
+                                                        static_cast<uint32_t>(elem_count),
+                                                        ktl::move(vmo_disp), header_va));
+    if (!ac.check()) {
+        vmo->Unpin(0, PAGE_SIZE);
+        return ZX_ERR_NO_MEMORY;
+    }
+
+    ring0->Init(ring1);
+    ring1->Init(ring0);
+
+    *rights = default_rights();
+    *producer = ktl::move(ring0);
+    *consumer = ktl::move(ring1);
+    return ZX_OK;
+}
+
+RingDispatcher::RingDispatcher(fbl::RefPtr<PeerHolder<RingDispatcher>> holder, bool is_producer,
+                               uint32_t elem_count, fbl::RefPtr<VmObjectDispatcher> vmo,
+                               const zx_ring_header_t* header)
+    : PeeredDispatcher(ktl::move(holder), is_producer ? ZX_RING_WRITABLE : 0u),
+      is_producer_(is_producer), elem_count_(elem_count), vmo_(ktl::move(vmo)),
+      header_(header) {
+}
+
+RingDispatcher::~RingDispatcher() {
+    vmo_->vmo()->Unpin(0, PAGE_SIZE);
+}
+
+// Thread safety analysis disabled as this happens during creation only,
+// when no other thread could be accessing the object.
+void RingDispatcher::Init(fbl::RefPtr<RingDispatcher> other) TA_NO_THREAD_SAFETY_ANALYSIS {
+    peer_ = ktl::move(other);
+    peer_koid_ = peer_->get_koid();
+}
+
+void RingDispatcher::on_zero_handles_locked() {
+    canary_.Assert();
+}
+
+void RingDispatcher::OnPeerZeroHandlesLocked() {
+    canary_.Assert();
+
+    UpdateStateLocked(ZX_RING_WRITABLE, ZX_RING_PEER_CLOSED);
+}
+
+zx_status_t RingDispatcher::Notify() TA_NO_THREAD_SAFETY_ANALYSIS {
+    canary_.Assert();
+
+    Guard<fbl::Mutex> guard{get_lock()};
+
+    // Each end publishes its own index, issues a full barrier and then loads
+    // the other end's index to decide whether it needs to call here.  This
+    // barrier completes the pairing: either the end that moved an index sees
+    // that the other end may be waiting and calls Notify(), or the waiting
+    // end's own Notify() sees the moved index.
+    smp_mb();
+    uint64_t head = __atomic_load_n(&header_->head, __ATOMIC_RELAXED);
+    uint64_t tail = __atomic_load_n(&header_->tail, __ATOMIC_RELAXED);
+    uint64_t count = head - tail;
+
+    // The indices are in memory userspace can write, so they may be garbage.
+    if (count > elem_count_)
+        return ZX_ERR_BAD_STATE;
+
+    RingDispatcher* producer = is_producer_ ? this : peer_.get();
+    RingDispatcher* consumer = is_producer_ ? peer_.get() : this;
+
+    // Once the consumer has gone, the producer stays unwritable.
+    if (producer && consumer) {
+        if (count < elem_count_) {
+            producer->UpdateStateLocked(0u, ZX_RING_WRITABLE);
+        } else {
+            producer->UpdateStateLocked(ZX_RING_WRITABLE, 0u);
+        }
+    }
+
+    // Elements left behind by a producer that has gone can still be read.
+    if (consumer) {
+        if (count > 0) {
+            consumer->UpdateStateLocked(0u, ZX_RING_READABLE);
+        } else {
+            consumer->UpdateStateLocked(ZX_RING_READABLE, 0u);
+        }
+    }
+
+    return peer_ ? ZX_OK : ZX_ERR_PEER_CLOSED;
+}
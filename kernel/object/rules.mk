@@ -42,7 +42,9 @@ MODULE_SRCS := \
     $(LOCAL_DIR)/profile_dispatcher.cpp \
     $(LOCAL_DIR)/resource_dispatcher.cpp \
     $(LOCAL_DIR)/resource.cpp \
+    $(LOCAL_DIR)/ring_dispatcher.cpp \
     $(LOCAL_DIR)/semaphore.cpp \
+    $(LOCAL_DIR)/slab.cpp \
     $(LOCAL_DIR)/socket_dispatcher.cpp \
     $(LOCAL_DIR)/suspend_token_dispatcher.cpp \
     $(LOCAL_DIR)/thread_dispatcher.cpp \
@@ -56,9 +58,11 @@ MODULE_SRCS := \
 # Tests
 MODULE_SRCS += \
     $(LOCAL_DIR)/buffer_chain_tests.cpp \
+    $(LOCAL_DIR)/handle_tests.cpp \
     $(LOCAL_DIR)/job_policy_tests.cpp \
     $(LOCAL_DIR)/mbuf_tests.cpp \
     $(LOCAL_DIR)/message_packet_tests.cpp \
+    $(LOCAL_DIR)/slab_tests.cpp \
     $(LOCAL_DIR)/state_tracker_tests.cpp \
 
 MODULE_DEPS := \
@@ -0,0 +1,138 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <object/slab.h>
+
+#include <arch/ops.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+Slab::GlobalList Slab::all_slabs_ = {};
+
+Slab::~Slab() {
+    if (ready()) {
+        Guard<fbl::Mutex> guard{AllSlabsLock::Get()};
+        all_slabs_.erase(*this);
+    }
+}
+
+zx_status_t Slab::Init(const char* name, size_t object_size, size_t max_count)
+    TA_NO_THREAD_SAFETY_ANALYSIS {
+    DEBUG_ASSERT(!ready());
+
+    zx_status_t status = arena_.Init(name, object_size, max_count);
+    if (status != ZX_OK) {
+        return status;
+    }
+    strlcpy(name_, name, sizeof(name_));
+    max_count_ = max_count;
+    start_ = reinterpret_cast<uintptr_t>(arena_.start());
+    end_ = reinterpret_cast<uintptr_t>(arena_.end());
+    object_size_ = object_size;
+
+    Guard<fbl::Mutex> guard{AllSlabsLock::Get()};
+    all_slabs_.push_back(this);
+    return ZX_OK;
+}
+
+// Pop a free slot off the current cpu's magazine.  If the magazine is empty,
+// take the slot from the arena and restock the magazine with a batch more, so
+// the next few allocations here don't need the arena's lock.
+void* Slab::Alloc() {
+    if (unlikely(!ready())) {
+        return nullptr;
+    }
+
+    void* addr = magazines_.Get();
+    if (likely(addr)) {
+        return addr;
+    }
+
+    // The arena may need to commit pages, so it can't be used while holding a
+    // magazine's spinlock.  Gather the batch first.
+    void* batch[Magazines::kBatch];
+    size_t batch_count = 0;
+    Guard<fbl::Mutex> guard{&lock_};
+    addr = arena_.Alloc();
+    if (unlikely(!addr)) {
+        // The free slots may all be sitting in magazines.
+        DrainLocked();
+        addr = arena_.Alloc();
+        if (!addr) {
+            return nullptr;
+        }
+    }
+    while (batch_count < Magazines::kBatch) {
+        void* slot = arena_.Alloc();
+        if (!slot) {
+            break;
+        }
+        batch[batch_count++] = slot;
+    }
+
+    // Another thread may have filled the magazine meanwhile.
+    batch_count = magazines_.Fill(batch, batch_count);
+    while (batch_count > 0) {
+        arena_.Free(batch[--batch_count]);
+    }
+    return addr;
+}
+
+// Push a slot onto the current cpu's magazine.  If that overflows the
+// magazine, hand its oldest batch back to the arena.
+void Slab::Free(void* addr) {
+    DEBUG_ASSERT(owns(addr));
+
+    void* spill[Magazines::kBatch];
+    if (likely(!magazines_.Put(addr, spill))) {
+        return;
+    }
+
+    Guard<fbl::Mutex> guard{&lock_};
+    for (void* slot : spill) {
+        arena_.Free(slot);
+    }
+}
+
+void Slab::Drain() {
+    Guard<fbl::Mutex> guard{&lock_};
+    DrainLocked();
+}
+
+void Slab::DrainLocked() {
+    magazines_.Drain([this](void* slot) TA_NO_THREAD_SAFETY_ANALYSIS { arena_.Free(slot); });
+}
+
+void Slab::Dump() {
+    const Magazines::Stats stats = magazines_.GetStats();
+
+    Guard<fbl::Mutex> guard{&lock_};
+    // Slots sitting in magazines are allocated as far as the arena is
+    // concerned.
+    const size_t allocated = arena_.DiagnosticCount();
+    const size_t live = allocated > stats.cached ? allocated - stats.cached : 0;
+    printf("%-16s %6zu %8zu %8zu %8zu %8zuK %10" PRIu64 " %8" PRIu64 " %8" PRIu64 "\n",
+           name_, object_size_, live, stats.cached, max_count_,
+           arena_.DiagnosticCommittedBytes() / 1024, stats.hits, stats.misses, stats.spills);
+}
+
+void Slab::DumpArena() {
+    Guard<fbl::Mutex> guard{&lock_};
+    arena_.Dump();
+
+    printf("%zu free slots in cpu magazines\n", magazines_.GetStats().cached);
+}
+
+// static
+void Slab::DumpAll() {
+    printf("%-16s %6s %8s %8s %8s %9s %10s %8s %8s\n",
+           "name", "size", "live", "cached", "max", "committed", "hits", "misses", "spills");
+    Guard<fbl::Mutex> guard{AllSlabsLock::Get()};
+    for (auto& slab : all_slabs_) {
+        slab.Dump();
+    }
+}
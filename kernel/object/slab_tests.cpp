@@ -0,0 +1,94 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <object/slab.h>
+
+#include <fbl/unique_ptr.h>
+#include <lib/unittest/unittest.h>
+
+namespace {
+
+// Allocate and free more slots than a magazine holds, so slots move between
+// the magazines and the arena.
+static bool alloc_and_free_many() {
+    BEGIN_TEST;
+    constexpr size_t kCount = 200;
+
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<Slab> slab(new (&ac) Slab);
+    ASSERT_TRUE(ac.check(), "");
+    ASSERT_EQ(ZX_OK, slab->Init("slab-test", 64, kCount), "");
+
+    void* slots[kCount];
+    for (size_t round = 0; round < 2; round++) {
+        for (auto& slot : slots) {
+            slot = slab->Alloc();
+            ASSERT_NONNULL(slot, "");
+            EXPECT_TRUE(slab->owns(slot), "");
+            memset(slot, 0xa5, 64);
+        }
+        for (size_t i = 0; i < kCount; i++) {
+            for (size_t j = i + 1; j < kCount; j++) {
+                EXPECT_NE(slots[i], slots[j], "");
+            }
+        }
+        for (auto& slot : slots) {
+            slab->Free(slot);
+        }
+    }
+    END_TEST;
+}
+
+// A full slab fails, and frees make room again even when the free slots are
+// sitting in magazines.
+static bool full_slab() {
+    BEGIN_TEST;
+    constexpr size_t kCount = PAGE_SIZE / 64;
+
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<Slab> slab(new (&ac) Slab);
+    ASSERT_TRUE(ac.check(), "");
+    ASSERT_EQ(ZX_OK, slab->Init("slab-test", 64, kCount), "");
+
+    void* slots[kCount];
+    for (auto& slot : slots) {
+        slot = slab->Alloc();
+        ASSERT_NONNULL(slot, "");
+    }
+    EXPECT_NULL(slab->Alloc(), "");
+
+    slab->Free(slots[0]);
+    slots[0] = slab->Alloc();
+    EXPECT_NONNULL(slots[0], "");
+
+    for (auto& slot : slots) {
+        slab->Free(slot);
+    }
+    slab->Drain();
+    EXPECT_NONNULL(slab->Alloc(), "");
+    END_TEST;
+}
+
+// An uninitialized slab hands out nothing and owns nothing.
+static bool uninitialized_slab() {
+    BEGIN_TEST;
+
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<Slab> slab(new (&ac) Slab);
+    ASSERT_TRUE(ac.check(), "");
+    EXPECT_FALSE(slab->ready(), "");
+    EXPECT_NULL(slab->Alloc(), "");
+    EXPECT_FALSE(slab->owns(slab.get()), "");
+    END_TEST;
+}
+
+} // namespace
+
+UNITTEST_START_TESTCASE(slab_tests)
+UNITTEST("alloc_and_free_many", alloc_and_free_many)
+UNITTEST("full_slab", full_slab)
+UNITTEST("uninitialized_slab", uninitialized_slab)
+UNITTEST_END_TESTCASE(slab_tests, "slab", "Slab tests");
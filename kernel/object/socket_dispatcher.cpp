@@ -19,6 +19,7 @@
 #include <vm/vm_object.h>
 #include <vm/vm_object_paged.h>
 #include <object/handle.h>
+#include <object/vm_object_dispatcher.h>
 
 #include <zircon/rights.h>
 #include <fbl/alloc_checker.h>
@@ -206,6 +207,33 @@ zx_status_t SocketDispatcher::Write(user_in_ptr<const void> src, size_t len,
     return peer_->WriteSelfLocked(src, len, nwritten);
 }
 
+zx_status_t SocketDispatcher::WriteVmo(fbl::RefPtr<VmObject> vmo, uint64_t offset, size_t len,
+                                       size_t* nwritten) TA_NO_THREAD_SAFETY_ANALYSIS {
+    canary_.Assert();
+
+    LTRACE_ENTRY;
+
+    if (flags_ & ZX_SOCKET_DATAGRAM)
+        return ZX_ERR_NOT_SUPPORTED;
+
+    Guard<fbl::Mutex> guard{get_lock()};
+
+    if (!peer_)
+        return ZX_ERR_PEER_CLOSED;
+    zx_signals_t signals = GetSignalsStateLocked();
+    if (signals & ZX_SOCKET_WRITE_DISABLED)
+        return ZX_ERR_BAD_STATE;
+
+    if (len == 0) {
+        *nwritten = 0;
+        return ZX_OK;
+    }
+    if (len != static_cast<size_t>(static_cast<uint32_t>(len)))
+        return ZX_ERR_INVALID_ARGS;
+
+    return peer_->WriteVmoSelfLocked(vmo, offset, len, nwritten);
+}
+
 zx_status_t SocketDispatcher::WriteControl(user_in_ptr<const void> src, size_t len)
     TA_NO_THREAD_SAFETY_ANALYSIS {
     canary_.Assert();
@@ -264,6 +292,35 @@ zx_status_t SocketDispatcher::WriteSelfLocked(user_in_ptr<const void> src, size_
     if (status)
         return status;
 
+    UpdateStateAfterWriteLocked(was_empty, st);
+
+    *written = st;
+    return status;
+}
+
+zx_status_t SocketDispatcher::WriteVmoSelfLocked(const fbl::RefPtr<VmObject>& vmo,
+                                                 uint64_t offset, size_t len,
+                                                 size_t* written) TA_NO_THREAD_SAFETY_ANALYSIS {
+    canary_.Assert();
+
+    if (is_full())
+        return ZX_ERR_SHOULD_WAIT;
+
+    bool was_empty = is_empty();
+
+    size_t st = 0u;
+    zx_status_t status = data_.WriteStreamVmo(vmo, offset, len, &st);
+    if (status)
+        return status;
+
+    UpdateStateAfterWriteLocked(was_empty, st);
+
+    *written = st;
+    return status;
+}
+
+void SocketDispatcher::UpdateStateAfterWriteLocked(bool was_empty,
+                                                   size_t st) TA_NO_THREAD_SAFETY_ANALYSIS {
     zx_signals_t clear = 0u;
     zx_signals_t set = 0u;
 
@@ -290,9 +347,6 @@ zx_status_t SocketDispatcher::WriteSelfLocked(user_in_ptr<const void> src, size_
 
     if (clear)
         peer_->UpdateStateLocked(clear, 0u);
-
-    *written = st;
-    return status;
 }
 
 zx_status_t SocketDispatcher::Read(user_out_ptr<void> dst, size_t len,
@@ -306,6 +360,73 @@ zx_status_t SocketDispatcher::Read(user_out_ptr<void> dst, size_t len,
     if (len != (size_t)((uint32_t)len))
         return ZX_ERR_INVALID_ARGS;
 
+    zx_status_t status = CheckReadableLocked();
+    if (status != ZX_OK)
+        return status;
+
+    bool was_full = is_full();
+
+    auto st = data_.Read(dst, len, flags_ & ZX_SOCKET_DATAGRAM);
+
+    UpdateStateAfterReadLocked(was_full, st);
+
+    *nread = static_cast<size_t>(st);
+    return ZX_OK;
+}
+
+zx_status_t SocketDispatcher::ReadVmo(size_t len, user_out_ptr<size_t> nread,
+                                      HandleOwner* h) TA_NO_THREAD_SAFETY_ANALYSIS {
+    canary_.Assert();
+
+    LTRACE_ENTRY;
+
+    if (flags_ & ZX_SOCKET_DATAGRAM)
+        return ZX_ERR_NOT_SUPPORTED;
+
+    if (len == 0 || len != (size_t)((uint32_t)len))
+        return ZX_ERR_INVALID_ARGS;
+
+    Guard<fbl::Mutex> guard{get_lock()};
+
+    zx_status_t status = CheckReadableLocked();
+    if (status != ZX_OK)
+        return status;
+
+    bool was_full = is_full();
+
+    fbl::RefPtr<VmObject> vmo;
+    size_t st = 0u;
+    status = data_.PeekVmo(len, &vmo, &st);
+    if (status != ZX_OK)
+        return status;
+
+    // Everything that can fail is done before the bytes leave the socket, so a failed read
+    // doesn't lose them.
+    fbl::RefPtr<Dispatcher> dispatcher;
+    zx_rights_t rights;
+    status = VmObjectDispatcher::Create(vmo, &dispatcher, &rights);
+    if (status != ZX_OK)
+        return status;
+    HandleOwner handle = Handle::Make(ktl::move(dispatcher), rights);
+    if (!handle)
+        return ZX_ERR_NO_MEMORY;
+    if (nread) {
+        status = nread.copy_to_user(st);
+        if (status != ZX_OK)
+            return status;
+    }
+
+    status = data_.ConsumeVmo(vmo, st);
+    if (status != ZX_OK)
+        return status;
+
+    UpdateStateAfterReadLocked(was_full, st);
+
+    *h = ktl::move(handle);
+    return ZX_OK;
+}
+
+zx_status_t SocketDispatcher::CheckReadableLocked() TA_NO_THREAD_SAFETY_ANALYSIS {
     if (is_empty()) {
         if (!peer_)
             return ZX_ERR_PEER_CLOSED;
@@ -315,11 +436,11 @@ zx_status_t SocketDispatcher::Read(user_out_ptr<void> dst, size_t len,
             return ZX_ERR_BAD_STATE;
         return ZX_ERR_SHOULD_WAIT;
     }
+    return ZX_OK;
+}
 
-    bool was_full = is_full();
-
-    auto st = data_.Read(dst, len, flags_ & ZX_SOCKET_DATAGRAM);
-
+void SocketDispatcher::UpdateStateAfterReadLocked(bool was_full,
+                                                  size_t st) TA_NO_THREAD_SAFETY_ANALYSIS {
     zx_signals_t clear = 0u;
     zx_signals_t set = 0u;
 
@@ -346,9 +467,6 @@ zx_status_t SocketDispatcher::Read(user_out_ptr<void> dst, size_t len,
         if (set)
             peer_->UpdateStateLocked(0u, set);
     }
-
-    *nread = static_cast<size_t>(st);
-    return ZX_OK;
 }
 
 zx_status_t SocketDispatcher::ReadControl(user_out_ptr<void> dst, size_t len,
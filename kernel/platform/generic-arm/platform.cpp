@@ -11,6 +11,7 @@
 #include <fbl/auto_lock.h>
 #include <fbl/ref_ptr.h>
 #include <reg.h>
+#include <string.h>
 #include <trace.h>
 
 #include <arch.h>
@@ -47,6 +48,7 @@
 #include <lib/console.h>
 #include <lib/debuglog.h>
 #include <lib/memory_limit.h>
+#include <lib/system-topology.h>
 #if WITH_PANIC_BACKTRACE
 #include <kernel/thread.h>
 #endif
@@ -81,6 +83,7 @@ static pmm_arena_info_t mem_arena = {
     /* .priority */ 0,
     /* .base */ 0, // filled in by zbi
     /* .size */ 0, // filled in by zbi
+    /* .node */ 0,
 };
 
 // boot items to save for mexec
@@ -375,7 +378,44 @@ void platform_early_init(void) {
     boot_reserve_wire();
 }
 
+// Publish the cpu topology for the scheduler: one cluster node per cpu
+// cluster, holding a processor for each of its cpus.
+static void platform_init_topology(void) {
+    static zbi_topology_node_t nodes[SMP_CPU_MAX_CLUSTERS + SMP_MAX_CPUS];
+
+    size_t count = 0;
+    for (uint cluster = 0; cluster < cpu_cluster_count; cluster++) {
+        uint16_t cluster_index = static_cast<uint16_t>(count);
+        zbi_topology_node_t* node = &nodes[count++];
+        memset(node, 0, sizeof(*node));
+        node->entity_type = ZBI_TOPOLOGY_ENTITY_CLUSTER;
+        node->parent_index = ZBI_TOPOLOGY_NO_PARENT;
+
+        for (uint cpu = 0; cpu < cpu_cluster_cpus[cluster]; cpu++) {
+            node = &nodes[count++];
+            memset(node, 0, sizeof(*node));
+            node->entity_type = ZBI_TOPOLOGY_ENTITY_PROCESSOR;
+            node->parent_index = cluster_index;
+            node->entity.processor.logical_ids[0] =
+                static_cast<uint16_t>(arch_mpid_to_cpu_num(cluster, cpu));
+            node->entity.processor.logical_id_count = 1;
+            node->entity.processor.flags =
+                (cluster == 0 && cpu == 0) ? ZBI_TOPOLOGY_PROCESSOR_PRIMARY : 0;
+            node->entity.processor.architecture = ZBI_TOPOLOGY_ARCH_ARM;
+            node->entity.processor.architecture_info.arm.cluster_1_id =
+                static_cast<uint8_t>(cluster);
+            node->entity.processor.architecture_info.arm.cpu_id = static_cast<uint8_t>(cpu);
+        }
+    }
+
+    zx_status_t status = system_topology::GetMutableSystemTopology().Update(nodes, count);
+    if (status != ZX_OK) {
+        dprintf(CRITICAL, "failed to publish cpu topology: %d\n", status);
+    }
+}
+
 void platform_init(void) {
+    platform_init_topology();
     platform_cpu_init();
 }
 
@@ -108,6 +108,7 @@ static zx_status_t mem_arena_init(boot_addr_range_t* range) {
     snprintf(base_arena.name, sizeof(base_arena.name), "%s", "memory");
     base_arena.priority = 1;
     base_arena.flags = 0;
+    base_arena.node = 0;
 
     zx_status_t status;
     for (range->reset(range), range->advance(range); !range->is_reset; range->advance(range)) {
@@ -139,18 +140,27 @@ static zx_status_t mem_arena_init(boot_addr_range_t* range) {
         }
 
         // If there is no limit, or we failed to add arenas from processing
-        // ranges then add the original range.
+        // ranges then add the original range, split wherever it crosses into
+        // another numa node. The memory limit path keeps everything on node 0.
         if (!have_limit || status != ZX_OK) {
-            auto arena = base_arena;
-            arena.base = base;
-            arena.size = size;
-
-            LTRACEF("Adding pmm range at %#" PRIxPTR " of %#zx bytes.\n", arena.base, arena.size);
-            status = pmm_add_arena(&arena);
+            while (size > 0) {
+                uint64_t span;
+                auto arena = base_arena;
+                arena.node = pc_numa_node_for_paddr(base, size, &span);
+                arena.base = base;
+                arena.size = span;
+
+                LTRACEF("Adding pmm range at %#" PRIxPTR " of %#zx bytes on node %u.\n",
+                        arena.base, arena.size, arena.node);
+                status = pmm_add_arena(&arena);
+
+                // print a warning and continue
+                if (status != ZX_OK) {
+                    printf("MEM: Failed to add pmm range at %#" PRIxPTR " size %#zx\n", arena.base, arena.size);
+                }
 
-            // print a warning and continue
-            if (status != ZX_OK) {
-                printf("MEM: Failed to add pmm range at %#" PRIxPTR " size %#zx\n", arena.base, arena.size);
+                base += span;
+                size -= span;
             }
         }
     }
@@ -371,6 +381,10 @@ zx_status_t enumerate_e820(enumerate_e820_callback callback, void* ctx) {
 
 /* Discover the basic memory map */
 void pc_mem_init(void) {
+    // find out which numa node each memory range belongs to before handing
+    // them to the pmm
+    pc_numa_init_early();
+
     if (platform_mem_range_init() != ZX_OK) {
         TRACEF("Error adding arenas from provided memory tables.\n");
     }
@@ -0,0 +1,268 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <zircon/compiler.h>
+
+#include <acpica/acpi.h>
+#include <arch/x86/mp.h>
+
+#include <fbl/algorithm.h>
+#include <inttypes.h>
+#include <platform/pc/bootloader.h>
+#include <string.h>
+#include <trace.h>
+#include <vm/physmap.h>
+#include <vm/pmm.h>
+
+#include "platform_p.h"
+
+#define LOCAL_TRACE 0
+
+// The memory arenas are handed to the pmm well before ACPICA is brought up, so
+// the SRAT is located and walked by hand here, reading the tables straight out
+// of the physmap.
+
+namespace {
+
+struct numa_mem_range {
+    uint64_t base;
+    uint64_t size;
+    uint node;
+};
+
+struct numa_cpu {
+    uint32_t apic_id;
+    uint node;
+};
+
+constexpr size_t kMaxMemRanges = 64;
+numa_mem_range mem_ranges[kMaxMemRanges];
+size_t mem_range_count;
+
+// the SRAT lists every processor the firmware knows of, which may be more than
+// we bring up
+constexpr size_t kMaxCpus = 256;
+numa_cpu cpus[kMaxCpus];
+size_t cpu_count;
+
+// proximity domains in the order they were first seen. a domain's index in
+// here is the node number the pmm knows it by.
+uint32_t domains[PMM_MAX_NUMA_NODES];
+uint domain_count;
+
+uint node_for_domain(uint32_t domain) {
+    for (uint i = 0; i < domain_count; i++) {
+        if (domains[i] == domain) {
+            return i;
+        }
+    }
+    if (domain_count == PMM_MAX_NUMA_NODES) {
+        printf("NUMA: too many proximity domains, folding domain %u into node 0\n", domain);
+        return 0;
+    }
+    domains[domain_count] = domain;
+    return domain_count++;
+}
+
+const void* map_table(uint64_t pa, size_t len) {
+    if (pa == 0 || len == 0 || !is_physmap_phys_addr(pa) || !is_physmap_phys_addr(pa + len - 1)) {
+        return nullptr;
+    }
+    return paddr_to_physmap(pa);
+}
+
+bool checksum_ok(const void* table, size_t len) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(table);
+    uint8_t sum = 0;
+    for (size_t i = 0; i < len; i++) {
+        sum = static_cast<uint8_t>(sum + bytes[i]);
+    }
+    return sum == 0;
+}
+
+const ACPI_TABLE_RSDP* find_rsdp() {
+    if (bootloader.acpi_rsdp) {
+        return static_cast<const ACPI_TABLE_RSDP*>(
+            map_table(bootloader.acpi_rsdp, sizeof(ACPI_TABLE_RSDP)));
+    }
+
+    // legacy bios, the rsdp sits on a 16 byte boundary in the bios rom area
+    for (uint64_t pa = 0xe0000; pa < 0x100000; pa += 16) {
+        auto rsdp = static_cast<const ACPI_TABLE_RSDP*>(paddr_to_physmap(pa));
+        if (!memcmp(rsdp->Signature, ACPI_SIG_RSDP, sizeof(rsdp->Signature)) &&
+            checksum_ok(rsdp, ACPI_RSDP_CHECKSUM_LENGTH)) {
+            return rsdp;
+        }
+    }
+    return nullptr;
+}
+
+const ACPI_TABLE_HEADER* map_table_header(uint64_t pa) {
+    auto hdr = static_cast<const ACPI_TABLE_HEADER*>(map_table(pa, sizeof(ACPI_TABLE_HEADER)));
+    if (!hdr || hdr->Length < sizeof(ACPI_TABLE_HEADER) || !map_table(pa, hdr->Length)) {
+        return nullptr;
+    }
+    return hdr;
+}
+
+const ACPI_TABLE_SRAT* find_srat(const ACPI_TABLE_RSDP* rsdp) {
+    // prefer the 64 bit entries of the xsdt when the firmware provides one
+    uint64_t root_pa = rsdp->RsdtPhysicalAddress;
+    size_t entry_size = sizeof(uint32_t);
+    if (rsdp->Revision >= 2 && rsdp->XsdtPhysicalAddress) {
+        root_pa = rsdp->XsdtPhysicalAddress;
+        entry_size = sizeof(uint64_t);
+    }
+
+    const ACPI_TABLE_HEADER* root = map_table_header(root_pa);
+    if (!root) {
+        return nullptr;
+    }
+
+    const uint8_t* entries = reinterpret_cast<const uint8_t*>(root) + sizeof(ACPI_TABLE_HEADER);
+    size_t count = (root->Length - sizeof(ACPI_TABLE_HEADER)) / entry_size;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t pa = 0;
+        memcpy(&pa, entries + i * entry_size, entry_size);
+
+        const ACPI_TABLE_HEADER* table = map_table_header(pa);
+        if (table && !memcmp(table->Signature, ACPI_SIG_SRAT, ACPI_NAME_SIZE) &&
+            table->Length >= sizeof(ACPI_TABLE_SRAT)) {
+            return reinterpret_cast<const ACPI_TABLE_SRAT*>(table);
+        }
+    }
+    return nullptr;
+}
+
+// cpus the SRAT doesn't mention are put on node 0
+uint node_for_apic_id(uint32_t apic_id) {
+    for (size_t i = 0; i < cpu_count; i++) {
+        if (cpus[i].apic_id == apic_id) {
+            return cpus[i].node;
+        }
+    }
+    return 0;
+}
+
+void add_cpu(uint32_t apic_id, uint32_t domain) {
+    if (cpu_count == kMaxCpus) {
+        return;
+    }
+    cpus[cpu_count++] = {apic_id, node_for_domain(domain)};
+}
+
+void add_mem_range(uint64_t base, uint64_t size, uint32_t domain) {
+    if (size == 0 || mem_range_count == kMaxMemRanges) {
+        return;
+    }
+    LTRACEF("memory %#" PRIx64 " size %#" PRIx64 " domain %u\n", base, size, domain);
+    mem_ranges[mem_range_count++] = {base, size, node_for_domain(domain)};
+}
+
+void parse_srat(const ACPI_TABLE_SRAT* srat) {
+    const uint8_t* ptr = reinterpret_cast<const uint8_t*>(srat) + sizeof(ACPI_TABLE_SRAT);
+    const uint8_t* end = reinterpret_cast<const uint8_t*>(srat) + srat->Header.Length;
+
+    while (ptr + sizeof(ACPI_SUBTABLE_HEADER) <= end) {
+        auto sub = reinterpret_cast<const ACPI_SUBTABLE_HEADER*>(ptr);
+        if (sub->Length < sizeof(ACPI_SUBTABLE_HEADER) || ptr + sub->Length > end) {
+            break;
+        }
+
+        switch (sub->Type) {
+        case ACPI_SRAT_TYPE_CPU_AFFINITY: {
+            if (sub->Length < sizeof(ACPI_SRAT_CPU_AFFINITY)) {
+                break;
+            }
+            auto cpu = reinterpret_cast<const ACPI_SRAT_CPU_AFFINITY*>(sub);
+            if (!(cpu->Flags & ACPI_SRAT_CPU_USE_AFFINITY)) {
+                break;
+            }
+            uint32_t domain = cpu->ProximityDomainLo |
+                              (cpu->ProximityDomainHi[0] << 8) |
+                              (cpu->ProximityDomainHi[1] << 16) |
+                              (cpu->ProximityDomainHi[2] << 24);
+            add_cpu(cpu->ApicId, domain);
+            break;
+        }
+        case ACPI_SRAT_TYPE_X2APIC_CPU_AFFINITY: {
+            if (sub->Length < sizeof(ACPI_SRAT_X2APIC_CPU_AFFINITY)) {
+                break;
+            }
+            auto cpu = reinterpret_cast<const ACPI_SRAT_X2APIC_CPU_AFFINITY*>(sub);
+            if (!(cpu->Flags & ACPI_SRAT_CPU_ENABLED)) {
+                break;
+            }
+            add_cpu(cpu->ApicId, cpu->ProximityDomain);
+            break;
+        }
+        case ACPI_SRAT_TYPE_MEMORY_AFFINITY: {
+            if (sub->Length < sizeof(ACPI_SRAT_MEM_AFFINITY)) {
+                break;
+            }
+            auto mem = reinterpret_cast<const ACPI_SRAT_MEM_AFFINITY*>(sub);
+            if (!(mem->Flags & ACPI_SRAT_MEM_ENABLED)) {
+                break;
+            }
+            add_mem_range(mem->BaseAddress, mem->Length, mem->ProximityDomain);
+            break;
+        }
+        }
+
+        ptr += sub->Length;
+    }
+}
+
+} // namespace
+
+void pc_numa_init_early(void) {
+    const ACPI_TABLE_RSDP* rsdp = find_rsdp();
+    if (!rsdp) {
+        return;
+    }
+    const ACPI_TABLE_SRAT* srat = find_srat(rsdp);
+    if (!srat) {
+        LTRACEF("no SRAT, treating all memory as one node\n");
+        return;
+    }
+
+    parse_srat(srat);
+
+    if (domain_count > 1) {
+        dprintf(INFO, "NUMA: %u nodes, %zu memory ranges, %zu cpus\n",
+                domain_count, mem_range_count, cpu_count);
+    }
+}
+
+uint pc_numa_node_for_paddr(uint64_t pa, uint64_t size, uint64_t* span) {
+    uint node = 0;
+    uint64_t len = size;
+
+    for (size_t i = 0; i < mem_range_count; i++) {
+        const numa_mem_range& r = mem_ranges[i];
+        if (pa >= r.base && pa - r.base < r.size) {
+            node = r.node;
+            len = fbl::min(len, r.size - (pa - r.base));
+        } else if (r.base > pa && r.base - pa < len) {
+            // memory the SRAT doesn't cover goes to node 0, up to the next range it does
+            len = r.base - pa;
+        }
+    }
+
+    // the pmm wants whole pages
+    *span = fbl::min(size, ROUNDUP(len, PAGE_SIZE));
+    return node;
+}
+
+void pc_numa_init_cpus(const uint32_t* apic_ids, uint32_t num_cpus) {
+    for (uint32_t i = 0; i < num_cpus; i++) {
+        int cpu_num = x86_apic_id_to_cpu_num(apic_ids[i]);
+        if (cpu_num < 0) {
+            continue;
+        }
+        pmm_set_cpu_numa_node(cpu_num, node_for_apic_id(apic_ids[i]));
+    }
+}
@@ -25,6 +25,7 @@
 #include <fbl/alloc_checker.h>
 #include <kernel/cmdline.h>
 #include <lib/debuglog.h>
+#include <lib/system-topology.h>
 #include <libzbi/zbi-cpp.h>
 #include <lk/init.h>
 #include <mexec.h>
@@ -773,6 +774,82 @@ void platform_early_init(void) {
     boot_reserve_wire();
 }
 
+// Publish the cpu topology for the scheduler: one cluster per die (package
+// and node), holding a processor for each cpu we are bringing up.
+static void platform_init_topology(const uint32_t* apic_ids, uint32_t num_cpus) {
+    // at worst every cpu sits on its own die
+    fbl::AllocChecker ac;
+    ktl::unique_ptr<zbi_topology_node_t[]> nodes =
+        ktl::unique_ptr<zbi_topology_node_t[]>(new (&ac) zbi_topology_node_t[num_cpus * 2]);
+    if (!ac.check()) {
+        TRACEF("failed to allocate topology table\n");
+        return;
+    }
+    ktl::unique_ptr<bool[]> placed = ktl::unique_ptr<bool[]>(new (&ac) bool[num_cpus]);
+    if (!ac.check()) {
+        TRACEF("failed to allocate topology table\n");
+        return;
+    }
+    memset(placed.get(), 0, sizeof(bool) * num_cpus);
+
+    // keep each cluster directly followed by its processors, as the flat
+    // format requires
+    uint32_t bsp_apic_id = apic_bsp_id();
+    size_t count = 0;
+    for (uint32_t i = 0; i < num_cpus; ++i) {
+        if (placed[i]) {
+            continue;
+        }
+        x86_cpu_topology_t die;
+        x86_cpu_topology_decode(apic_ids[i], &die);
+
+        uint16_t cluster_index = static_cast<uint16_t>(count);
+        zbi_topology_node_t* cluster = &nodes[count++];
+        memset(cluster, 0, sizeof(*cluster));
+        cluster->entity_type = ZBI_TOPOLOGY_ENTITY_CLUSTER;
+        cluster->parent_index = ZBI_TOPOLOGY_NO_PARENT;
+
+        for (uint32_t j = i; j < num_cpus; ++j) {
+            x86_cpu_topology_t topo;
+            x86_cpu_topology_decode(apic_ids[j], &topo);
+            if (placed[j] || topo.package_id != die.package_id || topo.node_id != die.node_id) {
+                continue;
+            }
+            placed[j] = true;
+
+            // a cpu the mp code never assigned a number to can't be placed
+            int cpu_num = x86_apic_id_to_cpu_num(apic_ids[j]);
+            if (cpu_num < 0) {
+                TRACEF("no cpu number for apic id %u, leaving it out of the topology\n",
+                       apic_ids[j]);
+                continue;
+            }
+
+            zbi_topology_node_t* processor = &nodes[count++];
+            memset(processor, 0, sizeof(*processor));
+            processor->entity_type = ZBI_TOPOLOGY_ENTITY_PROCESSOR;
+            processor->parent_index = cluster_index;
+            processor->entity.processor.logical_ids[0] = static_cast<uint16_t>(cpu_num);
+            processor->entity.processor.logical_id_count = 1;
+            processor->entity.processor.flags =
+                (apic_ids[j] == bsp_apic_id) ? ZBI_TOPOLOGY_PROCESSOR_PRIMARY : 0;
+            processor->entity.processor.architecture = ZBI_TOPOLOGY_ARCH_X86;
+            processor->entity.processor.architecture_info.x86.apic_id = apic_ids[j];
+        }
+
+        // don't publish a cluster none of whose cpus could be placed
+        if (count == cluster_index + 1u) {
+            count = cluster_index;
+        }
+    }
+
+    zx_status_t status =
+        system_topology::GetMutableSystemTopology().Update(nodes.get(), count);
+    if (status != ZX_OK) {
+        TRACEF("failed to publish cpu topology: %d\n", status);
+    }
+}
+
 static void platform_init_smp(void) {
     uint32_t num_cpus = 0;
 
@@ -862,6 +939,9 @@ static void platform_init_smp(void) {
 
     x86_init_smp(apic_ids.get(), num_cpus);
 
+    platform_init_topology(apic_ids.get(), num_cpus);
+    pc_numa_init_cpus(apic_ids.get(), num_cpus);
+
     // trim the boot cpu out of the apic id list before passing to the AP booting routine
     for (uint i = 0; i < num_cpus - 1; ++i) {
         if (apic_ids[i] == bsp_apic_id) {
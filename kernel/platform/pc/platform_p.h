@@ -32,6 +32,16 @@ void pc_init_debug(void);
 void pc_init_timer_percpu(void);
 void pc_mem_init(void);
 
+// Look for an ACPI SRAT describing which NUMA node memory and cpus belong to.
+// Until this runs, everything is reported as being on node 0.
+void pc_numa_init_early(void);
+// Returns the NUMA node of the memory at |pa|, and in |span| how many bytes from
+// |pa|, at most |size|, belong to that same node.
+uint pc_numa_node_for_paddr(uint64_t pa, uint64_t size, uint64_t* span);
+// Tell the pmm which NUMA node each of the |num_cpus| cpus in |apic_ids| is on.
+// Must run after the cpus have been given their cpu numbers.
+void pc_numa_init_cpus(const uint32_t* apic_ids, uint32_t num_cpus);
+
 void pc_prep_suspend_timer(void);
 void pc_resume_timer(void);
 void pc_resume_debug(void);
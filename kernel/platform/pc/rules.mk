@@ -19,6 +19,7 @@ MODULE_SRCS += \
     $(LOCAL_DIR)/interrupts.cpp \
     $(LOCAL_DIR)/keyboard.cpp \
     $(LOCAL_DIR)/memory.cpp \
+    $(LOCAL_DIR)/numa.cpp \
     $(LOCAL_DIR)/pcie_quirks.cpp \
     $(LOCAL_DIR)/pic.cpp \
     $(LOCAL_DIR)/platform.cpp \
@@ -38,6 +39,7 @@ MODULE_DEPS += \
     kernel/lib/fbl \
     kernel/lib/pow2_range_allocator \
     kernel/lib/smbios \
+    kernel/lib/topology \
     kernel/lib/version \
     kernel/lib/zbi \
     kernel/dev/interrupt \
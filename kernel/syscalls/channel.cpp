@@ -112,16 +112,16 @@ static void msg_get_handles(ProcessDispatcher* up, MessagePacket* msg,
     }
 }
 
-template <typename HandleInfoT>
-static zx_status_t channel_read(zx_handle_t handle_value, uint32_t options,
-                             user_out_ptr<void> bytes, user_out_ptr<HandleInfoT> handles,
-                             uint32_t num_bytes, uint32_t num_handles,
-                             user_out_ptr<uint32_t> actual_bytes,
-                             user_out_ptr<uint32_t> actual_handles) {
-    LTRACEF("handle %x bytes %p num_bytes %p handles %p num_handles %p",
-            handle_value, bytes.get(), actual_bytes.get(), handles.get(), actual_handles.get());
-
-    auto up = ProcessDispatcher::GetCurrent();
+// Reads one message.  |put_actuals| is handed the size of the message read
+// (or of the next message, on ZX_ERR_BUFFER_TOO_SMALL) before any of it is
+// copied out, and any error it returns is returned in turn.
+template <typename HandleInfoT, typename PutActualsFn>
+static zx_status_t channel_read(ProcessDispatcher* up, zx_handle_t handle_value, uint32_t options,
+                                user_out_ptr<void> bytes, user_out_ptr<HandleInfoT> handles,
+                                uint32_t num_bytes, uint32_t num_handles,
+                                PutActualsFn put_actuals) {
+    LTRACEF("handle %x bytes %p num_bytes %u handles %p num_handles %u",
+            handle_value, bytes.get(), num_bytes, handles.get(), num_handles);
 
     fbl::RefPtr<ChannelDispatcher> channel;
     zx_status_t result = up->GetDispatcherWithRights(handle_value, ZX_RIGHT_READ, &channel);
@@ -140,17 +140,9 @@ static zx_status_t channel_read(zx_handle_t handle_value, uint32_t options,
 
     // On ZX_ERR_BUFFER_TOO_SMALL, Read() gives us the size of the next message (which remains
     // unconsumed, unless |options| has ZX_CHANNEL_READ_MAY_DISCARD set).
-    if (actual_bytes) {
-        zx_status_t status = actual_bytes.copy_to_user(num_bytes);
-        if (status != ZX_OK)
-            return status;
-    }
-
-    if (actual_handles) {
-        zx_status_t status = actual_handles.copy_to_user(num_handles);
-        if (status != ZX_OK)
-            return status;
-    }
+    zx_status_t status = put_actuals(num_bytes, num_handles);
+    if (status != ZX_OK)
+        return status;
     if (result == ZX_ERR_BUFFER_TOO_SMALL)
         return result;
 
@@ -170,6 +162,29 @@ static zx_status_t channel_read(zx_handle_t handle_value, uint32_t options,
     return result;
 }
 
+template <typename HandleInfoT>
+static zx_status_t channel_read(zx_handle_t handle_value, uint32_t options,
+                                user_out_ptr<void> bytes, user_out_ptr<HandleInfoT> handles,
+                                uint32_t num_bytes, uint32_t num_handles,
+                                user_out_ptr<uint32_t> actual_bytes,
+                                user_out_ptr<uint32_t> actual_handles) {
+    auto put_actuals = [&](uint32_t msg_bytes, uint32_t msg_handles) {
+        if (actual_bytes) {
+            zx_status_t status = actual_bytes.copy_to_user(msg_bytes);
+            if (status != ZX_OK)
+                return status;
+        }
+        if (actual_handles) {
+            zx_status_t status = actual_handles.copy_to_user(msg_handles);
+            if (status != ZX_OK)
+                return status;
+        }
+        return ZX_OK;
+    };
+    return channel_read(ProcessDispatcher::GetCurrent(), handle_value, options,
+                        bytes, handles, num_bytes, num_handles, put_actuals);
+}
+
 // zx_status_t zx_channel_read
 zx_status_t sys_channel_read(zx_handle_t handle_value, uint32_t options,
                              user_out_ptr<void> bytes,
@@ -192,6 +207,43 @@ zx_status_t sys_channel_read_etc(zx_handle_t handle_value, uint32_t options,
         bytes, handle_info, num_bytes, num_handles, actual_bytes, actual_handles);
 }
 
+// zx_status_t zx_channel_read_many
+zx_status_t sys_channel_read_many(user_inout_ptr<zx_channel_read_item_t> user_items,
+                                  size_t count) {
+    LTRACEF("items %p count %zu\n", user_items.get(), count);
+
+    if (count > ZX_CHANNEL_MANY_MAX_ITEMS)
+        return ZX_ERR_OUT_OF_RANGE;
+
+    zx_channel_read_item_t items[ZX_CHANNEL_MANY_MAX_ITEMS];
+    if (user_items.copy_array_from_user(items, count) != ZX_OK)
+        return ZX_ERR_INVALID_ARGS;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    for (size_t ix = 0; ix < count; ++ix) {
+        zx_channel_read_item_t& item = items[ix];
+        item.actual_bytes = 0u;
+        item.actual_handles = 0u;
+        if (item.reserved != 0u) {
+            item.status = ZX_ERR_INVALID_ARGS;
+            continue;
+        }
+        auto put_actuals = [&item](uint32_t msg_bytes, uint32_t msg_handles) {
+            item.actual_bytes = msg_bytes;
+            item.actual_handles = msg_handles;
+            return ZX_OK;
+        };
+        item.status = channel_read(up, item.channel, item.options,
+                                   make_user_out_ptr(item.bytes), make_user_out_ptr(item.handles),
+                                   item.num_bytes, item.num_handles, put_actuals);
+    }
+
+    if (user_items.copy_array_to_user(items, count) != ZX_OK)
+        return ZX_ERR_INVALID_ARGS;
+    return ZX_OK;
+}
+
 static zx_status_t channel_read_out(ProcessDispatcher* up,
                                     MessagePacketPtr reply,
                                     zx_channel_call_args_t* args,
@@ -277,18 +329,20 @@ static zx_status_t msg_put_handles(ProcessDispatcher* up, MessagePacket* msg,
     return status;
 }
 
-// zx_status_t zx_channel_write
-zx_status_t sys_channel_write(zx_handle_t handle_value, uint32_t options,
-                              user_in_ptr<const void> user_bytes, uint32_t num_bytes,
-                              user_in_ptr<const zx_handle_t> user_handles, uint32_t num_handles) {
+// Writes one message.  Consumes all handles whether it succeeds or not.
+//
+// With ZX_CHANNEL_WRITE_USE_IOVEC, |user_bytes| is an array of
+// zx_channel_iovec_t and |num_bytes| is the number of segments in it.
+static zx_status_t channel_write(ProcessDispatcher* up, zx_handle_t handle_value, uint32_t options,
+                                 user_in_ptr<const void> user_bytes, uint32_t num_bytes,
+                                 user_in_ptr<const zx_handle_t> user_handles,
+                                 uint32_t num_handles) {
     LTRACEF("handle %x bytes %p num_bytes %u handles %p num_handles %u options 0x%x\n",
             handle_value, user_bytes.get(), num_bytes, user_handles.get(), num_handles, options);
 
-    auto up = ProcessDispatcher::GetCurrent();
-
     auto cleanup = fbl::MakeAutoCall([&]() { up->RemoveHandles(user_handles, num_handles); });
 
-    if (options != 0u) {
+    if (options & ~ZX_CHANNEL_WRITE_USE_IOVEC) {
         return ZX_ERR_INVALID_ARGS;
     }
 
@@ -299,10 +353,16 @@ zx_status_t sys_channel_write(zx_handle_t handle_value, uint32_t options,
     }
 
     MessagePacketPtr msg;
-    status = MessagePacket::Create(user_bytes, num_bytes, num_handles, &msg);
+    if (options & ZX_CHANNEL_WRITE_USE_IOVEC) {
+        status = MessagePacket::CreateIovec(user_bytes.reinterpret<const zx_channel_iovec_t>(),
+                                            num_bytes, num_handles, &msg);
+    } else {
+        status = MessagePacket::Create(user_bytes, num_bytes, num_handles, &msg);
+    }
     if (status != ZX_OK) {
         return status;
     }
+    const uint32_t data_size = msg->data_size();
 
     // msg_put_handles() always consumes all handles (or there are zero handles,
     // and so there's nothing to be done).
@@ -319,7 +379,49 @@ zx_status_t sys_channel_write(zx_handle_t handle_value, uint32_t options,
     if (status != ZX_OK)
         return status;
 
-    ktrace(TAG_CHANNEL_WRITE, (uint32_t)channel->get_koid(), num_bytes, num_handles, 0);
+    ktrace(TAG_CHANNEL_WRITE, (uint32_t)channel->get_koid(), data_size, num_handles, 0);
+    return ZX_OK;
+}
+
+// zx_status_t zx_channel_write
+zx_status_t sys_channel_write(zx_handle_t handle_value, uint32_t options,
+                              user_in_ptr<const void> user_bytes, uint32_t num_bytes,
+                              user_in_ptr<const zx_handle_t> user_handles, uint32_t num_handles) {
+    return channel_write(ProcessDispatcher::GetCurrent(), handle_value, options,
+                         user_bytes, num_bytes, user_handles, num_handles);
+}
+
+// zx_status_t zx_channel_write_many
+zx_status_t sys_channel_write_many(user_inout_ptr<zx_channel_write_item_t> user_items,
+                                   size_t count) {
+    LTRACEF("items %p count %zu\n", user_items.get(), count);
+
+    if (count > ZX_CHANNEL_MANY_MAX_ITEMS)
+        return ZX_ERR_OUT_OF_RANGE;
+
+    zx_channel_write_item_t items[ZX_CHANNEL_MANY_MAX_ITEMS];
+    if (user_items.copy_array_from_user(items, count) != ZX_OK)
+        return ZX_ERR_INVALID_ARGS;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    // Each item is written as zx_channel_write() would write it, in order,
+    // so messages for the same channel are queued in the order given.
+    for (size_t ix = 0; ix < count; ++ix) {
+        zx_channel_write_item_t& item = items[ix];
+        auto user_handles = make_user_in_ptr(item.handles);
+        if (item.reserved != 0u) {
+            up->RemoveHandles(user_handles, item.num_handles);
+            item.status = ZX_ERR_INVALID_ARGS;
+            continue;
+        }
+        item.status = channel_write(up, item.channel, item.options,
+                                    make_user_in_ptr(item.bytes), item.num_bytes,
+                                    user_handles, item.num_handles);
+    }
+
+    if (user_items.copy_array_to_user(items, count) != ZX_OK)
+        return ZX_ERR_INVALID_ARGS;
     return ZX_OK;
 }
 
@@ -693,6 +693,21 @@ zx_status_t sys_object_get_property(zx_handle_t handle_value, uint32_t property,
         size_t value = socket->GetWriteThreshold();
         return _value.reinterpret<size_t>().copy_to_user(value);
     }
+    case ZX_PROP_NUMA_NODE: {
+        if (size < sizeof(uint32_t))
+            return ZX_ERR_BUFFER_TOO_SMALL;
+        uint32_t value;
+        if (auto process = DownCastDispatcher<ProcessDispatcher>(&dispatcher)) {
+            value = process->get_numa_node();
+        } else if (auto vmo = DownCastDispatcher<VmObjectDispatcher>(&dispatcher)) {
+            zx_status_t status = vmo->vmo()->GetNumaNode(&value);
+            if (status != ZX_OK)
+                return status;
+        } else {
+            return ZX_ERR_WRONG_TYPE;
+        }
+        return _value.reinterpret<uint32_t>().copy_to_user(value);
+    }
     default:
         return ZX_ERR_INVALID_ARGS;
     }
@@ -820,6 +835,19 @@ zx_status_t sys_object_set_property(zx_handle_t handle_value, uint32_t property,
         }
         return ZX_OK;
     }
+    case ZX_PROP_NUMA_NODE: {
+        if (size < sizeof(uint32_t))
+            return ZX_ERR_BUFFER_TOO_SMALL;
+        uint32_t value = 0;
+        zx_status_t status = _value.reinterpret<const uint32_t>().copy_from_user(&value);
+        if (status != ZX_OK)
+            return status;
+        if (auto process = DownCastDispatcher<ProcessDispatcher>(&dispatcher))
+            return process->set_numa_node(value);
+        if (auto vmo = DownCastDispatcher<VmObjectDispatcher>(&dispatcher))
+            return vmo->vmo()->SetNumaNode(value);
+        return ZX_ERR_WRONG_TYPE;
+    }
     }
 
     return ZX_ERR_INVALID_ARGS;
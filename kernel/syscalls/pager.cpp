@@ -69,3 +69,61 @@ zx_status_t sys_pager_create_vmo(zx_handle_t pager, zx_handle_t port, uint64_t k
 
     return out->make(ktl::move(dispatcher), rights);
 }
+
+// zx_status_t zx_pager_supply_pages
+zx_status_t sys_pager_supply_pages(zx_handle_t pager, zx_handle_t pager_vmo,
+                                   uint64_t offset, uint64_t length,
+                                   zx_handle_t aux_vmo_handle, uint64_t aux_offset) {
+    auto up = ProcessDispatcher::GetCurrent();
+    fbl::RefPtr<PagerDispatcher> pager_dispatcher;
+    zx_status_t status = up->GetDispatcher(pager, &pager_dispatcher);
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    fbl::RefPtr<VmObjectDispatcher> pager_vmo_dispatcher;
+    status = up->GetDispatcher(pager_vmo, &pager_vmo_dispatcher);
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    // Only the pager that created the vmo can supply its pages.
+    if (pager_vmo_dispatcher->vmo()->page_source_id() != pager_dispatcher->get_koid()) {
+        return ZX_ERR_INVALID_ARGS;
+    }
+
+    if (!IS_PAGE_ALIGNED(offset) || !IS_PAGE_ALIGNED(length) || !IS_PAGE_ALIGNED(aux_offset)) {
+        return ZX_ERR_INVALID_ARGS;
+    }
+
+    fbl::RefPtr<VmObjectDispatcher> aux_vmo_dispatcher;
+    status = up->GetDispatcherWithRights(aux_vmo_handle, ZX_RIGHT_READ | ZX_RIGHT_WRITE,
+                                         &aux_vmo_dispatcher);
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    if (length == 0) {
+        return ZX_OK;
+    }
+
+    // Check the destination range before the pages are taken from the aux vmo, so a bad
+    // range doesn't throw its contents away.
+    uint64_t end;
+    if (add_overflow(offset, length, &end) ||
+        end > pager_vmo_dispatcher->vmo()->size()) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+
+    list_node pages = LIST_INITIAL_VALUE(pages);
+    status = aux_vmo_dispatcher->vmo()->TakePages(aux_offset, length, &pages);
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    status = pager_vmo_dispatcher->vmo()->SupplyPages(offset, length, &pages);
+    if (status != ZX_OK) {
+        pmm_free(&pages);
+    }
+    return status;
+}
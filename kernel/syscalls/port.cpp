@@ -13,6 +13,7 @@
 #include <object/port_dispatcher.h>
 #include <object/process_dispatcher.h>
 
+#include <fbl/algorithm.h>
 #include <fbl/alloc_checker.h>
 #include <fbl/ref_ptr.h>
 
@@ -96,6 +97,51 @@ zx_status_t sys_port_wait(zx_handle_t handle, zx_time_t deadline,
     return ZX_OK;
 }
 
+// Most packets zx_port_wait_many() will return from one call.  They're gathered
+// on the stack before being copied out.
+static constexpr size_t kMaxPacketsPerWait = 16;
+
+// zx_status_t zx_port_wait_many
+zx_status_t sys_port_wait_many(zx_handle_t handle, zx_time_t deadline,
+                               user_out_ptr<zx_port_packet_t> packets_out, size_t count,
+                               user_out_ptr<size_t> actual_out) {
+    LTRACEF("handle %x count %zu\n", handle, count);
+
+    if (count == 0)
+        return ZX_ERR_INVALID_ARGS;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    fbl::RefPtr<PortDispatcher> port;
+    zx_status_t status = up->GetDispatcherWithRights(handle, ZX_RIGHT_READ, &port);
+    if (status != ZX_OK)
+        return status;
+
+    const TimerSlack slack = up->GetTimerSlackPolicy();
+
+    ktrace(TAG_PORT_WAIT, (uint32_t)port->get_koid(), 0, 0, 0);
+
+    zx_port_packet_t pp[kMaxPacketsPerWait];
+    size_t actual = 0;
+    zx_status_t st = port->DequeueMany(deadline, slack, pp,
+                                       fbl::min(count, kMaxPacketsPerWait), &actual);
+
+    ktrace(TAG_PORT_WAIT_DONE, (uint32_t)port->get_koid(), st, 0, 0);
+
+    if (st != ZX_OK)
+        return st;
+
+    status = packets_out.copy_array_to_user(pp, actual);
+    if (status != ZX_OK)
+        return status;
+
+    status = actual_out.copy_to_user(actual);
+    if (status != ZX_OK)
+        return status;
+
+    return ZX_OK;
+}
+
 // zx_status_t zx_port_cancel
 zx_status_t sys_port_cancel(zx_handle_t handle, zx_handle_t source, uint64_t key) {
     auto up = ProcessDispatcher::GetCurrent();
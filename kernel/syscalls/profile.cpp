@@ -43,14 +43,29 @@ zx_status_t sys_profile_create(zx_handle_t root_job,
         return ZX_ERR_ACCESS_DENIED;
     }
 
-    zx_profile_info_t profile_info;
-    status = user_profile_info.copy_from_user(&profile_info);
+    // A deadline profile is passed as a zx_profile_deadline_info_t, which
+    // shares only its leading |type| field with zx_profile_info_t.
+    uint32_t type;
+    status = user_profile_info.reinterpret<const uint32_t>().copy_from_user(&type);
     if (status != ZX_OK)
         return status;
 
     fbl::RefPtr<Dispatcher> dispatcher;
     zx_rights_t rights;
-    status = ProfileDispatcher::Create(profile_info, &dispatcher, &rights);
+    if (type == ZX_PROFILE_INFO_DEADLINE) {
+        zx_profile_deadline_info_t deadline_info;
+        status = user_profile_info.reinterpret<const zx_profile_deadline_info_t>()
+                     .copy_from_user(&deadline_info);
+        if (status != ZX_OK)
+            return status;
+        status = ProfileDispatcher::Create(deadline_info, &dispatcher, &rights);
+    } else {
+        zx_profile_info_t profile_info;
+        status = user_profile_info.copy_from_user(&profile_info);
+        if (status != ZX_OK)
+            return status;
+        status = ProfileDispatcher::Create(profile_info, &dispatcher, &rights);
+    }
     if (status != ZX_OK)
         return status;
 
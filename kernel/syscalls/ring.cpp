@@ -0,0 +1,74 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <err.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <trace.h>
+
+#include <object/handle.h>
+#include <object/process_dispatcher.h>
+#include <object/ring_dispatcher.h>
+
+#include <zircon/syscalls/policy.h>
+#include <fbl/ref_ptr.h>
+
+#include "priv.h"
+
+#define LOCAL_TRACE 0
+
+// zx_status_t zx_ring_create
+zx_status_t sys_ring_create(size_t elem_count, size_t elem_size, uint32_t options,
+                            user_out_handle* producer, user_out_handle* consumer) {
+    LTRACEF("count %zu, size %zu, options %#x\n", elem_count, elem_size, options);
+
+    // A ring is a fifo whose storage is a VMO, so creating one needs both.
+    auto up = ProcessDispatcher::GetCurrent();
+    zx_status_t res = up->QueryBasicPolicy(ZX_POL_NEW_FIFO);
+    if (res != ZX_OK)
+        return res;
+    res = up->QueryBasicPolicy(ZX_POL_NEW_VMO);
+    if (res != ZX_OK)
+        return res;
+
+    fbl::RefPtr<Dispatcher> dispatcher0;
+    fbl::RefPtr<Dispatcher> dispatcher1;
+    zx_rights_t rights;
+    zx_status_t result = RingDispatcher::Create(elem_count, elem_size, options,
+                                                &dispatcher0, &dispatcher1, &rights);
+
+    if (result == ZX_OK)
+        result = producer->make(ktl::move(dispatcher0), rights);
+    if (result == ZX_OK)
+        result = consumer->make(ktl::move(dispatcher1), rights);
+    return result;
+}
+
+// zx_status_t zx_ring_get_vmo
+zx_status_t sys_ring_get_vmo(zx_handle_t handle, user_out_handle* vmo) {
+    auto up = ProcessDispatcher::GetCurrent();
+
+    fbl::RefPtr<RingDispatcher> ring;
+    zx_status_t status = up->GetDispatcherWithRights(handle, ZX_RIGHT_READ | ZX_RIGHT_WRITE,
+                                                     &ring);
+    if (status != ZX_OK)
+        return status;
+
+    // Both ends write to the VMO, but nobody should be executing from it.
+    return vmo->make(ring->vmo(), ZX_DEFAULT_VMO_RIGHTS & ~ZX_RIGHT_EXECUTE);
+}
+
+// zx_status_t zx_ring_notify
+zx_status_t sys_ring_notify(zx_handle_t handle) {
+    auto up = ProcessDispatcher::GetCurrent();
+
+    fbl::RefPtr<RingDispatcher> ring;
+    zx_status_t status = up->GetDispatcherWithRights(handle, ZX_RIGHT_SIGNAL, &ring);
+    if (status != ZX_OK)
+        return status;
+
+    return ring->Notify();
+}
@@ -17,6 +17,7 @@
 #include <object/handle.h>
 #include <object/process_dispatcher.h>
 #include <object/socket_dispatcher.h>
+#include <object/vm_object_dispatcher.h>
 
 #include <zircon/syscalls/policy.h>
 #include <fbl/ref_ptr.h>
@@ -118,6 +119,69 @@ zx_status_t sys_socket_read(zx_handle_t handle, uint32_t options,
     return status;
 }
 
+// zx_status_t zx_socket_write_vmo
+zx_status_t sys_socket_write_vmo(zx_handle_t handle, uint32_t options,
+                                 zx_handle_t vmo_handle, uint64_t offset, size_t size,
+                                 user_out_ptr<size_t> actual) {
+    LTRACEF("handle %x vmo %x offset %#" PRIx64 " size %#zx\n", handle, vmo_handle, offset, size);
+
+    if (options != 0)
+        return ZX_ERR_INVALID_ARGS;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    fbl::RefPtr<SocketDispatcher> socket;
+    zx_status_t status = up->GetDispatcherWithRights(handle, ZX_RIGHT_WRITE, &socket);
+    if (status != ZX_OK)
+        return status;
+
+    // Whole pages are moved out of the vmo rather than copied, which writes it.
+    fbl::RefPtr<VmObjectDispatcher> vmo;
+    status = up->GetDispatcherWithRights(vmo_handle, ZX_RIGHT_READ | ZX_RIGHT_WRITE, &vmo);
+    if (status != ZX_OK)
+        return status;
+
+    uint64_t vmo_size = vmo->vmo()->size();
+    if (offset > vmo_size || size > vmo_size - offset)
+        return ZX_ERR_OUT_OF_RANGE;
+
+    size_t nwritten;
+    status = socket->WriteVmo(vmo->vmo(), offset, size, &nwritten);
+
+    // Caller may ignore results if desired.
+    if (status == ZX_OK && actual)
+        status = actual.copy_to_user(nwritten);
+
+    return status;
+}
+
+// zx_status_t zx_socket_read_vmo
+zx_status_t sys_socket_read_vmo(zx_handle_t handle, uint32_t options, size_t size,
+                                user_out_handle* out_vmo, user_out_ptr<size_t> actual) {
+    LTRACEF("handle %x size %#zx\n", handle, size);
+
+    if (options != 0)
+        return ZX_ERR_INVALID_ARGS;
+
+    auto up = ProcessDispatcher::GetCurrent();
+    zx_status_t status = up->QueryBasicPolicy(ZX_POL_NEW_VMO);
+    if (status != ZX_OK)
+        return status;
+
+    fbl::RefPtr<SocketDispatcher> socket;
+    status = up->GetDispatcherWithRights(handle, ZX_RIGHT_READ, &socket);
+    if (status != ZX_OK)
+        return status;
+
+    // Caller may ignore results if desired.
+    HandleOwner vmo;
+    status = socket->ReadVmo(size, actual, &vmo);
+    if (status != ZX_OK)
+        return status;
+
+    return out_vmo->transfer(ktl::move(vmo));
+}
+
 // zx_status_t zx_socket_share
 zx_status_t sys_socket_share(zx_handle_t handle, zx_handle_t socket_to_share) {
     auto up = ProcessDispatcher::GetCurrent();
@@ -53,9 +53,15 @@ zx_status_t sys_vmo_create(uint64_t size, uint32_t options,
     if (res != ZX_OK)
         return res;
 
+    // allocate from the process's numa node, if it has one
+    uint32_t pmm_alloc_flags = PMM_ALLOC_FLAG_ANY;
+    uint32_t numa_node = up->get_numa_node();
+    if (numa_node != ZX_NUMA_NODE_ANY)
+        pmm_alloc_flags |= PMM_ALLOC_FLAG_NODE(numa_node);
+
     // create a vm object
     fbl::RefPtr<VmObject> vmo;
-    res = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, options, size, &vmo);
+    res = VmObjectPaged::Create(pmm_alloc_flags, options, size, &vmo);
     if (res != ZX_OK)
         return res;
 
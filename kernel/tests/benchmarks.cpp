@@ -9,11 +9,13 @@
 
 #include <arch/ops.h>
 #include <err.h>
+#include <fbl/alloc_checker.h>
 #include <inttypes.h>
 #include <kernel/mp.h>
 #include <kernel/mutex.h>
 #include <kernel/spinlock.h>
 #include <kernel/thread.h>
+#include <lib/ktrace.h>
 #include <platform.h>
 #include <rand.h>
 #include <stdio.h>
@@ -270,6 +272,101 @@ __NO_INLINE static void bench_mutex() {
     printf("%" PRIu64 " cycles to acquire/release uncontended mutex %u times (%" PRIu64 " cycles per)\n", c, count, c / count);
 }
 
+__NO_INLINE static void bench_ktrace() {
+    // Kept small enough to fit in a cpu's ring, so that every probe is
+    // recorded when the probe group is enabled rather than tracing stopping
+    // partway through.  With the group masked off this measures the cost of
+    // a disabled probe instead.
+    static const uint count = 16 * 1024;
+    uint64_t c = arch_cycle_count();
+    for (uint i = 0; i < count; i++) {
+        ktrace_probe2("bench_ktrace", i, 0);
+    }
+    c = arch_cycle_count() - c;
+
+    printf("%" PRIu64 " cycles to emit ktrace probe %u times (%" PRIu64 " cycles per)\n", c, count, c / count);
+}
+
+// Stands in for a small kernel object, such as a dispatcher or a handle.
+struct BenchObject {
+    uint64_t fields[8];
+};
+
+// How many objects each thread creates and destroys.
+const uint HEAP_BENCH_COUNT = 4 * 1024 * 1024;
+
+static int bench_heap_thread(void* arg) {
+    static const uint batch = 16;
+    BenchObject* objects[batch];
+
+    uint64_t c = arch_cycle_count();
+    for (uint i = 0; i < HEAP_BENCH_COUNT; i += batch) {
+        for (uint j = 0; j < batch; j++) {
+            fbl::AllocChecker ac;
+            objects[j] = new (&ac) BenchObject;
+            if (!ac.check()) {
+                TRACEF("error: allocation failed\n");
+                while (j-- > 0) {
+                    delete objects[j];
+                }
+                return ZX_ERR_NO_MEMORY;
+            }
+        }
+        for (uint j = 0; j < batch; j++) {
+            delete objects[j];
+        }
+    }
+    *static_cast<uint64_t*>(arg) = arch_cycle_count() - c;
+    return ZX_OK;
+}
+
+// Creates and destroys objects on |cpus| cpus at once, one thread pinned to each.
+static void bench_heap_on(cpu_mask_t cpus) {
+    thread_t* threads[SMP_MAX_CPUS] = {};
+    uint64_t cycles[SMP_MAX_CPUS] = {};
+
+    for (cpu_num_t i = 0; i < SMP_MAX_CPUS; i++) {
+        if (!(cpus & cpu_num_to_mask(i))) {
+            continue;
+        }
+        threads[i] = thread_create("bench_heap", bench_heap_thread, &cycles[i],
+                                   DEFAULT_PRIORITY);
+        if (threads[i] == nullptr) {
+            TRACEF("error: thread_create failed\n");
+            continue;
+        }
+        thread_set_cpu_affinity(threads[i], cpu_num_to_mask(i));
+        thread_resume(threads[i]);
+    }
+
+    uint64_t total = 0;
+    uint nthreads = 0;
+    for (cpu_num_t i = 0; i < SMP_MAX_CPUS; i++) {
+        if (threads[i] == nullptr) {
+            continue;
+        }
+        int retcode;
+        thread_join(threads[i], &retcode, ZX_TIME_INFINITE);
+        if (retcode == ZX_OK) {
+            total += cycles[i];
+            nthreads++;
+        }
+    }
+    if (nthreads == 0) {
+        return;
+    }
+
+    printf("%" PRIu64 " cycles per thread to create/destroy %u %zu byte objects on %u cpus "
+           "(%" PRIu64 " cycles per)\n",
+           total / nthreads, HEAP_BENCH_COUNT, sizeof(BenchObject), nthreads,
+           total / nthreads / HEAP_BENCH_COUNT);
+}
+
+__NO_INLINE static void bench_heap() {
+    bench_heap_on(cpu_num_to_mask(arch_curr_cpu_num()));
+    bench_heap_on(mp_get_online_mask());
+}
+
 int benchmarks(int, const cmd_args*, uint32_t) {
     bench_set_overhead();
     bench_memcpy();
@@ -287,5 +384,9 @@ int benchmarks(int, const cmd_args*, uint32_t) {
     bench_spinlock();
     bench_mutex();
 
+    bench_ktrace();
+
+    bench_heap();
+
     return 0;
 }
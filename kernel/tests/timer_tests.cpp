@@ -475,6 +475,112 @@ static bool trylock_or_cancel_get_lock() {
     END_TEST;
 }
 
+// Check that timers coalesce with the neighbor that best fits their slack, using the
+// same deadlines as the timer_diag coalescing cases.
+static bool coalescing() {
+    BEGIN_TEST;
+
+    zx_time_t when = current_time() + ZX_HOUR(5);
+    zx_duration_t off = ZX_USEC(10);
+
+    struct {
+        TimerSlack slack;
+        zx_time_t deadline[8];
+        zx_duration_t expected_adj[8];
+        size_t count;
+    } cases[] = {
+        {
+            {2u * off, TIMER_SLACK_CENTER},
+            {when + (6u * off), when, when - off, when - (3u * off),
+             when + off, when + (3u * off), when + (5u * off), when - (3u * off)},
+            {0, 0, ZX_USEC(10), 0, -ZX_USEC(10), 0, ZX_USEC(10), 0},
+            8,
+        },
+        {
+            {3u * off, TIMER_SLACK_LATE},
+            {when + off, when + (2u * off), when - off, when - (3u * off),
+             when + (3u * off), when + (2u * off), when - (4u * off)},
+            {0, 0, ZX_USEC(20), 0, 0, 0, ZX_USEC(10)},
+            7,
+        },
+        {
+            {3u * off, TIMER_SLACK_EARLY},
+            {when, when + (2u * off), when - off, when - (3u * off),
+             when + (4u * off), when + (5u * off), when - (2u * off)},
+            {0, -ZX_USEC(20), 0, 0, 0, -ZX_USEC(10), -ZX_USEC(10)},
+            7,
+        },
+    };
+
+    for (auto& c : cases) {
+        timer_t timers[8];
+        timer_args arg{};
+
+        // Keep all of the timers on one cpu's queue.
+        arch_disable_ints();
+        for (size_t i = 0; i < c.count; i++) {
+            timer_init(&timers[i]);
+            timer_set(&timers[i], c.deadline[i], c.slack, timer_cb, &arg);
+        }
+        arch_enable_ints();
+
+        for (size_t i = 0; i < c.count; i++) {
+            EXPECT_EQ(c.expected_adj[i], timers[i].slack, "");
+            EXPECT_EQ(c.deadline[i] + c.expected_adj[i], timers[i].scheduled_time, "");
+            EXPECT_TRUE(timer_cancel(&timers[i]), "");
+        }
+        EXPECT_FALSE(atomic_load(&arg.timer_fired), "");
+    }
+
+    END_TEST;
+}
+
+// Set and cancel a large number of timers, reporting how long each operation takes
+// on average with that many timers queued.
+static bool many_timers() {
+    BEGIN_TEST;
+
+    constexpr size_t kNumTimers = 100000;
+    timer_t* timers = static_cast<timer_t*>(malloc(sizeof(timer_t) * kNumTimers));
+    ASSERT_NONNULL(timers, "");
+
+    timer_args arg{};
+    const zx_time_t base = current_time() + ZX_HOUR(5);
+    const TimerSlack slacks[] = {
+        kNoSlack,
+        {ZX_USEC(50), TIMER_SLACK_CENTER},
+        {ZX_USEC(50), TIMER_SLACK_LATE},
+        {ZX_USEC(50), TIMER_SLACK_EARLY},
+    };
+
+    zx_time_t start = current_time();
+    for (size_t i = 0; i < kNumTimers; i++) {
+        timer_init(&timers[i]);
+        zx_time_t deadline = base + rand_duration(ZX_SEC(10));
+        timer_set(&timers[i], deadline, slacks[i % fbl::count_of(slacks)], timer_cb, &arg);
+    }
+    zx_duration_t set_time = zx_time_sub_time(current_time(), start);
+
+    // Cancel in a different order from the one the timers were set in.
+    size_t canceled = 0;
+    start = current_time();
+    for (size_t i = 0; i < kNumTimers; i++) {
+        size_t ix = (i * 7919) % kNumTimers;
+        canceled += timer_cancel(&timers[ix]) ? 1 : 0;
+    }
+    zx_duration_t cancel_time = zx_time_sub_time(current_time(), start);
+
+    printf("\n%zu timers: set %" PRIi64 " ns/timer, cancel %" PRIi64 " ns/timer\n",
+           kNumTimers, set_time / static_cast<zx_duration_t>(kNumTimers),
+           cancel_time / static_cast<zx_duration_t>(kNumTimers));
+
+    EXPECT_EQ(kNumTimers, canceled, "");
+    EXPECT_FALSE(atomic_load(&arg.timer_fired), "");
+
+    free(timers);
+    END_TEST;
+}
+
 UNITTEST_START_TESTCASE(timer_tests)
 UNITTEST("cancel_before_deadline", cancel_before_deadline)
 UNITTEST("cancel_after_fired", cancel_after_fired)
@@ -482,4 +588,6 @@ UNITTEST("cancel_from_callback", cancel_from_callback)
 UNITTEST("set_from_callback", set_from_callback)
 UNITTEST("trylock_or_cancel_canceled", trylock_or_cancel_canceled)
 UNITTEST("trylock_or_cancel_get_lock", trylock_or_cancel_get_lock)
+UNITTEST("coalescing", coalescing)
+UNITTEST("many_timers", many_timers)
 UNITTEST_END_TESTCASE(timer_tests, "timer", "timer tests");
@@ -0,0 +1,168 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include "vm/compression.h"
+
+#include "vm_priv.h"
+
+#include <assert.h>
+#include <fbl/algorithm.h>
+#include <fbl/alloc_checker.h>
+#include <fbl/atomic.h>
+#include <inttypes.h>
+#include <kernel/mutex.h>
+#include <ktl/move.h>
+#include <lib/counters.h>
+#include <lz4/lz4.h>
+#include <stdio.h>
+#include <string.h>
+#include <trace.h>
+#include <vm/physmap.h>
+#include <vm/vm_object_paged.h>
+
+#define LOCAL_TRACE MAX(VM_GLOBAL_TRACE, 0)
+
+// Together these give the compression ratio: pages * PAGE_SIZE / bytes.
+KCOUNTER(vm_compression_pages, "kernel.vm.compression.pages");
+KCOUNTER(vm_compression_bytes, "kernel.vm.compression.bytes");
+KCOUNTER(vm_compression_rejected, "kernel.vm.compression.rejected");
+
+// A page that compresses to more than this is left alone.  Compressed pages
+// live on the heap, and anything bigger would leave no room in a page for a
+// second one.
+static constexpr int kMaxCompressedSize = PAGE_SIZE / 2;
+
+// LZ4's hash table is far too large for a kernel stack, so there is one shared
+// table, along with a buffer to compress into before the size is known.
+struct VmCompressorGlobal {};
+static DECLARE_MUTEX(VmCompressorGlobal) compress_lock;
+static uint64_t compress_state[LZ4_STREAMSIZE_U64] TA_GUARDED(compress_lock);
+static char compress_buffer[kMaxCompressedSize] TA_GUARDED(compress_lock);
+
+// Pages held compressed right now, and the bytes they take.
+static fbl::atomic<uint64_t> stored_pages;
+static fbl::atomic<uint64_t> stored_bytes;
+
+// One scan runs at a time, picking up after the last VMO the previous one
+// looked at.
+struct VmReclaimScannerGlobal {};
+static DECLARE_MUTEX(VmReclaimScannerGlobal) reclaim_lock;
+static VmObject::ListCursor reclaim_cursor TA_GUARDED(reclaim_lock);
+
+// VMOs taken from the global list at a time.
+static constexpr size_t kReclaimBatch = 16;
+
+VmCompressedPage::VmCompressedPage(uint64_t offset, ktl::unique_ptr<uint8_t[]> data,
+                                   size_t size)
+    : offset_(offset), data_(ktl::move(data)), size_(size) {
+    stored_pages.fetch_add(1);
+    stored_bytes.fetch_add(size_);
+}
+
+VmCompressedPage::~VmCompressedPage() {
+    stored_pages.fetch_sub(1);
+    stored_bytes.fetch_sub(size_);
+}
+
+// static
+zx_status_t VmCompressedPage::Create(paddr_t pa, uint64_t offset,
+                                     ktl::unique_ptr<VmCompressedPage>* out) {
+    const char* src = reinterpret_cast<const char*>(paddr_to_physmap(pa));
+    DEBUG_ASSERT(src);
+
+    fbl::AllocChecker ac;
+    ktl::unique_ptr<uint8_t[]> data;
+    int size;
+    {
+        Guard<fbl::Mutex> guard{&compress_lock};
+        size = LZ4_compress_fast_extState(compress_state, src, compress_buffer,
+                                          PAGE_SIZE, kMaxCompressedSize, 1);
+        if (size <= 0) {
+            kcounter_add(vm_compression_rejected, 1);
+            return ZX_ERR_BUFFER_TOO_SMALL;
+        }
+
+        data.reset(new (&ac) uint8_t[size]);
+        if (!ac.check()) {
+            return ZX_ERR_NO_MEMORY;
+        }
+        memcpy(data.get(), compress_buffer, size);
+    }
+
+    ktl::unique_ptr<VmCompressedPage> page(
+        new (&ac) VmCompressedPage(offset, ktl::move(data), size));
+    if (!ac.check()) {
+        return ZX_ERR_NO_MEMORY;
+    }
+
+    kcounter_add(vm_compression_pages, 1);
+    kcounter_add(vm_compression_bytes, size);
+    LTRACEF("pa %#" PRIxPTR " offset %#" PRIx64 " to %d bytes\n", pa, offset, size);
+
+    *out = ktl::move(page);
+    return ZX_OK;
+}
+
+void VmCompressedPage::Decompress(paddr_t pa) const {
+    char* dst = reinterpret_cast<char*>(paddr_to_physmap(pa));
+    DEBUG_ASSERT(dst);
+
+    int size = LZ4_decompress_safe(reinterpret_cast<const char*>(data_.get()), dst,
+                                   static_cast<int>(size_), PAGE_SIZE);
+    ASSERT_MSG(size == PAGE_SIZE, "compressed page at offset %#" PRIx64 " is corrupt (%d)\n",
+               offset_, size);
+}
+
+size_t vm_reclaim_pages(size_t target_pages, uint min_age) {
+    DEBUG_ASSERT(min_age <= VM_PAGE_OBJECT_MAX_AGE);
+
+    Guard<fbl::Mutex> guard{&reclaim_lock};
+
+    // the scan is over once the hand has been all the way around the list
+    size_t remaining = VmObject::GetVmoCount();
+    size_t reclaimed = 0;
+    bool wrapped = false;
+    while (reclaimed < target_pages && remaining > 0) {
+        fbl::RefPtr<VmObject> batch[kReclaimBatch];
+        size_t count = VmObject::GetLiveVmos(&reclaim_cursor, batch,
+                                             fbl::min(kReclaimBatch, remaining));
+        if (count == 0) {
+            // the hand went off the end of the list, and goes around to the front
+            if (wrapped) {
+                break;
+            }
+            wrapped = true;
+            continue;
+        }
+        remaining -= count;
+
+        for (size_t i = 0; i < count; i++) {
+            if (batch[i]->is_paged()) {
+                auto vmo = static_cast<VmObjectPaged*>(batch[i].get());
+                reclaimed += vmo->ReclaimPages(target_pages - reclaimed, min_age);
+            }
+            if (reclaimed >= target_pages) {
+                // leave the rest of the batch for the next scan
+                reclaim_cursor.Set(batch[i]);
+                break;
+            }
+        }
+    }
+
+    LTRACEF("reclaimed %zu of %zu pages\n", reclaimed, target_pages);
+    return reclaimed;
+}
+
+void vm_compression_dump() {
+    const uint64_t pages = stored_pages.load();
+    const uint64_t bytes = stored_bytes.load();
+    printf("compressed pages: %" PRIu64 " in %" PRIu64 "K", pages, bytes / 1024);
+    if (bytes > 0) {
+        const uint64_t ratio = pages * PAGE_SIZE * 100 / bytes;
+        printf(", ratio %" PRIu64 ".%02" PRIu64 ":1", ratio / 100, ratio % 100);
+    }
+    printf("\n");
+}
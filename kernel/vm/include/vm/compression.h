@@ -0,0 +1,62 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <fbl/intrusive_wavl_tree.h>
+#include <fbl/macros.h>
+#include <ktl/unique_ptr.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <zircon/types.h>
+
+// Anonymous memory that has gone unused for a while is squeezed with LZ4 and
+// kept on the heap, freeing the page it was in.  The reclaim scanner sweeps
+// over every VmObjectPaged like a clock hand, aging each page it passes.  The
+// first time it passes a page it also unmaps it, so that the next touch
+// faults and the fault resets the age.  Pages that reach the age the scan
+// asks for are compressed, and a later fault on one decompresses it into a
+// fresh page.
+
+// The contents of one page of a VmObjectPaged, compressed.
+class VmCompressedPage final
+    : public fbl::WAVLTreeContainable<ktl::unique_ptr<VmCompressedPage>> {
+public:
+    // Compresses the page at |pa|, to be kept for |offset| in its object.
+    // Fails with ZX_ERR_BUFFER_TOO_SMALL if the page doesn't shrink enough to
+    // be worth keeping this way.
+    static zx_status_t Create(paddr_t pa, uint64_t offset,
+                              ktl::unique_ptr<VmCompressedPage>* out);
+    ~VmCompressedPage();
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(VmCompressedPage);
+
+    uint64_t offset() const { return offset_; }
+    uint64_t GetKey() const { return offset_; }
+
+    // Bytes the compressed contents take.
+    size_t size() const { return size_; }
+
+    // Writes the original contents out to the page at |pa|.
+    void Decompress(paddr_t pa) const;
+
+private:
+    VmCompressedPage(uint64_t offset, ktl::unique_ptr<uint8_t[]> data, size_t size);
+
+    const uint64_t offset_;
+    const ktl::unique_ptr<uint8_t[]> data_;
+    const size_t size_;
+};
+
+// Moves the reclaim scanner along until it has freed |target_pages| pages or
+// has looked at every VMO once, compressing unpinned anonymous pages that have
+// sat through at least |min_age| scans unused.  A |min_age| of zero compresses
+// every such page it passes, and it may be at most VM_PAGE_OBJECT_MAX_AGE.
+// Returns the number of pages freed.
+size_t vm_reclaim_pages(size_t target_pages, uint min_age);
+
+// Prints how many pages are held compressed and how well they compressed.
+void vm_compression_dump();
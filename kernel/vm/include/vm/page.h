@@ -29,6 +29,12 @@ enum vm_page_state {
 #define VM_PAGE_STATE_BITS 3
 static_assert((1u << VM_PAGE_STATE_BITS) >= VM_PAGE_STATE_COUNT_, "");
 
+// enough to number every numa node the pmm supports
+#define VM_PAGE_NODE_BITS 2
+
+// vm_page.flags
+#define VM_PAGE_FLAG_ZEROED (0x1) // free page known to be zero filled
+
 // core per page structure allocated at pmm arena creation time
 typedef struct vm_page {
     struct list_node queue_node;
@@ -38,6 +44,8 @@ typedef struct vm_page {
     struct {
         uint32_t flags : 8;
         uint32_t state : VM_PAGE_STATE_BITS;
+        // numa node of the arena the page came from
+        uint32_t node : VM_PAGE_NODE_BITS;
     };
     // offset: 0x1c
 
@@ -47,6 +55,12 @@ typedef struct vm_page {
 #define VM_PAGE_OBJECT_MAX_PIN_COUNT ((1ul << VM_PAGE_OBJECT_PIN_COUNT_BITS) - 1)
 
             uint8_t pin_count : VM_PAGE_OBJECT_PIN_COUNT_BITS;
+
+// number of reclaim scans the page has sat through unused, see vm/compression.h
+#define VM_PAGE_OBJECT_AGE_BITS 2
+#define VM_PAGE_OBJECT_MAX_AGE ((1u << VM_PAGE_OBJECT_AGE_BITS) - 1)
+
+            uint8_t age : VM_PAGE_OBJECT_AGE_BITS;
         } object; // attached to a vm object
     };
 
@@ -6,28 +6,89 @@
 
 #pragma once
 
+#include <fbl/intrusive_double_list.h>
+#include <fbl/macros.h>
 #include <fbl/mutex.h>
 #include <fbl/ref_counted.h>
 #include <fbl/ref_ptr.h>
+#include <kernel/event.h>
 #include <kernel/mutex.h>
 #include <vm/vm.h>
+#include <zircon/thread_annotations.h>
 #include <zircon/types.h>
 
+class PageSource;
+
 // Callback to whatever is backing the PageSource.
 class PageSourceCallback {
 public:
+    // Asks for the pages in [offset, offset + len). The source only has one request
+    // outstanding with the callback at a time: once this returns ZX_OK, the callback
+    // must call PageSource::OnRequestTaken() when it is ready for the next one. Called
+    // with the source's lock held.
+    virtual zx_status_t SendRequest(uint64_t offset, uint64_t len) = 0;
+
     // OnClose should be called once no more requests will be made to the page source. The
     // callback can keep a reference to the page source, so it must be called outside of
     // the PageSource destructor.
     virtual void OnClose() = 0;
 };
 
+// A thread's request for a page that a PageSource has not supplied yet. It lives on the
+// stack of the thread that needs the page: once PageSource::GetPage() has returned
+// ZX_ERR_SHOULD_WAIT, the thread drops its locks, calls Wait(), and then retries.
+class PageRequest : public fbl::DoublyLinkedListable<PageRequest*> {
+public:
+    PageRequest();
+    ~PageRequest();
+
+    // Waits for the page to be supplied. On ZX_OK the request can be passed to GetPage()
+    // again. Fails with ZX_ERR_BAD_STATE if the source was closed first or couldn't pass the
+    // request on, or with one of the ZX_ERR_INTERNAL_INTR_* errors if the thread was
+    // interrupted.
+    zx_status_t Wait();
+
+private:
+    friend PageSource;
+
+    // The source this request is outstanding against, if any.
+    fbl::RefPtr<PageSource> src_;
+    event_t event_;
+    // What the source completed the request with, once |event_| is signaled.
+    zx_status_t status_ = ZX_OK;
+
+    // The page the waiting thread needs.
+    uint64_t offset_ = 0;
+
+    // The range this request asks the source for, which covers |offset_| and may read
+    // ahead past it. Empty when the page is already in another request's range, in which
+    // case that request's range is waited on instead.
+    uint64_t range_offset_ = 0;
+    uint64_t range_len_ = 0;
+    bool sent_ = false;
+
+    DISALLOW_COPY_ASSIGN_AND_MOVE(PageRequest);
+};
+
 // Object which bridges a vm_object to some external data source.
 class PageSource : public fbl::RefCounted<PageSource> {
 public:
     PageSource(PageSourceCallback* callback, uint64_t page_source_id);
     ~PageSource();
 
+    // Asks the source for the page at |offset|. |max_len| is how far past |offset| the
+    // vm_object is missing pages too, and bounds how far the request may read ahead.
+    // Returns ZX_ERR_SHOULD_WAIT once |request| is outstanding, or ZX_ERR_BAD_STATE if
+    // the source is closed.
+    zx_status_t GetPage(uint64_t offset, uint64_t max_len, PageRequest* request);
+
+    // Completes the requests for any pages in [offset, offset + len), which the
+    // vm_object has just been given.
+    void OnPagesSupplied(uint64_t offset, uint64_t len);
+
+    // Called by the callback once it can take another request.
+    void OnRequestTaken();
+
     // Closes the source. All pending transactions will be aborted and all future
     // calls will fail.
     void Close();
@@ -36,9 +97,32 @@ public:
     uint64_t get_page_source_id() const { return page_source_id_; }
 
 private:
+    friend PageRequest;
+
+    // Withdraws a request whose thread has stopped waiting for it.
+    void CancelRequest(PageRequest* request);
+
+    void RemoveRequestLocked(PageRequest* request) TA_REQ(mtx_);
+    void SendRequestsLocked() TA_REQ(mtx_);
+    // Completes every request that isn't covered by one the callback has taken.
+    void FailUnsentRequestsLocked() TA_REQ(mtx_);
+    uint64_t ReadAheadLocked(uint64_t offset, uint64_t max_len) TA_REQ(mtx_);
+
     PageSourceCallback* const callback_;
     const uint64_t page_source_id_;
 
     fbl::Mutex mtx_;
     bool closed_ TA_GUARDED(mtx_) = false;
+
+    // Every request with a thread waiting on it, in the order they were made.
+    fbl::DoublyLinkedList<PageRequest*> requests_ TA_GUARDED(mtx_);
+
+    // Whether the callback has a request it hasn't taken yet. Requests made in the
+    // meantime are held back and sent together once it does.
+    bool request_in_flight_ TA_GUARDED(mtx_) = false;
+
+    // Where the last request that read ahead ended, and how many pages the next one
+    // should ask for if it starts there.
+    uint64_t read_ahead_end_ TA_GUARDED(mtx_) = 0;
+    uint64_t read_ahead_pages_ TA_GUARDED(mtx_) = 0;
 };
@@ -21,10 +21,15 @@ typedef struct pmm_arena_info {
 
     paddr_t base;
     size_t size;
+
+    // numa node the memory is attached to, below PMM_MAX_NUMA_NODES
+    uint node;
 } pmm_arena_info_t;
 
 #define PMM_ARENA_FLAG_LO_MEM (0x1) // this arena is contained within architecturally-defined 'low memory'
 
+#define PMM_MAX_NUMA_NODES (1u << VM_PAGE_NODE_BITS)
+
 // Add a pre-filled memory arena to the physical allocator.
 // The arena data will be copied.
 zx_status_t pmm_add_arena(const pmm_arena_info_t* arena) __NONNULL((1));
@@ -32,6 +37,14 @@ zx_status_t pmm_add_arena(const pmm_arena_info_t* arena) __NONNULL((1));
 // flags for allocation routines below
 #define PMM_ALLOC_FLAG_ANY (0x0)    // no restrictions on which arena to allocate from
 #define PMM_ALLOC_FLAG_LO_MEM (0x1) // allocate only from arenas marked LO_MEM
+#define PMM_ALLOC_FLAG_ZERO (0x2)   // hand back zero filled pages
+
+// By default memory comes from the numa node of the cpu making the allocation.
+// PMM_ALLOC_FLAG_NODE(n) asks for node n instead. Either way, other nodes are
+// used once the preferred one runs out.
+#define PMM_ALLOC_FLAG_NODE_SHIFT (8)
+#define PMM_ALLOC_FLAG_NODE_MASK (0xffu << PMM_ALLOC_FLAG_NODE_SHIFT)
+#define PMM_ALLOC_FLAG_NODE(n) ((((n) + 1u) << PMM_ALLOC_FLAG_NODE_SHIFT) & PMM_ALLOC_FLAG_NODE_MASK)
 
 // Allocate count pages of physical memory, adding to the tail of the passed list.
 // The list must be initialized.
@@ -68,6 +81,13 @@ uint64_t pmm_count_total_bytes();
 // |state_count|. Does not zero out the entries first.
 void pmm_count_total_states(size_t state_count[VM_PAGE_STATE_COUNT_]) __NONNULL((1));
 
+// Return the number of numa nodes that have memory attached.
+uint pmm_numa_node_count();
+
+// Record that |cpu| is attached to numa node |node|, so allocations made on it
+// prefer that node's memory.
+void pmm_set_cpu_numa_node(uint cpu, uint node);
+
 // virtual to physical
 paddr_t vaddr_to_paddr(const void* va);
 
@@ -49,6 +49,7 @@
                             VMAR_FLAG_CAN_MAP_WRITE | \
                             VMAR_FLAG_CAN_MAP_EXECUTE)
 
+class PageRequest;
 class VmAspace;
 
 // forward declarations
@@ -116,8 +117,10 @@ public:
     fbl::RefPtr<VmMapping> as_vm_mapping();
 
     // Page fault in an address within the region.  Recursively traverses
-    // the regions to find the target mapping, if it exists.
-    virtual zx_status_t PageFault(vaddr_t va, uint pf_flags) = 0;
+    // the regions to find the target mapping, if it exists.  Returns
+    // ZX_ERR_SHOULD_WAIT if the page has to come from a page source, once
+    // |page_request| has been queued with it.
+    virtual zx_status_t PageFault(vaddr_t va, uint pf_flags, PageRequest* page_request) = 0;
 
     // WAVL tree key function
     vaddr_t GetKey() const { return base(); }
@@ -243,7 +246,7 @@ public:
     bool has_parent() const;
 
     void Dump(uint depth, bool verbose) const override;
-    zx_status_t PageFault(vaddr_t va, uint pf_flags) override;
+    zx_status_t PageFault(vaddr_t va, uint pf_flags, PageRequest* page_request) override;
 
 protected:
     // constructor for use in creating a VmAddressRegionDummy
@@ -384,7 +387,7 @@ public:
         return;
     }
 
-    zx_status_t PageFault(vaddr_t va, uint pf_flags) override {
+    zx_status_t PageFault(vaddr_t va, uint pf_flags, PageRequest* page_request) override {
         // We should never be trying to page fault on this...
         ASSERT(false);
         return ZX_ERR_BAD_STATE;
@@ -448,7 +451,7 @@ public:
     bool is_mapping() const override { return true; }
 
     void Dump(uint depth, bool verbose) const override;
-    zx_status_t PageFault(vaddr_t va, uint pf_flags) override;
+    zx_status_t PageFault(vaddr_t va, uint pf_flags, PageRequest* page_request) override;
 
 protected:
     ~VmMapping() override;
@@ -486,6 +489,24 @@ private:
     // Version of AllocatedPages() that does not acquire the aspace lock
     size_t AllocatedPagesLocked() const override;
 
+    // Returns true if the large page sized block of address space at |block_va| lies
+    // wholly inside this mapping, lines up with a large page sized block of the object,
+    // and could be mapped with a single large page.  The block's offset into the object
+    // is returned in |vmo_offset|.
+    bool LargePageBlock(vaddr_t block_va, uint64_t* vmo_offset) const;
+
+    // Maps the block at |block_va| with a single large page if the object backs it with
+    // a suitable run of pages, replacing whatever smaller pages were mapped there.
+    // Should be annotated TA_REQ(object_->lock()), see ActivateLocked().
+    bool MapLargePageLocked(vaddr_t block_va, uint64_t vmo_offset, uint mmu_flags);
+
+    // Maps the pages of the fault-around window containing |va| that the object already
+    // has, and on write faults with kernel.vm.fault-around-commit commits the rest, so
+    // touching them later doesn't fault again.  |pf_flags| and |mmu_flags| are those
+    // used for the page at |va|, which must already be mapped.
+    // Should be annotated TA_REQ(object_->lock()), see ActivateLocked().
+    void FaultAroundLocked(vaddr_t va, uint pf_flags, uint mmu_flags);
+
     void Activate() override;
 
     // Version of Activate that does not take the object_ lock.
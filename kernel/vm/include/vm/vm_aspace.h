@@ -120,6 +120,18 @@ public:
 
     size_t AllocatedPages() const;
 
+    // Page fault statistics for the address space.
+    struct fault_stats_t {
+        // Page faults taken in the address space.
+        size_t faults;
+
+        // Pages mapped in by fault-around before they were touched. Each of
+        // these is a fault the address space would otherwise have taken.
+        size_t fault_around_pages;
+    };
+
+    void GetFaultStats(fault_stats_t* stats) const;
+
     // Convenience method for traversing the tree of VMARs to find the deepest
     // VMAR in the tree that includes *va*.
     fbl::RefPtr<VmAddressRegionOrMapping> FindRegion(vaddr_t va);
@@ -202,6 +214,10 @@ private:
     // Access to this reference is guarded by lock_.
     fbl::RefPtr<VmAddressRegion> root_vmar_;
 
+    // page fault statistics, guarded by lock_
+    size_t page_faults_ = 0;
+    size_t fault_around_pages_ = 0;
+
     // PRNG used by VMARs for address choices.  We record the seed to enable
     // reproducible debugging.
     crypto::PRNG aslr_prng_;
@@ -25,6 +25,7 @@
 #include <zircon/thread_annotations.h>
 #include <zircon/types.h>
 
+class PageRequest;
 class VmMapping;
 
 typedef zx_status_t (*vmo_lookup_fn_t)(void* context, size_t offset, size_t index, paddr_t pa);
@@ -56,6 +57,8 @@ public:
     virtual bool is_contiguous() const { return false; }
     // Returns true if the object size can be changed.
     virtual bool is_resizable() const { return false; }
+    // Returns the id of the page source supplying the object's pages, or 0 if it has none.
+    virtual uint64_t page_source_id() const { return 0; }
 
     // Returns the number of physical pages currently allocated to the
     // object where (offset <= page_offset < offset+len).
@@ -113,6 +116,21 @@ public:
         return ZX_ERR_NOT_SUPPORTED;
     }
 
+    // Removes the pages in the page aligned range [offset, offset + len) from the object
+    // and appends them to |pages| in order, committing any that were missing first.
+    virtual zx_status_t TakePages(uint64_t offset, uint64_t len, list_node* pages) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
+    // Adds the pages in |pages|, taken from another object with TakePages(), to the page
+    // aligned range [offset, offset + len) of the object and completes any page requests
+    // waiting on them if it has a page source. Pages the object already has are kept, and
+    // the supplied page is freed. On failure the pages that weren't added are left on
+    // |pages|, in order, for the caller to deal with.
+    virtual zx_status_t SupplyPages(uint64_t offset, uint64_t len, list_node* pages) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
     // The associated VmObjectDispatcher will set an observer to notify user mode.
     void SetChildObserver(VmObjectChildObserver* child_observer);
 
@@ -156,6 +174,14 @@ public:
         return ZX_ERR_NOT_SUPPORTED;
     }
 
+    // numa node pages are allocated from first, or ZX_NUMA_NODE_ANY
+    virtual zx_status_t GetNumaNode(uint32_t* node) const {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    virtual zx_status_t SetNumaNode(uint32_t node) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
     // create a copy-on-write clone vmo at the page-aligned offset and length
     // note: it's okay to start or extend past the size of the parent
     virtual zx_status_t CloneCOW(bool resizable,
@@ -174,15 +200,34 @@ public:
     zx_status_t GetPage(uint64_t offset, uint pf_flags, list_node* free_list,
                         vm_page_t** page, paddr_t* pa) {
         Guard<fbl::Mutex> guard{&lock_};
-        return GetPageLocked(offset, pf_flags, free_list, page, pa);
+        return GetPageLocked(offset, pf_flags, free_list, nullptr, page, pa);
     }
 
     // See VmObject::GetPage
+    //
+    // If faulting in the page needs it supplied by a page source, |page_request| is
+    // queued with the source and ZX_ERR_SHOULD_WAIT is returned. The caller should then
+    // drop its locks, wait on the request and try again. Without a |page_request| such
+    // a page is treated as missing.
     virtual zx_status_t GetPageLocked(uint64_t offset, uint pf_flags, list_node* free_list,
+                                      PageRequest* page_request,
                                       vm_page_t** page, paddr_t* pa) TA_REQ(lock_) {
         return ZX_ERR_NOT_SUPPORTED;
     }
 
+    // back the large page sized block starting at |offset| with one physically contiguous,
+    // aligned run of zeroed pages. only done while nothing in the block is committed yet.
+    virtual zx_status_t CommitLargePageLocked(uint64_t offset) TA_REQ(lock_) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
+    // returns true, and the physical address of the run in |pa|, if every page of the large
+    // page sized block starting at |offset| is present and together they form one aligned
+    // physically contiguous run that can be mapped as a single large page.
+    virtual bool GetLargePageLocked(uint64_t offset, paddr_t* pa) TA_REQ(lock_) {
+        return false;
+    }
+
     Lock<fbl::Mutex>* lock() TA_RET_CAP(lock_) { return &lock_; }
     Lock<fbl::Mutex>& lock_ref() TA_RET_CAP(lock_) { return lock_; }
 
@@ -217,6 +262,22 @@ public:
         return ZX_OK;
     }
 
+    // A place on the global VMO list that a walk can be picked up from later.
+    // It doesn't keep the object it points at alive: when that object is
+    // destroyed the cursor moves back to the one before it.
+    class ListCursor;
+
+    // Takes a reference to each VMO on the global list after |cursor|, passing
+    // over any that are being destroyed, until |max_refs| have been taken or
+    // the end of the list is reached.  Leaves |cursor| at the last object
+    // taken, so the next call carries on from there, and returns how many
+    // references were taken.  Zero means the walk has reached the end, and
+    // puts |cursor| back at the front.  |refs| must start out empty.
+    static size_t GetLiveVmos(ListCursor* cursor, fbl::RefPtr<VmObject>* refs, size_t max_refs);
+
+    // The number of VMOs on the global list, including any being destroyed.
+    static size_t GetVmoCount();
+
 protected:
     // private constructor (use Create())
     explicit VmObject(fbl::RefPtr<VmObject> parent);
@@ -286,4 +347,27 @@ private:
     using GlobalList = fbl::DoublyLinkedList<VmObject*, GlobalListTraits>;
     DECLARE_SINGLETON_MUTEX(AllVmosLock);
     static GlobalList all_vmos_ TA_GUARDED(AllVmosLock::Get());
+
+    // Every cursor that has been used for a walk, so the destructor can move
+    // any that point at the object going away.
+    static fbl::DoublyLinkedList<ListCursor*> cursors_ TA_GUARDED(AllVmosLock::Get());
+
+public:
+    class ListCursor : public fbl::DoublyLinkedListable<ListCursor*> {
+    public:
+        ListCursor() = default;
+        ~ListCursor();
+
+        DISALLOW_COPY_ASSIGN_AND_MOVE(ListCursor);
+
+        // Puts the cursor at |vmo|, which must be on the list, so that the next
+        // walk starts with the object after it.
+        void Set(const fbl::RefPtr<VmObject>& vmo);
+
+    private:
+        friend VmObject;
+
+        // The last object handed out, or null to start from the front.
+        VmObject* last_ TA_GUARDED(AllVmosLock::Get()) = nullptr;
+    };
 };
@@ -17,6 +17,7 @@
 #include <lib/user_copy/user_ptr.h>
 #include <list.h>
 #include <stdint.h>
+#include <vm/compression.h>
 #include <vm/page_source.h>
 #include <vm/pmm.h>
 #include <vm/vm.h>
@@ -58,6 +59,9 @@ public:
     bool is_paged() const override { return true; }
     bool is_contiguous() const override { return (options_ & kContiguous); }
     bool is_resizable() const override { return (options_ & kResizable); }
+    uint64_t page_source_id() const override {
+        return page_source_ ? page_source_->get_page_source_id() : 0;
+    }
 
     size_t AllocatedPagesInRange(uint64_t offset, uint64_t len) const override;
 
@@ -75,6 +79,9 @@ public:
     zx_status_t ReadUser(user_out_ptr<void> ptr, uint64_t offset, size_t len) override;
     zx_status_t WriteUser(user_in_ptr<const void> ptr, uint64_t offset, size_t len) override;
 
+    zx_status_t TakePages(uint64_t offset, uint64_t len, list_node* pages) override;
+    zx_status_t SupplyPages(uint64_t offset, uint64_t len, list_node* pages) override;
+
     void Dump(uint depth, bool verbose) override;
 
     zx_status_t InvalidateCache(const uint64_t offset, const uint64_t len) override;
@@ -83,10 +90,13 @@ public:
     zx_status_t SyncCache(const uint64_t offset, const uint64_t len) override;
 
     zx_status_t GetPageLocked(uint64_t offset, uint pf_flags, list_node* free_list,
-                              vm_page_t**, paddr_t*) override
+                              PageRequest* page_request, vm_page_t**, paddr_t*) override
         // Calls a Locked method of the parent, which confuses analysis.
         TA_NO_THREAD_SAFETY_ANALYSIS;
 
+    zx_status_t CommitLargePageLocked(uint64_t offset) override TA_REQ(lock_);
+    bool GetLargePageLocked(uint64_t offset, paddr_t* pa) override TA_REQ(lock_);
+
     zx_status_t CloneCOW(bool resizable, uint64_t offset, uint64_t size, bool copy_name,
                          fbl::RefPtr<VmObject>* clone_vmo) override
         // Calls a Locked method of the child, which confuses analysis.
@@ -99,6 +109,14 @@ public:
     uint32_t GetMappingCachePolicy() const override;
     zx_status_t SetMappingCachePolicy(const uint32_t cache_policy) override;
 
+    zx_status_t GetNumaNode(uint32_t* node) const override;
+    zx_status_t SetNumaNode(uint32_t node) override;
+
+    // Compresses up to |max_pages| of this object's pages that have sat through
+    // at least |min_age| reclaim scans unused, and ages the others it passes.
+    // Returns the number of pages freed. See vm/compression.h.
+    size_t ReclaimPages(size_t max_pages, uint min_age);
+
     // maximum size of a VMO is one page less than the full 64bit range
     static const uint64_t MAX_SIZE = ROUNDDOWN(UINT64_MAX, PAGE_SIZE);
 
@@ -135,6 +153,22 @@ private:
     // internal check if any pages in a range are pinned
     bool AnyPagesPinnedLocked(uint64_t offset, size_t len) TA_REQ(lock_);
 
+    // whether pages missing from this object, or from the parent it clones, have to
+    // come from a page source
+    bool IsPagerBackedLocked() const TA_REQ(lock_);
+
+    // whether the reclaim scanner may compress this object's pages
+    bool CanReclaimLocked() const TA_REQ(lock_);
+
+    // brings back the page at |offset| if it was compressed, taking the page to
+    // decompress it into from |free_list| if that has any
+    zx_status_t DecompressPageLocked(uint64_t offset, list_node* free_list,
+                                     vm_page_t** page_out, paddr_t* pa_out) TA_REQ(lock_);
+    // brings back every compressed page in [start, end)
+    zx_status_t DecompressRangeLocked(uint64_t start, uint64_t end) TA_REQ(lock_);
+    // throws away any compressed pages in [start, end)
+    void FreeCompressedPagesLocked(uint64_t start, uint64_t end) TA_REQ(lock_);
+
     // internal read/write routine that takes a templated copy function to help share some code
     template <typename T>
     zx_status_t ReadWriteInternal(uint64_t offset, size_t len, bool write, T copyfunc);
@@ -154,4 +188,8 @@ private:
 
     // a tree of pages
     VmPageList page_list_ TA_GUARDED(lock_);
+
+    // pages the reclaim scanner compressed, by offset. an offset is never in both
+    // this and page_list_.
+    fbl::WAVLTree<uint64_t, ktl::unique_ptr<VmCompressedPage>> compressed_pages_ TA_GUARDED(lock_);
 };
@@ -37,7 +37,8 @@ public:
     void Dump(uint depth, bool verbose) override;
 
     zx_status_t GetPageLocked(uint64_t offset, uint pf_flags, list_node* free_list,
-                              vm_page_t**, paddr_t* pa) override TA_REQ(lock_);
+                              PageRequest* page_request, vm_page_t**, paddr_t* pa) override
+        TA_REQ(lock_);
 
     uint32_t GetMappingCachePolicy() const override;
     zx_status_t SetMappingCachePolicy(const uint32_t cache_policy) override;
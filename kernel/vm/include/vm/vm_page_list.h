@@ -23,7 +23,9 @@ public:
 
     DISALLOW_COPY_ASSIGN_AND_MOVE(VmPageListNode);
 
-    static const size_t kPageFanOut = 16;
+    // a leaf covers 256KB of the object. large enough that a big object only needs a
+    // node per 64 pages, small enough that a tiny object doesn't waste much on one.
+    static const size_t kPageFanOut = 64;
 
     // accessors
     uint64_t offset() const { return obj_offset_; }
@@ -133,6 +135,11 @@ private:
     friend VmPageList;
 };
 
+// The pages of an object, kept in VmPageListNode leaves that each cover an aligned
+// run of kPageFanOut pages.  The leaves hang off a radix tree of inner nodes indexed
+// by successive bits of the offset, so finding the leaf for an offset takes a fixed
+// number of array lookups no matter how many pages are present.  The tree grows
+// taller only as far as the highest offset added so far needs.
 class VmPageList final {
 public:
     VmPageList();
@@ -140,82 +147,38 @@ public:
 
     DISALLOW_COPY_ASSIGN_AND_MOVE(VmPageList);
 
-    // walk the page tree, calling the passed in function on every tree node
+    // walk the page tree, calling the passed in function on every page
     template <typename T>
     zx_status_t ForEveryPage(T per_page_func) {
-        for (auto& pl : list_) {
-            zx_status_t status = pl.ForEveryPage(per_page_func, pl.offset(),
-                                                 pl.offset() + pl.kPageFanOut * PAGE_SIZE);
-            if (unlikely(status != ZX_ERR_NEXT)) {
-                if (status == ZX_ERR_STOP) {
-                    break;
-                }
-                return status;
-            }
-        }
-        return ZX_OK;
+        return ForEveryPageInRange(per_page_func, 0, UINT64_MAX);
     }
 
-    // walk the page tree, calling the passed in function on every tree node
+    // walk the page tree, calling the passed in function on every page
     template <typename T>
     zx_status_t ForEveryPage(T per_page_func) const {
-        for (auto& pl : list_) {
-            zx_status_t status = pl.ForEveryPage(per_page_func, pl.offset(),
-                                                 pl.offset() + pl.kPageFanOut * PAGE_SIZE);
-            if (unlikely(status != ZX_ERR_NEXT)) {
-                if (status == ZX_ERR_STOP) {
-                    break;
-                }
-                return status;
-            }
-        }
-        return ZX_OK;
+        return ForEveryPageInRange(per_page_func, 0, UINT64_MAX);
     }
 
-    // walk the page tree, calling the passed in function on every tree node
+    // walk the page tree, calling the passed in function on every page in the range
     template <typename T>
     zx_status_t ForEveryPageInRange(T per_page_func, uint64_t start_offset, uint64_t end_offset) {
-        // Find the first node with a start after start_offset; if start_offset
-        // is in a node, it'll be in the one before it.
-        auto start = --list_.upper_bound(start_offset);
-        if (!start.IsValid()) {
-            start = list_.begin();
-        }
-        const auto end = list_.lower_bound(end_offset);
-        for (auto itr = start; itr != end; ++itr) {
-            auto& pl = *itr;
-            zx_status_t status = pl.ForEveryPage(per_page_func, start_offset, end_offset);
-            if (unlikely(status != ZX_ERR_NEXT)) {
-                if (status == ZX_ERR_STOP) {
-                    break;
-                }
-                return status;
-            }
-        }
-        return ZX_OK;
+        zx_status_t status = ForEveryLeafInRange(
+            [&per_page_func, start_offset, end_offset](VmPageListNode* pl) {
+                return pl->ForEveryPage(per_page_func, start_offset, end_offset);
+            },
+            start_offset, end_offset);
+        return (status == ZX_ERR_NEXT || status == ZX_ERR_STOP) ? ZX_OK : status;
     }
 
     template <typename T>
     zx_status_t ForEveryPageInRange(T per_page_func, uint64_t start_offset,
                                     uint64_t end_offset) const {
-        // Find the first node with a start after start_offset; if start_offset
-        // is in a node, it'll be in the one before it.
-        auto start = --list_.upper_bound(start_offset);
-        if (!start.IsValid()) {
-            start = list_.begin();
-        }
-        const auto end = list_.lower_bound(end_offset);
-        for (auto itr = start; itr != end; ++itr) {
-            auto& pl = *itr;
-            zx_status_t status = pl.ForEveryPage(per_page_func, start_offset, end_offset);
-            if (unlikely(status != ZX_ERR_NEXT)) {
-                if (status == ZX_ERR_STOP) {
-                    break;
-                }
-                return status;
-            }
-        }
-        return ZX_OK;
+        zx_status_t status = ForEveryLeafInRange(
+            [&per_page_func, start_offset, end_offset](const VmPageListNode* pl) {
+                return pl->ForEveryPage(per_page_func, start_offset, end_offset);
+            },
+            start_offset, end_offset);
+        return (status == ZX_ERR_NEXT || status == ZX_ERR_STOP) ? ZX_OK : status;
     }
 
     zx_status_t AddPage(vm_page*, uint64_t offset);
@@ -232,5 +195,43 @@ public:
     VmPageSpliceList TakePages(uint64_t offset, uint64_t length);
 
 private:
-    fbl::WAVLTree<uint64_t, ktl::unique_ptr<VmPageListNode>> list_;
+    // Returns the leaf holding |offset|, if there is one.  Either way |next_offset| is
+    // set to the lowest offset above |offset| that another leaf could hold, skipping
+    // any empty subtree |offset| fell in, or UINT64_MAX if there is none.
+    VmPageListNode* LookupLeaf(uint64_t offset, uint64_t* next_offset) const;
+
+    // Returns the leaf holding |offset|, growing the tree and allocating nodes as needed.
+    zx_status_t GetOrAllocLeaf(uint64_t offset, VmPageListNode** leaf);
+
+    // Takes the leaf holding |offset| out of the tree and returns it, freeing any
+    // inner nodes on the way to it that are left empty.
+    VmPageListNode* UnlinkLeaf(uint64_t offset);
+
+    // Frees |node|, |level| levels above the leaves, and everything below it.
+    static void FreeSubtree(void* node, uint level);
+
+    // calls |func| on every leaf that overlaps [start_offset, end_offset), in order.
+    // |func| may unlink and free the leaf it is passed.
+    template <typename F>
+    zx_status_t ForEveryLeafInRange(F func, uint64_t start_offset, uint64_t end_offset) const {
+        uint64_t offset = start_offset;
+        while (offset < end_offset) {
+            uint64_t next_offset;
+            VmPageListNode* pl = LookupLeaf(offset, &next_offset);
+            if (pl) {
+                zx_status_t status = func(pl);
+                if (unlikely(status != ZX_ERR_NEXT)) {
+                    return status;
+                }
+            }
+            offset = next_offset;
+        }
+        return ZX_ERR_NEXT;
+    }
+
+    // the top of the tree: an inner node when height_ is non zero, otherwise the leaf
+    // for the first kPageFanOut pages
+    void* root_ = nullptr;
+    // the number of levels of inner nodes above the leaves
+    uint height_ = 0;
 };
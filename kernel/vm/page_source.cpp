@@ -4,12 +4,54 @@
 // license that can be found in the LICENSE file or at
 // https://opensource.org/licenses/MIT
 
+#include <fbl/algorithm.h>
 #include <fbl/auto_lock.h>
+#include <lib/counters.h>
 #include <trace.h>
 #include <vm/page_source.h>
 
+#include "vm_priv.h"
+
 #define LOCAL_TRACE 0
 
+KCOUNTER(pager_requests_sent, "kernel.vm.pager.requests_sent");
+KCOUNTER(pager_requests_coalesced, "kernel.vm.pager.requests_coalesced");
+KCOUNTER(pager_pages_requested, "kernel.vm.pager.pages_requested");
+
+namespace {
+
+// How many pages a request reads ahead when it doesn't follow on from the last one.
+constexpr uint64_t kInitialReadAheadPages = 4;
+
+} // namespace
+
+PageRequest::PageRequest() {
+    event_init(&event_, false, 0);
+}
+
+PageRequest::~PageRequest() {
+    if (src_) {
+        src_->CancelRequest(this);
+    }
+    event_destroy(&event_);
+}
+
+zx_status_t PageRequest::Wait() {
+    DEBUG_ASSERT(src_);
+
+    zx_status_t status = event_wait_deadline(&event_, ZX_TIME_INFINITE, true);
+    if (status == ZX_OK) {
+        status = status_;
+    } else {
+        // Interrupted, so the source may still be about to complete the request.
+        src_->CancelRequest(this);
+    }
+
+    src_.reset();
+    event_unsignal(&event_);
+    return status;
+}
+
 PageSource::PageSource(PageSourceCallback* callback, uint64_t page_source_id)
         : callback_(callback), page_source_id_(page_source_id) {
     LTRACEF("%p callback %p\n", this, callback_);
@@ -18,6 +60,191 @@ PageSource::PageSource(PageSourceCallback* callback, uint64_t page_source_id)
 PageSource::~PageSource() {
     LTRACEF("%p\n", this);
     DEBUG_ASSERT(closed_);
+    DEBUG_ASSERT(requests_.is_empty());
+}
+
+zx_status_t PageSource::GetPage(uint64_t offset, uint64_t max_len, PageRequest* request) {
+    DEBUG_ASSERT(IS_PAGE_ALIGNED(offset));
+    DEBUG_ASSERT(max_len >= PAGE_SIZE);
+    DEBUG_ASSERT(!request->src_);
+
+    fbl::AutoLock info_lock(&mtx_);
+    if (closed_) {
+        return ZX_ERR_BAD_STATE;
+    }
+
+    request->src_ = fbl::WrapRefPtr(this);
+    request->offset_ = offset;
+    request->range_offset_ = offset;
+    request->range_len_ = 0;
+    request->sent_ = false;
+
+    // If some other thread has already asked for the page, wait for that rather than
+    // asking again.
+    for (const auto& r : requests_) {
+        if (offset >= r.range_offset_ && offset - r.range_offset_ < r.range_len_) {
+            LTRACEF("%p offset %#" PRIx64 " already requested\n", this, offset);
+            kcounter_add(pager_requests_coalesced, 1);
+            requests_.push_back(request);
+            return ZX_ERR_SHOULD_WAIT;
+        }
+    }
+
+    request->range_len_ = ReadAheadLocked(offset, max_len);
+    LTRACEF("%p offset %#" PRIx64 " len %#" PRIx64 "\n", this, offset, request->range_len_);
+
+    requests_.push_back(request);
+    SendRequestsLocked();
+    return ZX_ERR_SHOULD_WAIT;
+}
+
+uint64_t PageSource::ReadAheadLocked(uint64_t offset, uint64_t max_len) {
+    // A fault right where the last request ended looks like a sequential reader, which
+    // gets asked for twice as much each time. Anything else starts over small.
+    const uint64_t max_pages = vm_pager_read_ahead_pages();
+    if (offset == read_ahead_end_ && read_ahead_pages_ != 0) {
+        read_ahead_pages_ = fbl::min(read_ahead_pages_ * 2, max_pages);
+    } else {
+        read_ahead_pages_ = fbl::min(kInitialReadAheadPages, max_pages);
+    }
+
+    uint64_t len = fbl::min(read_ahead_pages_ * PAGE_SIZE, max_len);
+    read_ahead_end_ = offset + len;
+    return len;
+}
+
+void PageSource::SendRequestsLocked() {
+    if (request_in_flight_) {
+        return;
+    }
+
+    // Send the oldest range that hasn't gone out yet, grown to take in every other
+    // unsent range that overlaps or abuts it. Faults that arrive while the callback is
+    // busy with the previous request end up going out together.
+    uint64_t start = 0;
+    uint64_t end = 0;
+    bool found = false;
+    bool grew;
+    do {
+        grew = false;
+        for (const auto& r : requests_) {
+            if (r.sent_ || r.range_len_ == 0) {
+                continue;
+            }
+            const uint64_t r_end = r.range_offset_ + r.range_len_;
+            if (!found) {
+                start = r.range_offset_;
+                end = r_end;
+                found = true;
+                grew = true;
+            } else if (r.range_offset_ <= end && r_end >= start &&
+                       (r.range_offset_ < start || r_end > end)) {
+                start = fbl::min(start, r.range_offset_);
+                end = fbl::max(end, r_end);
+                grew = true;
+            }
+        }
+    } while (grew);
+
+    if (!found) {
+        return;
+    }
+
+    zx_status_t status = callback_->SendRequest(start, end - start);
+    if (status != ZX_OK) {
+        // Nothing would ever send these again, so fail them rather than leave their
+        // threads waiting.
+        LTRACEF("%p failed to send request %d\n", this, status);
+        FailUnsentRequestsLocked();
+        return;
+    }
+    request_in_flight_ = true;
+    kcounter_add(pager_requests_sent, 1);
+    kcounter_add(pager_pages_requested, (end - start) / PAGE_SIZE);
+
+    for (auto& r : requests_) {
+        if (!r.sent_ && r.range_len_ != 0 &&
+            r.range_offset_ >= start && r.range_offset_ + r.range_len_ <= end) {
+            r.sent_ = true;
+        }
+    }
+}
+
+void PageSource::FailUnsentRequestsLocked() {
+    for (auto iter = requests_.begin(); iter != requests_.end();) {
+        PageRequest* request = &*iter++;
+        if (request->sent_) {
+            continue;
+        }
+        // A request waiting on another's range is fine if that range went out.
+        if (request->range_len_ == 0) {
+            bool covered = false;
+            for (const auto& r : requests_) {
+                if (r.sent_ && request->offset_ >= r.range_offset_ &&
+                    request->offset_ - r.range_offset_ < r.range_len_) {
+                    covered = true;
+                    break;
+                }
+            }
+            if (covered) {
+                continue;
+            }
+        }
+        requests_.erase(*request);
+        request->status_ = ZX_ERR_BAD_STATE;
+        event_signal(&request->event_, false);
+    }
+}
+
+void PageSource::RemoveRequestLocked(PageRequest* request) {
+    requests_.erase(*request);
+
+    // Requests waiting on this one's range would never be satisfied if the range were
+    // dropped before it was sent, so hand it on to one of them.
+    if (request->range_len_ == 0 || request->sent_) {
+        return;
+    }
+    for (auto& r : requests_) {
+        if (r.range_len_ == 0 && r.offset_ >= request->range_offset_ &&
+            r.offset_ - request->range_offset_ < request->range_len_) {
+            r.range_offset_ = request->range_offset_;
+            r.range_len_ = request->range_len_;
+            break;
+        }
+    }
+}
+
+void PageSource::CancelRequest(PageRequest* request) {
+    fbl::AutoLock info_lock(&mtx_);
+    LTRACEF("%p offset %#" PRIx64 "\n", this, request->offset_);
+
+    if (request->InContainer()) {
+        RemoveRequestLocked(request);
+    }
+}
+
+void PageSource::OnPagesSupplied(uint64_t offset, uint64_t len) {
+    fbl::AutoLock info_lock(&mtx_);
+    LTRACEF("%p offset %#" PRIx64 " len %#" PRIx64 "\n", this, offset, len);
+
+    for (auto iter = requests_.begin(); iter != requests_.end();) {
+        PageRequest* request = &*iter++;
+        if (request->offset_ < offset || request->offset_ - offset >= len) {
+            continue;
+        }
+        RemoveRequestLocked(request);
+        request->status_ = ZX_OK;
+        event_signal(&request->event_, false);
+    }
+}
+
+void PageSource::OnRequestTaken() {
+    fbl::AutoLock info_lock(&mtx_);
+
+    request_in_flight_ = false;
+    if (!closed_) {
+        SendRequestsLocked();
+    }
 }
 
 void PageSource::Close() {
@@ -26,6 +253,11 @@ void PageSource::Close() {
 
     if (!closed_) {
         closed_ = true;
+        while (!requests_.is_empty()) {
+            PageRequest* request = requests_.pop_front();
+            request->status_ = ZX_ERR_BAD_STATE;
+            event_signal(&request->event_, false);
+        }
         callback_->OnClose();
     }
 }
@@ -11,8 +11,10 @@
 #include <err.h>
 #include <inttypes.h>
 #include <kernel/mp.h>
+#include <kernel/thread.h>
 #include <kernel/timer.h>
 #include <lib/console.h>
+#include <lib/counters.h>
 #include <lk/init.h>
 #include <new>
 #include <platform.h>
@@ -28,6 +30,8 @@
 #include "pmm_node.h"
 #include "vm_priv.h"
 
+#include <fbl/algorithm.h>
+#include <fbl/atomic.h>
 #include <fbl/auto_lock.h>
 #include <fbl/intrusive_double_list.h>
 #include <fbl/mutex.h>
@@ -37,42 +41,246 @@
 
 #define LOCAL_TRACE MAX(VM_GLOBAL_TRACE, 0)
 
-// The (currently) one and only pmm node
-static PmmNode pmm_node;
+KCOUNTER(pmm_node0_alloc, "kernel.pmm.node0.alloc_pages");
+KCOUNTER(pmm_node1_alloc, "kernel.pmm.node1.alloc_pages");
+KCOUNTER(pmm_node2_alloc, "kernel.pmm.node2.alloc_pages");
+KCOUNTER(pmm_node3_alloc, "kernel.pmm.node3.alloc_pages");
+KCOUNTER(pmm_node0_free, "kernel.pmm.node0.free_pages");
+KCOUNTER(pmm_node1_free, "kernel.pmm.node1.free_pages");
+KCOUNTER(pmm_node2_free, "kernel.pmm.node2.free_pages");
+KCOUNTER(pmm_node3_free, "kernel.pmm.node3.free_pages");
+KCOUNTER(pmm_node0_remote, "kernel.pmm.node0.remote_alloc");
+KCOUNTER(pmm_node1_remote, "kernel.pmm.node1.remote_alloc");
+KCOUNTER(pmm_node2_remote, "kernel.pmm.node2.remote_alloc");
+KCOUNTER(pmm_node3_remote, "kernel.pmm.node3.remote_alloc");
+
+// pages handed out from and returned to each node since boot. both only go up;
+// the difference is the node's current usage.
+static const k_counter_desc* const pmm_node_alloc[] = {
+    pmm_node0_alloc, pmm_node1_alloc, pmm_node2_alloc, pmm_node3_alloc,
+};
+static const k_counter_desc* const pmm_node_free[] = {
+    pmm_node0_free, pmm_node1_free, pmm_node2_free, pmm_node3_free,
+};
+// allocations that wanted a node's memory but had to be served from another node
+static const k_counter_desc* const pmm_node_remote[] = {
+    pmm_node0_remote, pmm_node1_remote, pmm_node2_remote, pmm_node3_remote,
+};
+static_assert(fbl::count_of(pmm_node_alloc) == PMM_MAX_NUMA_NODES, "");
+static_assert(fbl::count_of(pmm_node_free) == PMM_MAX_NUMA_NODES, "");
+static_assert(fbl::count_of(pmm_node_remote) == PMM_MAX_NUMA_NODES, "");
+
+// One pmm node per numa node. Every page records the node it belongs to, so
+// frees go straight back to the right one.
+static PmmNode pmm_nodes[PMM_MAX_NUMA_NODES];
+// pages currently handed out from each node, shown by "pmm dump". the kcounters
+// above give the same figure from outside, but only summed across cpus.
+static fbl::atomic<uint64_t> pmm_node_used[PMM_MAX_NUMA_NODES];
+// number of leading entries of pmm_nodes that have had arenas added
+static uint pmm_node_count = 1;
+// numa node each cpu is attached to, set up by the platform
+static uint8_t cpu_numa_node[SMP_MAX_CPUS];
+
+static void pmm_node_allocated(uint node, size_t count) {
+    pmm_node_used[node].fetch_add(count, fbl::memory_order_relaxed);
+    kcounter_add(pmm_node_alloc[node], static_cast<int64_t>(count));
+}
+
+static void pmm_node_freed(uint node, size_t count) {
+    pmm_node_used[node].fetch_sub(count, fbl::memory_order_relaxed);
+    kcounter_add(pmm_node_free[node], static_cast<int64_t>(count));
+}
+
+// The node an allocation should try first: the one named in the flags, if
+// any, otherwise the current cpu's.
+static uint pmm_preferred_node(uint alloc_flags) {
+    uint node = (alloc_flags & PMM_ALLOC_FLAG_NODE_MASK) >> PMM_ALLOC_FLAG_NODE_SHIFT;
+    if (node != 0 && node <= pmm_node_count) {
+        return node - 1;
+    }
+    return cpu_numa_node[arch_curr_cpu_num()];
+}
+
+// Calls |func| with each node in the order an allocation should try them,
+// starting with |preferred|, until it returns ZX_OK. Returns the last status.
+template <typename F>
+static zx_status_t pmm_for_each_node_from(uint preferred, F func) {
+    zx_status_t status = ZX_ERR_NO_MEMORY;
+    for (uint i = 0; i < pmm_node_count; i++) {
+        uint node = (preferred + i) % pmm_node_count;
+        status = func(node);
+        if (status == ZX_OK) {
+            if (node != preferred) {
+                kcounter_add(pmm_node_remote[preferred], 1);
+            }
+            return ZX_OK;
+        }
+    }
+    return status;
+}
 
 #if PMM_ENABLE_FREE_FILL
 static void pmm_enforce_fill(uint level) {
-    pmm_node.EnforceFill();
+    for (uint i = 0; i < pmm_node_count; i++) {
+        pmm_nodes[i].EnforceFill();
+    }
 }
 LK_INIT_HOOK(pmm_fill, &pmm_enforce_fill, LK_INIT_LEVEL_VM);
 #endif
 
+static void pmm_start_zero_threads(uint level) {
+    for (uint i = 0; i < pmm_node_count; i++) {
+        char name[THREAD_NAME_LENGTH];
+        snprintf(name, sizeof(name), "pmm-zero-%u", i);
+        pmm_nodes[i].StartZeroThread(name);
+    }
+}
+LK_INIT_HOOK(pmm_zero, &pmm_start_zero_threads, LK_INIT_LEVEL_THREADING);
+
 vm_page_t* paddr_to_vm_page(paddr_t addr) {
-    return pmm_node.PaddrToPage(addr);
+    for (uint i = 0; i < pmm_node_count; i++) {
+        vm_page_t* page = pmm_nodes[i].PaddrToPage(addr);
+        if (page) {
+            return page;
+        }
+    }
+    return nullptr;
 }
 
 zx_status_t pmm_add_arena(const pmm_arena_info_t* info) {
-    return pmm_node.AddArena(info);
+    if (info->node >= PMM_MAX_NUMA_NODES) {
+        return ZX_ERR_INVALID_ARGS;
+    }
+    if (info->node >= pmm_node_count) {
+        pmm_node_count = info->node + 1;
+    }
+    return pmm_nodes[info->node].AddArena(info);
+}
+
+uint pmm_numa_node_count() {
+    return pmm_node_count;
+}
+
+void pmm_set_cpu_numa_node(uint cpu, uint node) {
+    DEBUG_ASSERT(cpu < SMP_MAX_CPUS);
+
+    // a node without memory is no use to allocate from
+    cpu_numa_node[cpu] = static_cast<uint8_t>(node < pmm_node_count ? node : 0);
+}
+
+// |page| and |pa| may each be null if the caller doesn't want them
+static zx_status_t pmm_alloc_one(uint alloc_flags, vm_page_t** page, paddr_t* pa) {
+    vm_page_t* p;
+    zx_status_t status = pmm_for_each_node_from(pmm_preferred_node(alloc_flags), [&](uint node) {
+        return pmm_nodes[node].AllocPage(alloc_flags, &p, pa);
+    });
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    pmm_node_allocated(p->node, 1);
+    if (page) {
+        *page = p;
+    }
+    return ZX_OK;
 }
 
 zx_status_t pmm_alloc_page(uint alloc_flags, paddr_t* pa) {
-    return pmm_node.AllocPage(alloc_flags, nullptr, pa);
+    return pmm_alloc_one(alloc_flags, nullptr, pa);
 }
 
 zx_status_t pmm_alloc_page(uint alloc_flags, vm_page_t** page) {
-    return pmm_node.AllocPage(alloc_flags, page, nullptr);
+    return pmm_alloc_one(alloc_flags, page, nullptr);
 }
 
 zx_status_t pmm_alloc_page(uint alloc_flags, vm_page_t** page, paddr_t* pa) {
-    return pmm_node.AllocPage(alloc_flags, page, pa);
+    return pmm_alloc_one(alloc_flags, page, pa);
 }
 
 zx_status_t pmm_alloc_pages(size_t count, uint alloc_flags, list_node* list) {
-    return pmm_node.AllocPages(count, alloc_flags, list);
+    if (unlikely(count == 0)) {
+        return ZX_OK;
+    }
+
+    // a node frees everything on the list it is handed if it comes up short, so
+    // each attempt gets a list of its own
+    list_node pages = LIST_INITIAL_VALUE(pages);
+    uint preferred = pmm_preferred_node(alloc_flags);
+    uint found_node = 0;
+    zx_status_t status = pmm_for_each_node_from(preferred, [&](uint node) {
+        found_node = node;
+        return pmm_nodes[node].AllocPages(count, alloc_flags, &pages);
+    });
+    if (status == ZX_OK) {
+        pmm_node_allocated(found_node, count);
+        list_splice_after(&pages, list->prev);
+        return ZX_OK;
+    }
+    if (pmm_node_count == 1) {
+        return status;
+    }
+
+    // no one node can cover the whole request, piece it together from all of them
+    kcounter_add(pmm_node_remote[preferred], 1);
+
+    size_t remaining = count;
+    for (uint i = 0; i < pmm_node_count && remaining > 0; i++) {
+        uint node = (preferred + i) % pmm_node_count;
+        size_t n = fbl::min(remaining, static_cast<size_t>(pmm_nodes[node].CountFreePages()));
+        list_node node_pages = LIST_INITIAL_VALUE(node_pages);
+        if (n == 0 || pmm_nodes[node].AllocPages(n, alloc_flags, &node_pages) != ZX_OK) {
+            continue;
+        }
+        pmm_node_allocated(node, n);
+        list_splice_after(&node_pages, pages.prev);
+        remaining -= n;
+    }
+    if (remaining > 0) {
+        pmm_free(&pages);
+        return ZX_ERR_NO_MEMORY;
+    }
+
+    list_splice_after(&pages, list->prev);
+    return ZX_OK;
 }
 
 zx_status_t pmm_alloc_range(paddr_t address, size_t count, list_node* list) {
-    return pmm_node.AllocRange(address, count, list);
+    address = ROUNDDOWN(address, PAGE_SIZE);
+
+    // a range can straddle nodes, so take it a run of same node pages at a time
+    list_node pages = LIST_INITIAL_VALUE(pages);
+    while (count > 0) {
+        vm_page_t* first = paddr_to_vm_page(address);
+        if (!first) {
+            pmm_free(&pages);
+            return ZX_ERR_NOT_FOUND;
+        }
+
+        size_t run = 1;
+        while (run < count) {
+            vm_page_t* p = paddr_to_vm_page(address + run * PAGE_SIZE);
+            if (!p || p->node != first->node) {
+                break;
+            }
+            run++;
+        }
+
+        uint node = first->node;
+        list_node run_pages = LIST_INITIAL_VALUE(run_pages);
+        zx_status_t status = pmm_nodes[node].AllocRange(address, run, &run_pages);
+        if (status != ZX_OK) {
+            pmm_free(&pages);
+            return status;
+        }
+        pmm_node_allocated(node, run);
+        list_splice_after(&run_pages, pages.prev);
+
+        address += run * PAGE_SIZE;
+        count -= run;
+    }
+
+    list_splice_after(&pages, list->prev);
+    return ZX_OK;
 }
 
 zx_status_t pmm_alloc_contiguous(size_t count, uint alloc_flags, uint8_t alignment_log2, paddr_t* pa,
@@ -80,7 +288,7 @@ zx_status_t pmm_alloc_contiguous(size_t count, uint alloc_flags, uint8_t alignme
     // if we're called with a single page, just fall through to the regular allocation routine
     if (unlikely(count == 1 && alignment_log2 <= PAGE_SIZE_SHIFT)) {
         vm_page_t* page;
-        zx_status_t status = pmm_node.AllocPage(alloc_flags, &page, pa);
+        zx_status_t status = pmm_alloc_page(alloc_flags, &page, pa);
         if (status != ZX_OK) {
             return status;
         }
@@ -88,33 +296,82 @@ zx_status_t pmm_alloc_contiguous(size_t count, uint alloc_flags, uint8_t alignme
         return ZX_OK;
     }
 
-    return pmm_node.AllocContiguous(count, alloc_flags, alignment_log2, pa, list);
+    uint found_node = 0;
+    zx_status_t status = pmm_for_each_node_from(pmm_preferred_node(alloc_flags), [&](uint node) {
+        found_node = node;
+        return pmm_nodes[node].AllocContiguous(count, alloc_flags, alignment_log2, pa, list);
+    });
+    if (status == ZX_OK) {
+        pmm_node_allocated(found_node, count);
+    }
+    return status;
 }
 
 void pmm_free(list_node* list) {
-    pmm_node.FreeList(list);
+    if (list_is_empty(list)) {
+        return;
+    }
+
+    if (pmm_node_count == 1) {
+        pmm_node_freed(0, list_length(list));
+        pmm_nodes[0].FreeList(list);
+        return;
+    }
+
+    // sort the pages out by node, then hand each node its share in one go
+    list_node node_lists[PMM_MAX_NUMA_NODES];
+    size_t node_counts[PMM_MAX_NUMA_NODES] = {};
+    for (auto& l : node_lists) {
+        list_initialize(&l);
+    }
+
+    vm_page_t* page;
+    while ((page = list_remove_head_type(list, vm_page_t, queue_node)) != nullptr) {
+        list_add_tail(&node_lists[page->node], &page->queue_node);
+        node_counts[page->node]++;
+    }
+
+    for (uint i = 0; i < pmm_node_count; i++) {
+        if (node_counts[i]) {
+            pmm_node_freed(i, node_counts[i]);
+            pmm_nodes[i].FreeList(&node_lists[i]);
+        }
+    }
 }
 
 void pmm_free_page(vm_page* page) {
-    pmm_node.FreePage(page);
+    pmm_node_freed(page->node, 1);
+    pmm_nodes[page->node].FreePage(page);
 }
 
 uint64_t pmm_count_free_pages() {
-    return pmm_node.CountFreePages();
+    uint64_t count = 0;
+    for (uint i = 0; i < pmm_node_count; i++) {
+        count += pmm_nodes[i].CountFreePages();
+    }
+    return count;
 }
 
 uint64_t pmm_count_total_bytes() {
-    return pmm_node.CountTotalBytes();
+    uint64_t bytes = 0;
+    for (uint i = 0; i < pmm_node_count; i++) {
+        bytes += pmm_nodes[i].CountTotalBytes();
+    }
+    return bytes;
 }
 
 void pmm_count_total_states(size_t state_count[VM_PAGE_STATE_COUNT_]) {
-    pmm_node.CountTotalStates(state_count);
+    for (uint i = 0; i < pmm_node_count; i++) {
+        pmm_nodes[i].CountTotalStates(state_count);
+    }
 }
 
 static void pmm_dump_timer(struct timer* t, zx_time_t now, void*) {
     zx_time_t deadline = zx_time_add_duration(now, ZX_SEC(1));
     timer_set_oneshot(t, deadline, &pmm_dump_timer, nullptr);
-    pmm_node.DumpFree();
+    for (uint i = 0; i < pmm_node_count; i++) {
+        pmm_nodes[i].DumpFree();
+    }
 }
 
 static int cmd_pmm(int argc, const cmd_args* argv, uint32_t flags) {
@@ -132,7 +389,11 @@ static int cmd_pmm(int argc, const cmd_args* argv, uint32_t flags) {
     }
 
     if (!strcmp(argv[1].str, "dump")) {
-        pmm_node.Dump(is_panic);
+        for (uint i = 0; i < pmm_node_count; i++) {
+            printf("node %u: %" PRIu64 " pages in use\n", i,
+                   pmm_node_used[i].load(fbl::memory_order_relaxed));
+            pmm_nodes[i].Dump(is_panic);
+        }
     } else if (is_panic) {
         // No other operations will work during a panic.
         printf("Only the \"arenas\" command is available during a panic.\n");
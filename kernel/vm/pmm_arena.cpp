@@ -69,6 +69,7 @@ zx_status_t PmmArena::Init(const pmm_arena_info_t* info, PmmNode* node) {
         auto& p = page_array_[i];
 
         p.paddr_priv = base() + i * PAGE_SIZE;
+        p.node = info_.node;
         if (i >= array_start_index && i < array_end_index) {
             p.state = VM_PAGE_STATE_WIRED;
         } else {
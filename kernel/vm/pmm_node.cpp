@@ -5,8 +5,11 @@
 // https://opensource.org/licenses/MIT
 #include "pmm_node.h"
 
+#include <arch/ops.h>
 #include <inttypes.h>
 #include <kernel/mp.h>
+#include <kernel/thread.h>
+#include <lib/counters.h>
 #include <new>
 #include <trace.h>
 #include <vm/bootalloc.h>
@@ -16,14 +19,29 @@
 
 #define LOCAL_TRACE MAX(VM_GLOBAL_TRACE, 0)
 
-namespace {
-
-void set_state_alloc(vm_page* page) {
-    LTRACEF("page %p: prev state %s\n", page, page_state_to_string(page->state));
+KCOUNTER(pmm_cache_alloc_hit, "kernel.pmm.cache.alloc_hit");
+KCOUNTER(pmm_cache_alloc_miss, "kernel.pmm.cache.alloc_miss");
+KCOUNTER(pmm_cache_free_hit, "kernel.pmm.cache.free_hit");
+KCOUNTER(pmm_cache_free_spill, "kernel.pmm.cache.free_spill");
+KCOUNTER(pmm_cache_drain, "kernel.pmm.cache.drain");
+KCOUNTER(pmm_zero_background, "kernel.pmm.zero.background");
+KCOUNTER(pmm_zero_prezeroed, "kernel.pmm.zero.prezeroed_alloc");
+KCOUNTER(pmm_zero_sync, "kernel.pmm.zero.sync_alloc");
 
-    DEBUG_ASSERT(page->state == VM_PAGE_STATE_FREE);
+namespace {
 
-    page->state = VM_PAGE_STATE_ALLOC;
+// a page just allocated with |alloc_flags|: zero it if the caller asked for that and
+// the zero thread didn't get to it first
+void prepare_page(vm_page* page, uint alloc_flags) {
+    if (alloc_flags & PMM_ALLOC_FLAG_ZERO) {
+        if (page->flags & VM_PAGE_FLAG_ZEROED) {
+            kcounter_add(pmm_zero_prezeroed, 1);
+        } else {
+            kcounter_add(pmm_zero_sync, 1);
+            arch_zero_page(paddr_to_physmap(page->paddr()));
+        }
+    }
+    page->flags &= ~VM_PAGE_FLAG_ZEROED;
 }
 
 } // namespace
@@ -91,25 +109,152 @@ void PmmNode::AddFreePages(list_node* list) TA_NO_THREAD_SAFETY_ANALYSIS {
     LTRACEF("free count now %" PRIu64 "\n", free_count_);
 }
 
-zx_status_t PmmNode::AllocPage(uint alloc_flags, vm_page_t** page_out, paddr_t* pa_out) {
+void PmmNode::AddToFreeListLocked(vm_page* page) {
+    page->state = VM_PAGE_STATE_FREE;
+    if (page->flags & VM_PAGE_FLAG_ZEROED) {
+        list_add_head(&zeroed_list_, &page->queue_node);
+        zeroed_count_++;
+    } else {
+        list_add_head(&free_list_, &page->queue_node);
+        if (zero_thread_idle_) {
+            zero_thread_idle_ = false;
+            event_signal(&zero_event_, false);
+        }
+    }
+    free_count_++;
+}
+
+void PmmNode::RemoveFromFreeListLocked(vm_page* page) {
+    DEBUG_ASSERT(page->is_free());
+    DEBUG_ASSERT(free_count_ > 0);
+
+    list_delete(&page->queue_node);
+    free_count_--;
+    if (page->flags & VM_PAGE_FLAG_ZEROED) {
+        DEBUG_ASSERT(zeroed_count_ > 0);
+        zeroed_count_--;
+    }
+    page->state = VM_PAGE_STATE_ALLOC;
+}
+
+// take a free page, from the zeroed queue if |zeroed| and the other queue otherwise,
+// falling back to whichever has pages. the page keeps VM_PAGE_FLAG_ZEROED if it has it.
+vm_page* PmmNode::TakeFreePageLocked(bool zeroed) {
+    list_node* first = zeroed ? &zeroed_list_ : &free_list_;
+    list_node* second = zeroed ? &free_list_ : &zeroed_list_;
+
+    vm_page* page = list_peek_head_type(first, vm_page, queue_node);
+    if (!page) {
+        page = list_peek_head_type(second, vm_page, queue_node);
+        if (!page) {
+            return nullptr;
+        }
+    }
+    RemoveFromFreeListLocked(page);
+    return page;
+}
+
+// pop a page off the current cpu's caches, if they have any. a zeroed page will do for
+// any allocation, and a plain one can be cleared for a zeroed allocation, so either cache
+// serves either kind, each kind trying its own cache first.
+vm_page* PmmNode::AllocPageFromCache(bool zeroed) {
+    if (zeroed) {
+        vm_page* page = zeroed_cache_.Get();
+        return page ? page : cache_.Get();
+    }
+    vm_page* page = cache_.Get();
+    return page ? page : zeroed_cache_.Get();
+}
+
+// take a page off the free list for the caller, and restock the current cpu's cache
+// with a batch more so the next few allocations here don't need lock_
+vm_page* PmmNode::AllocPageRefillCache(bool zeroed) {
     Guard<fbl::Mutex> guard{&lock_};
 
-    vm_page* page = list_remove_head_type(&free_list_, vm_page, queue_node);
+    if (free_count_ == 0) {
+        // the free pages may all be sitting in other cpus' caches
+        DrainCachesLocked();
+    }
+
+    vm_page* page = TakeFreePageLocked(zeroed);
     if (!page) {
-        return ZX_ERR_NO_MEMORY;
+        return nullptr;
     }
 
-    DEBUG_ASSERT(free_count_ > 0);
-    free_count_--;
+    vm_page* batch[kCacheBatch];
+    size_t count = 0;
+    if (zeroed) {
+        // only restock with pages that really are zeroed, or the next allocation
+        // would have to clear them itself anyway
+        while (count < kCacheBatch) {
+            vm_page* p = list_peek_head_type(&zeroed_list_, vm_page, queue_node);
+            if (!p) {
+                break;
+            }
+            RemoveFromFreeListLocked(p);
+            batch[count++] = p;
+        }
+        if (count > 0) {
+            count = zeroed_cache_.Fill(batch, count);
+            while (count > 0) {
+                AddToFreeListLocked(batch[--count]);
+            }
+            return page;
+        }
+    }
 
-    DEBUG_ASSERT(page->is_free());
+    // with nothing zeroed to hand, plain pages at least keep the next few
+    // allocations off lock_
+    while (count < kCacheBatch) {
+        vm_page* p = TakeFreePageLocked(false);
+        if (!p) {
+            break;
+        }
+        batch[count++] = p;
+    }
+    // another thread on this cpu may have restocked the cache meanwhile
+    count = cache_.Fill(batch, count);
+    while (count > 0) {
+        AddToFreeListLocked(batch[--count]);
+    }
 
-    set_state_alloc(page);
+    return page;
+}
+
+// return every page sitting in a cpu cache to the free list
+void PmmNode::DrainCachesLocked() {
+    kcounter_add(pmm_cache_drain, 1);
+
+    auto free_page = [this](vm_page* page) TA_NO_THREAD_SAFETY_ANALYSIS {
+        DEBUG_ASSERT(page->state == VM_PAGE_STATE_ALLOC);
+        AddToFreeListLocked(page);
+    };
+    cache_.Drain(free_page);
+    zeroed_cache_.Drain(free_page);
+}
+
+zx_status_t PmmNode::AllocPage(uint alloc_flags, vm_page_t** page_out, paddr_t* pa_out) {
+    const bool zeroed = alloc_flags & PMM_ALLOC_FLAG_ZERO;
+
+    vm_page* page = AllocPageFromCache(zeroed);
+    if (likely(page)) {
+        kcounter_add(pmm_cache_alloc_hit, 1);
+    } else {
+        kcounter_add(pmm_cache_alloc_miss, 1);
+        page = AllocPageRefillCache(zeroed);
+        if (!page) {
+            return ZX_ERR_NO_MEMORY;
+        }
+    }
+
+    DEBUG_ASSERT(page->state == VM_PAGE_STATE_ALLOC);
 
 #if PMM_ENABLE_FREE_FILL
     CheckFreeFill(page);
 #endif
 
+    prepare_page(page, alloc_flags);
+
     if (pa_out) {
         *pa_out = page->paddr();
     }
@@ -133,32 +278,42 @@ zx_status_t PmmNode::AllocPages(size_t count, uint alloc_flags, list_node* list)
         return ZX_OK;
     }
 
-    Guard<fbl::Mutex> guard{&lock_};
+    const bool zeroed = alloc_flags & PMM_ALLOC_FLAG_ZERO;
+    list_node pages = LIST_INITIAL_VALUE(pages);
+    {
+        Guard<fbl::Mutex> guard{&lock_};
 
-    while (count > 0) {
-        vm_page* page = list_remove_head_type(&free_list_, vm_page, queue_node);
-        if (unlikely(!page)) {
-            // free pages that have already been allocated
-            FreeListLocked(list);
-            return ZX_ERR_NO_MEMORY;
+        if (free_count_ < count) {
+            // make up the shortfall from the cpu caches, if they can
+            DrainCachesLocked();
         }
 
-        LTRACEF("allocating page %p, pa %#" PRIxPTR "\n", page, page->paddr());
-
-        DEBUG_ASSERT(free_count_ > 0);
+        while (count > 0) {
+            vm_page* page = TakeFreePageLocked(zeroed);
+            if (unlikely(!page)) {
+                // free pages that have already been allocated
+                FreeListLocked(&pages);
+                return ZX_ERR_NO_MEMORY;
+            }
 
-        free_count_--;
+            LTRACEF("allocating page %p, pa %#" PRIxPTR "\n", page, page->paddr());
 
-        DEBUG_ASSERT(page->is_free());
 #if PMM_ENABLE_FREE_FILL
-        CheckFreeFill(page);
+            CheckFreeFill(page);
 #endif
 
-        page->state = VM_PAGE_STATE_ALLOC;
-        list_add_tail(list, &page->queue_node);
+            list_add_tail(&pages, &page->queue_node);
+
+            count--;
+        }
+    }
 
-        count--;
+    // clear whatever still needs it outside of lock_
+    vm_page* page;
+    list_for_every_entry (&pages, page, vm_page, queue_node) {
+        prepare_page(page, alloc_flags);
     }
+    list_splice_after(&pages, list->prev);
 
     return ZX_OK;
 }
@@ -178,6 +333,9 @@ zx_status_t PmmNode::AllocRange(paddr_t address, size_t count, list_node* list)
 
     Guard<fbl::Mutex> guard{&lock_};
 
+    // pages in the cpu caches aren't free as far as the arenas are concerned, put them back
+    DrainCachesLocked();
+
     // walk through the arenas, looking to see if the physical page belongs to it
     for (auto& a : arena_list_) {
         while (allocated < count && a.address_in_arena(address)) {
@@ -190,15 +348,13 @@ zx_status_t PmmNode::AllocRange(paddr_t address, size_t count, list_node* list)
                 break;
             }
 
-            list_delete(&page->queue_node);
-
-            page->state = VM_PAGE_STATE_ALLOC;
+            RemoveFromFreeListLocked(page);
+            page->flags &= ~VM_PAGE_FLAG_ZEROED;
 
             list_add_tail(list, &page->queue_node);
 
             allocated++;
             address += PAGE_SIZE;
-            free_count_--;
         }
 
         if (allocated == count) {
@@ -230,27 +386,31 @@ zx_status_t PmmNode::AllocContiguous(const size_t count, uint alloc_flags, uint8
     DEBUG_ASSERT(pa);
     DEBUG_ASSERT(list);
 
-    Guard<fbl::Mutex> guard{&lock_};
+    vm_page_t* run = nullptr;
+    {
+        Guard<fbl::Mutex> guard{&lock_};
 
-    for (auto& a : arena_list_) {
-        vm_page_t* p = a.FindFreeContiguous(count, alignment_log2);
-        if (!p) {
-            continue;
-        }
+        // pages in the cpu caches aren't free as far as the arenas are concerned, put them back
+        DrainCachesLocked();
 
-        *pa = p->paddr();
+        for (auto& a : arena_list_) {
+            run = a.FindFreeContiguous(count, alignment_log2);
+            if (run) {
+                break;
+            }
+        }
+        if (!run) {
+            LTRACEF("couldn't find run\n");
+            return ZX_ERR_NOT_FOUND;
+        }
 
         // remove the pages from the run out of the free list
+        vm_page_t* p = run;
         for (size_t i = 0; i < count; i++, p++) {
             DEBUG_ASSERT_MSG(p->is_free(), "p %p state %u\n", p, p->state);
             DEBUG_ASSERT(list_in_list(&p->queue_node));
 
-            list_delete(&p->queue_node);
-            p->state = VM_PAGE_STATE_ALLOC;
-
-            DEBUG_ASSERT(free_count_ > 0);
-
-            free_count_--;
+            RemoveFromFreeListLocked(p);
 
 #if PMM_ENABLE_FREE_FILL
             CheckFreeFill(p);
@@ -258,12 +418,15 @@ zx_status_t PmmNode::AllocContiguous(const size_t count, uint alloc_flags, uint8
 
             list_add_tail(list, &p->queue_node);
         }
+    }
 
-        return ZX_OK;
+    // runs can be large, so do any zeroing after dropping the lock
+    for (size_t i = 0; i < count; i++) {
+        prepare_page(&run[i], alloc_flags);
     }
 
-    LTRACEF("couldn't find run\n");
-    return ZX_ERR_NOT_FOUND;
+    *pa = run->paddr();
+    return ZX_OK;
 }
 
 void PmmNode::FreePageLocked(vm_page* page) {
@@ -281,19 +444,44 @@ void PmmNode::FreePageLocked(vm_page* page) {
         list_delete(&page->queue_node);
     }
 
-    // mark it free
-    page->state = VM_PAGE_STATE_FREE;
-
-    // add it to the free queue
-    list_add_head(&free_list_, &page->queue_node);
-
-    free_count_++;
+    // add it to the free queue, whatever it holds now
+    page->flags &= ~VM_PAGE_FLAG_ZEROED;
+    AddToFreeListLocked(page);
 }
 
 void PmmNode::FreePage(vm_page* page) {
+    LTRACEF("page %p state %u paddr %#" PRIxPTR "\n", page, page->state, page->paddr());
+
+    DEBUG_ASSERT(page->state != VM_PAGE_STATE_OBJECT || page->object.pin_count == 0);
+    DEBUG_ASSERT(!page->is_free());
+
+#if PMM_ENABLE_FREE_FILL
+    FreeFill(page);
+#endif
+
+    // remove it from its old queue
+    if (list_in_list(&page->queue_node)) {
+        list_delete(&page->queue_node);
+    }
+
+    // it stays allocated to the cache until it goes back to the free list
+    page->state = VM_PAGE_STATE_ALLOC;
+    page->flags &= ~VM_PAGE_FLAG_ZEROED;
+
+    // stash it in the current cpu's cache. if that overflows the cache, hand the
+    // oldest batch back to the free list
+    vm_page* spill[kCacheBatch];
+    if (likely(!cache_.Put(page, spill))) {
+        kcounter_add(pmm_cache_free_hit, 1);
+        return;
+    }
+    kcounter_add(pmm_cache_free_spill, 1);
+
     Guard<fbl::Mutex> guard{&lock_};
 
-    FreePageLocked(page);
+    for (vm_page* p : spill) {
+        AddToFreeListLocked(p);
+    }
 }
 
 void PmmNode::FreeListLocked(list_node* list) {
@@ -312,9 +500,74 @@ void PmmNode::FreeList(list_node* list) {
     FreeListLocked(list);
 }
 
+// Zero a batch of pages from free_list_ and move them to zeroed_list_. The pages are
+// held in the ALLOC state while they're cleared, outside of lock_. Returns how many
+// were zeroed, 0 once free_list_ is empty.
+size_t PmmNode::ZeroPages() {
+    list_node batch = LIST_INITIAL_VALUE(batch);
+    size_t count = 0;
+    {
+        Guard<fbl::Mutex> guard{&lock_};
+
+        while (count < kZeroBatch) {
+            vm_page* page = list_peek_head_type(&free_list_, vm_page, queue_node);
+            if (!page) {
+                break;
+            }
+            RemoveFromFreeListLocked(page);
+            list_add_tail(&batch, &page->queue_node);
+            count++;
+        }
+        if (count == 0) {
+            // sleep until a page is freed
+            zero_thread_idle_ = true;
+            return 0;
+        }
+    }
+
+    vm_page* page;
+    list_for_every_entry (&batch, page, vm_page, queue_node) {
+        arch_zero_page(paddr_to_physmap(page->paddr()));
+        page->flags |= VM_PAGE_FLAG_ZEROED;
+    }
+
+    Guard<fbl::Mutex> guard{&lock_};
+    while ((page = list_remove_head_type(&batch, vm_page, queue_node)) != nullptr) {
+        AddToFreeListLocked(page);
+    }
+    kcounter_add(pmm_zero_background, count);
+
+    return count;
+}
+
+int PmmNode::ZeroThread(void* arg) {
+    PmmNode* node = static_cast<PmmNode*>(arg);
+
+    for (;;) {
+        if (node->ZeroPages() == 0) {
+            event_wait(&node->zero_event_);
+        }
+    }
+    return 0;
+}
+
+void PmmNode::StartZeroThread(const char* name) {
+    // zeroing would undo the fill pattern that free fill checks for
+#if !PMM_ENABLE_FREE_FILL
+    // run at the lowest priority, so pages are only zeroed on cpus with nothing
+    // better to do
+    thread_t* t = thread_create(name, &PmmNode::ZeroThread, this, LOWEST_PRIORITY);
+    if (!t) {
+        printf("PMM: failed to create %s thread\n", name);
+        return;
+    }
+    thread_detach_and_resume(t);
+#endif
+}
+
 // okay if accessed outside of a lock
 uint64_t PmmNode::CountFreePages() const TA_NO_THREAD_SAFETY_ANALYSIS {
-    return free_count_;
+    return free_count_ + cache_.CachedCount() + zeroed_cache_.CachedCount();
 }
 
 uint64_t PmmNode::CountTotalBytes() const TA_NO_THREAD_SAFETY_ANALYSIS {
@@ -338,8 +591,11 @@ void PmmNode::DumpFree() const TA_NO_THREAD_SAFETY_ANALYSIS {
 void PmmNode::Dump(bool is_panic) const {
     // No lock analysis here, as we want to just go for it in the panic case without the lock.
     auto dump = [this]() TA_NO_THREAD_SAFETY_ANALYSIS {
-        printf("pmm node %p: free_count %zu (%zu bytes), total size %zu\n",
-               this, free_count_, free_count_ * PAGE_SIZE, arena_cumulative_size_);
+        uint64_t free_count = CountFreePages();
+        printf("pmm node %p: free_count %zu (%zu bytes, %zu in cpu caches, %zu zeroed), "
+               "total size %zu\n",
+               this, free_count, free_count * PAGE_SIZE, free_count - free_count_,
+               zeroed_count_, arena_cumulative_size_);
         for (auto& a : arena_list_) {
             a.Dump(false, false);
         }
@@ -357,10 +613,19 @@ void PmmNode::Dump(bool is_panic) const {
 void PmmNode::EnforceFill() {
     DEBUG_ASSERT(!enforce_fill_);
 
+    DrainCachesLocked();
+
     vm_page* page;
     list_for_every_entry (&free_list_, page, vm_page, queue_node) {
         FreeFill(page);
     }
+    // the fill makes these pages anything but zero
+    while ((page = list_remove_head_type(&zeroed_list_, vm_page, queue_node)) != nullptr) {
+        page->flags &= ~VM_PAGE_FLAG_ZEROED;
+        FreeFill(page);
+        list_add_head(&free_list_, &page->queue_node);
+    }
+    zeroed_count_ = 0;
 
     enforce_fill_ = true;
 }
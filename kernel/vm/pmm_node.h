@@ -9,6 +9,8 @@
 #include <fbl/intrusive_double_list.h>
 #include <fbl/mutex.h>
 
+#include <kernel/cpu_magazine.h>
+#include <kernel/event.h>
 #include <kernel/lockdep.h>
 #include <vm/pmm.h>
 
@@ -55,26 +57,61 @@ public:
     // add new pages to the free queue. used when boostrapping a PmmArena
     void AddFreePages(list_node* list);
 
+    // start the thread that zeroes free pages in the background
+    void StartZeroThread(const char* name);
+
 private:
     void FreePageLocked(vm_page* page) TA_REQ(lock_);
     void FreeListLocked(list_node* list) TA_REQ(lock_);
 
+    // move pages on and off the free queues, keeping the counts in step
+    void AddToFreeListLocked(vm_page* page) TA_REQ(lock_);
+    void RemoveFromFreeListLocked(vm_page* page) TA_REQ(lock_);
+    vm_page* TakeFreePageLocked(bool zeroed) TA_REQ(lock_);
+
+    vm_page* AllocPageFromCache(bool zeroed);
+    vm_page* AllocPageRefillCache(bool zeroed);
+    void DrainCachesLocked() TA_REQ(lock_);
+
+    static int ZeroThread(void* arg);
+    size_t ZeroPages();
+
     fbl::Canary<fbl::magic("PNOD")> canary_;
 
     mutable DECLARE_MUTEX(PmmNode) lock_;
 
     uint64_t arena_cumulative_size_ TA_GUARDED(lock_) = 0;
+    // free pages, zeroed or not
     uint64_t free_count_ TA_GUARDED(lock_) = 0;
+    uint64_t zeroed_count_ TA_GUARDED(lock_) = 0;
 
     fbl::DoublyLinkedList<PmmArena*> arena_list_ TA_GUARDED(lock_);
 
     // page queues
     list_node free_list_ TA_GUARDED(lock_) = LIST_INITIAL_VALUE(free_list_);
+    // free pages the zero thread has already cleared, for PMM_ALLOC_FLAG_ZERO
+    list_node zeroed_list_ TA_GUARDED(lock_) = LIST_INITIAL_VALUE(zeroed_list_);
     list_node inactive_list_ TA_GUARDED(lock_) = LIST_INITIAL_VALUE(inactive_list_);
     list_node active_list_ TA_GUARDED(lock_) = LIST_INITIAL_VALUE(active_list_);
     list_node modified_list_ TA_GUARDED(lock_) = LIST_INITIAL_VALUE(modified_list_);
     list_node wired_list_ TA_GUARDED(lock_) = LIST_INITIAL_VALUE(wired_list_);
 
+    // per cpu caches of free pages, so most single page allocations and frees stay off
+    // lock_. pages move between a cache and free_list_ in batches of kCacheBatch. cached
+    // pages are left in the ALLOC state so that AllocRange() and AllocContiguous() pass
+    // over them, and are not counted in free_count_.
+    static constexpr size_t kCacheBatch = 32;
+    CpuMagazines<vm_page, kCacheBatch> cache_;
+    // pages taken off zeroed_list_, kept apart for PMM_ALLOC_FLAG_ZERO. only ever
+    // restocked, never freed into, so one batch is enough.
+    CpuMagazines<vm_page, kCacheBatch, kCacheBatch> zeroed_cache_;
+
+    // the zero thread waits on this while free_list_ is empty
+    event_t zero_event_ = EVENT_INITIAL_VALUE(zero_event_, false, EVENT_FLAG_AUTOUNSIGNAL);
+    bool zero_thread_idle_ TA_GUARDED(lock_) = false;
+    // pages the zero thread takes off free_list_ at a time
+    static constexpr size_t kZeroBatch = 16;
+
 #if PMM_ENABLE_FREE_FILL
     void FreeFill(vm_page_t* page);
     void CheckFreeFill(vm_page_t* page);
@@ -13,11 +13,13 @@ MODULE_DEPS += \
     kernel/lib/fbl \
     kernel/lib/pretty \
     kernel/lib/user_copy \
-    third_party/lib/cryptolib
+    third_party/lib/cryptolib \
+    third_party/lib/lz4
 
 MODULE_SRCS += \
     $(LOCAL_DIR)/bootalloc.cpp \
     $(LOCAL_DIR)/bootreserve.cpp \
+    $(LOCAL_DIR)/compression.cpp \
     $(LOCAL_DIR)/kstack.cpp \
     $(LOCAL_DIR)/page.cpp \
     $(LOCAL_DIR)/page_source.cpp \
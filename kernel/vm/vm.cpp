@@ -12,12 +12,15 @@
 #include <err.h>
 #include <fbl/algorithm.h>
 #include <inttypes.h>
+#include <kernel/cmdline.h>
 #include <kernel/thread.h>
 #include <lib/console.h>
 #include <lib/crypto/global_prng.h>
+#include <pow2.h>
 #include <string.h>
 #include <trace.h>
 #include <vm/bootalloc.h>
+#include <vm/compression.h>
 #include <vm/init.h>
 #include <vm/physmap.h>
 #include <vm/pmm.h>
@@ -31,6 +34,12 @@
 vm_page_t* zero_page;
 paddr_t zero_page_paddr;
 
+// set from the kernel command line in vm_init()
+bool large_pages_enabled;
+size_t fault_around_pages;
+bool fault_around_commit;
+uint64_t pager_read_ahead_pages = 1;
+
 // set early in arch code to record the start address of the kernel
 paddr_t kernel_base_phys;
 
@@ -169,6 +178,17 @@ void vm_init() {
     // reserve the kernel aspace where the physmap is
     aspace->ReserveSpace("physmap", PHYSMAP_SIZE, PHYSMAP_BASE);
 
+    // Be sure to update kernel_cmdline.md if this default changes.
+    large_pages_enabled = cmdline_get_bool("kernel.vm.large-pages", false);
+
+    // Be sure to update kernel_cmdline.md if these defaults change.
+    uint32_t around = cmdline_get_uint32("kernel.vm.fault-around", 16);
+    around = fbl::min<uint32_t>(around, VM_FAULT_AROUND_MAX_PAGES);
+    fault_around_pages = around ? (1u << log2_uint_floor(around)) : 0;
+    fault_around_commit = cmdline_get_bool("kernel.vm.fault-around-commit", false);
+    pager_read_ahead_pages = fbl::max<uint64_t>(
+        cmdline_get_uint64("kernel.vm.pager-read-ahead", 32), 1);
+
 #if !DISABLE_KASLR // Disable random memory padding for KASLR
     // Reserve random padding of up to 64GB after first mapping. It will make
     // the adjacent memory mappings (kstack_vmar, arena:handles and others) at
@@ -212,6 +232,8 @@ static int cmd_vm(int argc, const cmd_args* argv, uint32_t flags) {
         printf("%s virt2phys <address>\n", argv[0].str);
         printf("%s map <phys> <virt> <count> <flags>\n", argv[0].str);
         printf("%s unmap <virt> <count>\n", argv[0].str);
+        printf("%s reclaim <pages> [<min age>]\n", argv[0].str);
+        printf("%s compression\n", argv[0].str);
         return ZX_ERR_INTERNAL;
     }
 
@@ -275,6 +297,21 @@ static int cmd_vm(int argc, const cmd_args* argv, uint32_t flags) {
         size_t unmapped;
         auto err = aspace->arch_aspace().Unmap(argv[2].u, (uint)argv[3].u, &unmapped);
         printf("arch_mmu_unmap returns %d, unmapped %zu\n", err, unmapped);
+    } else if (!strcmp(argv[1].str, "reclaim")) {
+        if (argc < 3) {
+            goto notenoughargs;
+        }
+
+        uint min_age = argc > 3 ? (uint)argv[3].u : VM_PAGE_OBJECT_MAX_AGE;
+        if (min_age > VM_PAGE_OBJECT_MAX_AGE) {
+            printf("min age must be at most %u\n", VM_PAGE_OBJECT_MAX_AGE);
+            return ZX_ERR_INVALID_ARGS;
+        }
+        size_t reclaimed = vm_reclaim_pages(argv[2].u, min_age);
+        printf("reclaimed %zu pages\n", reclaimed);
+        vm_compression_dump();
+    } else if (!strcmp(argv[1].str, "compression")) {
+        vm_compression_dump();
     } else {
         printf("unknown command\n");
         goto usage;
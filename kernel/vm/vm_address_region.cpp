@@ -142,8 +142,18 @@ zx_status_t VmAddressRegion::CreateSubVmarInternal(size_t offset, size_t size, u
             return ZX_ERR_NO_MEMORY;
         }
     } else {
-        // If we're not mapping to a specific place, search for an opening.
-        zx_status_t status = AllocSpotLocked(size, align_pow2, arch_mmu_flags, &new_base);
+        // If we're not mapping to a specific place, search for an opening.  Mappings
+        // that can hold whole large pages get a large page aligned spot if there is
+        // one, otherwise the mmu could never use large pages for them.
+        zx_status_t status = ZX_ERR_NO_MEMORY;
+        if (vmo && vm_large_pages_enabled() && align_pow2 < VM_LARGE_PAGE_SHIFT &&
+            size >= VM_LARGE_PAGE_SIZE && IS_ALIGNED(vmo_offset, VM_LARGE_PAGE_SIZE) &&
+            !(arch_mmu_flags & ARCH_MMU_FLAG_PERM_EXECUTE)) {
+            status = AllocSpotLocked(size, VM_LARGE_PAGE_SHIFT, arch_mmu_flags, &new_base);
+        }
+        if (status != ZX_OK) {
+            status = AllocSpotLocked(size, align_pow2, arch_mmu_flags, &new_base);
+        }
         if (status != ZX_OK) {
             return status;
         }
@@ -378,14 +388,14 @@ size_t VmAddressRegion::AllocatedPagesLocked() const {
     return sum;
 }
 
-zx_status_t VmAddressRegion::PageFault(vaddr_t va, uint pf_flags) {
+zx_status_t VmAddressRegion::PageFault(vaddr_t va, uint pf_flags, PageRequest* page_request) {
     canary_.Assert();
     DEBUG_ASSERT(aspace_->lock()->lock().IsHeld());
 
     auto vmar = WrapRefPtr(this);
     while (auto next = vmar->FindRegionLocked(va)) {
         if (next->is_mapping()) {
-            return next->PageFault(va, pf_flags);
+            return next->PageFault(va, pf_flags, page_request);
         }
         vmar = next->as_vm_address_region();
     }
@@ -25,6 +25,7 @@
 #include <string.h>
 #include <trace.h>
 #include <vm/fault.h>
+#include <vm/page_source.h>
 #include <vm/vm.h>
 #include <vm/vm_address_region.h>
 #include <vm/vm_object.h>
@@ -555,7 +556,31 @@ zx_status_t VmAspace::PageFault(vaddr_t va, uint flags) {
     // the region out from underneath it
     Guard<fbl::Mutex> guard{&lock_};
 
-    return root_vmar_->PageFault(va, flags);
+    page_faults_++;
+
+    // a page that has to come from a pager is waited for with the lock
+    // dropped, after which the whole fault is taken again
+    PageRequest page_request;
+    zx_status_t status;
+    while ((status = root_vmar_->PageFault(va, flags, &page_request)) == ZX_ERR_SHOULD_WAIT) {
+        guard.CallUnlocked([&status, &page_request]() { status = page_request.Wait(); });
+        if (status != ZX_OK) {
+            break;
+        }
+        if (aspace_destroyed_) {
+            status = ZX_ERR_NOT_FOUND;
+            break;
+        }
+    }
+    return status;
+}
+
+void VmAspace::GetFaultStats(fault_stats_t* stats) const {
+    canary_.Assert();
+
+    Guard<fbl::Mutex> guard{&lock_};
+    stats->faults = page_faults_;
+    stats->fault_around_pages = fault_around_pages_;
 }
 
 void VmAspace::Dump(bool verbose) const {
@@ -565,6 +590,8 @@ void VmAspace::Dump(bool verbose) const {
 
     Guard<fbl::Mutex> guard{&lock_};
 
+    printf("  faults %zu, fault-around pages %zu\n", page_faults_, fault_around_pages_);
+
     if (verbose) {
         root_vmar_->Dump(1, verbose);
     }
@@ -13,6 +13,7 @@
 #include <fbl/auto_call.h>
 #include <ktl/move.h>
 #include <inttypes.h>
+#include <lib/counters.h>
 #include <trace.h>
 #include <vm/fault.h>
 #include <vm/vm.h>
@@ -22,6 +23,9 @@
 
 #define LOCAL_TRACE MAX(VM_GLOBAL_TRACE, 0)
 
+KCOUNTER(vm_large_page_map, "kernel.vm.large_page.map");
+KCOUNTER(vm_fault_around_mapped, "kernel.vm.fault_around.pages");
+
 VmMapping::VmMapping(VmAddressRegion& parent, vaddr_t base, size_t size, uint32_t vmar_flags,
                      fbl::RefPtr<VmObject> vmo, uint64_t vmo_offset, uint arch_mmu_flags)
     : VmAddressRegionOrMapping(base, size, vmar_flags,
@@ -392,7 +396,7 @@ namespace {
 
 class VmMappingCoalescer {
 public:
-    VmMappingCoalescer(VmMapping* mapping, vaddr_t base);
+    VmMappingCoalescer(VmMapping* mapping, vaddr_t base, uint mmu_flags);
     ~VmMappingCoalescer();
 
     // Add a page to the mapping run.  If this fails, the VmMappingCoalescer is
@@ -427,13 +431,14 @@ private:
 
     VmMapping* mapping_;
     vaddr_t base_;
+    uint mmu_flags_;
     paddr_t phys_[16];
     size_t count_;
     bool aborted_;
 };
 
-VmMappingCoalescer::VmMappingCoalescer(VmMapping* mapping, vaddr_t base)
-    : mapping_(mapping), base_(base), count_(0), aborted_(false) {}
+VmMappingCoalescer::VmMappingCoalescer(VmMapping* mapping, vaddr_t base, uint mmu_flags)
+    : mapping_(mapping), base_(base), mmu_flags_(mmu_flags), count_(0), aborted_(false) {}
 
 VmMappingCoalescer::~VmMappingCoalescer() {
     // Make sure we've flushed or aborted
@@ -445,10 +450,9 @@ zx_status_t VmMappingCoalescer::Flush() {
         return ZX_OK;
     }
 
-    uint flags = mapping_->arch_mmu_flags();
-    if (flags & ARCH_MMU_FLAG_PERM_RWX_MASK) {
+    if (mmu_flags_ & ARCH_MMU_FLAG_PERM_RWX_MASK) {
         size_t mapped;
-        zx_status_t ret = mapping_->aspace()->arch_aspace().Map(base_, phys_, count_, flags,
+        zx_status_t ret = mapping_->aspace()->arch_aspace().Map(base_, phys_, count_, mmu_flags_,
                                                                 &mapped);
         if (ret != ZX_OK) {
             TRACEF("error %d mapping %zu pages starting at va %#" PRIxPTR "\n", ret, count_, base_);
@@ -485,10 +489,12 @@ zx_status_t VmMapping::MapRange(size_t offset, size_t len, bool commit) {
     }
 
     // precompute the flags we'll pass GetPageLocked
-    // if committing, then tell it to soft fault in a page
+    // if committing, then tell it to soft fault in a page, otherwise only map what's there
     uint pf_flags = VMM_PF_FLAG_WRITE;
     if (commit) {
         pf_flags |= VMM_PF_FLAG_SW_FAULT;
+    } else {
+        pf_flags |= VMM_PF_FLAG_SPECULATIVE;
     }
 
     // grab the lock for the vmo
@@ -502,13 +508,27 @@ zx_status_t VmMapping::MapRange(size_t offset, size_t len, bool commit) {
     // iterate through the range, grabbing a page from the underlying object and
     // mapping it in
     size_t o;
-    VmMappingCoalescer coalescer(this, base_ + offset);
+    VmMappingCoalescer coalescer(this, base_ + offset, arch_mmu_flags_);
     for (o = offset; o < offset + len; o += PAGE_SIZE) {
         uint64_t vmo_offset = object_offset_ + o;
+        vaddr_t va = base_ + o;
+
+        // whole blocks the object can back with a large page get mapped as one
+        uint64_t block_offset;
+        if (IS_ALIGNED(va, VM_LARGE_PAGE_SIZE) && offset + len - o >= VM_LARGE_PAGE_SIZE &&
+            LargePageBlock(va, &block_offset)) {
+            if (commit) {
+                object_->CommitLargePageLocked(block_offset);
+            }
+            if (MapLargePageLocked(va, block_offset, arch_mmu_flags_)) {
+                o += VM_LARGE_PAGE_SIZE - PAGE_SIZE;
+                continue;
+            }
+        }
 
         zx_status_t status;
         paddr_t pa;
-        status = object_->GetPageLocked(vmo_offset, pf_flags, nullptr, nullptr, &pa);
+        status = object_->GetPageLocked(vmo_offset, pf_flags, nullptr, nullptr, nullptr, &pa);
         if (status != ZX_OK) {
             // no page to map
             if (commit) {
@@ -521,7 +541,6 @@ zx_status_t VmMapping::MapRange(size_t offset, size_t len, bool commit) {
             continue;
         }
 
-        vaddr_t va = base_ + o;
         LTRACEF_LEVEL(2, "mapping pa %#" PRIxPTR " to va %#" PRIxPTR "\n", pa, va);
         status = coalescer.Append(va, pa);
         if (status != ZX_OK) {
@@ -597,7 +616,144 @@ zx_status_t VmMapping::DestroyLocked() {
     return ZX_OK;
 }
 
-zx_status_t VmMapping::PageFault(vaddr_t va, const uint pf_flags) {
+bool VmMapping::LargePageBlock(vaddr_t block_va, uint64_t* vmo_offset) const {
+    DEBUG_ASSERT(IS_ALIGNED(block_va, VM_LARGE_PAGE_SIZE));
+
+    if (!vm_large_pages_enabled()) {
+        return false;
+    }
+
+    // executable pages may need cache maintenance a page at a time after they're mapped,
+    // so leave code at small page granularity
+    if (arch_mmu_flags_ & ARCH_MMU_FLAG_PERM_EXECUTE) {
+        return false;
+    }
+
+    if (size_ < VM_LARGE_PAGE_SIZE || block_va < base_ ||
+        block_va - base_ > size_ - VM_LARGE_PAGE_SIZE) {
+        return false;
+    }
+
+    // the block has to line up with a block of the object for the object to have been
+    // able to back it with one run
+    uint64_t offset = block_va - base_ + object_offset_;
+    if (!IS_ALIGNED(offset, VM_LARGE_PAGE_SIZE)) {
+        return false;
+    }
+
+    *vmo_offset = offset;
+    return true;
+}
+
+bool VmMapping::MapLargePageLocked(vaddr_t block_va, uint64_t vmo_offset,
+                                   uint mmu_flags) TA_NO_THREAD_SAFETY_ANALYSIS {
+    DEBUG_ASSERT(aspace_->lock()->lock().IsHeld());
+
+    paddr_t pa;
+    if (!object_->GetLargePageLocked(vmo_offset, &pa)) {
+        return false;
+    }
+
+    // any small pages mapped in the block so far are pages of the same run, drop them
+    // so the large page can take their place
+    zx_status_t status = aspace_->arch_aspace().Unmap(block_va, VM_LARGE_PAGE_COUNT, nullptr);
+    if (status != ZX_OK) {
+        return false;
+    }
+
+    size_t mapped;
+    status = aspace_->arch_aspace().MapContiguous(block_va, pa, VM_LARGE_PAGE_COUNT, mmu_flags,
+                                                  &mapped);
+    if (status != ZX_OK) {
+        LTRACEF("failed to map large page at va %#" PRIxPTR ": %d\n", block_va, status);
+        return false;
+    }
+    DEBUG_ASSERT(mapped == VM_LARGE_PAGE_COUNT);
+
+    LTRACEF("mapped large page pa %#" PRIxPTR " at va %#" PRIxPTR "\n", pa, block_va);
+    kcounter_add(vm_large_page_map, 1);
+    return true;
+}
+
+void VmMapping::FaultAroundLocked(vaddr_t va, uint pf_flags,
+                                  uint mmu_flags) TA_NO_THREAD_SAFETY_ANALYSIS {
+    DEBUG_ASSERT(aspace_->lock()->lock().IsHeld());
+
+    const size_t window_pages = vm_fault_around_pages();
+    if (window_pages <= 1 || (pf_flags & VMM_PF_FLAG_GUEST)) {
+        return;
+    }
+
+    // the window is aligned, so a run of faults walking through the mapping in either
+    // direction takes one fault per window
+    const size_t window_size = window_pages * PAGE_SIZE;
+    const vaddr_t window_base = ROUNDDOWN(va, window_size);
+    const vaddr_t start = fbl::max(window_base, base_);
+    const vaddr_t last = fbl::min(window_base + (window_size - 1), base_ + size_ - 1);
+
+    // without committing, whatever the object has is mapped as is. those pages may still
+    // be shared with a parent object, so they can only be mapped read-only; a write to one
+    // faults again to get its own copy. pages committed for a write fault are our own.
+    // none of these pages are being used yet, so compressed ones stay compressed and the
+    // resident ones keep their age.
+    uint around_pf_flags = VMM_PF_FLAG_SPECULATIVE;
+    uint around_mmu_flags = mmu_flags & ~ARCH_MMU_FLAG_PERM_WRITE;
+    if ((pf_flags & VMM_PF_FLAG_WRITE) && vm_fault_around_commit()) {
+        around_pf_flags |= VMM_PF_FLAG_WRITE | VMM_PF_FLAG_SW_FAULT;
+        around_mmu_flags = mmu_flags;
+    }
+
+    static_assert(VM_FAULT_AROUND_MAX_PAGES <= sizeof(uint64_t) * CHAR_BIT, "");
+    uint64_t mapped_mask = 0;
+    size_t mapped_count = 0;
+
+    VmMappingCoalescer coalescer(this, start, around_mmu_flags);
+    for (vaddr_t page_va = start; page_va <= last && page_va >= start; page_va += PAGE_SIZE) {
+        if (page_va == va) {
+            continue;
+        }
+
+        // leave alone anything already mapped, including large pages
+        if (aspace_->arch_aspace().Query(page_va, nullptr, nullptr) == ZX_OK) {
+            continue;
+        }
+
+        paddr_t pa;
+        uint64_t vmo_offset = page_va - base_ + object_offset_;
+        zx_status_t status = object_->GetPageLocked(vmo_offset, around_pf_flags, nullptr,
+                                                    nullptr, nullptr, &pa);
+        if (status == ZX_ERR_NO_MEMORY) {
+            break;
+        } else if (status != ZX_OK) {
+            continue;
+        }
+
+        if (coalescer.Append(page_va, pa) != ZX_OK) {
+            return;
+        }
+        mapped_mask |= 1ull << ((page_va - window_base) / PAGE_SIZE);
+        mapped_count++;
+    }
+    if (coalescer.Flush() != ZX_OK || mapped_count == 0) {
+        return;
+    }
+
+    LTRACEF("mapped %zu pages around va %#" PRIxPTR "\n", mapped_count, va);
+    aspace_->fault_around_pages_ += mapped_count;
+    kcounter_add(vm_fault_around_mapped, mapped_count);
+
+#if ARCH_ARM64
+    if (arch_mmu_flags_ & ARCH_MMU_FLAG_PERM_EXECUTE) {
+        for (size_t i = 0; i < window_pages; i++) {
+            if (mapped_mask & (1ull << i)) {
+                arch_sync_cache_range(window_base + i * PAGE_SIZE, PAGE_SIZE);
+            }
+        }
+    }
+#endif
+}
+
+zx_status_t VmMapping::PageFault(vaddr_t va, const uint pf_flags, PageRequest* page_request) {
     canary_.Assert();
     DEBUG_ASSERT(aspace_->lock()->lock().IsHeld());
 
@@ -636,6 +792,16 @@ zx_status_t VmMapping::PageFault(vaddr_t va, const uint pf_flags) {
     // grab the lock for the vmo
     Guard<fbl::Mutex> guard{object_->lock()};
 
+    // a write to an untouched block that we could map with a large page gets the whole
+    // block backed by one contiguous run. this is done before currently_faulting_ is set
+    // so that anything we had mapped in the block from the zero page is unmapped too.
+    const vaddr_t block_va = ROUNDDOWN(va, VM_LARGE_PAGE_SIZE);
+    uint64_t block_offset;
+    const bool large_block = LargePageBlock(block_va, &block_offset);
+    if (large_block && (pf_flags & VMM_PF_FLAG_WRITE)) {
+        object_->CommitLargePageLocked(block_offset);
+    }
+
     // set the currently faulting flag for any recursive calls the vmo may make back into us
     // The specific path we're avoiding is if the VMO calls back into us during vmo->GetPageLocked()
     // via UnmapVmoRangeLocked(). Since we're responsible for that page, signal to ourself to skip
@@ -647,7 +813,12 @@ zx_status_t VmMapping::PageFault(vaddr_t va, const uint pf_flags) {
     // fault in or grab an existing page
     paddr_t new_pa;
     vm_page_t* page;
-    zx_status_t status = object_->GetPageLocked(vmo_offset, pf_flags, nullptr, &page, &new_pa);
+    zx_status_t status = object_->GetPageLocked(vmo_offset, pf_flags, nullptr, page_request,
+                                                &page, &new_pa);
+    if (status == ZX_ERR_SHOULD_WAIT) {
+        // the page source has been asked for the page; the caller waits for it and faults again
+        return status;
+    }
     if (status != ZX_OK) {
         // TODO(cpu): This trace was originally TRACEF() always on, but it fires if the
         // VMO was resized, rather than just when the system is running out of memory.
@@ -665,6 +836,13 @@ zx_status_t VmMapping::PageFault(vaddr_t va, const uint pf_flags) {
         mmu_flags &= ~ARCH_MMU_FLAG_PERM_WRITE;
     }
 
+    // if the object backs the whole block with a large page, map all of it at once. this
+    // also replaces any small pages mapped in the block before it was fully populated.
+    if (large_block && mmu_flags == arch_mmu_flags_ &&
+        MapLargePageLocked(block_va, block_offset, mmu_flags)) {
+        return ZX_OK;
+    }
+
     // see if something is mapped here now
     // this may happen if we are one of multiple threads racing on a single address
     uint page_flags;
@@ -741,6 +919,8 @@ zx_status_t VmMapping::PageFault(vaddr_t va, const uint pf_flags) {
         arch_sync_cache_range(va, PAGE_SIZE);
     }
 #endif
+
+    FaultAroundLocked(va, pf_flags, mmu_flags);
     return ZX_OK;
 }
 
@@ -28,6 +28,7 @@
 #define LOCAL_TRACE MAX(VM_GLOBAL_TRACE, 0)
 
 VmObject::GlobalList VmObject::all_vmos_ = {};
+fbl::DoublyLinkedList<VmObject::ListCursor*> VmObject::cursors_ = {};
 
 VmObject::VmObject(fbl::RefPtr<VmObject> parent)
     : lock_(parent ? parent->lock_ref() : local_lock_),
@@ -68,10 +69,59 @@ VmObject::~VmObject() {
     {
         Guard<fbl::Mutex> guard{AllVmosLock::Get()};
         DEBUG_ASSERT(global_list_state_.InContainer() == true);
+        for (auto& cursor : cursors_) {
+            if (cursor.last_ == this) {
+                auto prev = all_vmos_.make_iterator(*this);
+                cursor.last_ = (prev == all_vmos_.begin()) ? nullptr : &*--prev;
+            }
+        }
         all_vmos_.erase(*this);
     }
 }
 
+VmObject::ListCursor::~ListCursor() {
+    Guard<fbl::Mutex> guard{AllVmosLock::Get()};
+    if (InContainer()) {
+        cursors_.erase(*this);
+    }
+}
+
+void VmObject::ListCursor::Set(const fbl::RefPtr<VmObject>& vmo) {
+    Guard<fbl::Mutex> guard{AllVmosLock::Get()};
+    DEBUG_ASSERT(vmo->global_list_state_.InContainer());
+    if (!InContainer()) {
+        cursors_.push_back(this);
+    }
+    last_ = vmo.get();
+}
+
+// static
+size_t VmObject::GetLiveVmos(ListCursor* cursor, fbl::RefPtr<VmObject>* refs, size_t max_refs) {
+    size_t count = 0;
+    Guard<fbl::Mutex> guard{AllVmosLock::Get()};
+    if (!cursor->InContainer()) {
+        cursors_.push_back(cursor);
+    }
+
+    auto iter = cursor->last_ ? ++all_vmos_.make_iterator(*cursor->last_) : all_vmos_.begin();
+    for (; iter != all_vmos_.end() && count < max_refs; ++iter) {
+        // An object whose last reference is gone can't leave the list until
+        // we drop the lock, but it mustn't be handed out.
+        if (iter->AddRefMaybeInDestructor()) {
+            DEBUG_ASSERT(!refs[count]);
+            refs[count++] = fbl::internal::MakeRefPtrNoAdopt(&*iter);
+        }
+    }
+    cursor->last_ = (count > 0) ? refs[count - 1].get() : nullptr;
+    return count;
+}
+
+// static
+size_t VmObject::GetVmoCount() {
+    Guard<fbl::Mutex> guard{AllVmosLock::Get()};
+    return all_vmos_.size_slow();
+}
+
 void VmObject::get_name(char* out_name, size_t len) const {
     canary_.Assert();
     name_.get(len, out_name);
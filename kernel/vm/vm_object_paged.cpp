@@ -16,6 +16,7 @@
 #include <inttypes.h>
 #include <ktl/move.h>
 #include <lib/console.h>
+#include <lib/counters.h>
 #include <stdlib.h>
 #include <string.h>
 #include <trace.h>
@@ -23,10 +24,16 @@
 #include <vm/physmap.h>
 #include <vm/vm.h>
 #include <vm/vm_address_region.h>
+#include <zircon/syscalls/object.h>
 #include <zircon/types.h>
 
 #define LOCAL_TRACE MAX(VM_GLOBAL_TRACE, 0)
 
+KCOUNTER(vm_large_page_alloc, "kernel.vm.large_page.alloc");
+KCOUNTER(vm_large_page_alloc_failed, "kernel.vm.large_page.alloc_failed");
+KCOUNTER(vm_compression_discarded, "kernel.vm.compression.discarded");
+KCOUNTER(vm_compression_faults, "kernel.vm.compression.faults");
+
 namespace {
 
 void ZeroPage(paddr_t pa) {
@@ -45,8 +52,12 @@ void InitializeVmPage(vm_page_t* p) {
     DEBUG_ASSERT(p->state == VM_PAGE_STATE_ALLOC);
     p->state = VM_PAGE_STATE_OBJECT;
     p->object.pin_count = 0;
+    p->object.age = 0;
 }
 
+// pages examined between rounds of compression in VmObjectPaged::ReclaimPages
+constexpr size_t kReclaimBatch = 32;
+
 // round up the size to the next page size boundary and make sure we dont wrap
 zx_status_t RoundSize(uint64_t size, uint64_t* out_size) {
     *out_size = ROUNDUP_PAGE_SIZE(size);
@@ -94,6 +105,9 @@ VmObjectPaged::~VmObjectPaged() {
 
     // free all of the pages attached to us
     page_list_.FreeAllPages();
+    [this]() TA_NO_THREAD_SAFETY_ANALYSIS {
+        FreeCompressedPagesLocked(0, UINT64_MAX);
+    }();
 
     if (page_source_) {
         page_source_->Close();
@@ -329,8 +343,8 @@ void VmObjectPaged::Dump(uint depth, bool verbose) {
         printf("  ");
     }
     printf("vmo %p/k%" PRIu64 " size %#" PRIx64
-           " pages %zu ref %d parent k%" PRIu64 "\n",
-           this, user_id_, size_, count, ref_count_debug(), parent_id);
+           " pages %zu compressed %zu ref %d parent k%" PRIu64 "\n",
+           this, user_id_, size_, count, compressed_pages_.size(), ref_count_debug(), parent_id);
 
     if (verbose) {
         auto f = [depth](const auto p, uint64_t offset) {
@@ -401,6 +415,7 @@ zx_status_t VmObjectPaged::AddPageLocked(vm_page_t* p, uint64_t offset) {
 // and will not fail if |free_list| is a non-empty list, faulting in was requested,
 // and offset is in range.
 zx_status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_node* free_list,
+                                         PageRequest* page_request,
                                          vm_page_t** const page_out, paddr_t* const pa_out) {
     canary_.Assert();
     DEBUG_ASSERT(lock_.lock().IsHeld());
@@ -415,6 +430,11 @@ zx_status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_no
     // see if we already have a page at that offset
     p = page_list_.GetPage(offset);
     if (p) {
+        // handing the page out counts as using it, see vm/compression.h, unless the caller
+        // is only mapping it ahead of a use that may never come
+        if (!(pf_flags & VMM_PF_FLAG_SPECULATIVE)) {
+            p->object.age = 0;
+        }
         if (page_out) {
             *page_out = p;
         }
@@ -424,6 +444,24 @@ zx_status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_no
         return ZX_OK;
     }
 
+    // a compressed page is still ours, so it comes back whether or not this is a fault.
+    // speculative lookups leave it where it is.
+    if (!compressed_pages_.is_empty()) {
+        if (pf_flags & VMM_PF_FLAG_SPECULATIVE) {
+            if (compressed_pages_.find(ROUNDDOWN(offset, PAGE_SIZE)).IsValid()) {
+                return ZX_ERR_NOT_FOUND;
+            }
+        } else {
+            zx_status_t status = DecompressPageLocked(offset, free_list, page_out, pa_out);
+            if (status != ZX_ERR_NOT_FOUND) {
+                if (status == ZX_OK && (pf_flags & VMM_PF_FLAG_FAULT_MASK)) {
+                    kcounter_add(vm_compression_faults, 1);
+                }
+                return status;
+            }
+        }
+    }
+
     __UNUSED char pf_string[5];
     LTRACEF("vmo %p, offset %#" PRIx64 ", pf_flags %#x (%s)\n", this, offset, pf_flags,
             vmm_pf_flags_to_string(pf_flags, pf_string));
@@ -434,11 +472,27 @@ zx_status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_no
         bool overflowed = add_overflow(parent_offset_, offset, &parent_offset);
         ASSERT(!overflowed);
 
-        // make sure we don't cause the parent to fault in new pages, just ask for any that already exist
+        // make sure we don't cause the parent to fault in new pages, just ask for any that already
+        // exist. the exception is a page source, the only place a missing page can come from, so
+        // the request is passed up and the caller waits on it like any other.
         uint parent_pf_flags = pf_flags & ~(VMM_PF_FLAG_FAULT_MASK);
+        PageRequest* parent_page_request = nullptr;
+        if (page_request && IsPagerBackedLocked()) {
+            parent_pf_flags = pf_flags & ~VMM_PF_FLAG_WRITE;
+            parent_page_request = page_request;
+        }
 
         zx_status_t status = parent_->GetPageLocked(parent_offset, parent_pf_flags,
-                                                    nullptr, &p, &pa);
+                                                    nullptr, parent_page_request, &p, &pa);
+        if (status == ZX_ERR_NO_MEMORY || status == ZX_ERR_SHOULD_WAIT) {
+            // the parent has the page, but compressed and with no memory to bring it back,
+            // or the page source has yet to supply it
+            return status;
+        }
+        if (status != ZX_OK && status != ZX_ERR_OUT_OF_RANGE && parent_page_request) {
+            // past the end of the parent is zeros, but anything else the source failed
+            return status;
+        }
         if (status == ZX_OK) {
             // we have a page from them. if we're read-only faulting, return that page so they can map
             // or read from it directly
@@ -504,6 +558,25 @@ zx_status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_no
         return ZX_ERR_NOT_FOUND;
     }
 
+    // pages of an object with a page source can only come from the source, which the
+    // caller has to wait on
+    if (page_source_) {
+        if (!page_request) {
+            return ZX_ERR_NOT_FOUND;
+        }
+
+        // ask for the pages after this one too, up to the first one we already have, so
+        // the source can read ahead
+        offset = ROUNDDOWN(offset, PAGE_SIZE);
+        const uint64_t max_len = fbl::min(size_ - offset,
+                                          vm_pager_read_ahead_pages() * PAGE_SIZE);
+        uint64_t len = PAGE_SIZE;
+        while (len < max_len && !page_list_.GetPage(offset + len)) {
+            len += PAGE_SIZE;
+        }
+        return page_source_->GetPage(offset, len, page_request);
+    }
+
     // if we're read faulting, we don't already have a page, and the parent doesn't have it,
     // return the single global zero page
     if ((pf_flags & VMM_PF_FLAG_WRITE) == 0) {
@@ -517,7 +590,7 @@ zx_status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_no
         return ZX_OK;
     }
 
-    // allocate a page
+    // allocate a zeroed page. any pages we were handed were allocated zeroed too.
     if (free_list) {
         p = list_remove_head_type(free_list, vm_page, queue_node);
         if (p) {
@@ -525,7 +598,7 @@ zx_status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_no
         }
     }
     if (!p) {
-        pmm_alloc_page(pmm_alloc_flags_, &p, &pa);
+        pmm_alloc_page(pmm_alloc_flags_ | PMM_ALLOC_FLAG_ZERO, &p, &pa);
     }
     if (!p) {
         return ZX_ERR_NO_MEMORY;
@@ -533,9 +606,6 @@ zx_status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_no
 
     InitializeVmPage(p);
 
-    // TODO: remove once pmm returns zeroed pages
-    ZeroPage(pa);
-
 // if ARM and not fully cached, clean/invalidate the page after zeroing it
 #if ARCH_ARM64
     if (cache_policy_ != ARCH_MMU_FLAG_CACHED) {
@@ -561,6 +631,107 @@ zx_status_t VmObjectPaged::GetPageLocked(uint64_t offset, uint pf_flags, list_no
     return ZX_OK;
 }
 
+zx_status_t VmObjectPaged::CommitLargePageLocked(uint64_t offset) {
+    canary_.Assert();
+    DEBUG_ASSERT(lock_.lock().IsHeld());
+    DEBUG_ASSERT(IS_ALIGNED(offset, VM_LARGE_PAGE_SIZE));
+
+    // clones share their parent's pages and pager backed objects get theirs from the
+    // page source, so only plain anonymous memory is backed this way
+    if (!vm_large_pages_enabled() || parent_ || page_source_) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    if (offset >= size_ || size_ - offset < VM_LARGE_PAGE_SIZE) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+
+    // a block that already has pages in it stays at small page granularity
+    bool committed = false;
+    page_list_.ForEveryPageInRange(
+        [&committed](const auto p, uint64_t off) {
+            committed = true;
+            return ZX_ERR_STOP;
+        },
+        offset, offset + VM_LARGE_PAGE_SIZE);
+    auto compressed = compressed_pages_.lower_bound(offset);
+    if (compressed.IsValid() && compressed->offset() < offset + VM_LARGE_PAGE_SIZE) {
+        committed = true;
+    }
+    if (committed) {
+        return ZX_ERR_ALREADY_EXISTS;
+    }
+
+    list_node page_list;
+    list_initialize(&page_list);
+
+    paddr_t pa;
+    zx_status_t status = pmm_alloc_contiguous(VM_LARGE_PAGE_COUNT,
+                                              pmm_alloc_flags_ | PMM_ALLOC_FLAG_ZERO,
+                                              VM_LARGE_PAGE_SHIFT, &pa, &page_list);
+    if (status != ZX_OK) {
+        kcounter_add(vm_large_page_alloc_failed, 1);
+        return status;
+    }
+    kcounter_add(vm_large_page_alloc, 1);
+
+// if ARM and not fully cached, clean/invalidate the pages after zeroing them
+#if ARCH_ARM64
+    if (cache_policy_ != ARCH_MMU_FLAG_CACHED) {
+        arch_clean_invalidate_cache_range((addr_t)paddr_to_physmap(pa), VM_LARGE_PAGE_SIZE);
+    }
+#endif
+
+    LTRACEF("vmo %p, offset %#" PRIx64 ", large page at pa %#" PRIxPTR "\n", this, offset, pa);
+
+    uint64_t o = offset;
+    vm_page_t* p;
+    while ((p = list_remove_head_type(&page_list, vm_page, queue_node)) != nullptr) {
+        InitializeVmPage(p);
+        status = page_list_.AddPage(p, o);
+        DEBUG_ASSERT(status == ZX_OK);
+        o += PAGE_SIZE;
+    }
+
+    // other mappings may have covered this block with the zero page, so unmap those ranges
+    RangeChangeUpdateLocked(offset, VM_LARGE_PAGE_SIZE);
+
+    return ZX_OK;
+}
+
+bool VmObjectPaged::GetLargePageLocked(uint64_t offset, paddr_t* pa) {
+    canary_.Assert();
+    DEBUG_ASSERT(lock_.lock().IsHeld());
+    DEBUG_ASSERT(IS_ALIGNED(offset, VM_LARGE_PAGE_SIZE));
+
+    if (offset >= size_ || size_ - offset < VM_LARGE_PAGE_SIZE) {
+        return false;
+    }
+
+    // check the first page before walking the whole block
+    vm_page_t* first = page_list_.GetPage(offset);
+    if (!first || !IS_ALIGNED(first->paddr(), VM_LARGE_PAGE_SIZE)) {
+        return false;
+    }
+
+    const paddr_t base = first->paddr();
+    size_t count = 0;
+    page_list_.ForEveryPageInRange(
+        [base, offset, &count](const auto p, uint64_t off) {
+            if (p->paddr() != base + (off - offset)) {
+                return ZX_ERR_STOP;
+            }
+            count++;
+            return ZX_ERR_NEXT;
+        },
+        offset, offset + VM_LARGE_PAGE_SIZE);
+    if (count != VM_LARGE_PAGE_COUNT) {
+        return false;
+    }
+
+    *pa = base;
+    return true;
+}
+
 zx_status_t VmObjectPaged::CommitRange(uint64_t offset, uint64_t len) {
     canary_.Assert();
     LTRACEF("offset %#" PRIx64 ", len %#" PRIx64 "\n", offset, len);
@@ -583,6 +754,45 @@ zx_status_t VmObjectPaged::CommitRange(uint64_t offset, uint64_t len) {
     DEBUG_ASSERT(end > offset);
     offset = ROUNDDOWN(offset, PAGE_SIZE);
 
+    // a page source has to supply the pages itself, waiting for it with the lock dropped. a
+    // clone of such an object then copies each page it gets.
+    if (IsPagerBackedLocked()) {
+        const uint flags = VMM_PF_FLAG_SW_FAULT | (page_source_ ? 0 : VMM_PF_FLAG_WRITE);
+        PageRequest page_request;
+        uint64_t o = offset;
+        while (o < end) {
+            zx_status_t status = GetPageLocked(o, flags, nullptr, &page_request,
+                                               nullptr, nullptr);
+            if (status == ZX_ERR_SHOULD_WAIT) {
+                guard.CallUnlocked([&status, &page_request]() {
+                    status = page_request.Wait();
+                });
+                if (status != ZX_OK) {
+                    return status;
+                }
+                if (end > size_) {
+                    return ZX_ERR_OUT_OF_RANGE;
+                }
+                continue;
+            }
+            if (status != ZX_OK) {
+                return status;
+            }
+            o += PAGE_SIZE;
+        }
+        return ZX_OK;
+    }
+
+    // back whole blocks in the range with large pages where we can, stopping at the
+    // first one that can't be had
+    for (uint64_t o = ROUNDUP(offset, VM_LARGE_PAGE_SIZE);
+         o < end && end - o >= VM_LARGE_PAGE_SIZE; o += VM_LARGE_PAGE_SIZE) {
+        zx_status_t status = CommitLargePageLocked(o);
+        if (status != ZX_OK && status != ZX_ERR_ALREADY_EXISTS) {
+            break;
+        }
+    }
+
     // make a pass through the list, counting the number of pages we need to allocate
     size_t count = 0;
     uint64_t expected_next_off = offset;
@@ -607,7 +817,7 @@ zx_status_t VmObjectPaged::CommitRange(uint64_t offset, uint64_t len) {
     list_node page_list;
     list_initialize(&page_list);
 
-    zx_status_t status = pmm_alloc_pages(count, pmm_alloc_flags_, &page_list);
+    zx_status_t status = pmm_alloc_pages(count, pmm_alloc_flags_ | PMM_ALLOC_FLAG_ZERO, &page_list);
     if (status != ZX_OK) {
         return status;
     }
@@ -628,7 +838,7 @@ zx_status_t VmObjectPaged::CommitRange(uint64_t offset, uint64_t len) {
         const uint flags = VMM_PF_FLAG_SW_FAULT | VMM_PF_FLAG_WRITE;
         // Should not be able to fail, since we're providing it memory and the
         // range should be valid.
-        zx_status_t status = GetPageLocked(o, flags, &page_list, &p, &pa);
+        zx_status_t status = GetPageLocked(o, flags, &page_list, nullptr, &p, &pa);
         ASSERT(status == ZX_OK);
     }
 
@@ -679,6 +889,7 @@ zx_status_t VmObjectPaged::DecommitRange(uint64_t offset, uint64_t len) {
     RangeChangeUpdateLocked(start, page_aligned_len);
 
     page_list_.FreePages(start, end);
+    FreeCompressedPagesLocked(start, end);
 
     return ZX_OK;
 }
@@ -705,8 +916,14 @@ zx_status_t VmObjectPaged::PinLocked(uint64_t offset, uint64_t len) {
     const uint64_t start_page_offset = ROUNDDOWN(offset, PAGE_SIZE);
     const uint64_t end_page_offset = ROUNDUP(offset + len, PAGE_SIZE);
 
+    // compressed pages count as committed, but have to be brought back to be pinned
+    zx_status_t status = DecompressRangeLocked(start_page_offset, end_page_offset);
+    if (status != ZX_OK) {
+        return status;
+    }
+
     uint64_t expected_next_off = start_page_offset;
-    zx_status_t status = page_list_.ForEveryPageInRange(
+    status = page_list_.ForEveryPageInRange(
         [&expected_next_off](const auto p, uint64_t off) {
             if (off != expected_next_off) {
                 return ZX_ERR_NOT_FOUND;
@@ -796,6 +1013,209 @@ bool VmObjectPaged::AnyPagesPinnedLocked(uint64_t offset, size_t len) {
     return found_pinned;
 }
 
+bool VmObjectPaged::IsPagerBackedLocked() const TA_NO_THREAD_SAFETY_ANALYSIS {
+    // clones share their parent's lock, so the whole chain is covered by ours
+    const VmObjectPaged* vmo = this;
+    while (!vmo->page_source_ && vmo->parent_) {
+        vmo = static_cast<const VmObjectPaged*>(vmo->parent_.get());
+    }
+    return vmo->page_source_ != nullptr;
+}
+
+bool VmObjectPaged::CanReclaimLocked() const {
+    // a pager backed object gets its pages from the pager, and the pages of a contiguous
+    // or uncached object stand for particular physical memory
+    if (page_source_ || is_contiguous() || cache_policy_ != ARCH_MMU_FLAG_CACHED) {
+        return false;
+    }
+
+    // the kernel doesn't expect to take faults on its own mappings
+    for (const auto& m : mapping_list_) {
+        if (!m.aspace()->is_user()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+zx_status_t VmObjectPaged::DecompressPageLocked(uint64_t offset, list_node* free_list,
+                                                vm_page_t** const page_out,
+                                                paddr_t* const pa_out) {
+    DEBUG_ASSERT(lock_.lock().IsHeld());
+
+    offset = ROUNDDOWN(offset, PAGE_SIZE);
+    auto compressed = compressed_pages_.find(offset);
+    if (!compressed.IsValid()) {
+        return ZX_ERR_NOT_FOUND;
+    }
+
+    vm_page_t* p = nullptr;
+    paddr_t pa;
+    if (free_list) {
+        p = list_remove_head_type(free_list, vm_page, queue_node);
+        if (p) {
+            pa = p->paddr();
+        }
+    }
+    if (!p) {
+        pmm_alloc_page(pmm_alloc_flags_, &p, &pa);
+    }
+    if (!p) {
+        return ZX_ERR_NO_MEMORY;
+    }
+
+    InitializeVmPage(p);
+    compressed->Decompress(pa);
+    compressed_pages_.erase(compressed);
+
+    // nothing can have mapped this offset while the page was compressed, since every
+    // lookup of it lands here, so there are no mappings to update
+    zx_status_t status = page_list_.AddPage(p, offset);
+    DEBUG_ASSERT(status == ZX_OK);
+
+    LTRACEF("decompressed page %p, pa %#" PRIxPTR " at offset %#" PRIx64 "\n", p, pa, offset);
+
+    if (page_out) {
+        *page_out = p;
+    }
+    if (pa_out) {
+        *pa_out = pa;
+    }
+    return ZX_OK;
+}
+
+zx_status_t VmObjectPaged::DecompressRangeLocked(uint64_t start, uint64_t end) {
+    DEBUG_ASSERT(lock_.lock().IsHeld());
+
+    for (auto compressed = compressed_pages_.lower_bound(start);
+         compressed.IsValid() && compressed->offset() < end;
+         compressed = compressed_pages_.lower_bound(start)) {
+        start = compressed->offset() + PAGE_SIZE;
+        zx_status_t status = DecompressPageLocked(compressed->offset(), nullptr,
+                                                  nullptr, nullptr);
+        if (status != ZX_OK) {
+            return status;
+        }
+    }
+    return ZX_OK;
+}
+
+void VmObjectPaged::FreeCompressedPagesLocked(uint64_t start, uint64_t end) {
+    size_t count = 0;
+    auto compressed = compressed_pages_.lower_bound(start);
+    while (compressed.IsValid() && compressed->offset() < end) {
+        compressed_pages_.erase(compressed++);
+        count++;
+    }
+    if (count > 0) {
+        kcounter_add(vm_compression_discarded, count);
+    }
+}
+
+size_t VmObjectPaged::ReclaimPages(size_t max_pages, uint min_age) {
+    canary_.Assert();
+
+    Guard<fbl::Mutex> guard{&lock_};
+
+    if (!CanReclaimLocked()) {
+        return 0;
+    }
+
+    // unmaps runs of pages a run at a time rather than a page at a time
+    uint64_t run_start = 0;
+    uint64_t run_end = 0;
+    auto unmap = [this, &run_start, &run_end](uint64_t off) TA_NO_THREAD_SAFETY_ANALYSIS {
+        if (off != run_end) {
+            if (run_end > run_start) {
+                RangeChangeUpdateLocked(run_start, run_end - run_start);
+            }
+            run_start = off;
+        }
+        run_end = off + PAGE_SIZE;
+    };
+
+    size_t reclaimed = 0;
+    uint64_t offset = 0;
+    while (offset < size_ && reclaimed < max_pages) {
+        // age the pages from |offset| on until a batch of them is old enough to compress.
+        // a page is unmapped as it first starts to age, so that the next touch faults and
+        // makes it young again.
+        uint64_t cold[kReclaimBatch];
+        size_t cold_count = 0;
+        const size_t cold_max = fbl::min(fbl::count_of(cold), max_pages - reclaimed);
+        uint64_t block = UINT64_MAX;
+        bool large = false;
+        uint64_t next_offset = size_;
+        page_list_.ForEveryPageInRange(
+            [&](const auto p, uint64_t off) TA_NO_THREAD_SAFETY_ANALYSIS {
+                if (p->state != VM_PAGE_STATE_OBJECT || p->object.pin_count > 0) {
+                    return ZX_ERR_NEXT;
+                }
+
+                // leave large pages whole
+                if (ROUNDDOWN(off, VM_LARGE_PAGE_SIZE) != block) {
+                    block = ROUNDDOWN(off, VM_LARGE_PAGE_SIZE);
+                    paddr_t unused;
+                    large = GetLargePageLocked(block, &unused);
+                }
+                if (large) {
+                    return ZX_ERR_NEXT;
+                }
+
+                if (p->object.age >= min_age) {
+                    cold[cold_count++] = off;
+                    if (cold_count == cold_max) {
+                        next_offset = off + PAGE_SIZE;
+                        return ZX_ERR_STOP;
+                    }
+                    return ZX_ERR_NEXT;
+                }
+                if (p->object.age == 0) {
+                    unmap(off);
+                }
+                p->object.age++;
+                return ZX_ERR_NEXT;
+            },
+            offset, size_);
+
+        // nothing may still map a page that is about to go away
+        for (size_t i = 0; i < cold_count; i++) {
+            unmap(cold[i]);
+        }
+        if (run_end > run_start) {
+            RangeChangeUpdateLocked(run_start, run_end - run_start);
+        }
+        run_start = run_end = 0;
+
+        for (size_t i = 0; i < cold_count; i++) {
+            vm_page_t* p = page_list_.GetPage(cold[i]);
+            DEBUG_ASSERT(p);
+
+            ktl::unique_ptr<VmCompressedPage> compressed;
+            zx_status_t status = VmCompressedPage::Create(p->paddr(), cold[i], &compressed);
+            if (status != ZX_OK) {
+                // start it over rather than trying it again on every scan
+                p->object.age = 0;
+                if (status == ZX_ERR_NO_MEMORY) {
+                    return reclaimed;
+                }
+                continue;
+            }
+
+            compressed_pages_.insert(ktl::move(compressed));
+            __UNUSED bool found = page_list_.RemovePage(cold[i], &p);
+            DEBUG_ASSERT(found);
+            pmm_free_page(p);
+            reclaimed++;
+        }
+
+        offset = next_offset;
+    }
+
+    LTRACEF("vmo %p reclaimed %zu pages\n", this, reclaimed);
+    return reclaimed;
+}
+
 zx_status_t VmObjectPaged::ResizeLocked(uint64_t s) {
     canary_.Assert();
     DEBUG_ASSERT(lock_.lock().IsHeld());
@@ -832,6 +1252,7 @@ zx_status_t VmObjectPaged::ResizeLocked(uint64_t s) {
         RangeChangeUpdateLocked(start, len);
 
         page_list_.FreePages(start, end);
+        FreeCompressedPagesLocked(start, end);
     } else if (s > size_) {
         // expanding
         // figure the starting and ending page offset that is affected
@@ -896,6 +1317,7 @@ zx_status_t VmObjectPaged::ReadWriteInternal(uint64_t offset, size_t len, bool w
     }
 
     // walk the list of pages and do the write
+    PageRequest page_request;
     uint64_t src_offset = offset;
     size_t dest_offset = 0;
     while (len > 0) {
@@ -906,7 +1328,20 @@ zx_status_t VmObjectPaged::ReadWriteInternal(uint64_t offset, size_t len, bool w
         paddr_t pa;
         auto status = GetPageLocked(src_offset,
                                     VMM_PF_FLAG_SW_FAULT | (write ? VMM_PF_FLAG_WRITE : 0),
-                                    nullptr, nullptr, &pa);
+                                    nullptr, &page_request, nullptr, &pa);
+        if (status == ZX_ERR_SHOULD_WAIT) {
+            // wait for the page source with the lock dropped, then try the page again
+            guard.CallUnlocked([&status, &page_request]() {
+                status = page_request.Wait();
+            });
+            if (status != ZX_OK) {
+                return status;
+            }
+            if (end_offset > size_) {
+                return ZX_ERR_OUT_OF_RANGE;
+            }
+            continue;
+        }
         if (status != ZX_OK) {
             return status;
         }
@@ -981,8 +1416,15 @@ zx_status_t VmObjectPaged::Lookup(uint64_t offset, uint64_t len,
     const uint64_t start_page_offset = ROUNDDOWN(offset, PAGE_SIZE);
     const uint64_t end_page_offset = ROUNDUP(offset + len, PAGE_SIZE);
 
+    // bring back compressed pages first, so the walk below doesn't add pages to the
+    // list it is walking
+    zx_status_t status = DecompressRangeLocked(start_page_offset, end_page_offset);
+    if (status != ZX_OK) {
+        return status;
+    }
+
     uint64_t expected_next_off = start_page_offset;
-    zx_status_t status = page_list_.ForEveryPageInRange(
+    status = page_list_.ForEveryPageInRange(
         [&expected_next_off, this, lookup_fn, context,
          start_page_offset](const auto p, uint64_t off) {
 
@@ -992,7 +1434,7 @@ zx_status_t VmObjectPaged::Lookup(uint64_t offset, uint64_t len,
                  missing_off += PAGE_SIZE) {
 
                 paddr_t pa;
-                zx_status_t status = this->GetPageLocked(missing_off, 0, nullptr,
+                zx_status_t status = this->GetPageLocked(missing_off, 0, nullptr, nullptr,
                                                          nullptr, &pa);
                 if (status != ZX_OK) {
                     return ZX_ERR_NO_MEMORY;
@@ -1028,7 +1470,7 @@ zx_status_t VmObjectPaged::Lookup(uint64_t offset, uint64_t len,
     // If expected_next_off isn't at the end, there's a gap to process
     for (uint64_t off = expected_next_off; off < end_page_offset; off += PAGE_SIZE) {
         paddr_t pa;
-        zx_status_t status = GetPageLocked(off, 0, nullptr, nullptr, &pa);
+        zx_status_t status = GetPageLocked(off, 0, nullptr, nullptr, nullptr, &pa);
         if (status != ZX_OK) {
             return ZX_ERR_NO_MEMORY;
         }
@@ -1064,6 +1506,92 @@ zx_status_t VmObjectPaged::WriteUser(user_in_ptr<const void> ptr, uint64_t offse
     return ReadWriteInternal(offset, len, true, write_routine);
 }
 
+zx_status_t VmObjectPaged::TakePages(uint64_t offset, uint64_t len, list_node* pages) {
+    canary_.Assert();
+    DEBUG_ASSERT(IS_PAGE_ALIGNED(offset) && IS_PAGE_ALIGNED(len));
+
+    Guard<fbl::Mutex> guard{&lock_};
+
+    if (!InRange(offset, len, size_)) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+    if (page_source_ || is_contiguous()) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    // clones may be reading our pages through their own, and pinned pages are in use by
+    // a device, so neither can be moved out from under them
+    if (children_list_len_ != 0 || AnyPagesPinnedLocked(offset, len)) {
+        return ZX_ERR_BAD_STATE;
+    }
+
+    const uint64_t end = offset + len;
+    for (uint64_t o = offset; o < end; o += PAGE_SIZE) {
+        if (!page_list_.GetPage(o)) {
+            zx_status_t status = GetPageLocked(o, VMM_PF_FLAG_SW_FAULT | VMM_PF_FLAG_WRITE,
+                                               nullptr, nullptr, nullptr, nullptr);
+            if (status != ZX_OK) {
+                return status;
+            }
+        }
+    }
+
+    // unmap all of the pages in this range on all the mapping regions
+    RangeChangeUpdateLocked(offset, len);
+
+    for (uint64_t o = offset; o < end; o += PAGE_SIZE) {
+        vm_page_t* p;
+        __UNUSED bool found = page_list_.RemovePage(o, &p);
+        DEBUG_ASSERT(found);
+        list_add_tail(pages, &p->queue_node);
+    }
+
+    return ZX_OK;
+}
+
+zx_status_t VmObjectPaged::SupplyPages(uint64_t offset, uint64_t len, list_node* pages) {
+    canary_.Assert();
+    DEBUG_ASSERT(IS_PAGE_ALIGNED(offset) && IS_PAGE_ALIGNED(len));
+
+    Guard<fbl::Mutex> guard{&lock_};
+
+    if (is_contiguous()) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    if (!InRange(offset, len, size_)) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+
+    // add the whole run before touching any mappings, so that a clone that mapped the
+    // zero page over part of it is updated once rather than once per page
+    zx_status_t status = ZX_OK;
+    const uint64_t end = offset + len;
+    uint64_t o;
+    for (o = offset; o < end; o += PAGE_SIZE) {
+        vm_page_t* p = list_remove_head_type(pages, vm_page_t, queue_node);
+        DEBUG_ASSERT(p);
+
+        if (page_list_.GetPage(o) || compressed_pages_.find(o).IsValid()) {
+            // supplied already; keep the copy anyone may have seen
+            pmm_free_page(p);
+            continue;
+        }
+        status = page_list_.AddPage(p, o);
+        if (status != ZX_OK) {
+            list_add_head(pages, &p->queue_node);
+            break;
+        }
+    }
+
+    if (o > offset) {
+        RangeChangeUpdateLocked(offset, o - offset);
+        if (page_source_) {
+            page_source_->OnPagesSupplied(offset, o - offset);
+        }
+    }
+
+    return status;
+}
+
 zx_status_t VmObjectPaged::InvalidateCache(const uint64_t offset, const uint64_t len) {
     return CacheOp(offset, len, CacheOpType::Invalidate);
 }
@@ -1111,7 +1639,7 @@ zx_status_t VmObjectPaged::CacheOp(const uint64_t start_offset, const uint64_t l
 
         // lookup the physical address of the page, careful not to fault in a new one
         paddr_t pa;
-        auto status = GetPageLocked(op_start_offset, 0, nullptr, nullptr, &pa);
+        auto status = GetPageLocked(op_start_offset, 0, nullptr, nullptr, nullptr, &pa);
 
         if (likely(status == ZX_OK)) {
             // Convert the page address to a Kernel virtual address.
@@ -1162,7 +1690,7 @@ zx_status_t VmObjectPaged::SetMappingCachePolicy(const uint32_t cache_policy) {
     // 2) vmo has no mappings
     // 3) vmo has no clones
     // 4) vmo is not a clone
-    if (!page_list_.IsEmpty()) {
+    if (!page_list_.IsEmpty() || !compressed_pages_.is_empty()) {
         return ZX_ERR_BAD_STATE;
     }
     if (!mapping_list_.is_empty()) {
@@ -1180,6 +1708,32 @@ zx_status_t VmObjectPaged::SetMappingCachePolicy(const uint32_t cache_policy) {
     return ZX_OK;
 }
 
+zx_status_t VmObjectPaged::GetNumaNode(uint32_t* node) const {
+    Guard<fbl::Mutex> guard{&lock_};
+
+    uint32_t flags_node = (pmm_alloc_flags_ & PMM_ALLOC_FLAG_NODE_MASK) >> PMM_ALLOC_FLAG_NODE_SHIFT;
+    *node = flags_node ? flags_node - 1 : ZX_NUMA_NODE_ANY;
+
+    return ZX_OK;
+}
+
+zx_status_t VmObjectPaged::SetNumaNode(uint32_t node) {
+    if (node != ZX_NUMA_NODE_ANY && node >= pmm_numa_node_count()) {
+        return ZX_ERR_INVALID_ARGS;
+    }
+
+    Guard<fbl::Mutex> guard{&lock_};
+
+    // only pages allocated from here on are affected, and clones made from
+    // here on inherit the node
+    pmm_alloc_flags_ &= ~PMM_ALLOC_FLAG_NODE_MASK;
+    if (node != ZX_NUMA_NODE_ANY) {
+        pmm_alloc_flags_ |= PMM_ALLOC_FLAG_NODE(node);
+    }
+
+    return ZX_OK;
+}
+
 void VmObjectPaged::RangeChangeUpdateFromParentLocked(const uint64_t offset, const uint64_t len) {
     canary_.Assert();
 
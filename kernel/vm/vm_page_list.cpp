@@ -7,6 +7,7 @@
 #include <vm/vm_page_list.h>
 
 #include <err.h>
+#include <fbl/algorithm.h>
 #include <fbl/alloc_checker.h>
 #include <inttypes.h>
 #include <ktl/move.h>
@@ -21,6 +22,24 @@
 
 namespace {
 
+// the radix tree above the leaves. each inner node resolves kInnerBits more bits of
+// the offset; level 1 nodes point at leaves.
+constexpr uint kInnerBits = 6;
+constexpr size_t kInnerFanOut = 1u << kInnerBits;
+
+// bits of the offset resolved within a leaf
+constexpr uint kLeafShift = PAGE_SIZE_SHIFT + 6;
+static_assert((1u << (kLeafShift - PAGE_SIZE_SHIFT)) == VmPageListNode::kPageFanOut, "");
+
+// enough levels to cover any 64 bit offset
+constexpr uint kMaxHeight = (64 - kLeafShift + kInnerBits - 1) / kInnerBits;
+
+struct InnerNode {
+    void* slots[kInnerFanOut] = {};
+    // the number of non null slots
+    size_t count = 0;
+};
+
 inline uint64_t offset_to_node_offset(uint64_t offset) {
     return ROUNDDOWN(offset, PAGE_SIZE * VmPageListNode::kPageFanOut);
 }
@@ -29,6 +48,28 @@ inline uint64_t offset_to_node_index(uint64_t offset) {
     return (offset >> PAGE_SIZE_SHIFT) % VmPageListNode::kPageFanOut;
 }
 
+// the shift of the offset bits that index an inner node at |level|
+inline uint level_shift(uint level) {
+    return kLeafShift + kInnerBits * (level - 1);
+}
+
+inline size_t offset_to_slot(uint64_t offset, uint level) {
+    return (offset >> level_shift(level)) % kInnerFanOut;
+}
+
+// whether a tree |height| levels of inner nodes tall reaches |offset|
+inline bool height_covers(uint height, uint64_t offset) {
+    const uint shift = kLeafShift + kInnerBits * height;
+    return shift >= 64 || (offset >> shift) == 0;
+}
+
+// the start of the next 1 << |shift| aligned block after the one holding |offset|,
+// or UINT64_MAX if there isn't one
+inline uint64_t next_block(uint64_t offset, uint shift) {
+    const uint64_t next = (offset | ((1ull << shift) - 1)) + 1;
+    return next > offset ? next : UINT64_MAX;
+}
+
 inline void move_vm_page_list_node(VmPageListNode* dest, VmPageListNode* src) {
     // Called by move ctor/assignment. Move assignment clears the dest node first.
     ASSERT(dest->IsEmpty());
@@ -93,75 +134,191 @@ VmPageList::VmPageList() {
 
 VmPageList::~VmPageList() {
     LTRACEF("%p\n", this);
-    DEBUG_ASSERT(list_.is_empty());
+    DEBUG_ASSERT(root_ == nullptr);
 }
 
-zx_status_t VmPageList::AddPage(vm_page* p, uint64_t offset) {
-    uint64_t node_offset = offset_to_node_offset(offset);
-    size_t index = offset_to_node_index(offset);
+VmPageListNode* VmPageList::LookupLeaf(uint64_t offset, uint64_t* next_offset) const {
+    if (!root_ || !height_covers(height_, offset)) {
+        *next_offset = UINT64_MAX;
+        return nullptr;
+    }
+
+    void* node = root_;
+    for (uint level = height_; level > 0; level--) {
+        node = static_cast<InnerNode*>(node)->slots[offset_to_slot(offset, level)];
+        if (!node) {
+            // nothing anywhere under this slot
+            *next_offset = next_block(offset, level_shift(level));
+            return nullptr;
+        }
+    }
 
-    LTRACEF_LEVEL(2, "%p page %p, offset %#" PRIx64 " node_offset %#" PRIx64 " index %zu\n", this, p, offset,
-                  node_offset, index);
+    *next_offset = next_block(offset, kLeafShift);
+    return static_cast<VmPageListNode*>(node);
+}
+
+zx_status_t VmPageList::GetOrAllocLeaf(uint64_t offset, VmPageListNode** leaf) {
+    fbl::AllocChecker ac;
+
+    // grow the tree upwards until it reaches the offset, keeping what's already
+    // there in the first slot of each new root
+    while (!height_covers(height_, offset)) {
+        if (root_) {
+            InnerNode* inner = new (&ac) InnerNode;
+            if (!ac.check()) {
+                return ZX_ERR_NO_MEMORY;
+            }
+            inner->slots[0] = root_;
+            inner->count = 1;
+            root_ = inner;
+        }
+        height_++;
+    }
 
-    // lookup the tree node that holds this page
-    auto pln = list_.find(node_offset);
-    if (!pln.IsValid()) {
-        fbl::AllocChecker ac;
-        ktl::unique_ptr<VmPageListNode> pl =
-            ktl::unique_ptr<VmPageListNode>(new (&ac) VmPageListNode(node_offset));
+    // then walk down, filling in any missing nodes
+    InnerNode* parent = nullptr;
+    void** slot = &root_;
+    for (uint level = height_; level > 0; level--) {
+        if (!*slot) {
+            InnerNode* inner = new (&ac) InnerNode;
+            if (!ac.check()) {
+                // drop any inner nodes we just added that lead nowhere
+                UnlinkLeaf(offset);
+                return ZX_ERR_NO_MEMORY;
+            }
+            LTRACEF("allocating new inner node %p at level %u\n", inner, level);
+            *slot = inner;
+            if (parent) {
+                parent->count++;
+            }
+        }
+        parent = static_cast<InnerNode*>(*slot);
+        slot = &parent->slots[offset_to_slot(offset, level)];
+    }
+
+    if (!*slot) {
+        VmPageListNode* pl = new (&ac) VmPageListNode(offset_to_node_offset(offset));
         if (!ac.check()) {
+            UnlinkLeaf(offset);
             return ZX_ERR_NO_MEMORY;
         }
+        LTRACEF("allocating new leaf node %p\n", pl);
+        *slot = pl;
+        if (parent) {
+            parent->count++;
+        }
+    }
+
+    *leaf = static_cast<VmPageListNode*>(*slot);
+    return ZX_OK;
+}
+
+VmPageListNode* VmPageList::UnlinkLeaf(uint64_t offset) {
+    if (!height_covers(height_, offset)) {
+        return nullptr;
+    }
+
+    // walk down, remembering the inner nodes passed through and the slot taken in each
+    InnerNode* nodes[kMaxHeight];
+    void** slots[kMaxHeight + 1];
+    uint depth = 0;
+    slots[0] = &root_;
+    while (depth < height_ && *slots[depth]) {
+        nodes[depth] = static_cast<InnerNode*>(*slots[depth]);
+        slots[depth + 1] = &nodes[depth]->slots[offset_to_slot(offset, height_ - depth)];
+        depth++;
+    }
+
+    VmPageListNode* leaf = nullptr;
+    if (depth == height_ && *slots[depth]) {
+        leaf = static_cast<VmPageListNode*>(*slots[depth]);
+        *slots[depth] = nullptr;
+        if (depth > 0) {
+            nodes[depth - 1]->count--;
+        }
+    }
 
-        LTRACEF("allocating new inner node %p\n", pl.get());
-        __UNUSED auto status = pl->AddPage(p, index);
-        DEBUG_ASSERT(status == ZX_OK);
+    // free the inner nodes that are now empty, from the bottom up
+    for (; depth > 0 && nodes[depth - 1]->count == 0; depth--) {
+        delete nodes[depth - 1];
+        *slots[depth - 1] = nullptr;
+        if (depth > 1) {
+            nodes[depth - 2]->count--;
+        }
+    }
 
-        list_.insert(ktl::move(pl));
-        return ZX_OK;
-    } else {
-        return pln->AddPage(p, index);
+    if (!root_) {
+        height_ = 0;
     }
+    return leaf;
+}
+
+void VmPageList::FreeSubtree(void* node, uint level) {
+    if (level == 0) {
+        delete static_cast<VmPageListNode*>(node);
+        return;
+    }
+
+    auto inner = static_cast<InnerNode*>(node);
+    for (auto child : inner->slots) {
+        if (child) {
+            FreeSubtree(child, level - 1);
+        }
+    }
+    delete inner;
+}
+
+zx_status_t VmPageList::AddPage(vm_page* p, uint64_t offset) {
+    size_t index = offset_to_node_index(offset);
+
+    LTRACEF_LEVEL(2, "%p page %p, offset %#" PRIx64 " index %zu\n", this, p, offset, index);
+
+    // lookup the leaf that holds this page
+    VmPageListNode* pl;
+    zx_status_t status = GetOrAllocLeaf(offset, &pl);
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    return pl->AddPage(p, index);
 }
 
 vm_page* VmPageList::GetPage(uint64_t offset) {
-    uint64_t node_offset = offset_to_node_offset(offset);
     size_t index = offset_to_node_index(offset);
 
-    LTRACEF_LEVEL(2, "%p offset %#" PRIx64 " node_offset %#" PRIx64 " index %zu\n", this, offset, node_offset,
-                  index);
+    LTRACEF_LEVEL(2, "%p offset %#" PRIx64 " index %zu\n", this, offset, index);
 
-    // lookup the tree node that holds this page
-    auto pln = list_.find(node_offset);
-    if (!pln.IsValid()) {
+    // lookup the leaf that holds this page
+    uint64_t next_offset;
+    VmPageListNode* pl = LookupLeaf(offset, &next_offset);
+    if (!pl) {
         return nullptr;
     }
 
-    return pln->GetPage(index);
+    return pl->GetPage(index);
 }
 
 bool VmPageList::RemovePage(uint64_t offset, vm_page_t** page_out) {
     DEBUG_ASSERT(page_out);
 
-    uint64_t node_offset = offset_to_node_offset(offset);
     size_t index = offset_to_node_index(offset);
 
-    LTRACEF_LEVEL(2, "%p offset %#" PRIx64 " node_offset %#" PRIx64 " index %zu\n", this, offset, node_offset,
-                  index);
+    LTRACEF_LEVEL(2, "%p offset %#" PRIx64 " index %zu\n", this, offset, index);
 
-    // lookup the tree node that holds this page
-    auto pln = list_.find(node_offset);
-    if (!pln.IsValid()) {
+    // lookup the leaf that holds this page
+    uint64_t next_offset;
+    VmPageListNode* pl = LookupLeaf(offset, &next_offset);
+    if (!pl) {
         return false;
     }
 
     // free this page
-    auto page = pln->RemovePage(index);
+    auto page = pl->RemovePage(index);
     if (page) {
-        // if it was the last page in the node, remove the node from the tree
-        if (pln->IsEmpty()) {
+        // if it was the last page in the leaf, remove the leaf from the tree
+        if (pl->IsEmpty()) {
             LTRACEF_LEVEL(2, "%p freeing the list node\n", this);
-            list_.erase(*pln);
+            delete UnlinkLeaf(offset);
         }
 
         *page_out = page;
@@ -172,16 +329,6 @@ bool VmPageList::RemovePage(uint64_t offset, vm_page_t** page_out) {
 }
 
 void VmPageList::FreePages(uint64_t start_offset, uint64_t end_offset) {
-    // Find the first node with a start after start_offset; if start_offset
-    // is in a node, it'll be in the one before that one.
-    auto start = --list_.upper_bound(start_offset);
-    if (!start.IsValid()) {
-        start = list_.begin();
-    }
-    // Find the first node which is completely after the end of the region. If
-    // end_offset falls in the middle of a node, this finds the next node.
-    const auto end = list_.lower_bound(end_offset);
-
     list_node list;
     list_initialize(&list);
 
@@ -193,15 +340,17 @@ void VmPageList::FreePages(uint64_t start_offset, uint64_t end_offset) {
         return ZX_ERR_NEXT;
     };
 
-    // Iterate through all nodes which have at least some overlap with the
-    // region, freeing the pages and erasing nodes which become empty.
-    while (start != end) {
-        auto cur = start++;
-        cur->ForEveryPage(per_page_func, start_offset, end_offset);
-        if (cur->IsEmpty()) {
-            list_.erase(cur);
-        }
-    }
+    // Iterate through all leaves which have at least some overlap with the
+    // region, freeing the pages and dropping leaves which become empty.
+    ForEveryLeafInRange(
+        [this, &per_page_func, start_offset, end_offset](VmPageListNode* pl) {
+            pl->ForEveryPage(per_page_func, start_offset, end_offset);
+            if (pl->IsEmpty()) {
+                delete UnlinkLeaf(pl->offset());
+            }
+            return ZX_ERR_NEXT;
+        },
+        start_offset, end_offset);
 
     pmm_free(&list);
 }
@@ -231,13 +380,17 @@ size_t VmPageList::FreeAllPages() {
     pmm_free(&list);
 
     // empty the tree
-    list_.clear();
+    if (root_) {
+        FreeSubtree(root_, height_);
+        root_ = nullptr;
+    }
+    height_ = 0;
 
     return count;
 }
 
 bool VmPageList::IsEmpty() {
-    return list_.is_empty();
+    return root_ == nullptr;
 }
 
 VmPageSpliceList VmPageList::TakePages(uint64_t offset, uint64_t length) {
@@ -255,13 +408,16 @@ VmPageSpliceList VmPageList::TakePages(uint64_t offset, uint64_t length) {
     }
 
     // As long as the current and end node offsets are different, we
-    // can just move the whole node into the splice list.
-    while (offset_to_node_offset(offset) != offset_to_node_offset(end)) {
-        ktl::unique_ptr<VmPageListNode> node = list_.erase(offset_to_node_offset(offset));
-        if (node) {
+    // can just move the whole node into the splice list, skipping over
+    // any empty parts of the tree.
+    const uint64_t end_node_offset = offset_to_node_offset(end);
+    while (offset < end_node_offset) {
+        uint64_t next_offset;
+        if (LookupLeaf(offset, &next_offset)) {
+            ktl::unique_ptr<VmPageListNode> node(UnlinkLeaf(offset));
             res.middle_.insert(ktl::move(node));
         }
-        offset += (PAGE_SIZE * VmPageListNode::kPageFanOut);
+        offset = fbl::min(next_offset, end_node_offset);
     }
 
     // Move any remaining pages into the splice list tail_ node.
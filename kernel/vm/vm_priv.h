@@ -16,6 +16,12 @@
 
 #define VM_GLOBAL_TRACE 0
 
+// vmos back aligned blocks of this size with a single physically contiguous run of
+// pages where they can, so that mappings of those blocks can use a large mmu page
+#define VM_LARGE_PAGE_SHIFT 21
+#define VM_LARGE_PAGE_SIZE (1UL << VM_LARGE_PAGE_SHIFT)
+#define VM_LARGE_PAGE_COUNT (VM_LARGE_PAGE_SIZE / PAGE_SIZE)
+
 // return a pointer to the zero page
 static inline vm_page_t* vm_get_zero_page(void) {
     extern vm_page_t* zero_page;
@@ -28,3 +34,36 @@ static inline paddr_t vm_get_zero_page_paddr(void) {
 
     return zero_page_paddr;
 }
+
+// whether vmos should try to back blocks with large pages, see kernel.vm.large-pages
+static inline bool vm_large_pages_enabled(void) {
+    extern bool large_pages_enabled;
+
+    return large_pages_enabled;
+}
+
+// largest window kernel.vm.fault-around may ask for, in pages
+#define VM_FAULT_AROUND_MAX_PAGES 64
+
+// number of pages in the window mapped in around a page fault, a power of two
+// no larger than VM_FAULT_AROUND_MAX_PAGES. see kernel.vm.fault-around
+static inline size_t vm_fault_around_pages(void) {
+    extern size_t fault_around_pages;
+
+    return fault_around_pages;
+}
+
+// whether write faults may commit the rest of their window, see kernel.vm.fault-around-commit
+static inline bool vm_fault_around_commit(void) {
+    extern bool fault_around_commit;
+
+    return fault_around_commit;
+}
+
+// most pages a fault on a pager-backed vmo may ask its pager for, at least one.
+// see kernel.vm.pager-read-ahead
+static inline uint64_t vm_pager_read_ahead_pages(void) {
+    extern uint64_t pager_read_ahead_pages;
+
+    return pager_read_ahead_pages;
+}
@@ -8,8 +8,12 @@
 #include <err.h>
 #include <fbl/alloc_checker.h>
 #include <fbl/array.h>
+#include <inttypes.h>
 #include <ktl/move.h>
 #include <lib/unittest/unittest.h>
+#include <platform.h>
+#include <pow2.h>
+#include <vm/fault.h>
 #include <vm/physmap.h>
 #include <vm/vm.h>
 #include <vm/vm_address_region.h>
@@ -19,6 +23,8 @@
 #include <vm/vm_object_physical.h>
 #include <zircon/types.h>
 
+#include "vm_priv.h"
+
 static const uint kArchRwFlags = ARCH_MMU_FLAG_PERM_READ | ARCH_MMU_FLAG_PERM_WRITE;
 
 // Allocates a single page, translates it to a vm_page_t and frees it.
@@ -85,6 +91,93 @@ static bool pmm_alloc_contiguous_one_test() {
     END_TEST;
 }
 
+// Allocates and frees enough single pages to cycle them through the per cpu page
+// caches and back, making sure no page is handed out twice along the way.
+static bool pmm_alloc_free_cycle_test() {
+    BEGIN_TEST;
+
+    static const size_t alloc_count = 512;
+
+    fbl::AllocChecker ac;
+    fbl::Array<vm_page_t*> pages(new (&ac) vm_page_t*[alloc_count], alloc_count);
+    ASSERT_TRUE(ac.check(), "");
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < alloc_count; i++) {
+            paddr_t pa;
+            zx_status_t status = pmm_alloc_page(0, &pages[i], &pa);
+            ASSERT_EQ(ZX_OK, status, "pmm_alloc single page");
+            EXPECT_EQ(VM_PAGE_STATE_ALLOC, pages[i]->state, "");
+
+            // tag each page so a page given out twice shows up below
+            *static_cast<size_t*>(paddr_to_physmap(pa)) = i;
+        }
+        for (size_t i = 0; i < alloc_count; i++) {
+            EXPECT_EQ(i, *static_cast<size_t*>(paddr_to_physmap(pages[i]->paddr())),
+                      "page allocated twice");
+        }
+        for (size_t i = 0; i < alloc_count; i++) {
+            pmm_free_page(pages[i]);
+        }
+    }
+
+    // pages left in the caches must still be available to a contiguous allocation
+    list_node list = LIST_INITIAL_VALUE(list);
+    paddr_t pa;
+    zx_status_t status = pmm_alloc_contiguous(4, 0, PAGE_SIZE_SHIFT, &pa, &list);
+    EXPECT_EQ(ZX_OK, status, "pmm_alloc_contiguous after cycling pages");
+    pmm_free(&list);
+
+    END_TEST;
+}
+
+static bool page_is_zero(paddr_t pa) {
+    const uint64_t* words = static_cast<const uint64_t*>(paddr_to_physmap(pa));
+    for (size_t i = 0; i < PAGE_SIZE / sizeof(uint64_t); i++) {
+        if (words[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Dirties a batch of pages and frees them, then checks that PMM_ALLOC_FLAG_ZERO
+// allocations come back zero filled whether or not the zero thread got to them.
+static bool pmm_alloc_zeroed_test() {
+    BEGIN_TEST;
+
+    static const size_t alloc_count = 64;
+
+    list_node list = LIST_INITIAL_VALUE(list);
+    zx_status_t status = pmm_alloc_pages(alloc_count, 0, &list);
+    ASSERT_EQ(ZX_OK, status, "pmm_alloc_pages");
+    vm_page_t* page;
+    list_for_every_entry (&list, page, vm_page_t, queue_node) {
+        memset(paddr_to_physmap(page->paddr()), 0xa5, PAGE_SIZE);
+    }
+    pmm_free(&list);
+
+    status = pmm_alloc_pages(alloc_count, PMM_ALLOC_FLAG_ZERO, &list);
+    ASSERT_EQ(ZX_OK, status, "pmm_alloc_pages zeroed");
+    list_for_every_entry (&list, page, vm_page_t, queue_node) {
+        EXPECT_TRUE(page_is_zero(page->paddr()), "pmm_alloc_pages page not zeroed");
+        EXPECT_FALSE(page->flags & VM_PAGE_FLAG_ZEROED, "zeroed flag left set");
+    }
+    pmm_free(&list);
+
+    for (size_t i = 0; i < alloc_count; i++) {
+        paddr_t pa;
+        status = pmm_alloc_page(PMM_ALLOC_FLAG_ZERO, &page, &pa);
+        ASSERT_EQ(ZX_OK, status, "pmm_alloc_page zeroed");
+        EXPECT_TRUE(page_is_zero(pa), "pmm_alloc_page page not zeroed");
+        // dirty it again on the way back, so the next iteration can't get lucky
+        memset(paddr_to_physmap(pa), 0x5a, PAGE_SIZE);
+        pmm_free_page(page);
+    }
+
+    END_TEST;
+}
+
 static uint32_t test_rand(uint32_t seed) {
     return (seed = seed * 1664525 + 1013904223);
 }
@@ -601,6 +694,62 @@ static bool vmo_precommitted_map_test() {
     END_TEST;
 }
 
+// Maps a committed vm object that spans two large pages, then unmaps a single page
+// in the middle of the first one.  The rest of the block has to stay mapped, and
+// faulting the page back in has to see the same memory as before.
+static bool vmo_large_page_split_test() {
+    BEGIN_TEST;
+
+    // Large pages are opt-in; without them this is just a small page unmap.
+    if (!vm_large_pages_enabled()) {
+        printf("skipping test vmo_large_page_split, kernel.vm.large-pages is off\n");
+        return true;
+    }
+
+    static const size_t alloc_size = VM_LARGE_PAGE_SIZE * 2;
+    fbl::RefPtr<VmObject> vmo;
+    zx_status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0u, alloc_size, &vmo);
+    ASSERT_EQ(status, ZX_OK, "vmobject creation\n");
+    ASSERT_TRUE(vmo, "vmobject creation\n");
+
+    auto ka = VmAspace::kernel_aspace();
+    void* ptr;
+    auto ret = ka->MapObjectInternal(vmo, "test", 0, alloc_size, &ptr,
+                                     VM_LARGE_PAGE_SHIFT, VmAspace::VMM_FLAG_COMMIT,
+                                     kArchRwFlags);
+    ASSERT_EQ(ZX_OK, ret, "mapping object");
+    EXPECT_TRUE(IS_ALIGNED(ptr, VM_LARGE_PAGE_SIZE), "mapping alignment");
+
+    const uintptr_t seed = (uintptr_t)ptr;
+    fill_region(seed, ptr, alloc_size);
+
+    uint8_t* base = static_cast<uint8_t*>(ptr);
+    uint8_t* hole = base + VM_LARGE_PAGE_SIZE / 2;
+    size_t unmapped;
+    status = ka->arch_aspace().Unmap((vaddr_t)hole, 1, &unmapped);
+    ASSERT_EQ(ZX_OK, status, "unmapping page\n");
+    EXPECT_EQ(1u, unmapped, "unmapping page\n");
+
+    paddr_t pa;
+    EXPECT_EQ(ZX_ERR_NOT_FOUND, ka->arch_aspace().Query((vaddr_t)hole, &pa, nullptr),
+              "page is unmapped\n");
+    EXPECT_EQ(ZX_OK, ka->arch_aspace().Query((vaddr_t)(hole - PAGE_SIZE), &pa, nullptr),
+              "page before is mapped\n");
+    EXPECT_EQ(ZX_OK, ka->arch_aspace().Query((vaddr_t)(hole + PAGE_SIZE), &pa, nullptr),
+              "page after is mapped\n");
+    EXPECT_TRUE(test_region(seed, ptr, hole - base), "memory before the hole");
+
+    // fault the page back in, which may map the whole block as one again
+    *reinterpret_cast<volatile uint32_t*>(hole) = 0;
+    EXPECT_EQ(ZX_OK, ka->arch_aspace().Query((vaddr_t)hole, &pa, nullptr),
+              "page is mapped again\n");
+    EXPECT_TRUE(test_region(seed, ptr, hole - base), "memory before the hole");
+
+    auto err = ka->FreeRegion((vaddr_t)ptr);
+    EXPECT_EQ(ZX_OK, err, "unmapping object");
+    END_TEST;
+}
+
 // Creates a vm object, maps it, demand paged.
 static bool vmo_demand_paged_map_test() {
     BEGIN_TEST;
@@ -626,6 +775,57 @@ static bool vmo_demand_paged_map_test() {
     END_TEST;
 }
 
+// Faults on one page of a mapping of a committed vm object, and checks that
+// the rest of its fault-around window got mapped along with it.
+static bool vmo_fault_around_test() {
+    BEGIN_TEST;
+    static const size_t alloc_size = PAGE_SIZE * VM_FAULT_AROUND_MAX_PAGES * 2;
+    fbl::RefPtr<VmObject> vmo;
+    zx_status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0u, alloc_size, &vmo);
+    ASSERT_EQ(status, ZX_OK, "vmobject creation\n");
+    ASSERT_TRUE(vmo, "vmobject creation\n");
+    status = vmo->CommitRange(0, alloc_size);
+    ASSERT_EQ(ZX_OK, status, "committing vm object\n");
+
+    // align the mapping so it starts on a window boundary whatever the window size is
+    auto ka = VmAspace::kernel_aspace();
+    void* ptr;
+    auto ret = ka->MapObjectInternal(vmo, "test", 0, alloc_size, &ptr,
+                                     log2_uint_floor(VM_FAULT_AROUND_MAX_PAGES * PAGE_SIZE),
+                                     0, kArchRwFlags);
+    ASSERT_EQ(ret, ZX_OK, "mapping object");
+
+    VmAspace::fault_stats_t before;
+    ka->GetFaultStats(&before);
+
+    // read fault the first page
+    volatile uint8_t* base = static_cast<volatile uint8_t*>(ptr);
+    EXPECT_EQ(0u, base[0], "reading first page\n");
+
+    const size_t window_pages = vm_fault_around_pages();
+    for (size_t i = 1; i < VM_FAULT_AROUND_MAX_PAGES; i++) {
+        vaddr_t va = reinterpret_cast<vaddr_t>(ptr) + i * PAGE_SIZE;
+        status = ka->arch_aspace().Query(va, nullptr, nullptr);
+        if (i < window_pages) {
+            EXPECT_EQ(ZX_OK, status, "page in window not mapped\n");
+        } else {
+            EXPECT_EQ(ZX_ERR_NOT_FOUND, status, "page outside window mapped\n");
+        }
+    }
+
+    VmAspace::fault_stats_t after;
+    ka->GetFaultStats(&after);
+    EXPECT_LT(before.faults, after.faults, "fault not counted\n");
+    if (window_pages > 1) {
+        EXPECT_LE(before.fault_around_pages + window_pages - 1, after.fault_around_pages,
+                  "fault-around pages not counted\n");
+    }
+
+    auto err = ka->FreeRegion((vaddr_t)ptr);
+    EXPECT_EQ(ZX_OK, err, "unmapping object");
+    END_TEST;
+}
+
 // Creates a vm object, maps it, drops ref before unmapping.
 static bool vmo_dropped_ref_test() {
     BEGIN_TEST;
@@ -1038,6 +1238,213 @@ static bool arch_noncontiguous_map() {
     END_TEST;
 }
 
+// Fills a page with a short run of random words repeated over and over, which
+// LZ4 squeezes down to very little.
+static void fill_compressible_page(uintptr_t seed, void* page) {
+    static const size_t kRunSize = 64;
+    fill_region(seed, page, kRunSize);
+    for (size_t off = kRunSize; off < PAGE_SIZE; off += kRunSize) {
+        memcpy(static_cast<uint8_t*>(page) + off, page, kRunSize);
+    }
+}
+
+static bool test_compressible_page(uintptr_t seed, void* page) {
+    static const size_t kRunSize = 64;
+    for (size_t off = 0; off < PAGE_SIZE; off += kRunSize) {
+        if (!test_region(seed, static_cast<uint8_t*>(page) + off, kRunSize)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Compresses the pages of a VMO, checking that pages are only compressed once
+// they are old enough, and that their contents come back on the next touch.
+static bool vmo_compress_test() {
+    BEGIN_TEST;
+
+    static const size_t page_count = 16;
+    static const size_t alloc_size = PAGE_SIZE * page_count;
+    fbl::RefPtr<VmObject> vmo;
+    zx_status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0, alloc_size, &vmo);
+    ASSERT_EQ(ZX_OK, status, "vmobject creation\n");
+    auto paged = static_cast<VmObjectPaged*>(vmo.get());
+
+    fbl::AllocChecker ac;
+    fbl::Array<uint8_t> buf(new (&ac) uint8_t[PAGE_SIZE], PAGE_SIZE);
+    ASSERT_TRUE(ac.check(), "");
+    for (size_t i = 0; i < page_count; i++) {
+        fill_compressible_page(i, buf.get());
+        status = vmo->Write(buf.get(), i * PAGE_SIZE, PAGE_SIZE);
+        ASSERT_EQ(ZX_OK, status, "writing to object\n");
+    }
+    EXPECT_EQ(page_count, vmo->AllocatedPagesInRange(0, alloc_size), "committed pages\n");
+
+    // every scan ages the pages by one, until they are old enough to compress
+    for (uint age = 0; age < 2; age++) {
+        EXPECT_EQ(0u, paged->ReclaimPages(page_count, 2), "reclaiming young pages\n");
+    }
+    EXPECT_EQ(page_count, paged->ReclaimPages(page_count, 2), "reclaiming old pages\n");
+    EXPECT_EQ(0u, vmo->AllocatedPagesInRange(0, alloc_size), "committed pages\n");
+
+    // reading a page brings it back young
+    status = vmo->Read(buf.get(), 3 * PAGE_SIZE, PAGE_SIZE);
+    EXPECT_EQ(ZX_OK, status, "reading from object\n");
+    EXPECT_TRUE(test_compressible_page(3, buf.get()), "decompressed contents\n");
+    EXPECT_EQ(1u, vmo->AllocatedPagesInRange(0, alloc_size), "committed pages\n");
+    EXPECT_EQ(0u, paged->ReclaimPages(page_count, 1), "reclaiming a young page\n");
+
+    // a speculative lookup leaves compressed pages where they are
+    paddr_t pa;
+    status = vmo->GetPage(4 * PAGE_SIZE, VMM_PF_FLAG_SPECULATIVE, nullptr, nullptr, &pa);
+    EXPECT_EQ(ZX_ERR_NOT_FOUND, status, "speculative lookup\n");
+    EXPECT_EQ(1u, vmo->AllocatedPagesInRange(0, alloc_size), "committed pages\n");
+
+    // pinned pages stay put, and pinning brings compressed pages back
+    status = vmo->Pin(0, 2 * PAGE_SIZE);
+    EXPECT_EQ(ZX_OK, status, "pinning compressed pages\n");
+    EXPECT_EQ(3u, vmo->AllocatedPagesInRange(0, alloc_size), "committed pages\n");
+    EXPECT_EQ(1u, paged->ReclaimPages(page_count, 0), "reclaiming with pinned pages\n");
+    vmo->Unpin(0, 2 * PAGE_SIZE);
+
+    // a page that doesn't compress is left alone
+    fill_region(99, buf.get(), PAGE_SIZE);
+    status = vmo->Write(buf.get(), 5 * PAGE_SIZE, PAGE_SIZE);
+    EXPECT_EQ(ZX_OK, status, "writing to object\n");
+    EXPECT_EQ(2u, paged->ReclaimPages(page_count, 0), "reclaiming pages\n");
+    EXPECT_EQ(1u, vmo->AllocatedPagesInRange(0, alloc_size), "committed pages\n");
+
+    // decommitting throws compressed pages away
+    status = vmo->DecommitRange(0, 4 * PAGE_SIZE);
+    EXPECT_EQ(ZX_OK, status, "decommitting\n");
+
+    for (size_t i = 0; i < page_count; i++) {
+        status = vmo->Read(buf.get(), i * PAGE_SIZE, PAGE_SIZE);
+        EXPECT_EQ(ZX_OK, status, "reading from object\n");
+        if (i < 4) {
+            bool zero = true;
+            for (size_t j = 0; j < PAGE_SIZE; j++) {
+                zero = zero && buf[j] == 0;
+            }
+            EXPECT_TRUE(zero, "decommitted contents\n");
+        } else if (i == 5) {
+            EXPECT_TRUE(test_region(99, buf.get(), PAGE_SIZE), "incompressible contents\n");
+        } else {
+            EXPECT_TRUE(test_compressible_page(i, buf.get()), "decompressed contents\n");
+        }
+    }
+
+    END_TEST;
+}
+
+// Keeps many times more memory in VMOs than it ever lets be resident, by
+// compressing each VMO as soon as it has been filled, then checks every page
+// as it is brought back a VMO at a time.
+static bool vmo_compress_oversubscribe_test() {
+    BEGIN_TEST;
+
+    static const size_t vmo_count = 32;
+    static const size_t pages_per_vmo = 128;
+    static const size_t vmo_size = pages_per_vmo * PAGE_SIZE;
+
+    fbl::AllocChecker ac;
+    fbl::Array<fbl::RefPtr<VmObject>> vmos(new (&ac) fbl::RefPtr<VmObject>[vmo_count],
+                                           vmo_count);
+    ASSERT_TRUE(ac.check(), "");
+    fbl::Array<uint8_t> buf(new (&ac) uint8_t[PAGE_SIZE], PAGE_SIZE);
+    ASSERT_TRUE(ac.check(), "");
+
+    auto resident_pages = [&vmos]() {
+        size_t count = 0;
+        for (size_t v = 0; v < vmo_count; v++) {
+            if (vmos[v]) {
+                count += vmos[v]->AllocatedPagesInRange(0, vmo_size);
+            }
+        }
+        return count;
+    };
+
+    for (size_t v = 0; v < vmo_count; v++) {
+        zx_status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0, vmo_size, &vmos[v]);
+        ASSERT_EQ(ZX_OK, status, "vmobject creation\n");
+        for (size_t i = 0; i < pages_per_vmo; i++) {
+            fill_compressible_page(v * pages_per_vmo + i, buf.get());
+            status = vmos[v]->Write(buf.get(), i * PAGE_SIZE, PAGE_SIZE);
+            ASSERT_EQ(ZX_OK, status, "writing to object\n");
+        }
+        auto paged = static_cast<VmObjectPaged*>(vmos[v].get());
+        EXPECT_EQ(pages_per_vmo, paged->ReclaimPages(pages_per_vmo, 0), "reclaiming\n");
+        EXPECT_EQ(0u, resident_pages(), "resident pages\n");
+    }
+
+    // read them back in an order unrelated to the one they were written in,
+    // compressing each VMO again once it has been checked
+    for (size_t n = 0; n < vmo_count; n++) {
+        const size_t v = (n * 7) % vmo_count;
+        for (size_t i = 0; i < pages_per_vmo; i++) {
+            const size_t page = (i * 5) % pages_per_vmo;
+            zx_status_t status = vmos[v]->Read(buf.get(), page * PAGE_SIZE, PAGE_SIZE);
+            ASSERT_EQ(ZX_OK, status, "reading from object\n");
+            EXPECT_TRUE(test_compressible_page(v * pages_per_vmo + page, buf.get()),
+                        "decompressed contents\n");
+        }
+        EXPECT_EQ(pages_per_vmo, resident_pages(), "resident pages\n");
+        auto paged = static_cast<VmObjectPaged*>(vmos[v].get());
+        EXPECT_EQ(pages_per_vmo, paged->ReclaimPages(pages_per_vmo, 0), "reclaiming\n");
+    }
+
+    END_TEST;
+}
+
+// Times committing, looking up every page of and decommitting a large VMO,
+// which is dominated by VmPageList operations once the pages themselves are
+// cheap to come by.
+static bool vmo_large_commit_benchmark() {
+    BEGIN_TEST;
+
+    static const size_t alloc_size = 256 * 1024 * 1024;
+    static const size_t page_count = alloc_size / PAGE_SIZE;
+    if (pmm_count_free_pages() < 2 * page_count) {
+        unittest_printf("not enough free memory, skipping\n");
+        END_TEST;
+    }
+
+    fbl::RefPtr<VmObject> vmo;
+    zx_status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, 0u, alloc_size, &vmo);
+    ASSERT_EQ(status, ZX_OK, "vmobject creation\n");
+    ASSERT_TRUE(vmo, "vmobject creation\n");
+
+    zx_time_t t = current_time();
+    status = vmo->CommitRange(0, alloc_size);
+    zx_duration_t commit_time = current_time() - t;
+    ASSERT_EQ(ZX_OK, status, "committing vm object\n");
+    EXPECT_EQ(page_count, vmo->AllocatedPages(), "committing vm object\n");
+
+    t = current_time();
+    for (uint64_t off = 0; off < alloc_size; off += PAGE_SIZE) {
+        paddr_t pa;
+        status = vmo->GetPage(off, 0, nullptr, nullptr, &pa);
+        if (status != ZX_OK) {
+            break;
+        }
+    }
+    zx_duration_t lookup_time = current_time() - t;
+    EXPECT_EQ(ZX_OK, status, "looking up committed page\n");
+
+    t = current_time();
+    status = vmo->DecommitRange(0, alloc_size);
+    zx_duration_t decommit_time = current_time() - t;
+    EXPECT_EQ(ZX_OK, status, "decommitting vm object\n");
+    EXPECT_EQ(0u, vmo->AllocatedPages(), "decommitting vm object\n");
+
+    unittest_printf("%zu pages: commit %" PRIi64 " nsecs, lookup %" PRIi64
+                    " nsecs (%" PRIi64 " per page), decommit %" PRIi64 " nsecs\n",
+                    page_count, commit_time, lookup_time,
+                    lookup_time / static_cast<zx_duration_t>(page_count), decommit_time);
+
+    END_TEST;
+}
+
 // Basic test that checks adding/removing a page
 static bool vmpl_add_remove_page_test() {
     BEGIN_TEST;
@@ -1281,6 +1688,47 @@ static bool vmpl_take_cleanup_test() {
     END_TEST;
 }
 
+// Spreads pages thinly across a very large offset range, so every page lands
+// in its own leaf and each operation has to walk the full depth of the list,
+// and times adding, looking up and removing them.
+static bool vmpl_sparse_benchmark() {
+    BEGIN_TEST;
+
+    static const size_t kCount = 4096;
+    static const uint64_t kStride = 4ull * 1024 * 1024 * 1024;
+    fbl::AllocChecker ac;
+    fbl::Array<vm_page_t> pages(new (&ac) vm_page_t[kCount](), kCount);
+    ASSERT_TRUE(ac.check(), "allocating test pages\n");
+
+    VmPageList pl;
+    zx_time_t t = current_time();
+    for (size_t i = 0; i < kCount; i++) {
+        EXPECT_EQ(ZX_OK, pl.AddPage(&pages[i], i * kStride), "adding page\n");
+    }
+    zx_duration_t add_time = current_time() - t;
+
+    t = current_time();
+    for (size_t i = 0; i < kCount; i++) {
+        EXPECT_EQ(&pages[i], pl.GetPage(i * kStride), "unexpected page\n");
+    }
+    zx_duration_t lookup_time = current_time() - t;
+
+    t = current_time();
+    for (size_t i = 0; i < kCount; i++) {
+        vm_page* remove_page;
+        EXPECT_TRUE(pl.RemovePage(i * kStride, &remove_page), "remove failure\n");
+        EXPECT_EQ(&pages[i], remove_page, "unexpected page\n");
+    }
+    zx_duration_t remove_time = current_time() - t;
+    EXPECT_TRUE(pl.IsEmpty(), "list not empty\n");
+
+    unittest_printf("%zu sparse pages: add %" PRIi64 " nsecs, lookup %" PRIi64
+                    " nsecs, remove %" PRIi64 " nsecs\n",
+                    kCount, add_time, lookup_time, remove_time);
+
+    END_TEST;
+}
+
 // Use the function name as the test name
 #define VM_UNITTEST(fname) UNITTEST(#fname, fname)
 
@@ -1304,12 +1752,17 @@ VM_UNITTEST(vmo_create_contiguous_test)
 VM_UNITTEST(vmo_contiguous_decommit_test)
 VM_UNITTEST(vmo_precommitted_map_test)
 VM_UNITTEST(vmo_demand_paged_map_test)
+VM_UNITTEST(vmo_large_page_split_test)
+VM_UNITTEST(vmo_fault_around_test)
 VM_UNITTEST(vmo_dropped_ref_test)
 VM_UNITTEST(vmo_remap_test)
 VM_UNITTEST(vmo_double_remap_test)
 VM_UNITTEST(vmo_read_write_smoke_test)
 VM_UNITTEST(vmo_cache_test)
 VM_UNITTEST(vmo_lookup_test)
+VM_UNITTEST(vmo_compress_test)
+VM_UNITTEST(vmo_compress_oversubscribe_test)
+VM_UNITTEST(vmo_large_commit_benchmark)
 VM_UNITTEST(arch_noncontiguous_map)
 // Uncomment for debugging
 // VM_UNITTEST(dump_all_aspaces)  // Run last
@@ -1319,6 +1772,8 @@ UNITTEST_START_TESTCASE(pmm_tests)
 VM_UNITTEST(pmm_smoke_test)
 VM_UNITTEST(pmm_alloc_contiguous_one_test)
 VM_UNITTEST(pmm_multi_alloc_test)
+VM_UNITTEST(pmm_alloc_free_cycle_test)
+VM_UNITTEST(pmm_alloc_zeroed_test)
 // runs the system out of memory, uncomment for debugging
 //VM_UNITTEST(pmm_oversized_alloc_test)
 UNITTEST_END_TESTCASE(pmm_tests, "pmm", "Physical memory manager tests");
@@ -1333,4 +1788,5 @@ VM_UNITTEST(vmpl_take_all_pages_test)
 VM_UNITTEST(vmpl_take_middle_pages_test)
 VM_UNITTEST(vmpl_take_gap_test)
 VM_UNITTEST(vmpl_take_cleanup_test)
+VM_UNITTEST(vmpl_sparse_benchmark)
 UNITTEST_END_TESTCASE(vm_page_list_tests, "vmpl", "VmPageList tests");
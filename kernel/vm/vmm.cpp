@@ -61,6 +61,14 @@ zx_status_t vmm_page_fault_handler(vaddr_t addr, uint flags) {
     // page fault it
     zx_status_t status = aspace->PageFault(addr, flags);
 
+    // A user thread interrupted while waiting on a pager goes back to user mode to be
+    // suspended or killed, and takes the fault again if it is resumed. A fault taken by
+    // the kernel on behalf of a syscall can't be retried that way, so it just fails.
+    if ((status == ZX_ERR_INTERNAL_INTR_RETRY || status == ZX_ERR_INTERNAL_INTR_KILLED) &&
+        (flags & VMM_PF_FLAG_USER)) {
+        status = ZX_OK;
+    }
+
     // If it's a user fault, dump info about process memory usage.
     // If it's a kernel fault, the kernel could possibly already
     // hold locks on VMOs, Aspaces, etc, so we can't safely do
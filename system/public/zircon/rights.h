@@ -85,6 +85,10 @@ typedef uint32_t zx_rights_t;
     (ZX_RIGHT_TRANSFER | ZX_RIGHT_DUPLICATE | ZX_RIGHT_WRITE |\
      ZX_RIGHT_INSPECT)
 
+#define ZX_DEFAULT_RING_RIGHTS \
+    (ZX_RIGHTS_BASIC | ZX_RIGHTS_IO |\
+     ZX_RIGHT_SIGNAL | ZX_RIGHT_SIGNAL_PEER)
+
 #define ZX_DEFAULT_SOCKET_RIGHTS \
     (ZX_RIGHTS_BASIC | ZX_RIGHTS_IO | ZX_RIGHT_GET_PROPERTY |\
      ZX_RIGHT_SET_PROPERTY | ZX_RIGHT_SIGNAL | ZX_RIGHT_SIGNAL_PEER)
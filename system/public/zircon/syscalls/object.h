@@ -429,6 +429,13 @@ typedef struct zx_info_resource {
 // Terminate this job if the system is low on memory.
 #define ZX_PROP_JOB_KILL_ON_OOM             15u
 
+// Argument is a uint32_t, the NUMA node to allocate memory from first. Set on
+// a VMO it applies to the VMO's pages; set on a process it applies to the VMOs
+// the process creates from then on. ZX_NUMA_NODE_ANY, the default, prefers the
+// node of the cpu touching the memory.
+#define ZX_PROP_NUMA_NODE                   16u
+#define ZX_NUMA_NODE_ANY                    ((uint32_t) 0xffffffffu)
+
 // Basic thread states, in zx_info_thread_t.state.
 #define ZX_THREAD_STATE_NEW                 ((zx_thread_state_t) 0x0000u)
 #define ZX_THREAD_STATE_RUNNING             ((zx_thread_state_t) 0x0001u)
@@ -12,6 +12,7 @@ __BEGIN_CDECLS
 // clang-format off
 
 #define ZX_PROFILE_INFO_SCHEDULER   1
+#define ZX_PROFILE_INFO_DEADLINE    2
 
 typedef struct zx_profile_scheduler {
     int32_t priority;
@@ -33,5 +34,26 @@ typedef struct zx_profile_info {
     };
 } zx_profile_info_t;
 
+// A deadline profile guarantees the thread |capacity| of cpu time every
+// |period|, delivered within |deadline| of the start of each period, ahead of
+// any thread scheduled by priority. Once a period's capacity is used up the
+// thread runs at its normal priority until the next period begins. Applying
+// the profile fails with ZX_ERR_NO_RESOURCES if the deadline threads together
+// would need more cpu time than the system has.
+typedef struct zx_profile_deadline {
+    zx_duration_t capacity;
+    zx_duration_t deadline;
+    zx_duration_t period;
+} zx_profile_deadline_t;
+
+// Passed to zx_profile_create() in place of a zx_profile_info_t. It starts
+// with the same |type| field, which the kernel reads first to tell the two
+// apart, so zx_profile_info_t keeps its size and layout.
+typedef struct zx_profile_deadline_info {
+    uint32_t type;                  // ZX_PROFILE_INFO_DEADLINE
+    uint32_t reserved;              // must be zero
+    zx_profile_deadline_t deadline;
+} zx_profile_deadline_info_t;
+
 
 __END_CDECLS
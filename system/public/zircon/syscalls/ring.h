@@ -0,0 +1,45 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ZIRCON_SYSCALLS_RING_H_
+#define ZIRCON_SYSCALLS_RING_H_
+
+#include <zircon/compiler.h>
+#include <zircon/types.h>
+
+__BEGIN_CDECLS
+
+// clang-format off
+
+// The most element storage, in bytes, a single ring may have.
+#define ZX_RING_MAX_SIZE            ((size_t)64u * 1024u * 1024u)
+
+// Offset of the first element within a ring's VMO.  Element |n| (counting
+// from zero since the ring was created) lives at
+//   ZX_RING_DATA_OFFSET + (n & (elem_count - 1)) * elem_size.
+#define ZX_RING_DATA_OFFSET         ((uint64_t)4096u)
+
+// clang-format on
+
+// The control block at offset 0 of a ring's VMO.
+//
+// |head| is the number of elements the producer has ever published and is
+// only written by the producer.  |tail| is the number of elements the
+// consumer has ever released and is only written by the consumer.  Neither
+// wraps in practice, so the ring holds |head - tail| elements.  The two
+// live on separate cache lines so that the ends do not contend for one
+// line on every element.
+typedef struct zx_ring_header {
+    uint32_t elem_size;
+    uint32_t elem_count;
+    uint8_t reserved0[56];
+    uint64_t head;
+    uint8_t reserved1[56];
+    uint64_t tail;
+    uint8_t reserved2[56];
+} zx_ring_header_t;
+
+__END_CDECLS
+
+#endif // ZIRCON_SYSCALLS_RING_H_
@@ -145,6 +145,11 @@ typedef uint32_t zx_signals_t;
 #define ZX_FIFO_WRITABLE            __ZX_OBJECT_WRITABLE
 #define ZX_FIFO_PEER_CLOSED         __ZX_OBJECT_PEER_CLOSED
 
+// Ring
+#define ZX_RING_READABLE            __ZX_OBJECT_READABLE
+#define ZX_RING_WRITABLE            __ZX_OBJECT_WRITABLE
+#define ZX_RING_PEER_CLOSED         __ZX_OBJECT_PEER_CLOSED
+
 // Task signals (process, thread, job)
 #define ZX_TASK_TERMINATED          __ZX_OBJECT_SIGNALED
 
@@ -192,6 +197,22 @@ typedef struct zx_channel_call_args {
     uint32_t rd_num_handles;
 } zx_channel_call_args_t;
 
+// Maximum number of items allowed for zx_channel_write_many() and
+// zx_channel_read_many()
+#define ZX_CHANNEL_MANY_MAX_ITEMS ((size_t)16)
+
+// Structure for zx_channel_write_many():
+typedef struct zx_channel_write_item {
+    zx_handle_t channel;
+    uint32_t options;
+    const void* bytes;
+    const zx_handle_t* handles;
+    uint32_t num_bytes;
+    uint32_t num_handles;
+    zx_status_t status;
+    uint32_t reserved;
+} zx_channel_write_item_t;
+
 // Maximum number of wait items allowed for zx_object_wait_many()
 // TODO(ZX-1349) Re-lower this.
 #define ZX_WAIT_MANY_MAX_ITEMS ((size_t)16)
@@ -278,9 +299,19 @@ typedef uint64_t zx_off_t;
 
 // Channel options and limits.
 #define ZX_CHANNEL_READ_MAY_DISCARD         ((uint32_t)1u)
+#define ZX_CHANNEL_WRITE_USE_IOVEC          ((uint32_t)2u)
 
 #define ZX_CHANNEL_MAX_MSG_BYTES            ((uint32_t)65536u)
 #define ZX_CHANNEL_MAX_MSG_HANDLES          ((uint32_t)64u)
+#define ZX_CHANNEL_MAX_MSG_IOVECS           ((uint32_t)8192u)
+
+// Structure for zx_channel_write() with ZX_CHANNEL_WRITE_USE_IOVEC: one
+// segment of the message, which is gathered from all of them in order.
+typedef struct zx_channel_iovec {
+    const void* buffer;
+    uint32_t capacity;
+    uint32_t reserved;
+} zx_channel_iovec_t;
 
 // Socket options and limits.
 // These options can be passed to zx_socket_shutdown()
@@ -349,7 +380,8 @@ typedef uint32_t zx_obj_type_t;
 #define ZX_OBJ_TYPE_PMT             ((zx_obj_type_t)26u)
 #define ZX_OBJ_TYPE_SUSPEND_TOKEN   ((zx_obj_type_t)27u)
 #define ZX_OBJ_TYPE_PAGER           ((zx_obj_type_t)28u)
-#define ZX_OBJ_TYPE_LAST            ((zx_obj_type_t)29u)
+#define ZX_OBJ_TYPE_RING            ((zx_obj_type_t)29u)
+#define ZX_OBJ_TYPE_LAST            ((zx_obj_type_t)30u)
 
 typedef struct zx_handle_info {
     zx_handle_t handle;
@@ -358,6 +390,20 @@ typedef struct zx_handle_info {
     uint32_t unused;
 } zx_handle_info_t;
 
+// Structure for zx_channel_read_many():
+typedef struct zx_channel_read_item {
+    zx_handle_t channel;
+    uint32_t options;
+    void* bytes;
+    zx_handle_info_t* handles;
+    uint32_t num_bytes;
+    uint32_t num_handles;
+    uint32_t actual_bytes;
+    uint32_t actual_handles;
+    zx_status_t status;
+    uint32_t reserved;
+} zx_channel_read_item_t;
+
 // The ZX_VM_FLAG_* constants are to be deprecated in favor of the ZX_VM_*
 // versions.
 #define ZX_VM_FLAG_PERM_READ              ((uint32_t)1u << 0)
@@ -34,8 +34,124 @@ struct TestArgs {
     uint32_t size;
     uint32_t handles;
     uint32_t queue;
+    // Messages moved per zx_channel_write_many()/zx_channel_read_many() call,
+    // or 0 to use zx_channel_write()/zx_channel_read().
+    uint32_t batch;
+    // Channels the messages of a batch are spread across.
+    uint32_t channels;
 };
 
+void print_result(const TestArgs& test_args, const char* op, double msgs_per_second) {
+    printf("%s %" PRIu32 " bytes, %" PRIu32 " handles (%" PRIu32 " pre-queued", op,
+           test_args.size, test_args.handles, test_args.queue);
+    if (test_args.batch)
+        printf(", %" PRIu32 " per batch over %" PRIu32 " channels", test_args.batch,
+               test_args.channels);
+    printf("): %.0f iterations/second, %.0f ns/iteration\n",
+           msgs_per_second, 1000000000.0 / msgs_per_second);
+}
+
+// Like do_test(), but writes and reads |test_args.batch| messages per
+// syscall, spreading them across |test_args.channels| channels, and
+// reports the rate per message.
+void do_batch_test(uint32_t duration_sec, const TestArgs& test_args) {
+    __UNUSED zx_status_t status;
+
+    zx_duration_t duration_ns = ZX_SEC(duration_sec);
+    const uint32_t batch = test_args.batch;
+    const uint32_t num_channels = test_args.channels;
+
+    // We'll write to the first of each pair (and read from the second).
+    fbl::unique_ptr<zx_handle_t[]> mp(new zx_handle_t[2 * num_channels]);
+    for (uint32_t i = 0; i < num_channels; i++) {
+        status = zx_channel_create(0u, &mp[2 * i], &mp[2 * i + 1]);
+        assert(status == ZX_OK);
+    }
+
+    zx_handle_t event;
+    status = zx_event_create(0u, &event);
+    assert(status == ZX_OK);
+
+    fbl::unique_ptr<uint8_t[]> data;
+    if (test_args.size) {
+        data.reset(new uint8_t[test_args.size * batch]);
+        for (uint32_t i = 0; i < test_args.size * batch; i++)
+            data[i] = static_cast<uint8_t>(i);
+    }
+    fbl::unique_ptr<zx_handle_t[]> handles;
+    fbl::unique_ptr<zx_handle_info_t[]> handle_infos;
+    if (test_args.handles) {
+        handles.reset(new zx_handle_t[test_args.handles * batch]);
+        handle_infos.reset(new zx_handle_info_t[test_args.handles * batch]);
+    }
+
+    zx_channel_write_item_t writes[ZX_CHANNEL_MANY_MAX_ITEMS];
+    zx_channel_read_item_t reads[ZX_CHANNEL_MANY_MAX_ITEMS];
+    for (uint32_t i = 0; i < batch; i++) {
+        uint32_t channel = i % num_channels;
+        writes[i] = {mp[2 * channel], 0u, data.get() + i * test_args.size,
+                     handles.get() + i * test_args.handles, test_args.size,
+                     test_args.handles, ZX_OK, 0u};
+        reads[i] = {mp[2 * channel + 1], 0u, data.get() + i * test_args.size,
+                    handle_infos.get() + i * test_args.handles, test_args.size,
+                    test_args.handles, 0u, 0u, ZX_OK, 0u};
+    }
+
+    for (uint32_t i = 0; i < test_args.queue; i++) {
+        for (uint32_t c = 0; c < num_channels; c++) {
+            duplicate_handles(test_args.handles, event, handles.get());
+            status = zx_channel_write(mp[2 * c], 0u, data.get(), test_args.size,
+                                      handles.get(), test_args.handles);
+            assert(status == ZX_OK);
+        }
+    }
+
+    duplicate_handles(test_args.handles * batch, event, handles.get());
+
+    static constexpr uint32_t big_it_size = 10000;
+    uint64_t big_its = 0;
+    zx_time_t start_ns = zx_clock_get_monotonic();
+    zx_time_t end_ns;
+    for (;;) {
+        big_its++;
+        for (uint32_t i = 0; i < big_it_size; i += batch) {
+            status = zx_channel_write_many(writes, batch);
+            assert(status == ZX_OK);
+
+            status = zx_channel_read_many(reads, batch);
+            assert(status == ZX_OK);
+            for (uint32_t j = 0; j < batch; j++) {
+                assert(writes[j].status == ZX_OK);
+                assert(reads[j].status == ZX_OK);
+                assert(reads[j].actual_bytes == test_args.size);
+                assert(reads[j].actual_handles == test_args.handles);
+            }
+            for (uint32_t j = 0; j < test_args.handles * batch; j++)
+                handles[j] = handle_infos[j].handle;
+        }
+
+        end_ns = zx_clock_get_monotonic();
+        if (zx_time_sub_time(end_ns, start_ns) >= duration_ns)
+            break;
+    }
+    uint64_t msgs_per_big_it = (big_it_size + batch - 1) / batch * batch;
+
+    for (uint32_t i = 0; i < test_args.handles * batch; i++) {
+        status = zx_handle_close(handles[i]);
+        assert(status == ZX_OK);
+    }
+    status = zx_handle_close(event);
+    assert(status == ZX_OK);
+    for (uint32_t i = 0; i < 2 * num_channels; i++) {
+        status = zx_handle_close(mp[i]);
+        assert(status == ZX_OK);
+    }
+
+    double real_duration = static_cast<double>(zx_time_sub_time(end_ns, start_ns)) / 1000000000.0;
+    double msgs_per_second = static_cast<double>(big_its * msgs_per_big_it) / real_duration;
+    print_result(test_args, "write_many/read_many", msgs_per_second);
+}
+
 void do_test(uint32_t duration_sec, const TestArgs& test_args) {
     __UNUSED zx_status_t status;
 
@@ -110,9 +226,14 @@ void do_test(uint32_t duration_sec, const TestArgs& test_args) {
 
     double real_duration = static_cast<double>(zx_time_sub_time(end_ns, start_ns)) / 1000000000.0;
     double its_per_second = static_cast<double>(big_its) * big_it_size / real_duration;
-    printf("write/read %" PRIu32 " bytes, %" PRIu32 " handles (%" PRIu32 " pre-queued): "
-               "%.0f iterations/second\n",
-           test_args.size, test_args.handles, test_args.queue, its_per_second);
+    print_result(test_args, "write/read", its_per_second);
+}
+
+void run_test(uint32_t duration_sec, const TestArgs& test_args) {
+    if (test_args.batch)
+        do_batch_test(duration_sec, test_args);
+    else
+        do_test(duration_sec, test_args);
 }
 
 }  // namespace
@@ -129,7 +250,10 @@ int main(int argc, char** argv) {
         "  -d N  set test duration to N seconds (default: 5)\n"
         "  -S N  set message size to N bytes (default: 10)\n"
         "  -H N  set message handle count to N handles (default: 0)\n"
-        "  -Q N  set message pre-queue count to N messages (default: 0)\n";
+        "  -Q N  set message pre-queue count to N messages (default: 0)\n"
+        "  -B N  write/read N messages per zx_channel_{write,read}_many() call\n"
+        "        (default: 0, use zx_channel_{write,read}())\n"
+        "  -C N  spread each batch over N channels (default: 1)\n";
 
     bool run_suite = false;  // -o/-s
     uint32_t duration = 5;   // -d
@@ -138,11 +262,13 @@ int main(int argc, char** argv) {
     TestArgs test_args = {
         10,                  // -S (size)
         0,                   // -H (handles)
-        0                    // -Q (queue)
+        0,                   // -Q (queue)
+        0,                   // -B (batch)
+        1                    // -C (channels)
     };
 
     int opt;
-    while ((opt = getopt(argc, argv, "+hosn:d:S:H:Q:")) != -1) {
+    while ((opt = getopt(argc, argv, "+hosn:d:S:H:Q:B:C:")) != -1) {
         // Our option values are always unsigned numbers.
         uint32_t value = 0;
         if (optarg) {
@@ -184,6 +310,18 @@ int main(int argc, char** argv) {
                 assert(optarg);
                 test_args.queue = value;
                 break;
+            case 'B':
+                assert(optarg);
+                if (value > ZX_CHANNEL_MANY_MAX_ITEMS)
+                    argument_error(argv[0], "batch too large");
+                test_args.batch = value;
+                break;
+            case 'C':
+                assert(optarg);
+                if (value == 0)
+                    argument_error(argv[0], "need at least one channel");
+                test_args.channels = value;
+                break;
             default:  // '?'
                 argument_error(argv[0], "invalid option");
                 break;
@@ -191,6 +329,8 @@ int main(int argc, char** argv) {
     }
     if (optind < argc)
         argument_error(argv[0], "unexpected positional argument");
+    if (test_args.batch && test_args.channels > test_args.batch)
+        argument_error(argv[0], "more channels than messages per batch");
 
     for (uint32_t i = 0; i < repeats; i++) {
         if (repeats > 1u) {
@@ -202,26 +342,36 @@ int main(int argc, char** argv) {
 
         if (run_suite) {
             static constexpr TestArgs suite[] = {
-                {10, 0, 0},
-                {100, 0, 0},
-                {1000, 0, 0},
-                {10, 1, 0},
-                {100, 1, 0},
-                {1000, 1, 0},
-                {10, 2, 0},
-                {100, 2, 0},
-                {1000, 2, 0},
-                {10, 5, 0},
-                {100, 5, 0},
-                {1000, 5, 0},
-                {10, 0, 1},
-                {100, 0, 1},
-                {1000, 0, 1},
+                {10, 0, 0, 0, 1},
+                {64, 0, 0, 0, 1},
+                {100, 0, 0, 0, 1},
+                {1000, 0, 0, 0, 1},
+                {10, 1, 0, 0, 1},
+                {100, 1, 0, 0, 1},
+                {1000, 1, 0, 0, 1},
+                {10, 2, 0, 0, 1},
+                {100, 2, 0, 0, 1},
+                {1000, 2, 0, 0, 1},
+                {10, 5, 0, 0, 1},
+                {100, 5, 0, 0, 1},
+                {1000, 5, 0, 0, 1},
+                {10, 0, 1, 0, 1},
+                {100, 0, 1, 0, 1},
+                {1000, 0, 1, 0, 1},
+                {64, 0, 1000, 0, 1},
+                {4000, 0, 1000, 0, 1},
+                // The same messages, batched, to compare the cost per message.
+                {64, 0, 0, 1, 1},
+                {64, 0, 0, 4, 1},
+                {64, 0, 0, 16, 1},
+                {64, 0, 0, 16, 16},
+                {64, 1, 0, 16, 16},
+                {1000, 0, 0, 16, 16},
             };
             for (size_t i = 0; i < fbl::count_of(suite); i++)
-                do_test(duration, suite[i]);
+                run_test(duration, suite[i]);
         } else {
-            do_test(duration, test_args);
+            run_test(duration, test_args);
         }
     }
 
@@ -52,6 +52,15 @@ typedef struct async_loop_config {
 
     // Data to pass to the callback functions.
     void* data;
+
+    // If true, |async_loop_run()| takes up to 16 packets from the loop's port
+    // per wait rather than one, saving a syscall per packet when the loop is
+    // busy.  Packets taken in a batch are dispatched in turn by the thread
+    // that took them, so this is best left off for loops served by several
+    // threads, where it would keep the other threads from sharing the work.
+    //
+    // If false, the loop takes one packet per wait.
+    bool batch_port_packets;
 } async_loop_config_t;
 
 // Simple config that when passed to async_loop_create will create a loop
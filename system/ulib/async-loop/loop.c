@@ -10,6 +10,7 @@
 #include <assert.h>
 #include <stdatomic.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <zircon/assert.h>
 #include <zircon/listnode.h>
@@ -26,6 +27,9 @@
 // The port wait key associated with the dispatcher's control messages.
 #define KEY_CONTROL (0u)
 
+// The most packets a dispatch thread takes from the port per wakeup.
+#define MAX_PACKETS_PER_WAIT (16u)
+
 static zx_time_t async_loop_now(async_dispatcher_t* dispatcher);
 static zx_status_t async_loop_begin_wait(async_dispatcher_t* dispatcher, async_wait_t* wait);
 static zx_status_t async_loop_cancel_wait(async_dispatcher_t* dispatcher, async_wait_t* wait);
@@ -69,6 +73,19 @@ typedef struct thread_record {
     thrd_t thread;
 } thread_record_t;
 
+// Packets a dispatch thread has taken from the port but not yet dispatched.
+// The batch lives on the dispatching thread's stack and is linked into the
+// loop's |batch_list| so that cancelling a wait or unbinding an exception
+// port can keep a packet which is already out of the port from being
+// delivered, just as |zx_port_cancel| would if it were still queued.
+typedef struct packet_batch {
+    list_node_t node;
+    size_t next; // index of the next packet to dispatch, guarded by the loop's lock
+    size_t count;
+    bool canceled[MAX_PACKETS_PER_WAIT]; // guarded by the loop's lock
+    zx_port_packet_t packets[MAX_PACKETS_PER_WAIT];
+} packet_batch_t;
+
 const async_loop_config_t kAsyncLoopConfigAttachToThread = {
     .make_default_for_current_thread = true};
 const async_loop_config_t kAsyncLoopConfigNoAttachToThread = {
@@ -90,9 +107,15 @@ typedef struct async_loop {
     list_node_t due_list; // due tasks, earliest deadline first
     list_node_t thread_list; // earliest created thread first
     list_node_t exception_list; // most recently added first
+    list_node_t batch_list; // batches of packets being dispatched
 } async_loop_t;
 
-static zx_status_t async_loop_run_once(async_loop_t* loop, zx_time_t deadline);
+static zx_status_t async_loop_run_once(async_loop_t* loop, zx_time_t deadline,
+                                       size_t max_packets);
+static zx_status_t async_loop_dispatch_batch(async_loop_t* loop, packet_batch_t* batch);
+static zx_status_t async_loop_dispatch_port_packet(async_loop_t* loop,
+                                                   const zx_port_packet_t* packet);
+static bool async_loop_cancel_batched_locked(async_loop_t* loop, uint64_t key);
 static zx_status_t async_loop_dispatch_wait(async_loop_t* loop, async_wait_t* wait,
                                             zx_status_t status, const zx_packet_signal_t* signal);
 static zx_status_t async_loop_dispatch_tasks(async_loop_t* loop);
@@ -162,6 +185,7 @@ zx_status_t async_loop_create(const async_loop_config_t* config, async_loop_t**
     list_initialize(&loop->due_list);
     list_initialize(&loop->thread_list);
     list_initialize(&loop->exception_list);
+    list_initialize(&loop->batch_list);
 
     zx_status_t status = zx_port_create(0u, &loop->port);
     if (status == ZX_OK)
@@ -234,10 +258,14 @@ void async_loop_shutdown(async_loop_t* loop) {
 zx_status_t async_loop_run(async_loop_t* loop, zx_time_t deadline, bool once) {
     ZX_DEBUG_ASSERT(loop);
 
+    // A single unit of work is a single packet; otherwise take packets from
+    // the port in batches if the loop asked to.
+    size_t max_packets = (once || !loop->config.batch_port_packets) ? 1u : MAX_PACKETS_PER_WAIT;
+
     zx_status_t status;
     atomic_fetch_add_explicit(&loop->active_threads, 1u, memory_order_acq_rel);
     do {
-        status = async_loop_run_once(loop, deadline);
+        status = async_loop_run_once(loop, deadline, max_packets);
     } while (status == ZX_OK && !once);
     atomic_fetch_sub_explicit(&loop->active_threads, 1u, memory_order_acq_rel);
     return status;
@@ -251,56 +279,144 @@ zx_status_t async_loop_run_until_idle(async_loop_t* loop) {
     return status;
 }
 
-static zx_status_t async_loop_run_once(async_loop_t* loop, zx_time_t deadline) {
+static zx_status_t async_loop_run_once(async_loop_t* loop, zx_time_t deadline,
+                                       size_t max_packets) {
     async_loop_state_t state = atomic_load_explicit(&loop->state, memory_order_acquire);
     if (state == ASYNC_LOOP_SHUTDOWN)
         return ZX_ERR_BAD_STATE;
     if (state != ASYNC_LOOP_RUNNABLE)
         return ZX_ERR_CANCELED;
 
-    zx_port_packet_t packet;
-    zx_status_t status = zx_port_wait(loop->port, deadline, &packet);
+    packet_batch_t batch;
+    zx_status_t status = zx_port_wait_many(loop->port, deadline, batch.packets,
+                                           max_packets, &batch.count);
     if (status != ZX_OK)
         return status;
 
-    if (packet.key == KEY_CONTROL) {
+    if (batch.count > 1u)
+        return async_loop_dispatch_batch(loop, &batch);
+
+    zx_port_packet_t* packet = &batch.packets[0];
+    if (packet->key != KEY_CONTROL && packet->type == ZX_PKT_TYPE_SIGNAL_ONE) {
+        async_wait_t* wait = (void*)(uintptr_t)packet->key;
+        mtx_lock(&loop->lock);
+        list_delete(wait_to_node(wait));
+        mtx_unlock(&loop->lock);
+    }
+    return async_loop_dispatch_port_packet(loop, packet);
+}
+
+static zx_status_t async_loop_dispatch_batch(async_loop_t* loop, packet_batch_t* batch) {
+    batch->next = 0u;
+    memset(batch->canceled, 0, sizeof(batch->canceled));
+    mtx_lock(&loop->lock);
+    list_add_tail(&loop->batch_list, &batch->node);
+    mtx_unlock(&loop->lock);
+
+    zx_status_t result = ZX_OK;
+    bool woken = false;
+    size_t i = 0u;
+    for (; i < batch->count; i++) {
+        zx_port_packet_t* packet = &batch->packets[i];
+
+        // Other threads are owed any further wake-up packets in the batch;
+        // one is enough to make this thread look at the loop's state again.
+        if (packet->key == KEY_CONTROL && packet->type == ZX_PKT_TYPE_USER) {
+            if (woken) {
+                zx_status_t status = zx_port_queue(loop->port, packet);
+                ZX_ASSERT_MSG(status == ZX_OK, "zx_port_queue: status=%d", status);
+            }
+            woken = true;
+            continue;
+        }
+
+        // Shutting down cancels every pending wait itself, so stop here
+        // rather than deliver them a second time.
+        if (atomic_load_explicit(&loop->state, memory_order_acquire) == ASYNC_LOOP_SHUTDOWN)
+            break;
+
+        mtx_lock(&loop->lock);
+        batch->next = i + 1u;
+        bool canceled = batch->canceled[i];
+        if (!canceled && packet->key != KEY_CONTROL && packet->type == ZX_PKT_TYPE_SIGNAL_ONE) {
+            async_wait_t* wait = (void*)(uintptr_t)packet->key;
+            list_delete(wait_to_node(wait));
+        }
+        mtx_unlock(&loop->lock);
+        if (canceled)
+            continue;
+
+        zx_status_t status = async_loop_dispatch_port_packet(loop, packet);
+        if (status != ZX_OK && result == ZX_OK)
+            result = status;
+    }
+
+    // Pass on any wake-ups left behind.
+    for (; i < batch->count; i++) {
+        zx_port_packet_t* packet = &batch->packets[i];
+        if (packet->key == KEY_CONTROL && packet->type == ZX_PKT_TYPE_USER) {
+            zx_status_t status = zx_port_queue(loop->port, packet);
+            ZX_ASSERT_MSG(status == ZX_OK, "zx_port_queue: status=%d", status);
+        }
+    }
+
+    mtx_lock(&loop->lock);
+    list_delete(&batch->node);
+    mtx_unlock(&loop->lock);
+    return result;
+}
+
+static bool async_loop_cancel_batched_locked(async_loop_t* loop, uint64_t key) {
+    packet_batch_t* batch;
+    list_for_every_entry (&loop->batch_list, batch, packet_batch_t, node) {
+        for (size_t i = batch->next; i < batch->count; i++) {
+            if (batch->packets[i].key == key && !batch->canceled[i]) {
+                batch->canceled[i] = true;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static zx_status_t async_loop_dispatch_port_packet(async_loop_t* loop,
+                                                   const zx_port_packet_t* packet) {
+    if (packet->key == KEY_CONTROL) {
         // Handle wake-up packets.
-        if (packet.type == ZX_PKT_TYPE_USER)
+        if (packet->type == ZX_PKT_TYPE_USER)
             return ZX_OK;
 
         // Handle task timer expirations.
-        if (packet.type == ZX_PKT_TYPE_SIGNAL_REP &&
-            packet.signal.observed & ZX_TIMER_SIGNALED) {
+        if (packet->type == ZX_PKT_TYPE_SIGNAL_REP &&
+            packet->signal.observed & ZX_TIMER_SIGNALED) {
             return async_loop_dispatch_tasks(loop);
         }
     } else {
-        // Handle wait completion packets.
-        if (packet.type == ZX_PKT_TYPE_SIGNAL_ONE) {
-            async_wait_t* wait = (void*)(uintptr_t)packet.key;
-            mtx_lock(&loop->lock);
-            list_delete(wait_to_node(wait));
-            mtx_unlock(&loop->lock);
-            return async_loop_dispatch_wait(loop, wait, packet.status, &packet.signal);
+        // Handle wait completion packets.  The caller has already taken the
+        // wait off the wait list.
+        if (packet->type == ZX_PKT_TYPE_SIGNAL_ONE) {
+            async_wait_t* wait = (void*)(uintptr_t)packet->key;
+            return async_loop_dispatch_wait(loop, wait, packet->status, &packet->signal);
         }
 
         // Handle queued user packets.
-        if (packet.type == ZX_PKT_TYPE_USER) {
-            async_receiver_t* receiver = (void*)(uintptr_t)packet.key;
-            return async_loop_dispatch_packet(loop, receiver, packet.status, &packet.user);
+        if (packet->type == ZX_PKT_TYPE_USER) {
+            async_receiver_t* receiver = (void*)(uintptr_t)packet->key;
+            return async_loop_dispatch_packet(loop, receiver, packet->status, &packet->user);
         }
 
         // Handle guest bell trap packets.
-        if (packet.type == ZX_PKT_TYPE_GUEST_BELL) {
-            async_guest_bell_trap_t* trap = (void*)(uintptr_t)packet.key;
+        if (packet->type == ZX_PKT_TYPE_GUEST_BELL) {
+            async_guest_bell_trap_t* trap = (void*)(uintptr_t)packet->key;
             return async_loop_dispatch_guest_bell_trap(
-                loop, trap, packet.status, &packet.guest_bell);
+                loop, trap, packet->status, &packet->guest_bell);
         }
 
         // Handle exception packets.
-        if (ZX_PKT_IS_EXCEPTION(packet.type)) {
-            async_exception_t* exception = (void*)(uintptr_t)packet.key;
-            return async_loop_dispatch_exception(loop, exception, packet.status,
-                                                 &packet);
+        if (ZX_PKT_IS_EXCEPTION(packet->type)) {
+            async_exception_t* exception = (void*)(uintptr_t)packet->key;
+            return async_loop_dispatch_exception(loop, exception, packet->status,
+                                                 packet);
         }
     }
 
@@ -528,6 +644,11 @@ static zx_status_t async_loop_cancel_wait(async_dispatcher_t* async, async_wait_
     // to cancel then we assume we lost the race.
     zx_status_t status = zx_port_cancel(loop->port, wait->object,
                                         (uintptr_t)wait);
+    if (status == ZX_ERR_NOT_FOUND && async_loop_cancel_batched_locked(loop, (uintptr_t)wait)) {
+        // The packet was already taken from the port along with others but
+        // has not been dispatched yet, so it can still be cancelled.
+        status = ZX_OK;
+    }
     if (status == ZX_OK) {
         list_delete(node);
     } else {
@@ -681,6 +802,10 @@ static zx_status_t async_loop_unbind_exception_port(async_dispatcher_t* async,
 
     if (status == ZX_OK) {
         list_delete(node);
+        // Drop any exception report already taken from the port but not yet
+        // dispatched.
+        while (async_loop_cancel_batched_locked(loop, key)) {
+        }
     }
 
     mtx_unlock(&loop->lock);
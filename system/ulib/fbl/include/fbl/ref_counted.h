@@ -37,6 +37,7 @@ public:
     ~RefCounted() {}
 
     using internal::RefCountedBase<EnableAdoptionValidator>::AddRef;
+    using internal::RefCountedBase<EnableAdoptionValidator>::AddRefMaybeInDestructor;
     using internal::RefCountedBase<EnableAdoptionValidator>::Release;
     using internal::RefCountedBase<EnableAdoptionValidator>::Adopt;
     using internal::RefCountedBase<EnableAdoptionValidator>::ref_count_debug;
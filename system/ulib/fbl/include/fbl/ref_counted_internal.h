@@ -59,6 +59,22 @@ protected:
         }
     }
 
+    // Like AddRef(), but for an object that may already have dropped its last
+    // reference and be running its destructor, which the caller has to be
+    // keeping from completing by some other means.  Returns false, without
+    // taking a reference, if that is the case.
+    bool AddRefMaybeInDestructor() const __WARN_UNUSED_RESULT {
+        int32_t rc = ref_count_.load(std::memory_order_relaxed);
+        do {
+            if (rc <= 0) {
+                return false;
+            }
+        } while (!ref_count_.compare_exchange_weak(rc, rc + 1,
+                                                   std::memory_order_acquire,
+                                                   std::memory_order_relaxed));
+        return true;
+    }
+
     // Returns true if the object should self-delete.
     bool Release() const __WARN_UNUSED_RESULT {
         const int32_t rc = ref_count_.fetch_sub(1, std::memory_order_release);
@@ -50,6 +50,12 @@ struct SetPtrConst<true, U> {
 //   HandleState GetHandleState(zx_handle_t) - returns if a handle is present or not
 //   void UpdatePointer(T**p, T*v) - mutates a pointer representation for a present pointer
 //   void SetError(const char* error_msg) - flags that an error occurred
+//
+// and may offer:
+//
+//   bool ClaimExternalStorage(uint32_t size, uint32_t pointer_offset, uint32_t position)
+//      - claims the data of a string, or of a vector with no pointers or handles in its elements,
+//        from outside the buffer; see the default below
 template <class Derived, bool kMutating, bool kContinueAfterErrors>
 class BufferWalker {
 public:
@@ -365,6 +371,13 @@ public:
                     SetError("message tried to decode too large of a bounded string");
                     FIDL_POP_AND_CONTINUE_OR_RETURN;
                 }
+                if (derived()->ClaimExternalStorage(
+                        static_cast<uint32_t>(size),
+                        static_cast<uint32_t>(frame->offset + offsetof(fidl_string_t, data)),
+                        out_of_line_offset_)) {
+                    Pop();
+                    continue;
+                }
                 uint32_t string_data_offset = 0u;
                 if (!ClaimOutOfLineStorage(static_cast<uint32_t>(size), string_ptr->data, &string_data_offset)) {
                     SetError("decoding a string overflowed buffer");
@@ -430,6 +443,13 @@ public:
                     SetError("integer overflow calculating vector size");
                     FIDL_POP_AND_CONTINUE_OR_RETURN;
                 }
+                if (!frame->vector_state.element &&
+                    derived()->ClaimExternalStorage(
+                        size, static_cast<uint32_t>(frame->offset + offsetof(fidl_vector_t, data)),
+                        out_of_line_offset_)) {
+                    Pop();
+                    continue;
+                }
                 if (!ClaimOutOfLineStorage(size, vector_ptr->data, &frame->offset)) {
                     SetError("message wanted to store too large of a vector");
                     FIDL_POP_AND_CONTINUE_OR_RETURN;
@@ -459,6 +479,15 @@ public:
 #undef FIDL_POP_AND_CONTINUE_OR_RETURN
     }
 
+    // Called for |size| bytes of string or vector data that has no pointers or handles in it,
+    // whose data pointer is at |pointer_offset| in the buffer, and which would be claimed at
+    // |position| in the out-of-line part of the buffer.  Returning true means Derived has taken
+    // the data from somewhere else, so it takes no space in the buffer.  By default all data
+    // must be in the buffer.
+    bool ClaimExternalStorage(uint32_t size, uint32_t pointer_offset, uint32_t position) {
+        return false;
+    }
+
 protected:
     void SetError(const char* error_msg) {
         derived()->SetError(error_msg);
@@ -34,6 +34,14 @@ public:
           handles_(handles), num_handles_(num_handles), out_actual_handles_(out_actual_handles),
           out_error_msg_(out_error_msg) {}
 
+    // Makes the encoder describe the message as |iovecs| rather than requiring it to be
+    // linearized into |bytes|.  See fidl_encode_iovec().
+    void SetIovecs(zx_channel_iovec_t* iovecs, uint32_t max_iovecs, uint32_t* out_actual_iovecs) {
+        iovecs_ = iovecs;
+        max_iovecs_ = max_iovecs;
+        out_actual_iovecs_ = out_actual_iovecs;
+    }
+
     void Walk() {
         if (handles_ == nullptr && num_handles_ != 0u) {
             SetError("Cannot provide non-zero handle count and null handle pointer");
@@ -43,9 +51,19 @@ public:
             SetError("Cannot encode with null out_actual_handles");
             return;
         }
+        if (iovecs_ != nullptr && out_actual_iovecs_ == nullptr) {
+            SetError("Cannot encode with null out_actual_iovecs");
+            return;
+        }
         Super::Walk();
+        if (iovecs_ != nullptr && iovec_cursor_ < num_bytes_) {
+            AddIovec(bytes_ + iovec_cursor_, num_bytes_ - iovec_cursor_);
+        }
         if (status_ == ZX_OK) {
             *out_actual_handles_ = handle_idx();
+            if (iovecs_ != nullptr) {
+                *out_actual_iovecs_ = num_iovecs_;
+            }
         }
     }
 
@@ -80,6 +98,34 @@ public:
                    : HandleState::PRESENT;
     }
 
+    bool ClaimExternalStorage(uint32_t size, uint32_t pointer_offset, uint32_t position) {
+        if (iovecs_ == nullptr) {
+            return false;
+        }
+        auto data_ptr = reinterpret_cast<const uint8_t**>(bytes_ + pointer_offset);
+        const uint8_t* data = *data_ptr;
+        if (data >= bytes_ && data < bytes_ + num_bytes_) {
+            return false;
+        }
+
+        // Everything in the buffer before this point, then the data where it lies, padded out
+        // to keep what follows aligned.
+        static const uint8_t kPadding[FIDL_ALIGNMENT] = {};
+        if (position > iovec_cursor_) {
+            AddIovec(bytes_ + iovec_cursor_, position - iovec_cursor_);
+            iovec_cursor_ = position;
+        }
+        if (size > 0u) {
+            AddIovec(data, size);
+            const uint32_t padding = static_cast<uint32_t>(fidl::FidlAlign(size)) - size;
+            if (padding > 0u) {
+                AddIovec(kPadding, padding);
+            }
+        }
+        *reinterpret_cast<uintptr_t*>(data_ptr) = FIDL_ALLOC_PRESENT;
+        return true;
+    }
+
     template <class T>
     void UpdatePointer(T** p, T* v) {
         assert(*p == v);
@@ -106,6 +152,14 @@ public:
     zx_status_t status() const { return status_; }
 
 private:
+    void AddIovec(const void* buffer, uint32_t capacity) {
+        if (num_iovecs_ == max_iovecs_) {
+            SetError("message needs too many iovecs");
+            return;
+        }
+        iovecs_[num_iovecs_++] = {buffer, capacity, 0u};
+    }
+
     // Message state passed in to the constructor.
     uint8_t* const bytes_;
     const uint32_t num_bytes_;
@@ -114,6 +168,14 @@ private:
     uint32_t* const out_actual_handles_;
     const char** const out_error_msg_;
     zx_status_t status_ = ZX_OK;
+
+    // Only used when encoding to iovecs.
+    zx_channel_iovec_t* iovecs_ = nullptr;
+    uint32_t max_iovecs_ = 0u;
+    uint32_t* out_actual_iovecs_ = nullptr;
+    uint32_t num_iovecs_ = 0u;
+    // How much of |bytes_| the iovecs describe so far.
+    uint32_t iovec_cursor_ = 0u;
 };
 
 } // namespace
@@ -127,6 +189,24 @@ zx_status_t fidl_encode(const fidl_type_t* type, void* bytes, uint32_t num_bytes
     return encoder.status();
 }
 
+zx_status_t fidl_encode_iovec(const fidl_type_t* type, void* bytes, uint32_t num_bytes,
+                              zx_handle_t* handles, uint32_t max_handles,
+                              uint32_t* out_actual_handles, zx_channel_iovec_t* iovecs,
+                              uint32_t max_iovecs, uint32_t* out_actual_iovecs,
+                              const char** out_error_msg) {
+    FidlEncoder encoder(type, bytes, num_bytes, handles, max_handles, out_actual_handles,
+                        out_error_msg);
+    if (iovecs == nullptr) {
+        if (out_error_msg != nullptr) {
+            *out_error_msg = "Cannot encode with null iovecs";
+        }
+        return ZX_ERR_INVALID_ARGS;
+    }
+    encoder.SetIovecs(iovecs, max_iovecs, out_actual_iovecs);
+    encoder.Walk();
+    return encoder.status();
+}
+
 zx_status_t fidl_encode_msg(const fidl_type_t* type, fidl_msg_t* msg,
                             uint32_t* out_actual_handles, const char** out_error_msg) {
     return fidl_encode(type, msg->bytes, msg->num_bytes, msg->handles, msg->num_handles,
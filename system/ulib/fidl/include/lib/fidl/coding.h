@@ -23,6 +23,21 @@ zx_status_t fidl_encode(const fidl_type_t* type, void* bytes, uint32_t num_bytes
 zx_status_t fidl_encode_msg(const fidl_type_t* type, fidl_msg_t* msg,
                             uint32_t* out_actual_handles, const char** out_error_msg);
 
+// Like fidl_encode(), but the data of strings, and of vectors whose elements
+// hold no pointers or handles, may be left outside of |bytes| rather than
+// copied in, so large payloads need not be copied to build a message.
+//
+// |bytes| holds the rest of the message, linearized as for fidl_encode().
+// On success, the encoded message is the concatenation of the
+// |*out_actual_iovecs| segments written to |iovecs|, which point into
+// |bytes| and at the data left outside it.  The segments can be passed
+// straight to zx_channel_write() with ZX_CHANNEL_WRITE_USE_IOVEC.
+zx_status_t fidl_encode_iovec(const fidl_type_t* type, void* bytes, uint32_t num_bytes,
+                              zx_handle_t* handles, uint32_t max_handles,
+                              uint32_t* out_actual_handles, zx_channel_iovec_t* iovecs,
+                              uint32_t max_iovecs, uint32_t* out_actual_iovecs,
+                              const char** out_error_msg);
+
 // See https://fuchsia.googlesource.com/docs/+/master/development/languages/fidl/languages/c.md#fidl_decode-fidl_decode_msg
 zx_status_t fidl_decode(const fidl_type_t* type, void* bytes, uint32_t num_bytes,
                         const zx_handle_t* handles, uint32_t num_handles,
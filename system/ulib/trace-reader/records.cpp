@@ -45,7 +45,7 @@ const char* ThreadStateToString(ThreadState state) {
 }
 
 const char* ObjectTypeToString(zx_obj_type_t type) {
-    static_assert(ZX_OBJ_TYPE_LAST == 29, "need to update switch below");
+    static_assert(ZX_OBJ_TYPE_LAST == 30, "need to update switch below");
 
     switch (type) {
     case ZX_OBJ_TYPE_PROCESS:
@@ -96,6 +96,8 @@ const char* ObjectTypeToString(zx_obj_type_t type) {
         return "suspend-token";
     case ZX_OBJ_TYPE_PAGER:
         return "pager";
+    case ZX_OBJ_TYPE_RING:
+        return "ring";
     default:
         return "???";
     }
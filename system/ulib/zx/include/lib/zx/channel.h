@@ -57,6 +57,15 @@ public:
         return zx_channel_call(get(), flags, deadline.get(), args, actual_bytes,
                                actual_handles);
     }
+
+    // The items name their own channels, which may differ from item to item.
+    static zx_status_t write_many(zx_channel_write_item_t* items, size_t count) {
+        return zx_channel_write_many(items, count);
+    }
+
+    static zx_status_t read_many(zx_channel_read_item_t* items, size_t count) {
+        return zx_channel_read_many(items, count);
+    }
 };
 
 using unowned_channel = unowned<channel>;
@@ -0,0 +1,48 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_ZX_RING_H_
+#define LIB_ZX_RING_H_
+
+#include <lib/zx/handle.h>
+#include <lib/zx/object.h>
+#include <lib/zx/vmo.h>
+#include <zircon/syscalls/ring.h>
+
+namespace zx {
+
+class ring : public object<ring> {
+public:
+    static constexpr zx_obj_type_t TYPE = ZX_OBJ_TYPE_RING;
+
+    constexpr ring() = default;
+
+    explicit ring(zx_handle_t value) : object(value) {}
+
+    explicit ring(handle&& h) : object(h.release()) {}
+
+    ring(ring&& other) : object(other.release()) {}
+
+    ring& operator=(ring&& other) {
+        reset(other.release());
+        return *this;
+    }
+
+    static zx_status_t create(uint32_t elem_count, uint32_t elem_size,
+                              uint32_t options, ring* producer, ring* consumer);
+
+    zx_status_t get_vmo(vmo* result) const {
+        return zx_ring_get_vmo(get(), result->reset_and_get_address());
+    }
+
+    zx_status_t notify() const {
+        return zx_ring_notify(get());
+    }
+};
+
+using unowned_ring = unowned<ring>;
+
+} // namespace zx
+
+#endif  // LIB_ZX_RING_H_
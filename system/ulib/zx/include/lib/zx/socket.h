@@ -7,6 +7,7 @@
 
 #include <lib/zx/handle.h>
 #include <lib/zx/object.h>
+#include <lib/zx/vmo.h>
 
 namespace zx {
 
@@ -40,6 +41,17 @@ public:
         return zx_socket_read(get(), options, buffer, len, actual);
     }
 
+    zx_status_t write_vmo(uint32_t options, const vmo& vmo, uint64_t offset,
+                          size_t len, size_t* actual) const {
+        return zx_socket_write_vmo(get(), options, vmo.get(), offset, len, actual);
+    }
+
+    zx_status_t read_vmo(uint32_t options, size_t len, vmo* out_vmo,
+                         size_t* actual) const {
+        return zx_socket_read_vmo(get(), options, len,
+                                  out_vmo->reset_and_get_address(), actual);
+    }
+
     zx_status_t share(socket socket_to_share) const {
         return zx_socket_share(get(), socket_to_share.release());
     }
@@ -0,0 +1,25 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <lib/zx/ring.h>
+
+#include <zircon/syscalls.h>
+
+namespace zx {
+
+zx_status_t ring::create(uint32_t elem_count, uint32_t elem_size,
+                         uint32_t options, ring* producer, ring* consumer) {
+    // Ensure aliasing of both out parameters to the same container
+    // has a well-defined result, and does not leak.
+    ring h0;
+    ring h1;
+    zx_status_t status = zx_ring_create(
+        elem_count, elem_size, options, h0.reset_and_get_address(),
+        h1.reset_and_get_address());
+    producer->reset(h0.release());
+    consumer->reset(h1.release());
+    return status;
+}
+
+} // namespace zx
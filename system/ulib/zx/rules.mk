@@ -26,6 +26,7 @@ MODULE_SRCS += \
     $(LOCAL_DIR)/process.cpp \
     $(LOCAL_DIR)/profile.cpp \
     $(LOCAL_DIR)/resource.cpp \
+    $(LOCAL_DIR)/ring.cpp \
     $(LOCAL_DIR)/socket.cpp \
     $(LOCAL_DIR)/thread.cpp \
     $(LOCAL_DIR)/timer.cpp \
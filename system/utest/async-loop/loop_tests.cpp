@@ -110,6 +110,22 @@ protected:
     }
 };
 
+class CancelOtherWait : public TestWait {
+public:
+    CancelOtherWait(zx_handle_t object, zx_signals_t trigger)
+        : TestWait(object, trigger) {}
+
+    TestWait* other = nullptr;
+    zx_status_t cancel_result = ZX_ERR_INTERNAL;
+
+protected:
+    void Handle(async_dispatcher_t* dispatcher, zx_status_t status,
+                const zx_packet_signal_t* signal) override {
+        TestWait::Handle(dispatcher, status, signal);
+        cancel_result = other->Cancel(dispatcher);
+    }
+};
+
 class TestTask : public async_task_t {
 public:
     TestTask()
@@ -601,6 +617,38 @@ bool wait_test() {
     END_TEST;
 }
 
+bool wait_cancel_pending_test() {
+    BEGIN_TEST;
+
+    async_loop_config_t config = {};
+    config.batch_port_packets = true;
+    async::Loop loop(&config);
+    zx::event event;
+    EXPECT_EQ(ZX_OK, zx::event::create(0u, &event), "create event");
+
+    // Both waits complete at once, so the loop takes both packets from the
+    // port together.  Whichever runs first cancels the other, which must
+    // then not run even though its packet has already left the port.
+    CancelOtherWait wait1(event.get(), ZX_USER_SIGNAL_0);
+    CancelOtherWait wait2(event.get(), ZX_USER_SIGNAL_0);
+    wait1.other = &wait2;
+    wait2.other = &wait1;
+    EXPECT_EQ(ZX_OK, wait1.Begin(loop.dispatcher()), "wait 1");
+    EXPECT_EQ(ZX_OK, wait2.Begin(loop.dispatcher()), "wait 2");
+
+    EXPECT_EQ(ZX_OK, event.signal(0u, ZX_USER_SIGNAL_0), "signal 0");
+    EXPECT_EQ(ZX_OK, loop.RunUntilIdle(), "run loop");
+    EXPECT_EQ(1u, wait1.run_count + wait2.run_count, "run count");
+    CancelOtherWait* ran = wait1.run_count ? &wait1 : &wait2;
+    EXPECT_EQ(ZX_OK, ran->last_status, "status");
+    EXPECT_EQ(ZX_OK, ran->cancel_result, "cancel result");
+
+    loop.Shutdown();
+    EXPECT_EQ(1u, wait1.run_count + wait2.run_count, "run count");
+
+    END_TEST;
+}
+
 bool wait_unwaitable_handle_test() {
     BEGIN_TEST;
 
@@ -1377,6 +1425,7 @@ RUN_TEST(make_default_true_test)
 RUN_TEST(quit_test)
 RUN_TEST(time_test)
 RUN_TEST(wait_test)
+RUN_TEST(wait_cancel_pending_test)
 RUN_TEST(wait_unwaitable_handle_test)
 RUN_TEST(wait_shutdown_test)
 RUN_TEST(task_test)
@@ -1048,6 +1048,139 @@ static bool channel_write_takes_all_handles(void) {
     END_TEST;
 }
 
+static bool channel_write_many_read_many(void) {
+    BEGIN_TEST;
+
+    zx_handle_t a[2], b[2];
+    ASSERT_EQ(zx_channel_create(0, &a[0], &a[1]), ZX_OK, "");
+    ASSERT_EQ(zx_channel_create(0, &b[0], &b[1]), ZX_OK, "");
+
+    zx_handle_t event, lost_event;
+    ASSERT_EQ(zx_event_create(0u, &event), ZX_OK, "");
+    ASSERT_EQ(zx_event_create(0u, &lost_event), ZX_OK, "");
+
+    const char msg0[] = "one";
+    const char msg1[] = "two";
+    const char msg2[] = "three";
+    zx_channel_write_item_t writes[] = {
+        {a[0], 0u, msg0, NULL, sizeof(msg0), 0u, ZX_ERR_INTERNAL, 0u},
+        {b[0], 0u, msg1, &event, sizeof(msg1), 1u, ZX_ERR_INTERNAL, 0u},
+        {a[0], 0u, msg2, NULL, sizeof(msg2), 0u, ZX_ERR_INTERNAL, 0u},
+        // A failed item still consumes its handles, and doesn't stop the rest.
+        {ZX_HANDLE_INVALID, 0u, msg0, &lost_event, sizeof(msg0), 1u, ZX_ERR_INTERNAL, 0u},
+        {b[0], 1u, msg0, NULL, sizeof(msg0), 0u, ZX_ERR_INTERNAL, 0u},
+    };
+    ASSERT_EQ(zx_channel_write_many(writes, countof(writes)), ZX_OK, "");
+    EXPECT_EQ(writes[0].status, ZX_OK, "");
+    EXPECT_EQ(writes[1].status, ZX_OK, "");
+    EXPECT_EQ(writes[2].status, ZX_OK, "");
+    EXPECT_EQ(writes[3].status, ZX_ERR_BAD_HANDLE, "");
+    EXPECT_EQ(writes[4].status, ZX_ERR_INVALID_ARGS, "");
+    EXPECT_EQ(zx_handle_close(lost_event), ZX_ERR_BAD_HANDLE, "handle not consumed");
+
+    zx_channel_write_item_t too_many[ZX_CHANNEL_MANY_MAX_ITEMS + 1] = {};
+    EXPECT_EQ(zx_channel_write_many(too_many, countof(too_many)), ZX_ERR_OUT_OF_RANGE, "");
+
+    char buf[4][8] = {};
+    zx_handle_info_t info = {};
+    zx_channel_read_item_t reads[] = {
+        {a[1], 0u, buf[0], NULL, sizeof(buf[0]), 0u, 0u, 0u, ZX_ERR_INTERNAL, 0u},
+        {b[1], 0u, buf[1], &info, sizeof(buf[1]), 1u, 0u, 0u, ZX_ERR_INTERNAL, 0u},
+        // Too small for "three": it stays queued for the next item.
+        {a[1], 0u, buf[2], NULL, 2u, 0u, 0u, 0u, ZX_ERR_INTERNAL, 0u},
+        {a[1], 0u, buf[2], NULL, sizeof(buf[2]), 0u, 0u, 0u, ZX_ERR_INTERNAL, 0u},
+        {b[1], 0u, buf[3], NULL, sizeof(buf[3]), 0u, 0u, 0u, ZX_ERR_INTERNAL, 0u},
+    };
+    ASSERT_EQ(zx_channel_read_many(reads, countof(reads)), ZX_OK, "");
+
+    EXPECT_EQ(reads[0].status, ZX_OK, "");
+    EXPECT_EQ(reads[0].actual_bytes, sizeof(msg0), "");
+    EXPECT_EQ(reads[0].actual_handles, 0u, "");
+    EXPECT_EQ(memcmp(buf[0], msg0, sizeof(msg0)), 0, "");
+
+    EXPECT_EQ(reads[1].status, ZX_OK, "");
+    EXPECT_EQ(reads[1].actual_bytes, sizeof(msg1), "");
+    EXPECT_EQ(reads[1].actual_handles, 1u, "");
+    EXPECT_EQ(memcmp(buf[1], msg1, sizeof(msg1)), 0, "");
+    EXPECT_EQ(info.type, ZX_OBJ_TYPE_EVENT, "");
+
+    EXPECT_EQ(reads[2].status, ZX_ERR_BUFFER_TOO_SMALL, "");
+    EXPECT_EQ(reads[2].actual_bytes, sizeof(msg2), "");
+
+    EXPECT_EQ(reads[3].status, ZX_OK, "");
+    EXPECT_EQ(reads[3].actual_bytes, sizeof(msg2), "");
+    EXPECT_EQ(memcmp(buf[2], msg2, sizeof(msg2)), 0, "");
+
+    EXPECT_EQ(reads[4].status, ZX_ERR_SHOULD_WAIT, "");
+
+    EXPECT_EQ(zx_handle_close(info.handle), ZX_OK, "");
+    EXPECT_EQ(zx_handle_close(a[0]), ZX_OK, "");
+    EXPECT_EQ(zx_handle_close(a[1]), ZX_OK, "");
+    EXPECT_EQ(zx_handle_close(b[0]), ZX_OK, "");
+    EXPECT_EQ(zx_handle_close(b[1]), ZX_OK, "");
+
+    END_TEST;
+}
+
+static bool channel_write_iovec(void) {
+    BEGIN_TEST;
+
+    zx_handle_t channel[2];
+    ASSERT_EQ(zx_channel_create(0, &channel[0], &channel[1]), ZX_OK, "");
+
+    // The segments are gathered into a single message, in order.
+    const char part0[] = "gather";
+    const char part2[] = "ed";
+    zx_channel_iovec_t iovecs[] = {
+        {part0, 6u, 0u},
+        {NULL, 0u, 0u},
+        {part2, 3u, 0u},
+    };
+    zx_handle_t event;
+    ASSERT_EQ(zx_event_create(0u, &event), ZX_OK, "");
+    ASSERT_EQ(zx_channel_write(channel[0], ZX_CHANNEL_WRITE_USE_IOVEC, iovecs, countof(iovecs),
+                               &event, 1u), ZX_OK, "");
+
+    char buf[16] = {};
+    zx_handle_t received;
+    uint32_t actual_bytes, actual_handles;
+    ASSERT_EQ(zx_channel_read(channel[1], 0u, buf, &received, sizeof(buf), 1u,
+                              &actual_bytes, &actual_handles), ZX_OK, "");
+    EXPECT_EQ(actual_bytes, 9u, "");
+    EXPECT_EQ(actual_handles, 1u, "");
+    EXPECT_EQ(memcmp(buf, "gathered", 9u), 0, "");
+    EXPECT_EQ(zx_handle_close(received), ZX_OK, "");
+
+    // A nonzero reserved field is rejected, and the handles still consumed.
+    ASSERT_EQ(zx_event_create(0u, &event), ZX_OK, "");
+    iovecs[1].reserved = 1u;
+    EXPECT_EQ(zx_channel_write(channel[0], ZX_CHANNEL_WRITE_USE_IOVEC, iovecs, countof(iovecs),
+                               &event, 1u), ZX_ERR_INVALID_ARGS, "");
+    EXPECT_EQ(zx_handle_close(event), ZX_ERR_BAD_HANDLE, "handle not consumed");
+    iovecs[1].reserved = 0u;
+
+    // So are messages that add up to more than the largest message.
+    char* big = malloc(ZX_CHANNEL_MAX_MSG_BYTES);
+    ASSERT_NE(NULL, big, "");
+    zx_channel_iovec_t too_big[] = {
+        {big, ZX_CHANNEL_MAX_MSG_BYTES, 0u},
+        {big, 1u, 0u},
+    };
+    EXPECT_EQ(zx_channel_write(channel[0], ZX_CHANNEL_WRITE_USE_IOVEC, too_big, countof(too_big),
+                               NULL, 0u), ZX_ERR_OUT_OF_RANGE, "");
+    free(big);
+
+    EXPECT_EQ(zx_channel_write(channel[0], ZX_CHANNEL_WRITE_USE_IOVEC, iovecs,
+                               ZX_CHANNEL_MAX_MSG_IOVECS + 1, NULL, 0u), ZX_ERR_OUT_OF_RANGE, "");
+    EXPECT_EQ(zx_channel_write(channel[0], ZX_CHANNEL_WRITE_USE_IOVEC, NULL, 1u, NULL, 0u),
+              ZX_ERR_INVALID_ARGS, "");
+
+    EXPECT_EQ(zx_handle_close(channel[0]), ZX_OK, "");
+    EXPECT_EQ(zx_handle_close(channel[1]), ZX_OK, "");
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(channel_tests)
 RUN_TEST(channel_test)
 RUN_TEST(channel_read_error_test)
@@ -1066,6 +1199,8 @@ RUN_TEST(channel_disallow_write_to_self)
 RUN_TEST(channel_read_etc)
 RUN_TEST(channel_write_different_sizes)
 RUN_TEST(channel_write_takes_all_handles)
+RUN_TEST(channel_write_many_read_many)
+RUN_TEST(channel_write_iovec)
 END_TEST_CASE(channel_tests)
 
 #ifndef BUILD_COMBINED_TESTS
@@ -0,0 +1,347 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <threads.h>
+
+#include <zircon/process.h>
+#include <zircon/syscalls.h>
+#include <zircon/syscalls/port.h>
+#include <unittest/unittest.h>
+
+#define VMO_PAGES 64u
+#define KEY 0x1234u
+
+// A pager, one of its vmos, and the port the vmo's requests arrive on.
+typedef struct paged_vmo {
+    zx_handle_t pager;
+    zx_handle_t port;
+    zx_handle_t vmo;
+} paged_vmo_t;
+
+static bool paged_vmo_create(paged_vmo_t* p) {
+    BEGIN_HELPER;
+    ASSERT_EQ(zx_pager_create(0, &p->pager), ZX_OK, "");
+    ASSERT_EQ(zx_port_create(0, &p->port), ZX_OK, "");
+    ASSERT_EQ(zx_pager_create_vmo(p->pager, p->port, KEY, VMO_PAGES * ZX_PAGE_SIZE, 0,
+                                  &p->vmo), ZX_OK, "");
+    END_HELPER;
+}
+
+static void paged_vmo_close(paged_vmo_t* p) {
+    zx_handle_close(p->vmo);
+    zx_handle_close(p->port);
+    zx_handle_close(p->pager);
+}
+
+// Every word of the vmo holds its own offset, so that misplaced pages show up.
+static bool supply(paged_vmo_t* p, uint64_t offset, uint64_t length) {
+    BEGIN_HELPER;
+    zx_handle_t aux;
+    ASSERT_EQ(zx_vmo_create(length, 0, &aux), ZX_OK, "");
+    for (uint64_t o = 0; o < length; o += sizeof(uint64_t)) {
+        uint64_t value = offset + o;
+        ASSERT_EQ(zx_vmo_write(aux, &value, o, sizeof(value)), ZX_OK, "");
+    }
+    ASSERT_EQ(zx_pager_supply_pages(p->pager, p->vmo, offset, length, aux, 0), ZX_OK, "");
+
+    // The pages were moved out, not copied.
+    uint64_t value;
+    ASSERT_EQ(zx_vmo_read(aux, &value, 0, sizeof(value)), ZX_OK, "");
+    EXPECT_EQ(value, 0u, "");
+    zx_handle_close(aux);
+    END_HELPER;
+}
+
+// Waits for the next page request and checks that it covers |offset|.
+static bool wait_for_request(paged_vmo_t* p, uint64_t offset, zx_packet_page_request_t* req) {
+    BEGIN_HELPER;
+    zx_port_packet_t packet;
+    ASSERT_EQ(zx_port_wait(p->port, ZX_TIME_INFINITE, &packet), ZX_OK, "");
+    EXPECT_EQ(packet.key, KEY, "");
+    EXPECT_EQ(packet.type, ZX_PKT_TYPE_PAGE_REQUEST, "");
+    EXPECT_EQ(packet.status, ZX_OK, "");
+    EXPECT_EQ(packet.page_request.command, ZX_PAGER_VMO_READ, "");
+    EXPECT_EQ(packet.page_request.offset % ZX_PAGE_SIZE, 0u, "");
+    EXPECT_EQ(packet.page_request.length % ZX_PAGE_SIZE, 0u, "");
+    EXPECT_LE(packet.page_request.offset, offset, "");
+    EXPECT_GT(packet.page_request.offset + packet.page_request.length, offset, "");
+    *req = packet.page_request;
+    END_HELPER;
+}
+
+typedef struct reader_args {
+    zx_handle_t vmo;
+    uint64_t offset;
+    uint64_t value;
+    zx_status_t status;
+} reader_args_t;
+
+static int vmo_reader(void* arg) {
+    reader_args_t* args = arg;
+    args->status = zx_vmo_read(args->vmo, &args->value, args->offset, sizeof(args->value));
+    return 0;
+}
+
+static int mapping_reader(void* arg) {
+    reader_args_t* args = arg;
+    args->value = *(volatile uint64_t*)(uintptr_t)args->offset;
+    args->status = ZX_OK;
+    return 0;
+}
+
+static bool read_test(void) {
+    BEGIN_TEST;
+
+    paged_vmo_t p;
+    ASSERT_TRUE(paged_vmo_create(&p), "");
+
+    reader_args_t args = {p.vmo, 3 * ZX_PAGE_SIZE + 8, 0, ZX_ERR_INTERNAL};
+    thrd_t thread;
+    ASSERT_EQ(thrd_create(&thread, vmo_reader, &args), thrd_success, "");
+
+    zx_packet_page_request_t req;
+    ASSERT_TRUE(wait_for_request(&p, args.offset, &req), "");
+    ASSERT_TRUE(supply(&p, req.offset, req.length), "");
+
+    ASSERT_EQ(thrd_join(thread, NULL), thrd_success, "");
+    EXPECT_EQ(args.status, ZX_OK, "");
+    EXPECT_EQ(args.value, args.offset, "");
+
+    // The supplied range is now part of the vmo.
+    uint64_t value;
+    uint64_t last = req.offset + req.length - sizeof(value);
+    ASSERT_EQ(zx_vmo_read(p.vmo, &value, last, sizeof(value)), ZX_OK, "");
+    EXPECT_EQ(value, last, "");
+
+    paged_vmo_close(&p);
+
+    END_TEST;
+}
+
+static bool map_test(void) {
+    BEGIN_TEST;
+
+    paged_vmo_t p;
+    ASSERT_TRUE(paged_vmo_create(&p), "");
+
+    zx_vaddr_t addr;
+    ASSERT_EQ(zx_vmar_map(zx_vmar_root_self(), ZX_VM_PERM_READ, 0, p.vmo, 0,
+                          VMO_PAGES * ZX_PAGE_SIZE, &addr), ZX_OK, "");
+
+    const uint64_t offset = 10 * ZX_PAGE_SIZE;
+    reader_args_t args = {p.vmo, addr + offset, 0, ZX_ERR_INTERNAL};
+    thrd_t thread;
+    ASSERT_EQ(thrd_create(&thread, mapping_reader, &args), thrd_success, "");
+
+    zx_packet_page_request_t req;
+    ASSERT_TRUE(wait_for_request(&p, offset, &req), "");
+    ASSERT_TRUE(supply(&p, req.offset, req.length), "");
+
+    ASSERT_EQ(thrd_join(thread, NULL), thrd_success, "");
+    EXPECT_EQ(args.status, ZX_OK, "");
+    EXPECT_EQ(args.value, offset, "");
+
+    ASSERT_EQ(zx_vmar_unmap(zx_vmar_root_self(), addr, VMO_PAGES * ZX_PAGE_SIZE), ZX_OK, "");
+    paged_vmo_close(&p);
+
+    END_TEST;
+}
+
+// Sequential faults should ask for more and more at a time.
+static bool read_ahead_test(void) {
+    BEGIN_TEST;
+
+    paged_vmo_t p;
+    ASSERT_TRUE(paged_vmo_create(&p), "");
+
+    uint64_t offset = 0;
+    uint64_t last_length = 0;
+    for (int i = 0; i < 3; i++) {
+        reader_args_t args = {p.vmo, offset, 0, ZX_ERR_INTERNAL};
+        thrd_t thread;
+        ASSERT_EQ(thrd_create(&thread, vmo_reader, &args), thrd_success, "");
+
+        zx_packet_page_request_t req;
+        ASSERT_TRUE(wait_for_request(&p, offset, &req), "");
+        EXPECT_EQ(req.offset, offset, "");
+        EXPECT_GT(req.length, last_length, "");
+        ASSERT_TRUE(supply(&p, req.offset, req.length), "");
+
+        ASSERT_EQ(thrd_join(thread, NULL), thrd_success, "");
+        EXPECT_EQ(args.status, ZX_OK, "");
+        EXPECT_EQ(args.value, offset, "");
+
+        offset = req.offset + req.length;
+        last_length = req.length;
+    }
+
+    paged_vmo_close(&p);
+
+    END_TEST;
+}
+
+// Clones don't have pages of their own until written, so reading one has to
+// wait for the pager just like reading the vmo.
+static bool clone_test(void) {
+    BEGIN_TEST;
+
+    paged_vmo_t p;
+    ASSERT_TRUE(paged_vmo_create(&p), "");
+
+    const uint64_t clone_offset = 2 * ZX_PAGE_SIZE;
+    zx_handle_t clone;
+    ASSERT_EQ(zx_vmo_clone(p.vmo, ZX_VMO_CLONE_COPY_ON_WRITE, clone_offset,
+                           8 * ZX_PAGE_SIZE, &clone), ZX_OK, "");
+
+    reader_args_t args = {clone, 5 * ZX_PAGE_SIZE + 16, 0, ZX_ERR_INTERNAL};
+    thrd_t thread;
+    ASSERT_EQ(thrd_create(&thread, vmo_reader, &args), thrd_success, "");
+
+    zx_packet_page_request_t req;
+    ASSERT_TRUE(wait_for_request(&p, clone_offset + args.offset, &req), "");
+    ASSERT_TRUE(supply(&p, req.offset, req.length), "");
+
+    ASSERT_EQ(thrd_join(thread, NULL), thrd_success, "");
+    EXPECT_EQ(args.status, ZX_OK, "");
+    EXPECT_EQ(args.value, clone_offset + args.offset, "");
+
+    // Writing the clone copies the supplied page rather than starting from zero.
+    uint64_t value = 0;
+    ASSERT_EQ(zx_vmo_write(clone, &value, args.offset, sizeof(value)), ZX_OK, "");
+    ASSERT_EQ(zx_vmo_read(clone, &value, args.offset + 8, sizeof(value)), ZX_OK, "");
+    EXPECT_EQ(value, clone_offset + args.offset + 8, "");
+    ASSERT_EQ(zx_vmo_read(p.vmo, &value, clone_offset + args.offset, sizeof(value)), ZX_OK, "");
+    EXPECT_EQ(value, clone_offset + args.offset, "");
+
+    zx_handle_close(clone);
+    paged_vmo_close(&p);
+
+    END_TEST;
+}
+
+static bool close_pager_test(void) {
+    BEGIN_TEST;
+
+    paged_vmo_t p;
+    ASSERT_TRUE(paged_vmo_create(&p), "");
+
+    reader_args_t args = {p.vmo, 0, 0, ZX_ERR_INTERNAL};
+    thrd_t thread;
+    ASSERT_EQ(thrd_create(&thread, vmo_reader, &args), thrd_success, "");
+
+    zx_packet_page_request_t req;
+    ASSERT_TRUE(wait_for_request(&p, 0, &req), "");
+
+    // Waiting threads are failed once the pager goes away.
+    zx_handle_close(p.pager);
+    p.pager = ZX_HANDLE_INVALID;
+
+    ASSERT_EQ(thrd_join(thread, NULL), thrd_success, "");
+    EXPECT_EQ(args.status, ZX_ERR_BAD_STATE, "");
+
+    uint64_t value;
+    EXPECT_EQ(zx_vmo_read(p.vmo, &value, 0, sizeof(value)), ZX_ERR_BAD_STATE, "");
+
+    paged_vmo_close(&p);
+
+    END_TEST;
+}
+
+static bool close_port_test(void) {
+    BEGIN_TEST;
+
+    paged_vmo_t p;
+    ASSERT_TRUE(paged_vmo_create(&p), "");
+
+    // With no one left to read the request, the read fails instead of waiting.
+    zx_handle_close(p.port);
+    p.port = ZX_HANDLE_INVALID;
+
+    uint64_t value;
+    EXPECT_EQ(zx_vmo_read(p.vmo, &value, 0, sizeof(value)), ZX_ERR_BAD_STATE, "");
+
+    paged_vmo_close(&p);
+
+    END_TEST;
+}
+
+static bool supply_errors_test(void) {
+    BEGIN_TEST;
+
+    paged_vmo_t p;
+    ASSERT_TRUE(paged_vmo_create(&p), "");
+    zx_handle_t aux;
+    ASSERT_EQ(zx_vmo_create(ZX_PAGE_SIZE, 0, &aux), ZX_OK, "");
+
+    EXPECT_EQ(zx_pager_supply_pages(p.pager, p.vmo, 0, 0, aux, 0), ZX_OK, "");
+
+    // Unaligned ranges.
+    EXPECT_EQ(zx_pager_supply_pages(p.pager, p.vmo, 1, ZX_PAGE_SIZE, aux, 0),
+              ZX_ERR_INVALID_ARGS, "");
+    EXPECT_EQ(zx_pager_supply_pages(p.pager, p.vmo, 0, 1, aux, 0),
+              ZX_ERR_INVALID_ARGS, "");
+    EXPECT_EQ(zx_pager_supply_pages(p.pager, p.vmo, 0, ZX_PAGE_SIZE, aux, 1),
+              ZX_ERR_INVALID_ARGS, "");
+
+    // Ranges outside either vmo.
+    EXPECT_EQ(zx_pager_supply_pages(p.pager, p.vmo, VMO_PAGES * ZX_PAGE_SIZE, ZX_PAGE_SIZE,
+                                    aux, 0), ZX_ERR_OUT_OF_RANGE, "");
+    EXPECT_EQ(zx_pager_supply_pages(p.pager, p.vmo, 0, ZX_PAGE_SIZE, aux, ZX_PAGE_SIZE),
+              ZX_ERR_OUT_OF_RANGE, "");
+
+    // A vmo from another pager, or from none.
+    paged_vmo_t other;
+    ASSERT_TRUE(paged_vmo_create(&other), "");
+    EXPECT_EQ(zx_pager_supply_pages(p.pager, other.vmo, 0, ZX_PAGE_SIZE, aux, 0),
+              ZX_ERR_INVALID_ARGS, "");
+    EXPECT_EQ(zx_pager_supply_pages(p.pager, aux, 0, ZX_PAGE_SIZE, aux, 0),
+              ZX_ERR_INVALID_ARGS, "");
+
+    // Pages can't come out of another pager's vmo.
+    EXPECT_EQ(zx_pager_supply_pages(p.pager, p.vmo, 0, ZX_PAGE_SIZE, other.vmo, 0),
+              ZX_ERR_NOT_SUPPORTED, "");
+    paged_vmo_close(&other);
+
+    // The aux vmo needs to be readable and writable.
+    zx_handle_t read_only;
+    ASSERT_EQ(zx_handle_duplicate(aux, ZX_RIGHT_READ, &read_only), ZX_OK, "");
+    EXPECT_EQ(zx_pager_supply_pages(p.pager, p.vmo, 0, ZX_PAGE_SIZE, read_only, 0),
+              ZX_ERR_ACCESS_DENIED, "");
+    zx_handle_close(read_only);
+
+    // Nothing was supplied, so reading the vmo still has to wait for the pager.
+    zx_packet_page_request_t req;
+    reader_args_t args = {p.vmo, 0, 0, ZX_ERR_INTERNAL};
+    thrd_t thread;
+    ASSERT_EQ(thrd_create(&thread, vmo_reader, &args), thrd_success, "");
+    ASSERT_TRUE(wait_for_request(&p, 0, &req), "");
+    ASSERT_TRUE(supply(&p, req.offset, req.length), "");
+    ASSERT_EQ(thrd_join(thread, NULL), thrd_success, "");
+    EXPECT_EQ(args.status, ZX_OK, "");
+    EXPECT_EQ(args.value, 0u, "");
+
+    zx_handle_close(aux);
+    paged_vmo_close(&p);
+
+    END_TEST;
+}
+
+BEGIN_TEST_CASE(pager_tests)
+RUN_TEST(read_test)
+RUN_TEST(map_test)
+RUN_TEST(read_ahead_test)
+RUN_TEST(clone_test)
+RUN_TEST(close_pager_test)
+RUN_TEST(close_port_test)
+RUN_TEST(supply_errors_test)
+END_TEST_CASE(pager_tests)
+
+#ifndef BUILD_COMBINED_TESTS
+int main(int argc, char** argv) {
+    return unittest_run_all_tests(argc, argv) ? 0 : -1;
+}
+#endif
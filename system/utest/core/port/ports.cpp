@@ -108,6 +108,73 @@ static bool queue_too_many(void) {
     END_TEST;
 }
 
+static bool wait_many_test(void) {
+    BEGIN_TEST;
+    zx_status_t status;
+
+    zx_handle_t port;
+    status = zx_port_create(0, &port);
+    ASSERT_EQ(status, ZX_OK, "could not create port");
+
+    zx_port_packet_t out[8] = {};
+    size_t actual = 0;
+    status = zx_port_wait_many(port, zx_deadline_after(ZX_USEC(1)), out, fbl::count_of(out),
+                               &actual);
+    EXPECT_EQ(status, ZX_ERR_TIMED_OUT);
+
+    status = zx_port_wait_many(port, 0, out, 0, &actual);
+    EXPECT_EQ(status, ZX_ERR_INVALID_ARGS);
+
+    for (uint64_t key = 0; key < 5; ++key) {
+        zx_port_packet_t in = {key, ZX_PKT_TYPE_USER, 0, { {} }};
+        in.user.u64[0] = key * 3;
+        status = zx_port_queue(port, &in);
+        ASSERT_EQ(status, ZX_OK);
+    }
+
+    // Ask for fewer than are queued.
+    status = zx_port_wait_many(port, ZX_TIME_INFINITE, out, 3, &actual);
+    ASSERT_EQ(status, ZX_OK);
+    ASSERT_EQ(actual, 3u);
+    for (uint64_t i = 0; i < actual; ++i) {
+        EXPECT_EQ(out[i].key, i);
+        EXPECT_EQ(out[i].type, ZX_PKT_TYPE_USER);
+        EXPECT_EQ(out[i].user.u64[0], i * 3);
+    }
+
+    // Then more than are left.
+    status = zx_port_wait_many(port, ZX_TIME_INFINITE, out, fbl::count_of(out), &actual);
+    ASSERT_EQ(status, ZX_OK);
+    ASSERT_EQ(actual, 2u);
+    EXPECT_EQ(out[0].key, 3u);
+    EXPECT_EQ(out[1].key, 4u);
+
+    status = zx_port_wait_many(port, 0, out, fbl::count_of(out), &actual);
+    EXPECT_EQ(status, ZX_ERR_TIMED_OUT);
+
+    // Signal packets come out alongside user packets, in order.
+    zx_handle_t ev;
+    ASSERT_EQ(zx_event_create(0u, &ev), ZX_OK);
+    ASSERT_EQ(zx_object_wait_async(ev, port, 10u, ZX_EVENT_SIGNALED, ZX_WAIT_ASYNC_ONCE), ZX_OK);
+    ASSERT_EQ(zx_object_signal(ev, 0u, ZX_EVENT_SIGNALED), ZX_OK);
+    const zx_port_packet_t in = {11u, ZX_PKT_TYPE_USER, 0, { {} }};
+    ASSERT_EQ(zx_port_queue(port, &in), ZX_OK);
+
+    status = zx_port_wait_many(port, ZX_TIME_INFINITE, out, fbl::count_of(out), &actual);
+    ASSERT_EQ(status, ZX_OK);
+    ASSERT_EQ(actual, 2u);
+    EXPECT_EQ(out[0].key, 10u);
+    EXPECT_EQ(out[0].type, ZX_PKT_TYPE_SIGNAL_ONE);
+    EXPECT_EQ(out[0].signal.observed & ZX_EVENT_SIGNALED, ZX_EVENT_SIGNALED);
+    EXPECT_EQ(out[1].key, 11u);
+    EXPECT_EQ(out[1].type, ZX_PKT_TYPE_USER);
+
+    EXPECT_EQ(zx_handle_close(ev), ZX_OK);
+    EXPECT_EQ(zx_handle_close(port), ZX_OK);
+
+    END_TEST;
+}
+
 static bool async_wait_channel_test(void) {
     BEGIN_TEST;
     zx_status_t status;
@@ -681,6 +748,7 @@ BEGIN_TEST_CASE(port_tests)
 RUN_TEST(basic_test)
 RUN_TEST(queue_and_close_test)
 RUN_TEST(queue_too_many)
+RUN_TEST(wait_many_test)
 RUN_TEST(async_wait_channel_test)
 RUN_TEST(async_wait_event_test_single)
 RUN_TEST(async_wait_event_test_repeat)
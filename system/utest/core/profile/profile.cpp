@@ -2,13 +2,33 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <atomic>
+#include <threads.h>
+
+#include <fbl/vector.h>
 #include <unittest/unittest.h>
+#include <lib/zx/event.h>
 #include <lib/zx/profile.h>
 #include <lib/zx/thread.h>
+#include <lib/zx/time.h>
 #include <lib/zx/job.h>
+#include <zircon/syscalls.h>
+#include <zircon/threads.h>
 
 // Tests in this file rely that the default job is the root job.
 
+static zx_status_t create_deadline_profile(const zx::job& root_job, zx_duration_t capacity,
+                                           zx_duration_t deadline, zx_duration_t period,
+                                           zx::profile* profile) {
+    zx_profile_deadline_info_t info = {};
+    info.type = ZX_PROFILE_INFO_DEADLINE;
+    info.deadline.capacity = capacity;
+    info.deadline.deadline = deadline;
+    info.deadline.period = period;
+    return zx::profile::create(root_job, reinterpret_cast<const zx_profile_info_t*>(&info),
+                               profile);
+}
+
 static bool profile_failures_test() {
     BEGIN_TEST;
 
@@ -66,7 +86,262 @@ static bool profile_priority_test(void) {
     END_TEST;
 }
 
+static bool profile_deadline_failures_test() {
+    BEGIN_TEST;
+
+    zx::unowned_job root_job(zx_job_default());
+    if (!root_job->is_valid()) {
+        unittest_printf("no root job. skipping test\n");
+    } else {
+        zx::profile profile;
+
+        // No capacity at all.
+        ASSERT_EQ(create_deadline_profile(*root_job, 0, ZX_MSEC(5), ZX_MSEC(10), &profile),
+                  ZX_ERR_INVALID_ARGS, "");
+
+        // Capacity larger than the deadline.
+        ASSERT_EQ(create_deadline_profile(*root_job, ZX_MSEC(6), ZX_MSEC(5), ZX_MSEC(10), &profile),
+                  ZX_ERR_INVALID_ARGS, "");
+
+        // Deadline past the end of the period.
+        ASSERT_EQ(create_deadline_profile(*root_job, ZX_MSEC(2), ZX_MSEC(11), ZX_MSEC(10), &profile),
+                  ZX_ERR_INVALID_ARGS, "");
+
+        // Nonzero reserved field.
+        zx_profile_deadline_info_t info = {};
+        info.type = ZX_PROFILE_INFO_DEADLINE;
+        info.reserved = 1;
+        info.deadline.capacity = ZX_MSEC(2);
+        info.deadline.deadline = ZX_MSEC(5);
+        info.deadline.period = ZX_MSEC(10);
+        ASSERT_EQ(zx::profile::create(*root_job, reinterpret_cast<const zx_profile_info_t*>(&info),
+                                      &profile), ZX_ERR_INVALID_ARGS, "");
+
+        ASSERT_EQ(create_deadline_profile(*root_job, ZX_MSEC(2), ZX_MSEC(5), ZX_MSEC(10), &profile),
+                  ZX_OK, "");
+    }
+
+    END_TEST;
+}
+
+static int spin_until_stopped(void* arg) {
+    auto stop = static_cast<std::atomic<bool>*>(arg);
+    while (!stop->load()) {
+    }
+    return 0;
+}
+
+// With every cpu kept busy by spinning threads at the same priority, a thread
+// with a deadline profile should still get its work done by its deadline in
+// (nearly) every period.
+static bool profile_deadline_under_load_test() {
+    BEGIN_TEST;
+
+    zx::unowned_job root_job(zx_job_default());
+    if (!root_job->is_valid()) {
+        unittest_printf("no root job. skipping test\n");
+    } else {
+        constexpr zx::duration kCapacity = zx::msec(2);
+        constexpr zx::duration kDeadline = zx::msec(5);
+        constexpr zx::duration kPeriod = zx::msec(10);
+        constexpr zx::duration kWork = zx::usec(500);
+        constexpr int kPeriods = 50;
+        // Leave some room for interrupts and real time threads elsewhere in the system.
+        constexpr int kMaxMissed = kPeriods / 10;
+
+        zx::profile deadline_profile;
+        ASSERT_EQ(create_deadline_profile(*root_job, kCapacity.get(), kDeadline.get(),
+                                          kPeriod.get(), &deadline_profile), ZX_OK, "");
+
+        zx_profile_info_t profile_info = {};
+        profile_info.type = ZX_PROFILE_INFO_SCHEDULER;
+        profile_info.scheduler.priority = ZX_PRIORITY_DEFAULT;
+        zx::profile default_profile;
+        ASSERT_EQ(zx::profile::create(*root_job, &profile_info, &default_profile), ZX_OK, "");
+
+        std::atomic<bool> stop(false);
+        fbl::Vector<thrd_t> spinners;
+        for (uint32_t i = 0; i < zx_system_get_num_cpus() * 2; ++i) {
+            thrd_t spinner;
+            ASSERT_EQ(thrd_create(&spinner, spin_until_stopped, &stop), thrd_success, "");
+            spinners.push_back(spinner);
+        }
+
+        ASSERT_EQ(zx::thread::self()->set_profile(deadline_profile, 0), ZX_OK, "");
+
+        int missed = 0;
+        zx::time period_start = zx::clock::get_monotonic();
+        for (int i = 0; i < kPeriods; ++i) {
+            zx::time work_end = zx::clock::get_monotonic() + kWork;
+            while (zx::clock::get_monotonic() < work_end) {
+            }
+            if (zx::clock::get_monotonic() > period_start + kDeadline) {
+                ++missed;
+            }
+            period_start += kPeriod;
+            zx::nanosleep(period_start);
+        }
+
+        ASSERT_EQ(zx::thread::self()->set_profile(default_profile, 0), ZX_OK, "");
+
+        stop.store(true);
+        for (thrd_t spinner : spinners) {
+            ASSERT_EQ(thrd_join(spinner, nullptr), thrd_success, "");
+        }
+
+        EXPECT_LE(missed, kMaxMissed, "too many deadlines missed under load");
+    }
+
+    END_TEST;
+}
+
+static zx::duration thread_runtime() {
+    zx_info_thread_stats_t stats;
+    zx_status_t status = zx::thread::self()->get_info(ZX_INFO_THREAD_STATS, &stats,
+                                                      sizeof(stats), nullptr, nullptr);
+    return status == ZX_OK ? zx::duration(stats.total_runtime) : zx::duration::infinite();
+}
+
+// A deadline thread that never stops running should be held to roughly its
+// capacity while other threads want the cpus, and should be handed a fresh
+// budget at the start of every period rather than waiting its turn behind them.
+static bool profile_deadline_throttle_test() {
+    BEGIN_TEST;
+
+    zx::unowned_job root_job(zx_job_default());
+    if (!root_job->is_valid()) {
+        unittest_printf("no root job. skipping test\n");
+    } else {
+        constexpr zx::duration kCapacity = zx::msec(2);
+        constexpr zx::duration kDeadline = zx::msec(5);
+        constexpr zx::duration kPeriod = zx::msec(10);
+        // Each window spans at least one whole period, whatever the alignment.
+        constexpr zx::duration kWindow = kPeriod * 2;
+        constexpr int kWindows = 25;
+        constexpr int kMaxStarved = kWindows / 10;
+
+        zx::profile deadline_profile;
+        ASSERT_EQ(create_deadline_profile(*root_job, kCapacity.get(), kDeadline.get(),
+                                          kPeriod.get(), &deadline_profile), ZX_OK, "");
+
+        zx_profile_info_t profile_info = {};
+        profile_info.type = ZX_PROFILE_INFO_SCHEDULER;
+        profile_info.scheduler.priority = ZX_PRIORITY_DEFAULT;
+        zx::profile default_profile;
+        ASSERT_EQ(zx::profile::create(*root_job, &profile_info, &default_profile), ZX_OK, "");
+
+        std::atomic<bool> stop(false);
+        fbl::Vector<thrd_t> spinners;
+        for (uint32_t i = 0; i < zx_system_get_num_cpus() * 2; ++i) {
+            thrd_t spinner;
+            ASSERT_EQ(thrd_create(&spinner, spin_until_stopped, &stop), thrd_success, "");
+            spinners.push_back(spinner);
+        }
+
+        ASSERT_EQ(zx::thread::self()->set_profile(deadline_profile, 0), ZX_OK, "");
+
+        int starved = 0;
+        zx::time start = zx::clock::get_monotonic();
+        zx::duration start_runtime = thread_runtime();
+        zx::duration window_runtime = start_runtime;
+        for (int i = 0; i < kWindows; ++i) {
+            zx::time window_end = start + kWindow * (i + 1);
+            while (zx::clock::get_monotonic() < window_end) {
+            }
+            zx::duration runtime = thread_runtime();
+            if (runtime - window_runtime < kCapacity) {
+                ++starved;
+            }
+            window_runtime = runtime;
+        }
+        zx::duration elapsed = zx::clock::get_monotonic() - start;
+
+        ASSERT_EQ(zx::thread::self()->set_profile(default_profile, 0), ZX_OK, "");
+
+        stop.store(true);
+        for (thrd_t spinner : spinners) {
+            ASSERT_EQ(thrd_join(spinner, nullptr), thrd_success, "");
+        }
+
+        // Past its capacity the thread shares the cpus with the spinners, so it
+        // can't have had anything like all of the time.
+        EXPECT_LT((window_runtime - start_runtime).get(), (elapsed * 4 / 5).get(),
+                  "deadline thread was not throttled");
+        EXPECT_LE(starved, kMaxStarved, "deadline thread was not replenished");
+    }
+
+    END_TEST;
+}
+
+static int wait_for_event(void* arg) {
+    auto event = static_cast<zx::event*>(arg);
+    return event->wait_one(ZX_EVENT_SIGNALED, zx::time::infinite(), nullptr);
+}
+
+// Threads that each want a whole cpu are turned away once every cpu is spoken for.
+static bool profile_deadline_admission_test() {
+    BEGIN_TEST;
+
+    zx::unowned_job root_job(zx_job_default());
+    if (!root_job->is_valid()) {
+        unittest_printf("no root job. skipping test\n");
+    } else {
+        zx::profile full_cpu_profile;
+        ASSERT_EQ(create_deadline_profile(*root_job, ZX_MSEC(10), ZX_MSEC(10), ZX_MSEC(10),
+                                          &full_cpu_profile), ZX_OK, "");
+
+        zx_profile_info_t profile_info = {};
+        profile_info.type = ZX_PROFILE_INFO_SCHEDULER;
+        profile_info.scheduler.priority = ZX_PRIORITY_DEFAULT;
+        zx::profile default_profile;
+        ASSERT_EQ(zx::profile::create(*root_job, &profile_info, &default_profile), ZX_OK, "");
+
+        zx::event event;
+        ASSERT_EQ(zx::event::create(0u, &event), ZX_OK, "");
+
+        // The threads sleep throughout, so holding a whole cpu each costs nothing.
+        const uint32_t num_cpus = zx_system_get_num_cpus();
+        fbl::Vector<thrd_t> waiters;
+        for (uint32_t i = 0; i <= num_cpus; ++i) {
+            thrd_t waiter;
+            ASSERT_EQ(thrd_create(&waiter, wait_for_event, &event), thrd_success, "");
+            waiters.push_back(waiter);
+        }
+
+        uint32_t admitted = 0;
+        zx_status_t status = ZX_OK;
+        for (thrd_t waiter : waiters) {
+            zx::unowned_thread thread(thrd_get_zx_handle(waiter));
+            status = thread->set_profile(full_cpu_profile, 0);
+            if (status != ZX_OK) {
+                break;
+            }
+            ++admitted;
+        }
+        EXPECT_EQ(status, ZX_ERR_NO_RESOURCES, "");
+        EXPECT_LE(admitted, num_cpus, "");
+
+        // Giving a cpu back makes room again.
+        if (admitted > 0) {
+            zx::unowned_thread thread(thrd_get_zx_handle(waiters[0]));
+            EXPECT_EQ(thread->set_profile(default_profile, 0), ZX_OK, "");
+            EXPECT_EQ(thread->set_profile(full_cpu_profile, 0), ZX_OK, "");
+        }
+
+        ASSERT_EQ(event.signal(0u, ZX_EVENT_SIGNALED), ZX_OK, "");
+        for (thrd_t waiter : waiters) {
+            ASSERT_EQ(thrd_join(waiter, nullptr), thrd_success, "");
+        }
+    }
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(profile_cpp_tests)
 RUN_TEST(profile_failures_test)
 RUN_TEST(profile_priority_test)
+RUN_TEST(profile_deadline_failures_test)
+RUN_TEST(profile_deadline_under_load_test)
+RUN_TEST(profile_deadline_throttle_test)
+RUN_TEST(profile_deadline_admission_test)
 END_TEST_CASE(profile_cpp_tests)
@@ -0,0 +1,306 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <threads.h>
+
+#include <zircon/process.h>
+#include <zircon/syscalls.h>
+#include <zircon/syscalls/ring.h>
+#include <unittest/unittest.h>
+
+static zx_signals_t get_signals(zx_handle_t h) {
+    zx_signals_t pending;
+    zx_status_t status = zx_object_wait_one(h, 0xFFFFFFFF, 0u, &pending);
+    if ((status != ZX_OK) && (status != ZX_ERR_TIMED_OUT)) {
+        return 0xFFFFFFFF;
+    }
+    return pending;
+}
+
+#define EXPECT_SIGNALS(h, s) EXPECT_EQ(get_signals(h), s, "")
+
+// One end of a ring of uint64_t elements, mapped into this process.
+typedef struct ring_end {
+    zx_handle_t handle;
+    zx_ring_header_t* header;
+    uint64_t* data;
+    uint64_t count;
+} ring_end_t;
+
+static bool ring_end_map(zx_handle_t handle, ring_end_t* end) {
+    zx_handle_t vmo;
+    if (zx_ring_get_vmo(handle, &vmo) != ZX_OK) {
+        return false;
+    }
+    uint64_t size;
+    zx_status_t status = zx_vmo_get_size(vmo, &size);
+    zx_vaddr_t addr = 0;
+    if (status == ZX_OK) {
+        status = zx_vmar_map(zx_vmar_root_self(), ZX_VM_PERM_READ | ZX_VM_PERM_WRITE, 0,
+                             vmo, 0, size, &addr);
+    }
+    zx_handle_close(vmo);
+    if (status != ZX_OK) {
+        return false;
+    }
+    end->handle = handle;
+    end->header = (zx_ring_header_t*)addr;
+    end->data = (uint64_t*)(addr + ZX_RING_DATA_OFFSET);
+    end->count = end->header->elem_count;
+    return true;
+}
+
+static void ring_end_unmap(ring_end_t* end) {
+    zx_vmar_unmap(zx_vmar_root_self(), (zx_vaddr_t)end->header,
+                  ZX_RING_DATA_OFFSET + end->count * sizeof(uint64_t));
+}
+
+// Append |value|, waiting while the ring is full.  Returns false if the
+// consumer has gone.
+static bool ring_push(ring_end_t* end, uint64_t value) {
+    uint64_t head = end->header->head;
+    for (;;) {
+        uint64_t tail = __atomic_load_n(&end->header->tail, __ATOMIC_ACQUIRE);
+        if (head - tail < end->count) {
+            break;
+        }
+        if (zx_ring_notify(end->handle) != ZX_OK) {
+            return false;
+        }
+        zx_object_wait_one(end->handle, ZX_RING_WRITABLE | ZX_RING_PEER_CLOSED,
+                           ZX_TIME_INFINITE, NULL);
+    }
+
+    end->data[head & (end->count - 1)] = value;
+    __atomic_store_n(&end->header->head, head + 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&end->header->tail, __ATOMIC_RELAXED) >= head) {
+        // The ring was empty, so the consumer may be waiting.
+        zx_ring_notify(end->handle);
+    }
+    return true;
+}
+
+// Remove the oldest element into |value|, waiting while the ring is empty.
+// Returns false if the ring is empty and the producer has gone.
+static bool ring_pop(ring_end_t* end, uint64_t* value) {
+    uint64_t tail = end->header->tail;
+    for (;;) {
+        uint64_t head = __atomic_load_n(&end->header->head, __ATOMIC_ACQUIRE);
+        if (head != tail) {
+            break;
+        }
+        if (zx_ring_notify(end->handle) != ZX_OK &&
+            __atomic_load_n(&end->header->head, __ATOMIC_ACQUIRE) == tail) {
+            return false;
+        }
+        zx_object_wait_one(end->handle, ZX_RING_READABLE | ZX_RING_PEER_CLOSED,
+                           ZX_TIME_INFINITE, NULL);
+    }
+
+    *value = end->data[tail & (end->count - 1)];
+    __atomic_store_n(&end->header->tail, tail + 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&end->header->head, __ATOMIC_RELAXED) - tail >= end->count) {
+        // The ring was full, so the producer may be waiting.
+        zx_ring_notify(end->handle);
+    }
+    return true;
+}
+
+static bool create_test(void) {
+    BEGIN_TEST;
+
+    zx_handle_t a, b;
+    EXPECT_EQ(zx_ring_create(0, 8, 0, &a, &b), ZX_ERR_OUT_OF_RANGE, ""); // too small
+    EXPECT_EQ(zx_ring_create(8, 0, 0, &a, &b), ZX_ERR_OUT_OF_RANGE, ""); // too small
+    EXPECT_EQ(zx_ring_create(35, 8, 0, &a, &b), ZX_ERR_OUT_OF_RANGE, ""); // not power of two
+    EXPECT_EQ(zx_ring_create(ZX_RING_MAX_SIZE, 2, 0, &a, &b), ZX_ERR_OUT_OF_RANGE, ""); // too large
+    EXPECT_EQ(zx_ring_create(8, 8, 1, &a, &b), ZX_ERR_INVALID_ARGS, ""); // invalid options
+
+    ASSERT_EQ(zx_ring_create(8, sizeof(uint64_t), 0, &a, &b), ZX_OK, "");
+    EXPECT_SIGNALS(a, ZX_RING_WRITABLE);
+    EXPECT_SIGNALS(b, 0u);
+
+    // Check that koids line up.
+    zx_info_handle_basic_t info[2] = {};
+    ASSERT_EQ(zx_object_get_info(a, ZX_INFO_HANDLE_BASIC, &info[0], sizeof(info[0]),
+                                 NULL, NULL), ZX_OK, "");
+    ASSERT_EQ(zx_object_get_info(b, ZX_INFO_HANDLE_BASIC, &info[1], sizeof(info[1]),
+                                 NULL, NULL), ZX_OK, "");
+    EXPECT_EQ(info[0].type, ZX_OBJ_TYPE_RING, "");
+    EXPECT_EQ(info[0].koid, info[1].related_koid, "mismatched koids!");
+    EXPECT_EQ(info[1].koid, info[0].related_koid, "mismatched koids!");
+
+    // Both ends hand out the same VMO, with the control block filled in.
+    zx_handle_t vmo[2];
+    ASSERT_EQ(zx_ring_get_vmo(a, &vmo[0]), ZX_OK, "");
+    ASSERT_EQ(zx_ring_get_vmo(b, &vmo[1]), ZX_OK, "");
+    ASSERT_EQ(zx_object_get_info(vmo[0], ZX_INFO_HANDLE_BASIC, &info[0], sizeof(info[0]),
+                                 NULL, NULL), ZX_OK, "");
+    ASSERT_EQ(zx_object_get_info(vmo[1], ZX_INFO_HANDLE_BASIC, &info[1], sizeof(info[1]),
+                                 NULL, NULL), ZX_OK, "");
+    EXPECT_EQ(info[0].type, ZX_OBJ_TYPE_VMO, "");
+    EXPECT_EQ(info[0].koid, info[1].koid, "");
+    EXPECT_EQ(info[0].rights & ZX_RIGHT_EXECUTE, 0u, "");
+
+    uint64_t size;
+    ASSERT_EQ(zx_vmo_get_size(vmo[0], &size), ZX_OK, "");
+    EXPECT_EQ(size, ZX_RING_DATA_OFFSET + ZX_PAGE_SIZE, "");
+
+    zx_ring_header_t header;
+    ASSERT_EQ(zx_vmo_read(vmo[0], &header, 0, sizeof(header)), ZX_OK, "");
+    EXPECT_EQ(header.elem_size, sizeof(uint64_t), "");
+    EXPECT_EQ(header.elem_count, 8u, "");
+    EXPECT_EQ(header.head, 0u, "");
+    EXPECT_EQ(header.tail, 0u, "");
+
+    // The kernel keeps the control block resident.
+    EXPECT_EQ(zx_vmo_op_range(vmo[0], ZX_VMO_OP_DECOMMIT, 0, ZX_PAGE_SIZE, NULL, 0),
+              ZX_ERR_BAD_STATE, "");
+
+    zx_handle_close(vmo[0]);
+    zx_handle_close(vmo[1]);
+    zx_handle_close(a);
+    zx_handle_close(b);
+
+    END_TEST;
+}
+
+static bool notify_test(void) {
+    BEGIN_TEST;
+
+    zx_handle_t a, b;
+    ASSERT_EQ(zx_ring_create(8, sizeof(uint64_t), 0, &a, &b), ZX_OK, "");
+    ring_end_t producer, consumer;
+    ASSERT_TRUE(ring_end_map(a, &producer), "");
+    ASSERT_TRUE(ring_end_map(b, &consumer), "");
+
+    // Moving the indices by hand changes nothing until someone notifies.
+    for (uint64_t i = 0; i < 3; i++) {
+        producer.data[i] = i;
+    }
+    producer.header->head = 3;
+    EXPECT_SIGNALS(b, 0u);
+    EXPECT_EQ(zx_ring_notify(a), ZX_OK, "");
+    EXPECT_SIGNALS(a, ZX_RING_WRITABLE);
+    EXPECT_SIGNALS(b, ZX_RING_READABLE);
+
+    // Full.
+    producer.header->head = 8;
+    EXPECT_EQ(zx_ring_notify(a), ZX_OK, "");
+    EXPECT_SIGNALS(a, 0u);
+    EXPECT_SIGNALS(b, ZX_RING_READABLE);
+
+    // Either end can notify.
+    consumer.header->tail = 1;
+    EXPECT_EQ(zx_ring_notify(b), ZX_OK, "");
+    EXPECT_SIGNALS(a, ZX_RING_WRITABLE);
+    EXPECT_SIGNALS(b, ZX_RING_READABLE);
+
+    // Empty.
+    consumer.header->tail = 8;
+    EXPECT_EQ(zx_ring_notify(b), ZX_OK, "");
+    EXPECT_SIGNALS(a, ZX_RING_WRITABLE);
+    EXPECT_SIGNALS(b, 0u);
+
+    // Indices that claim more elements than fit are rejected, and the
+    // signals are left alone.
+    producer.header->head = 17;
+    EXPECT_EQ(zx_ring_notify(a), ZX_ERR_BAD_STATE, "");
+    EXPECT_SIGNALS(a, ZX_RING_WRITABLE);
+    EXPECT_SIGNALS(b, 0u);
+    producer.header->head = 9;
+    EXPECT_EQ(zx_ring_notify(a), ZX_OK, "");
+    EXPECT_SIGNALS(b, ZX_RING_READABLE);
+
+    // Once the producer goes, what it left behind can still be read.
+    ring_end_unmap(&producer);
+    zx_handle_close(a);
+    EXPECT_SIGNALS(b, ZX_RING_READABLE | ZX_RING_PEER_CLOSED);
+    uint64_t value;
+    ASSERT_TRUE(ring_pop(&consumer, &value), "");
+    EXPECT_EQ(value, 0u, "");
+    EXPECT_FALSE(ring_pop(&consumer, &value), "");
+    EXPECT_SIGNALS(b, ZX_RING_PEER_CLOSED);
+
+    ring_end_unmap(&consumer);
+    zx_handle_close(b);
+
+    END_TEST;
+}
+
+static bool peer_closed_test(void) {
+    BEGIN_TEST;
+
+    zx_handle_t a, b;
+    ASSERT_EQ(zx_ring_create(16, 16, 0, &a, &b), ZX_OK, "");
+    ASSERT_EQ(zx_handle_close(b), ZX_OK, "");
+    EXPECT_SIGNALS(a, ZX_RING_PEER_CLOSED);
+    EXPECT_EQ(zx_ring_notify(a), ZX_ERR_PEER_CLOSED, "");
+    EXPECT_SIGNALS(a, ZX_RING_PEER_CLOSED);
+    ASSERT_EQ(zx_object_signal_peer(a, 0u, ZX_USER_SIGNAL_0), ZX_ERR_PEER_CLOSED, "");
+    ASSERT_EQ(zx_handle_close(a), ZX_OK, "");
+
+    END_TEST;
+}
+
+#define TRANSFER_COUNT 100000u
+
+static int producer_thread(void* arg) {
+    ring_end_t* producer = arg;
+    for (uint64_t i = 0; i < TRANSFER_COUNT; i++) {
+        if (!ring_push(producer, i)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// A small ring keeps both ends going back and forth between full and empty,
+// so this covers the wakeups in both directions.
+static bool transfer_test(void) {
+    BEGIN_TEST;
+
+    zx_handle_t a, b;
+    ASSERT_EQ(zx_ring_create(4, sizeof(uint64_t), 0, &a, &b), ZX_OK, "");
+    ring_end_t producer, consumer;
+    ASSERT_TRUE(ring_end_map(a, &producer), "");
+    ASSERT_TRUE(ring_end_map(b, &consumer), "");
+
+    thrd_t thread;
+    ASSERT_EQ(thrd_create(&thread, producer_thread, &producer), thrd_success, "");
+
+    for (uint64_t i = 0; i < TRANSFER_COUNT; i++) {
+        uint64_t value;
+        ASSERT_TRUE(ring_pop(&consumer, &value), "");
+        ASSERT_EQ(value, i, "");
+    }
+
+    int result;
+    ASSERT_EQ(thrd_join(thread, &result), thrd_success, "");
+    EXPECT_EQ(result, 0, "");
+
+    ring_end_unmap(&producer);
+    ring_end_unmap(&consumer);
+    zx_handle_close(a);
+    zx_handle_close(b);
+
+    END_TEST;
+}
+
+BEGIN_TEST_CASE(ring_tests)
+RUN_TEST(create_test)
+RUN_TEST(notify_test)
+RUN_TEST(peer_closed_test)
+RUN_TEST(transfer_test)
+END_TEST_CASE(ring_tests)
+
+#ifndef BUILD_COMBINED_TESTS
+int main(int argc, char** argv) {
+    return unittest_run_all_tests(argc, argv) ? 0 : -1;
+}
+#endif
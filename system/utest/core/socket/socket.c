@@ -3,6 +3,8 @@
 // found in the LICENSE file.
 
 #include <assert.h>
+#include <string.h>
+#include <zircon/limits.h>
 #include <zircon/syscalls.h>
 #include <unittest/unittest.h>
 #include <stdbool.h>
@@ -1206,6 +1208,146 @@ bool socket_share_consumes_on_failure(void) {
     END_TEST;
 }
 
+static bool socket_write_vmo_read_vmo(void) {
+    BEGIN_TEST;
+
+    zx_status_t status;
+    size_t count;
+
+    zx_handle_t h0, h1;
+    status = zx_socket_create(0, &h0, &h1);
+    ASSERT_EQ(status, ZX_OK, "");
+
+    // Page aligned, so the pages are loaned to the socket and handed on to
+    // the reader.
+    const size_t size = 3 * ZX_PAGE_SIZE;
+    char* data = malloc(size);
+    char* read_data = malloc(size);
+    for (size_t i = 0; i < size; ++i)
+        data[i] = (char)(i * 7);
+
+    zx_handle_t vmo;
+    status = zx_vmo_create(size, 0u, &vmo);
+    ASSERT_EQ(status, ZX_OK, "");
+    status = zx_vmo_write(vmo, data, 0u, size);
+    ASSERT_EQ(status, ZX_OK, "");
+
+    status = zx_socket_write_vmo(h0, 0u, vmo, 0u, size, &count);
+    EXPECT_EQ(status, ZX_OK, "");
+    EXPECT_EQ(count, size, "");
+
+    // The pages were moved out of the writer's VMO, so changing it now
+    // doesn't change what the reader gets.
+    status = zx_vmo_read(vmo, read_data, 0u, size);
+    EXPECT_EQ(status, ZX_OK, "");
+    for (size_t i = 0; i < size; ++i)
+        ASSERT_EQ(read_data[i], 0, "");
+    status = zx_vmo_write(vmo, data + 1, 0u, size - 1);
+    EXPECT_EQ(status, ZX_OK, "");
+
+    // Take the first page as a VMO and the rest by copying.
+    zx_handle_t out_vmo = ZX_HANDLE_INVALID;
+    status = zx_socket_read_vmo(h1, 0u, ZX_PAGE_SIZE, &out_vmo, &count);
+    EXPECT_EQ(status, ZX_OK, "");
+    EXPECT_EQ(count, (size_t)ZX_PAGE_SIZE, "");
+    status = zx_vmo_read(out_vmo, read_data, 0u, ZX_PAGE_SIZE);
+    EXPECT_EQ(status, ZX_OK, "");
+    zx_handle_close(out_vmo);
+
+    status = zx_socket_read(h1, 0u, read_data + ZX_PAGE_SIZE, size, &count);
+    EXPECT_EQ(status, ZX_OK, "");
+    EXPECT_EQ(count, size - ZX_PAGE_SIZE, "");
+    EXPECT_EQ(memcmp(data, read_data, size), 0, "");
+
+    // A read-only VMO can't have its pages moved out.
+    zx_handle_t read_only;
+    status = zx_handle_duplicate(vmo, ZX_RIGHT_READ, &read_only);
+    ASSERT_EQ(status, ZX_OK, "");
+    status = zx_socket_write_vmo(h0, 0u, read_only, 0u, size, &count);
+    EXPECT_EQ(status, ZX_ERR_ACCESS_DENIED, "");
+    zx_handle_close(read_only);
+
+    status = zx_vmo_write(vmo, data, 0u, size);
+    EXPECT_EQ(status, ZX_OK, "");
+
+    // Only whole pages are loaned; the rest is copied, and the VMO the
+    // reader gets holds just the loaned pages.
+    status = zx_socket_write_vmo(h0, 0u, vmo, 0u, ZX_PAGE_SIZE + 100u, &count);
+    EXPECT_EQ(status, ZX_OK, "");
+    EXPECT_EQ(count, ZX_PAGE_SIZE + 100u, "");
+    status = zx_socket_read_vmo(h1, 0u, size, &out_vmo, &count);
+    EXPECT_EQ(status, ZX_OK, "");
+    EXPECT_EQ(count, (size_t)ZX_PAGE_SIZE, "");
+    uint64_t vmo_size;
+    status = zx_vmo_get_size(out_vmo, &vmo_size);
+    EXPECT_EQ(status, ZX_OK, "");
+    EXPECT_EQ(vmo_size, (uint64_t)ZX_PAGE_SIZE, "");
+    zx_handle_close(out_vmo);
+    status = zx_socket_read(h1, 0u, read_data, size, &count);
+    EXPECT_EQ(status, ZX_OK, "");
+    EXPECT_EQ(count, 100u, "");
+    EXPECT_EQ(memcmp(data + ZX_PAGE_SIZE, read_data, 100u), 0, "");
+
+    status = zx_vmo_write(vmo, data, 0u, size);
+    EXPECT_EQ(status, ZX_OK, "");
+
+    // Not page aligned, so the bytes are copied in; reading them as a VMO
+    // copies them out again.
+    status = zx_socket_write_vmo(h0, 0u, vmo, 10u, 100u, &count);
+    EXPECT_EQ(status, ZX_OK, "");
+    EXPECT_EQ(count, 100u, "");
+
+    status = zx_socket_read_vmo(h1, 0u, size, &out_vmo, &count);
+    EXPECT_EQ(status, ZX_OK, "");
+    EXPECT_EQ(count, 100u, "");
+    status = zx_vmo_read(out_vmo, read_data, 0u, 100u);
+    EXPECT_EQ(status, ZX_OK, "");
+    EXPECT_EQ(memcmp(data + 10, read_data, 100u), 0, "");
+    zx_handle_close(out_vmo);
+
+    status = zx_socket_read_vmo(h1, 0u, size, &out_vmo, &count);
+    EXPECT_EQ(status, ZX_ERR_SHOULD_WAIT, "");
+
+    status = zx_socket_write_vmo(h0, 0u, vmo, size - 1, 2u, &count);
+    EXPECT_EQ(status, ZX_ERR_OUT_OF_RANGE, "");
+
+    free(data);
+    free(read_data);
+    zx_handle_close(vmo);
+    zx_handle_close(h0);
+    zx_handle_close(h1);
+
+    END_TEST;
+}
+
+static bool socket_vmo_datagram_not_supported(void) {
+    BEGIN_TEST;
+
+    zx_status_t status;
+    size_t count;
+
+    zx_handle_t h0, h1;
+    status = zx_socket_create(ZX_SOCKET_DATAGRAM, &h0, &h1);
+    ASSERT_EQ(status, ZX_OK, "");
+
+    zx_handle_t vmo;
+    status = zx_vmo_create(ZX_PAGE_SIZE, 0u, &vmo);
+    ASSERT_EQ(status, ZX_OK, "");
+
+    status = zx_socket_write_vmo(h0, 0u, vmo, 0u, ZX_PAGE_SIZE, &count);
+    EXPECT_EQ(status, ZX_ERR_NOT_SUPPORTED, "");
+
+    zx_handle_t out_vmo;
+    status = zx_socket_read_vmo(h1, 0u, ZX_PAGE_SIZE, &out_vmo, &count);
+    EXPECT_EQ(status, ZX_ERR_NOT_SUPPORTED, "");
+
+    zx_handle_close(vmo);
+    zx_handle_close(h0);
+    zx_handle_close(h1);
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(socket_tests)
 RUN_TEST(socket_basic)
 RUN_TEST(socket_signals)
@@ -1226,6 +1368,8 @@ RUN_TEST(socket_accept)
 RUN_TEST(socket_share_invalid_handle)
 RUN_TEST(socket_share_consumes_on_failure)
 RUN_TEST(socket_signals2)
+RUN_TEST(socket_write_vmo_read_vmo)
+RUN_TEST(socket_vmo_datagram_not_supported)
 END_TEST_CASE(socket_tests)
 
 #ifndef BUILD_COMBINED_TESTS
@@ -599,6 +599,76 @@ bool encode_multiple_present_nullable_string() {
     END_TEST;
 }
 
+bool encode_iovec_external_string() {
+    BEGIN_TEST;
+
+    // Only the second string's data is in the buffer; the first string's
+    // data is left where it is and gathered in as its own segment.
+    struct {
+        alignas(FIDL_ALIGNMENT)
+        multiple_nullable_strings_inline_data inline_struct;
+        alignas(FIDL_ALIGNMENT) char data2[8];
+    } message;
+    char external[6];
+    memcpy(external, "hello ", 6);
+    memcpy(message.data2, "world!!!", 8);
+    message.inline_struct.string = fidl_string_t{6, external};
+    message.inline_struct.string2 = fidl_string_t{8, &message.data2[0]};
+
+    zx_channel_iovec_t iovecs[8];
+    const char* error = nullptr;
+    uint32_t actual_handles = 0u;
+    uint32_t actual_iovecs = 0u;
+    auto status = fidl_encode_iovec(&multiple_nullable_strings_message_type, &message,
+                                    sizeof(message), nullptr, 0, &actual_handles, iovecs,
+                                    ArraySize(iovecs), &actual_iovecs, &error);
+
+    EXPECT_EQ(status, ZX_OK);
+    EXPECT_NULL(error, error);
+    EXPECT_EQ(actual_handles, 0u);
+    EXPECT_EQ(reinterpret_cast<uint64_t>(message.inline_struct.string.data), FIDL_ALLOC_PRESENT);
+    EXPECT_EQ(reinterpret_cast<uint64_t>(message.inline_struct.string2.data), FIDL_ALLOC_PRESENT);
+
+    // Inline part, first string's data and its padding, then the rest of the buffer.
+    ASSERT_EQ(actual_iovecs, 4u);
+    EXPECT_EQ(iovecs[0].buffer, &message.inline_struct);
+    EXPECT_EQ(iovecs[0].capacity, sizeof(message.inline_struct));
+    EXPECT_EQ(iovecs[1].buffer, external);
+    EXPECT_EQ(iovecs[1].capacity, 6u);
+    EXPECT_EQ(iovecs[2].capacity, 2u);
+    EXPECT_EQ(static_cast<const uint8_t*>(iovecs[2].buffer)[0], 0u);
+    EXPECT_EQ(static_cast<const uint8_t*>(iovecs[2].buffer)[1], 0u);
+    EXPECT_EQ(iovecs[3].buffer, &message.data2[0]);
+    EXPECT_EQ(iovecs[3].capacity, 8u);
+    for (uint32_t i = 0; i < actual_iovecs; ++i) {
+        EXPECT_EQ(iovecs[i].reserved, 0u);
+    }
+
+    END_TEST;
+}
+
+bool encode_iovec_too_many_iovecs_error() {
+    BEGIN_TEST;
+
+    char external[6];
+    memcpy(external, "hello!", 6);
+    unbounded_nonnullable_string_inline_data message = {};
+    message.string = fidl_string_t{6, external};
+
+    zx_channel_iovec_t iovecs[2];
+    const char* error = nullptr;
+    uint32_t actual_handles = 0u;
+    uint32_t actual_iovecs = 0u;
+    auto status = fidl_encode_iovec(&unbounded_nonnullable_string_message_type, &message,
+                                    sizeof(message), nullptr, 0, &actual_handles, iovecs,
+                                    ArraySize(iovecs), &actual_iovecs, &error);
+
+    EXPECT_EQ(status, ZX_ERR_INVALID_ARGS);
+    EXPECT_NONNULL(error);
+
+    END_TEST;
+}
+
 bool encode_absent_nonnullable_string_error() {
     BEGIN_TEST;
 
@@ -1770,6 +1840,8 @@ RUN_TEST(encode_absent_nonnullable_bounded_string_error)
 RUN_TEST(encode_absent_nullable_bounded_string)
 RUN_TEST(encode_present_nonnullable_bounded_string_short_error)
 RUN_TEST(encode_present_nullable_bounded_string_short_error)
+RUN_TEST(encode_iovec_external_string)
+RUN_TEST(encode_iovec_too_many_iovecs_error)
 END_TEST_CASE(strings)
 
 BEGIN_TEST_CASE(vectors)
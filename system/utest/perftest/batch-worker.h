@@ -0,0 +1,82 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <fbl/atomic.h>
+#include <fbl/unique_ptr.h>
+#include <fbl/vector.h>
+#include <lib/zx/event.h>
+#include <perftest/perftest.h>
+#include <zircon/assert.h>
+
+namespace perftest_util {
+
+// Hands batches of work to threads of a test's own and waits for them to
+// finish, so that a test can run several workers at once and time them as
+// one.  A worker class derives from this.  Its threads call WaitForBatch()
+// and, once a batch is done, FinishBatch().  Its destructor calls Stop()
+// before joining them.
+class BatchWorker {
+public:
+    BatchWorker() {
+        ZX_ASSERT(zx::event::create(0, &start_) == ZX_OK);
+        ZX_ASSERT(zx::event::create(0, &done_) == ZX_OK);
+    }
+
+    // Kick off one batch.
+    void Start() {
+        ZX_ASSERT(start_.signal(0, kGo) == ZX_OK);
+    }
+
+    // Wait for the batch started by Start() to complete.
+    void Wait() {
+        ZX_ASSERT(done_.wait_one(kGo, zx::time::infinite(), nullptr) == ZX_OK);
+        ZX_ASSERT(done_.signal(kGo, 0) == ZX_OK);
+    }
+
+protected:
+    // Wakes the worker thread with no batch to run, telling it to exit.
+    void Stop() {
+        exiting_.store(true);
+        ZX_ASSERT(start_.signal(0, kGo) == ZX_OK);
+    }
+
+    // Waits for the next batch.  Returns false if the thread should exit
+    // instead.
+    bool WaitForBatch() {
+        ZX_ASSERT(start_.wait_one(kGo, zx::time::infinite(), nullptr) == ZX_OK);
+        ZX_ASSERT(start_.signal(kGo, 0) == ZX_OK);
+        return !exiting_.load();
+    }
+
+    // Reports that the current batch is complete.
+    void FinishBatch() {
+        ZX_ASSERT(done_.signal(0, kGo) == ZX_OK);
+    }
+
+private:
+    static constexpr zx_signals_t kGo = ZX_USER_SIGNAL_0;
+
+    zx::event start_;
+    zx::event done_;
+    fbl::atomic<bool> exiting_{false};
+};
+
+// Runs a batch on every one of |workers| at once for each iteration of
+// |state|.
+template <typename Worker>
+void RunBatches(perftest::RepeatState* state,
+                const fbl::Vector<fbl::unique_ptr<Worker>>& workers) {
+    while (state->KeepRunning()) {
+        for (auto& worker : workers) {
+            worker->Start();
+        }
+        for (auto& worker : workers) {
+            worker->Wait();
+        }
+    }
+}
+
+}  // namespace perftest_util
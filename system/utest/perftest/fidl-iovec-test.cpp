@@ -0,0 +1,117 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stddef.h>
+#include <string.h>
+
+#include <fbl/algorithm.h>
+#include <fbl/string_printf.h>
+#include <fbl/unique_ptr.h>
+#include <lib/fidl/coding.h>
+#include <lib/fidl/internal.h>
+#include <lib/zx/channel.h>
+#include <perftest/perftest.h>
+#include <zircon/assert.h>
+
+namespace {
+
+// A message carrying a single vector<uint8>, the shape of a bulk data
+// transfer such as a file read or write.
+struct BlobMessage {
+    alignas(FIDL_ALIGNMENT) fidl_message_header_t header;
+    fidl_vector_t data;
+};
+
+const fidl_type_t kBlobVector = fidl_type_t(
+    fidl::FidlCodedVector(nullptr, FIDL_MAX_SIZE, sizeof(uint8_t), fidl::kNonnullable));
+const fidl::FidlField kBlobFields[] = {
+    fidl::FidlField(&kBlobVector, offsetof(BlobMessage, data)),
+};
+const fidl_type_t kBlobMessageType = fidl_type_t(fidl::FidlCodedStruct(
+    kBlobFields, fbl::count_of(kBlobFields), sizeof(BlobMessage), "BlobMessage"));
+
+// Measure the time taken to send a |size| byte vector through a channel
+// and read it out again, the usual way: the payload is first copied in
+// behind the message header to linearize the message, then encoded and
+// written.
+bool FidlLinearizedWriteTest(perftest::RepeatState* state, uint32_t size) {
+    zx::channel tx, rx;
+    ZX_ASSERT(zx::channel::create(0, &tx, &rx) == ZX_OK);
+    fbl::unique_ptr<uint8_t[]> payload(new uint8_t[size]);
+    memset(payload.get(), 0xa5, size);
+    const uint32_t msg_size = static_cast<uint32_t>(sizeof(BlobMessage) + FIDL_ALIGN(size));
+    fbl::unique_ptr<uint8_t[]> buffer(new uint8_t[msg_size]);
+    fbl::unique_ptr<uint8_t[]> read_buffer(new uint8_t[msg_size]);
+
+    while (state->KeepRunning()) {
+        auto* msg = reinterpret_cast<BlobMessage*>(buffer.get());
+        memset(msg, 0, sizeof(*msg));
+        uint8_t* data = buffer.get() + sizeof(BlobMessage);
+        memcpy(data, payload.get(), size);
+        msg->data = fidl_vector_t{size, data};
+        uint32_t actual_handles;
+        const char* error;
+        ZX_ASSERT(fidl_encode(&kBlobMessageType, buffer.get(), msg_size, nullptr, 0,
+                              &actual_handles, &error) == ZX_OK);
+        ZX_ASSERT(tx.write(0, buffer.get(), msg_size, nullptr, 0) == ZX_OK);
+
+        uint32_t actual_bytes;
+        ZX_ASSERT(rx.read(0, read_buffer.get(), msg_size, &actual_bytes, nullptr, 0,
+                          nullptr) == ZX_OK);
+        ZX_ASSERT(actual_bytes == msg_size);
+    }
+    return true;
+}
+
+// The same transfer, but encoded with fidl_encode_iovec() so the payload
+// is gathered by the kernel straight from where it lies, skipping the copy
+// that linearizes the message.
+bool FidlIovecWriteTest(perftest::RepeatState* state, uint32_t size) {
+    zx::channel tx, rx;
+    ZX_ASSERT(zx::channel::create(0, &tx, &rx) == ZX_OK);
+    fbl::unique_ptr<uint8_t[]> payload(new uint8_t[size]);
+    memset(payload.get(), 0xa5, size);
+    const uint32_t msg_size = static_cast<uint32_t>(sizeof(BlobMessage) + FIDL_ALIGN(size));
+    fbl::unique_ptr<uint8_t[]> read_buffer(new uint8_t[msg_size]);
+
+    while (state->KeepRunning()) {
+        BlobMessage msg = {};
+        msg.data = fidl_vector_t{size, payload.get()};
+        zx_channel_iovec_t iovecs[4];
+        uint32_t actual_iovecs;
+        uint32_t actual_handles;
+        const char* error;
+        ZX_ASSERT(fidl_encode_iovec(&kBlobMessageType, &msg, sizeof(msg), nullptr, 0,
+                                    &actual_handles, iovecs, fbl::count_of(iovecs),
+                                    &actual_iovecs, &error) == ZX_OK);
+        ZX_ASSERT(tx.write(ZX_CHANNEL_WRITE_USE_IOVEC, iovecs, actual_iovecs,
+                           nullptr, 0) == ZX_OK);
+
+        uint32_t actual_bytes;
+        ZX_ASSERT(rx.read(0, read_buffer.get(), msg_size, &actual_bytes, nullptr, 0,
+                          nullptr) == ZX_OK);
+        ZX_ASSERT(actual_bytes == msg_size);
+    }
+    return true;
+}
+
+void RegisterTests() {
+    static const uint32_t kSizes[] = {
+        64,
+        4 * 1024,
+        16 * 1024,
+        60 * 1024,
+    };
+    for (auto size : kSizes) {
+        auto name = fbl::StringPrintf("FidlWrite/Linearized/%ubytes", size);
+        perftest::RegisterTest(name.c_str(), FidlLinearizedWriteTest, size);
+    }
+    for (auto size : kSizes) {
+        auto name = fbl::StringPrintf("FidlWrite/Iovec/%ubytes", size);
+        perftest::RegisterTest(name.c_str(), FidlIovecWriteTest, size);
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+}  // namespace
@@ -0,0 +1,126 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <threads.h>
+
+#include <fbl/string_printf.h>
+#include <fbl/unique_ptr.h>
+#include <fbl/vector.h>
+#include <perftest/perftest.h>
+#include <zircon/assert.h>
+#include <zircon/syscalls.h>
+
+#include "batch-worker.h"
+
+namespace {
+
+// Number of round trips each thread pair makes per test run.
+constexpr uint32_t kRoundTripsPerRun = 100;
+
+// Values of a pair's |turn_| futex.
+constexpr zx_futex_t kPingTurn = 0;
+constexpr zx_futex_t kPongTurn = 1;
+constexpr zx_futex_t kExit = 2;
+
+// A pair of threads that hand a turn back and forth through a futex of
+// their own, as a mutex or condition variable handoff would.  Every round
+// trip makes each thread wait on and wake the futex once.  Different
+// pairs use different futexes, so with several pairs running at once the
+// test measures how well futex operations on unrelated addresses in one
+// process scale across CPUs.
+class FutexPair : public perftest_util::BatchWorker {
+public:
+    FutexPair() {
+        ZX_ASSERT(thrd_create(&ping_thread_, PingThread, this) == thrd_success);
+        ZX_ASSERT(thrd_create(&pong_thread_, PongThread, this) == thrd_success);
+    }
+
+    ~FutexPair() {
+        Stop();
+        ZX_ASSERT(thrd_join(ping_thread_, nullptr) == thrd_success);
+        ZX_ASSERT(thrd_join(pong_thread_, nullptr) == thrd_success);
+    }
+
+private:
+    // Gives the turn to the other thread and wakes it.
+    void Pass(zx_futex_t value) {
+        __atomic_store_n(&turn_, value, __ATOMIC_SEQ_CST);
+        ZX_ASSERT(zx_futex_wake(&turn_, 1) == ZX_OK);
+    }
+
+    // Waits until |turn_| no longer holds |value|, and returns what it
+    // holds instead.
+    zx_futex_t WaitWhile(zx_futex_t value) {
+        for (;;) {
+            zx_futex_t current = __atomic_load_n(&turn_, __ATOMIC_SEQ_CST);
+            if (current != value) {
+                return current;
+            }
+            zx_status_t status = zx_futex_wait(&turn_, value, ZX_HANDLE_INVALID,
+                                               ZX_TIME_INFINITE);
+            ZX_ASSERT(status == ZX_OK || status == ZX_ERR_BAD_STATE);
+        }
+    }
+
+    static int PingThread(void* arg) {
+        auto* pair = static_cast<FutexPair*>(arg);
+        for (;;) {
+            if (!pair->WaitForBatch()) {
+                pair->Pass(kExit);
+                return 0;
+            }
+            for (uint32_t i = 0; i < kRoundTripsPerRun; ++i) {
+                pair->Pass(kPongTurn);
+                pair->WaitWhile(kPongTurn);
+            }
+            pair->FinishBatch();
+        }
+    }
+
+    static int PongThread(void* arg) {
+        auto* pair = static_cast<FutexPair*>(arg);
+        for (;;) {
+            if (pair->WaitWhile(kPingTurn) == kExit) {
+                return 0;
+            }
+            pair->Pass(kPingTurn);
+        }
+    }
+
+    zx_futex_t turn_ = kPingTurn;
+    thrd_t ping_thread_;
+    thrd_t pong_thread_;
+};
+
+// Measure the time taken for |pair_count| thread pairs to each complete
+// kRoundTripsPerRun round trips on their own futex concurrently.  If
+// operations on different futexes do not contend in the kernel, the time
+// per run should stay roughly flat as |pair_count| grows, up to the number
+// of CPUs.
+bool FutexPingPongTest(perftest::RepeatState* state, uint32_t pair_count) {
+    fbl::Vector<fbl::unique_ptr<FutexPair>> pairs;
+    for (uint32_t i = 0; i < pair_count; ++i) {
+        pairs.push_back(fbl::make_unique<FutexPair>());
+    }
+
+    perftest_util::RunBatches(state, pairs);
+    return true;
+}
+
+void RegisterTests() {
+    static const uint32_t kPairCounts[] = {
+        1,
+        2,
+        4,
+        8,
+        16,
+    };
+    for (auto pair_count : kPairCounts) {
+        auto name = fbl::StringPrintf("FutexPingPong/%upairs", pair_count);
+        perftest::RegisterTest(name.c_str(), FutexPingPongTest, pair_count);
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+}  // namespace
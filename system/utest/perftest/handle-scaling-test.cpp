@@ -0,0 +1,104 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <threads.h>
+
+#include <fbl/string_printf.h>
+#include <fbl/unique_ptr.h>
+#include <fbl/vector.h>
+#include <lib/zx/event.h>
+#include <perftest/perftest.h>
+#include <zircon/assert.h>
+#include <zircon/syscalls.h>
+
+#include "batch-worker.h"
+
+namespace {
+
+// Number of handle operations each thread makes per test run.
+constexpr uint32_t kOpsPerRun = 100;
+
+// Does one handle operation on |event|.
+using HandleOp = void (*)(const zx::event& event);
+
+// Duplicates |event| and closes the duplicate: a handle is made, added
+// to the process, removed from it and destroyed.
+void DuplicateClose(const zx::event& event) {
+    zx_handle_t dup;
+    ZX_ASSERT(zx_handle_duplicate(event.get(), ZX_RIGHT_SAME_RIGHTS, &dup) == ZX_OK);
+    ZX_ASSERT(zx_handle_close(dup) == ZX_OK);
+}
+
+// Signals |event| without changing its signals, which does little more
+// than look up the handle.
+void Lookup(const zx::event& event) {
+    ZX_ASSERT(event.signal(0, 0) == ZX_OK);
+}
+
+// A thread that repeats a handle operation on an event of its own.  Each
+// thread uses different handles, so with several of these running at once
+// the test measures how well the kernel's handle bookkeeping scales across
+// CPUs within one process.
+class HandleThread : public perftest_util::BatchWorker {
+public:
+    explicit HandleThread(HandleOp op) : op_(op) {
+        ZX_ASSERT(zx::event::create(0, &event_) == ZX_OK);
+        ZX_ASSERT(thrd_create(&thread_, ThreadFunc, this) == thrd_success);
+    }
+
+    ~HandleThread() {
+        Stop();
+        ZX_ASSERT(thrd_join(thread_, nullptr) == thrd_success);
+    }
+
+private:
+    static int ThreadFunc(void* arg) {
+        auto* self = static_cast<HandleThread*>(arg);
+        for (;;) {
+            if (!self->WaitForBatch()) {
+                return 0;
+            }
+            for (uint32_t i = 0; i < kOpsPerRun; ++i) {
+                self->op_(self->event_);
+            }
+            self->FinishBatch();
+        }
+    }
+
+    const HandleOp op_;
+    zx::event event_;
+    thrd_t thread_;
+};
+
+// Measure the time taken for |thread_count| threads to each do kOpsPerRun
+// |op| operations concurrently.
+bool HandleScalingTest(perftest::RepeatState* state, HandleOp op, uint32_t thread_count) {
+    fbl::Vector<fbl::unique_ptr<HandleThread>> threads;
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        threads.push_back(fbl::make_unique<HandleThread>(op));
+    }
+
+    perftest_util::RunBatches(state, threads);
+    return true;
+}
+
+void RegisterTests() {
+    static const uint32_t kThreadCounts[] = {
+        1,
+        2,
+        4,
+        8,
+    };
+    for (auto thread_count : kThreadCounts) {
+        auto name = fbl::StringPrintf("HandleDuplicateClose/%uthreads", thread_count);
+        perftest::RegisterTest(name.c_str(), HandleScalingTest, DuplicateClose, thread_count);
+    }
+    for (auto thread_count : kThreadCounts) {
+        auto name = fbl::StringPrintf("HandleLookup/%uthreads", thread_count);
+        perftest::RegisterTest(name.c_str(), HandleScalingTest, Lookup, thread_count);
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+}  // namespace
@@ -4,7 +4,14 @@
 
 #include <threads.h>
 
+#include <fbl/string_printf.h>
+#include <fbl/unique_ptr.h>
+#include <fbl/vector.h>
+#include <lib/zx/event.h>
 #include <perftest/perftest.h>
+#include <zircon/assert.h>
+
+#include "batch-worker.h"
 
 namespace {
 
@@ -24,8 +31,72 @@ bool MutexLockUnlockTest(perftest::RepeatState* state) {
     return true;
 }
 
+// Number of zx_object_signal() calls each thread makes per test run.
+constexpr uint32_t kSignalsPerRun = 1000;
+
+// A thread that, each batch, repeatedly signals an event it shares with
+// other threads.  Each zx_object_signal() holds the event's kernel mutex
+// for only a short while, so with several of these running at once the
+// test measures what contention on a briefly held kernel mutex costs.
+class SignalThread : public perftest_util::BatchWorker {
+public:
+    explicit SignalThread(const zx::event* target) : target_(target) {
+        ZX_ASSERT(thrd_create(&thread_, ThreadFunc, this) == thrd_success);
+    }
+
+    ~SignalThread() {
+        Stop();
+        ZX_ASSERT(thrd_join(thread_, nullptr) == thrd_success);
+    }
+
+private:
+    static int ThreadFunc(void* arg) {
+        auto* self = static_cast<SignalThread*>(arg);
+        for (;;) {
+            if (!self->WaitForBatch()) {
+                return 0;
+            }
+            for (uint32_t i = 0; i < kSignalsPerRun; ++i) {
+                ZX_ASSERT(self->target_->signal(0, ZX_USER_SIGNAL_1) == ZX_OK);
+            }
+            self->FinishBatch();
+        }
+    }
+
+    const zx::event* const target_;
+    thrd_t thread_;
+};
+
+// Measure the time taken for |thread_count| threads to each signal one
+// shared event kSignalsPerRun times concurrently.  Compare runs with
+// kernel.mutex.spin-max-ns=0 to see what spinning on the contended kernel
+// mutex saves over blocking on it.
+bool KernelMutexContendedTest(perftest::RepeatState* state, uint32_t thread_count) {
+    zx::event target;
+    ZX_ASSERT(zx::event::create(0, &target) == ZX_OK);
+
+    fbl::Vector<fbl::unique_ptr<SignalThread>> threads;
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        threads.push_back(fbl::make_unique<SignalThread>(&target));
+    }
+
+    perftest_util::RunBatches(state, threads);
+    return true;
+}
+
 void RegisterTests() {
     perftest::RegisterTest("MutexLockUnlock", MutexLockUnlockTest);
+
+    static const uint32_t kThreadCounts[] = {
+        1,
+        2,
+        4,
+        8,
+    };
+    for (auto thread_count : kThreadCounts) {
+        auto name = fbl::StringPrintf("KernelMutexContended/%uthreads", thread_count);
+        perftest::RegisterTest(name.c_str(), KernelMutexContendedTest, thread_count);
+    }
 }
 PERFTEST_CTOR(RegisterTests);
 
@@ -0,0 +1,120 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <fbl/algorithm.h>
+#include <fbl/string_printf.h>
+#include <lib/async-loop/cpp/loop.h>
+#include <lib/async/cpp/receiver.h>
+#include <lib/zx/port.h>
+#include <perftest/perftest.h>
+#include <zircon/assert.h>
+
+namespace {
+
+// Queue |count| user packets on a port.
+void QueuePackets(const zx::port& port, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        zx_port_packet_t packet = {i, ZX_PKT_TYPE_USER, ZX_OK, {}};
+        ZX_ASSERT(port.queue(&packet) == ZX_OK);
+    }
+}
+
+// Measure the time taken to queue |count| packets on a port and then take
+// them off again one zx_port_wait() call at a time.
+bool PortWaitTest(perftest::RepeatState* state, uint32_t count) {
+    state->DeclareStep("queue");
+    state->DeclareStep("wait");
+
+    zx::port port;
+    ZX_ASSERT(zx::port::create(0, &port) == ZX_OK);
+
+    while (state->KeepRunning()) {
+        QueuePackets(port, count);
+        state->NextStep();
+        for (uint32_t i = 0; i < count; ++i) {
+            zx_port_packet_t packet;
+            ZX_ASSERT(port.wait(zx::time::infinite(), &packet) == ZX_OK);
+        }
+    }
+    return true;
+}
+
+// As PortWaitTest, but taking the packets off with zx_port_wait_many(), so
+// the cost of the wait syscall is shared between up to |batch| packets.
+bool PortWaitManyTest(perftest::RepeatState* state, uint32_t count, uint32_t batch) {
+    state->DeclareStep("queue");
+    state->DeclareStep("wait");
+
+    zx::port port;
+    ZX_ASSERT(zx::port::create(0, &port) == ZX_OK);
+    zx_port_packet_t packets[16];
+    ZX_ASSERT(batch <= fbl::count_of(packets));
+
+    while (state->KeepRunning()) {
+        QueuePackets(port, count);
+        state->NextStep();
+        for (uint32_t received = 0; received < count;) {
+            size_t actual;
+            ZX_ASSERT(port.wait_many(zx::time::infinite(), packets, batch, &actual) == ZX_OK);
+            received += static_cast<uint32_t>(actual);
+        }
+    }
+    return true;
+}
+
+// Measure the time taken for an async loop to dispatch |count| packets
+// queued to a receiver.  This is the path a busy server's message loop
+// takes, with the loop pulling packets from its port in batches if
+// |batched|.
+bool AsyncLoopPacketsTest(perftest::RepeatState* state, uint32_t count, bool batched) {
+    async_loop_config_t config = {};
+    config.batch_port_packets = batched;
+    async::Loop loop(&config);
+    uint32_t dispatched = 0;
+    async::Receiver receiver([&dispatched](async_dispatcher_t* dispatcher,
+                                           async::Receiver* receiver, zx_status_t status,
+                                           const zx_packet_user_t* data) {
+        ++dispatched;
+    });
+
+    while (state->KeepRunning()) {
+        for (uint32_t i = 0; i < count; ++i) {
+            ZX_ASSERT(receiver.QueuePacket(loop.dispatcher()) == ZX_OK);
+        }
+        ZX_ASSERT(loop.RunUntilIdle() == ZX_OK);
+    }
+    ZX_ASSERT(dispatched % count == 0);
+    return true;
+}
+
+void RegisterTests() {
+    static const uint32_t kCounts[] = {
+        1,
+        16,
+        256,
+    };
+    for (auto count : kCounts) {
+        auto name = fbl::StringPrintf("Port/Wait/%upackets", count);
+        perftest::RegisterTest(name.c_str(), PortWaitTest, count);
+    }
+    static const uint32_t kBatches[] = {
+        4,
+        16,
+    };
+    for (auto count : kCounts) {
+        for (auto batch : kBatches) {
+            auto name = fbl::StringPrintf("Port/WaitMany%u/%upackets", batch, count);
+            perftest::RegisterTest(name.c_str(), PortWaitManyTest, count, batch);
+        }
+    }
+    for (auto count : kCounts) {
+        auto name = fbl::StringPrintf("AsyncLoop/Packets/%upackets", count);
+        perftest::RegisterTest(name.c_str(), AsyncLoopPacketsTest, count, false);
+        name = fbl::StringPrintf("AsyncLoop/BatchedPackets/%upackets", count);
+        perftest::RegisterTest(name.c_str(), AsyncLoopPacketsTest, count, true);
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+}  // namespace
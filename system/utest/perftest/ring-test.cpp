@@ -0,0 +1,204 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string.h>
+#include <threads.h>
+
+#include <utility>
+
+#include <fbl/algorithm.h>
+#include <fbl/string_printf.h>
+#include <fbl/unique_ptr.h>
+#include <lib/zx/fifo.h>
+#include <lib/zx/ring.h>
+#include <lib/zx/vmar.h>
+#include <lib/zx/vmo.h>
+#include <perftest/perftest.h>
+#include <zircon/assert.h>
+
+namespace {
+
+// Number of records passed from the producer to the consumer per test run.
+constexpr size_t kRecordsPerRun = 10000;
+
+// Number of records each queue can hold.
+constexpr uint32_t kQueueLength = 64;
+
+// One end of a ring, mapped into this process, following the protocol in
+// docs/objects/ring.md: the ends only make a syscall when the ring goes
+// between empty and non-empty or full and non-full, or before waiting.
+class RingEnd {
+public:
+    RingEnd(zx::ring ring, size_t record_size)
+        : ring_(std::move(ring)), record_size_(record_size) {
+        zx::vmo vmo;
+        ZX_ASSERT(ring_.get_vmo(&vmo) == ZX_OK);
+        ZX_ASSERT(vmo.get_size(&size_) == ZX_OK);
+        uintptr_t addr;
+        ZX_ASSERT(zx::vmar::root_self()->map(0, vmo, 0, size_,
+                                             ZX_VM_PERM_READ | ZX_VM_PERM_WRITE,
+                                             &addr) == ZX_OK);
+        header_ = reinterpret_cast<zx_ring_header_t*>(addr);
+        data_ = reinterpret_cast<uint8_t*>(addr + ZX_RING_DATA_OFFSET);
+        count_ = header_->elem_count;
+    }
+
+    ~RingEnd() {
+        ZX_ASSERT(zx::vmar::root_self()->unmap(reinterpret_cast<uintptr_t>(header_),
+                                               size_) == ZX_OK);
+    }
+
+    // Returns false once the consumer has gone.
+    bool Push(const void* record) {
+        uint64_t head = header_->head;
+        while (head - __atomic_load_n(&header_->tail, __ATOMIC_ACQUIRE) == count_) {
+            if (ring_.notify() != ZX_OK) {
+                return false;
+            }
+            ring_.wait_one(ZX_RING_WRITABLE | ZX_RING_PEER_CLOSED, zx::time::infinite(),
+                           nullptr);
+        }
+
+        memcpy(data_ + (head & (count_ - 1)) * record_size_, record, record_size_);
+        __atomic_store_n(&header_->head, head + 1, __ATOMIC_RELEASE);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&header_->tail, __ATOMIC_RELAXED) >= head) {
+            ring_.notify();
+        }
+        return true;
+    }
+
+    void Pop(void* record) {
+        uint64_t tail = header_->tail;
+        while (__atomic_load_n(&header_->head, __ATOMIC_ACQUIRE) == tail) {
+            ZX_ASSERT(ring_.notify() == ZX_OK);
+            ring_.wait_one(ZX_RING_READABLE, zx::time::infinite(), nullptr);
+        }
+
+        memcpy(record, data_ + (tail & (count_ - 1)) * record_size_, record_size_);
+        __atomic_store_n(&header_->tail, tail + 1, __ATOMIC_RELEASE);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&header_->head, __ATOMIC_RELAXED) - tail >= count_) {
+            ring_.notify();
+        }
+    }
+
+private:
+    zx::ring ring_;
+    const size_t record_size_;
+    uint64_t size_;
+    zx_ring_header_t* header_;
+    uint8_t* data_;
+    uint64_t count_;
+};
+
+int RingProducer(void* arg) {
+    auto* end = static_cast<RingEnd*>(arg);
+    uint8_t record[ZX_PAGE_SIZE] = {};
+    while (end->Push(record)) {
+    }
+    return 0;
+}
+
+// Measure the throughput of passing |record_size| byte records from one
+// thread to another through a ring, one record at a time.
+bool RingTransferTest(perftest::RepeatState* state, uint32_t record_size) {
+    state->SetBytesProcessedPerRun(kRecordsPerRun * record_size);
+
+    zx::ring producer, consumer;
+    ZX_ASSERT(zx::ring::create(kQueueLength, record_size, 0, &producer, &consumer) == ZX_OK);
+    fbl::unique_ptr<RingEnd> producer_end(new RingEnd(std::move(producer), record_size));
+    fbl::unique_ptr<RingEnd> consumer_end(new RingEnd(std::move(consumer), record_size));
+
+    thrd_t thread;
+    ZX_ASSERT(thrd_create(&thread, RingProducer, producer_end.get()) == thrd_success);
+
+    uint8_t record[ZX_PAGE_SIZE];
+    while (state->KeepRunning()) {
+        for (size_t i = 0; i < kRecordsPerRun; ++i) {
+            consumer_end->Pop(record);
+        }
+    }
+
+    // Closing the consumer stops the producer.
+    consumer_end.reset();
+    ZX_ASSERT(thrd_join(thread, nullptr) == thrd_success);
+    return true;
+}
+
+struct FifoProducerArgs {
+    zx::fifo fifo;
+    uint32_t record_size;
+};
+
+int FifoProducer(void* arg) {
+    auto* args = static_cast<FifoProducerArgs*>(arg);
+    uint8_t records[ZX_PAGE_SIZE] = {};
+    size_t batch = sizeof(records) / args->record_size;
+    for (;;) {
+        size_t actual;
+        zx_status_t status = args->fifo.write(args->record_size, records, batch, &actual);
+        if (status == ZX_ERR_SHOULD_WAIT) {
+            args->fifo.wait_one(ZX_FIFO_WRITABLE | ZX_FIFO_PEER_CLOSED,
+                                zx::time::infinite(), nullptr);
+        } else if (status != ZX_OK) {
+            return 0;
+        }
+    }
+}
+
+// Measure the same transfer as RingTransferTest() through a fifo, writing
+// and reading as many records as fit per syscall.
+bool FifoTransferTest(perftest::RepeatState* state, uint32_t record_size) {
+    state->SetBytesProcessedPerRun(kRecordsPerRun * record_size);
+
+    FifoProducerArgs args;
+    args.record_size = record_size;
+    zx::fifo consumer;
+    ZX_ASSERT(zx::fifo::create(kQueueLength, record_size, 0, &args.fifo, &consumer) == ZX_OK);
+
+    thrd_t thread;
+    ZX_ASSERT(thrd_create(&thread, FifoProducer, &args) == thrd_success);
+
+    uint8_t records[ZX_PAGE_SIZE];
+    while (state->KeepRunning()) {
+        size_t remaining = kRecordsPerRun;
+        while (remaining > 0) {
+            size_t batch = fbl::min(remaining, sizeof(records) / record_size);
+            size_t actual;
+            zx_status_t status = consumer.read(record_size, records, batch, &actual);
+            if (status == ZX_ERR_SHOULD_WAIT) {
+                ZX_ASSERT(consumer.wait_one(ZX_FIFO_READABLE, zx::time::infinite(),
+                                            nullptr) == ZX_OK);
+                continue;
+            }
+            ZX_ASSERT(status == ZX_OK);
+            remaining -= actual;
+        }
+    }
+
+    // Closing the consumer stops the producer.
+    consumer.reset();
+    ZX_ASSERT(thrd_join(thread, nullptr) == thrd_success);
+    return true;
+}
+
+void RegisterTests() {
+    // Both sizes keep a kQueueLength deep fifo within its 4096 byte limit.
+    static const uint32_t kRecordSizes[] = {
+        8,
+        64,
+    };
+    for (auto record_size : kRecordSizes) {
+        auto name = fbl::StringPrintf("RingTransfer/Ring/%ubytes", record_size);
+        perftest::RegisterTest(name.c_str(), RingTransferTest, record_size);
+    }
+    for (auto record_size : kRecordSizes) {
+        auto name = fbl::StringPrintf("RingTransfer/Fifo/%ubytes", record_size);
+        perftest::RegisterTest(name.c_str(), FifoTransferTest, record_size);
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+}  // namespace
@@ -10,17 +10,25 @@ MODULE_TYPE := usertest
 
 MODULE_SRCS += \
     $(LOCAL_DIR)/clock-test.cpp \
+    $(LOCAL_DIR)/fidl-iovec-test.cpp \
+    $(LOCAL_DIR)/futex-test.cpp \
     $(LOCAL_DIR)/handle-creation-test.cpp \
+    $(LOCAL_DIR)/handle-scaling-test.cpp \
     $(LOCAL_DIR)/malloc-test.cpp \
     $(LOCAL_DIR)/memcpy-test.cpp \
     $(LOCAL_DIR)/mutex-test.cpp \
     $(LOCAL_DIR)/null-test.cpp \
+    $(LOCAL_DIR)/port-test.cpp \
     $(LOCAL_DIR)/process-test.cpp \
     $(LOCAL_DIR)/results-test.cpp \
+    $(LOCAL_DIR)/ring-test.cpp \
     $(LOCAL_DIR)/runner-test.cpp \
     $(LOCAL_DIR)/sleep-test.cpp \
+    $(LOCAL_DIR)/socket-test.cpp \
     $(LOCAL_DIR)/syscalls-test.cpp \
     $(LOCAL_DIR)/timer-test.cpp \
+    $(LOCAL_DIR)/vmo-access-test.cpp \
+    $(LOCAL_DIR)/vmo-fault-test.cpp \
 
 MODULE_NAME := perf-test
 
@@ -30,6 +38,7 @@ MODULE_STATIC_LIBS := \
     system/ulib/async-loop.cpp \
     system/ulib/async.cpp \
     system/ulib/fbl \
+    system/ulib/fidl \
     system/ulib/perftest \
     system/ulib/trace \
     system/ulib/trace-provider \
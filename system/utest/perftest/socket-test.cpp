@@ -0,0 +1,91 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string.h>
+
+#include <fbl/string_printf.h>
+#include <fbl/unique_ptr.h>
+#include <lib/zx/socket.h>
+#include <lib/zx/vmar.h>
+#include <lib/zx/vmo.h>
+#include <perftest/perftest.h>
+#include <zircon/assert.h>
+
+namespace {
+
+// Measure the throughput of passing |size| bytes through a stream socket
+// with zx_socket_write() and zx_socket_read(), which copy the data into the
+// socket and back out again.
+bool SocketCopyTest(perftest::RepeatState* state, size_t size) {
+    state->SetBytesProcessedPerRun(size);
+
+    zx::socket writer, reader;
+    ZX_ASSERT(zx::socket::create(0, &writer, &reader) == ZX_OK);
+
+    fbl::unique_ptr<uint8_t[]> buffer(new uint8_t[size]);
+    memset(buffer.get(), 0xa5, size);
+
+    while (state->KeepRunning()) {
+        size_t written;
+        ZX_ASSERT(writer.write(0, buffer.get(), size, &written) == ZX_OK);
+        ZX_ASSERT(written == size);
+        size_t nread;
+        ZX_ASSERT(reader.read(0, buffer.get(), size, &nread) == ZX_OK);
+        ZX_ASSERT(nread == size);
+    }
+    return true;
+}
+
+// Measure the throughput of passing |size| bytes through a stream socket
+// with zx_socket_write_vmo() and zx_socket_read_vmo(), which loan the
+// writer's pages to the socket and hand them on to the reader, who maps
+// them.
+bool SocketLoanTest(perftest::RepeatState* state, size_t size) {
+    state->SetBytesProcessedPerRun(size);
+
+    zx::socket writer, reader;
+    ZX_ASSERT(zx::socket::create(0, &writer, &reader) == ZX_OK);
+
+    zx::vmo vmo;
+    ZX_ASSERT(zx::vmo::create(size, 0, &vmo) == ZX_OK);
+    fbl::unique_ptr<uint8_t[]> buffer(new uint8_t[size]);
+    memset(buffer.get(), 0xa5, size);
+    ZX_ASSERT(vmo.write(buffer.get(), 0, size) == ZX_OK);
+
+    while (state->KeepRunning()) {
+        size_t written;
+        ZX_ASSERT(writer.write_vmo(0, vmo, 0, size, &written) == ZX_OK);
+        ZX_ASSERT(written == size);
+        zx::vmo out;
+        size_t nread;
+        ZX_ASSERT(reader.read_vmo(0, size, &out, &nread) == ZX_OK);
+        ZX_ASSERT(nread == size);
+        uintptr_t addr;
+        ZX_ASSERT(zx::vmar::root_self()->map(0, out, 0, size, ZX_VM_PERM_READ,
+                                             &addr) == ZX_OK);
+        ZX_ASSERT(zx::vmar::root_self()->unmap(addr, size) == ZX_OK);
+    }
+    return true;
+}
+
+void RegisterTests() {
+    // All of these fit in the socket's buffer, so each run is a single
+    // write and a single read.
+    static const size_t kSizes[] = {
+        4 * 1024,
+        64 * 1024,
+        128 * 1024,
+    };
+    for (auto size : kSizes) {
+        auto name = fbl::StringPrintf("SocketTransfer/Copy/%zubytes", size);
+        perftest::RegisterTest(name.c_str(), SocketCopyTest, size);
+    }
+    for (auto size : kSizes) {
+        auto name = fbl::StringPrintf("SocketTransfer/Loan/%zubytes", size);
+        perftest::RegisterTest(name.c_str(), SocketLoanTest, size);
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+}  // namespace
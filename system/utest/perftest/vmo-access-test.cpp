@@ -0,0 +1,64 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <fbl/string_printf.h>
+#include <lib/zx/vmar.h>
+#include <lib/zx/vmo.h>
+#include <perftest/perftest.h>
+#include <zircon/assert.h>
+#include <zircon/limits.h>
+
+namespace {
+
+// Number of loads made per test run.
+constexpr size_t kLoadsPerRun = 4096;
+
+// Measure the time taken to make kLoadsPerRun loads from random pages of a
+// committed |size| byte mapping.  Once the mapping is larger than the TLB
+// can cover with small pages, nearly every load takes a TLB miss, so this
+// shows how much the kernel's use of large pages for the mapping saves when
+// booted with kernel.vm.large-pages=true.
+bool VmoRandomAccessTest(perftest::RepeatState* state, size_t size) {
+    zx::vmo vmo;
+    ZX_ASSERT(zx::vmo::create(size, 0, &vmo) == ZX_OK);
+    uintptr_t addr;
+    ZX_ASSERT(zx::vmar::root_self()->map(0, vmo, 0, size,
+                                         ZX_VM_PERM_READ | ZX_VM_PERM_WRITE,
+                                         &addr) == ZX_OK);
+
+    // Fault everything in up front by writing to it, so that the test only
+    // measures loads from pages that are already mapped.
+    for (size_t offset = 0; offset < size; offset += ZX_PAGE_SIZE) {
+        *reinterpret_cast<volatile uint8_t*>(addr + offset) = 1;
+    }
+
+    const size_t page_count = size / ZX_PAGE_SIZE;
+    uint32_t rand = 1;
+    while (state->KeepRunning()) {
+        for (size_t i = 0; i < kLoadsPerRun; ++i) {
+            // A simple LCG is enough to defeat the prefetchers.
+            rand = rand * 1103515245 + 12345;
+            size_t page = rand % page_count;
+            *reinterpret_cast<volatile uint8_t*>(addr + page * ZX_PAGE_SIZE);
+        }
+    }
+
+    ZX_ASSERT(zx::vmar::root_self()->unmap(addr, size) == ZX_OK);
+    return true;
+}
+
+void RegisterTests() {
+    static const size_t kSizes[] = {
+        2 * 1024 * 1024,
+        64 * 1024 * 1024,
+        512 * 1024 * 1024,
+    };
+    for (auto size : kSizes) {
+        auto name = fbl::StringPrintf("VmoRandomAccess/%zubytes", size);
+        perftest::RegisterTest(name.c_str(), VmoRandomAccessTest, size);
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+}  // namespace
@@ -0,0 +1,152 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string.h>
+#include <threads.h>
+
+#include <fbl/string_printf.h>
+#include <fbl/unique_ptr.h>
+#include <fbl/vector.h>
+#include <lib/zx/vmar.h>
+#include <lib/zx/vmo.h>
+#include <perftest/perftest.h>
+#include <zircon/assert.h>
+#include <zircon/limits.h>
+
+#include "batch-worker.h"
+
+namespace {
+
+// Number of pages each thread faults in per test run.
+constexpr size_t kPagesPerRun = 64;
+constexpr size_t kVmoSize = kPagesPerRun * ZX_PAGE_SIZE;
+
+// A thread with a mapping of its own VMO.  Each batch it touches every page
+// of the mapping, so each touch takes a page fault that has to allocate a
+// fresh page, and then decommits the VMO to hand the pages back.  With
+// several of these running at once the test measures how well page
+// allocation and freeing scale across CPUs.
+class FaultThread : public perftest_util::BatchWorker {
+public:
+    FaultThread() {
+        ZX_ASSERT(zx::vmo::create(kVmoSize, 0, &vmo_) == ZX_OK);
+        ZX_ASSERT(zx::vmar::root_self()->map(0, vmo_, 0, kVmoSize,
+                                             ZX_VM_PERM_READ | ZX_VM_PERM_WRITE,
+                                             &addr_) == ZX_OK);
+        ZX_ASSERT(thrd_create(&thread_, ThreadFunc, this) == thrd_success);
+    }
+
+    ~FaultThread() {
+        Stop();
+        ZX_ASSERT(thrd_join(thread_, nullptr) == thrd_success);
+        ZX_ASSERT(zx::vmar::root_self()->unmap(addr_, kVmoSize) == ZX_OK);
+    }
+
+private:
+    static int ThreadFunc(void* arg) {
+        auto* self = static_cast<FaultThread*>(arg);
+        for (;;) {
+            if (!self->WaitForBatch()) {
+                return 0;
+            }
+            for (size_t offset = 0; offset < kVmoSize; offset += ZX_PAGE_SIZE) {
+                *reinterpret_cast<volatile uint8_t*>(self->addr_ + offset) = 1;
+            }
+            ZX_ASSERT(self->vmo_.op_range(ZX_VMO_OP_DECOMMIT, 0, kVmoSize,
+                                          nullptr, 0) == ZX_OK);
+            self->FinishBatch();
+        }
+    }
+
+    zx::vmo vmo_;
+    uintptr_t addr_;
+    thrd_t thread_;
+};
+
+// Measure the time taken for |thread_count| threads to each fault in and
+// release kPagesPerRun pages concurrently.
+bool VmoFaultTest(perftest::RepeatState* state, uint32_t thread_count) {
+    fbl::Vector<fbl::unique_ptr<FaultThread>> threads;
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        threads.push_back(fbl::make_unique<FaultThread>());
+    }
+
+    perftest_util::RunBatches(state, threads);
+    return true;
+}
+
+// Measure the time taken to map a fresh |size| byte VMO and write to each
+// of its pages once.  Every touch is a first touch, so each needs a zeroed
+// page from the kernel; this tracks how much of that zeroing the fault path
+// still pays for itself.
+bool VmoFirstTouchTest(perftest::RepeatState* state, size_t size) {
+    while (state->KeepRunning()) {
+        zx::vmo vmo;
+        ZX_ASSERT(zx::vmo::create(size, 0, &vmo) == ZX_OK);
+        uintptr_t addr;
+        ZX_ASSERT(zx::vmar::root_self()->map(0, vmo, 0, size,
+                                             ZX_VM_PERM_READ | ZX_VM_PERM_WRITE,
+                                             &addr) == ZX_OK);
+        for (size_t offset = 0; offset < size; offset += ZX_PAGE_SIZE) {
+            *reinterpret_cast<volatile uint8_t*>(addr + offset) = 1;
+        }
+        ZX_ASSERT(zx::vmar::root_self()->unmap(addr, size) == ZX_OK);
+    }
+    return true;
+}
+
+// Measure the time taken to map a |size| byte VMO whose pages are all
+// already committed, as with a file that is in the page cache, and read
+// each of its pages once in order.  No page needs allocating, so this
+// tracks how many faults the kernel takes to map pages that are already
+// there.
+bool VmoSequentialReadTest(perftest::RepeatState* state, size_t size) {
+    zx::vmo vmo;
+    ZX_ASSERT(zx::vmo::create(size, 0, &vmo) == ZX_OK);
+    // Write the contents in through the VMO rather than committing it, so
+    // the pages are committed one at a time like a file's would be.
+    fbl::unique_ptr<uint8_t[]> buffer(new uint8_t[size]);
+    memset(buffer.get(), 0xa5, size);
+    ZX_ASSERT(vmo.write(buffer.get(), 0, size) == ZX_OK);
+
+    while (state->KeepRunning()) {
+        uintptr_t addr;
+        ZX_ASSERT(zx::vmar::root_self()->map(0, vmo, 0, size, ZX_VM_PERM_READ,
+                                             &addr) == ZX_OK);
+        for (size_t offset = 0; offset < size; offset += ZX_PAGE_SIZE) {
+            (void)*reinterpret_cast<volatile uint8_t*>(addr + offset);
+        }
+        ZX_ASSERT(zx::vmar::root_self()->unmap(addr, size) == ZX_OK);
+    }
+    return true;
+}
+
+void RegisterTests() {
+    static const size_t kSizes[] = {
+        1024 * 1024,
+        16 * 1024 * 1024,
+    };
+    for (auto size : kSizes) {
+        auto name = fbl::StringPrintf("VmoFirstTouch/%zubytes", size);
+        perftest::RegisterTest(name.c_str(), VmoFirstTouchTest, size);
+    }
+    for (auto size : kSizes) {
+        auto name = fbl::StringPrintf("VmoSequentialRead/%zubytes", size);
+        perftest::RegisterTest(name.c_str(), VmoSequentialReadTest, size);
+    }
+
+    static const uint32_t kThreadCounts[] = {
+        1,
+        2,
+        4,
+        8,
+    };
+    for (auto thread_count : kThreadCounts) {
+        auto name = fbl::StringPrintf("VmoFault/%uthreads", thread_count);
+        perftest::RegisterTest(name.c_str(), VmoFaultTest, thread_count);
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+}  // namespace
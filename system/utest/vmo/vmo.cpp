@@ -459,6 +459,69 @@ bool vmo_info_test() {
     END_TEST;
 }
 
+bool vmo_numa_node_test() {
+    BEGIN_TEST;
+
+    const size_t len = PAGE_SIZE * 4;
+    zx_handle_t vmo;
+    ASSERT_EQ(ZX_OK, zx_vmo_create(len, 0, &vmo), "vmo_create");
+
+    // not bound to a node until asked
+    uint32_t node = 0;
+    EXPECT_EQ(ZX_OK, zx_object_get_property(vmo, ZX_PROP_NUMA_NODE, &node, sizeof(node)),
+              "get_property");
+    EXPECT_EQ(ZX_NUMA_NODE_ANY, node, "default node");
+
+    // every system has a node 0
+    node = 0;
+    EXPECT_EQ(ZX_OK, zx_object_set_property(vmo, ZX_PROP_NUMA_NODE, &node, sizeof(node)),
+              "set_property");
+    EXPECT_EQ(ZX_OK, zx_vmo_op_range(vmo, ZX_VMO_OP_COMMIT, 0, len, nullptr, 0), "commit");
+    node = ZX_NUMA_NODE_ANY;
+    EXPECT_EQ(ZX_OK, zx_object_get_property(vmo, ZX_PROP_NUMA_NODE, &node, sizeof(node)),
+              "get_property");
+    EXPECT_EQ(0u, node, "bound node");
+
+    // clones take the node of their parent
+    zx_handle_t clone;
+    ASSERT_EQ(ZX_OK, zx_vmo_clone(vmo, ZX_VMO_CLONE_COPY_ON_WRITE, 0, len, &clone), "clone");
+    node = ZX_NUMA_NODE_ANY;
+    EXPECT_EQ(ZX_OK, zx_object_get_property(clone, ZX_PROP_NUMA_NODE, &node, sizeof(node)),
+              "get_property");
+    EXPECT_EQ(0u, node, "clone node");
+    EXPECT_EQ(ZX_OK, zx_handle_close(clone), "handle_close");
+
+    // there aren't this many nodes anywhere
+    node = 1000;
+    EXPECT_EQ(ZX_ERR_INVALID_ARGS,
+              zx_object_set_property(vmo, ZX_PROP_NUMA_NODE, &node, sizeof(node)),
+              "bad node");
+
+    node = ZX_NUMA_NODE_ANY;
+    EXPECT_EQ(ZX_OK, zx_object_set_property(vmo, ZX_PROP_NUMA_NODE, &node, sizeof(node)),
+              "unbind");
+    EXPECT_EQ(ZX_OK, zx_handle_close(vmo), "handle_close");
+
+    // a node set on the process applies to the vmos it creates from then on
+    node = 0;
+    ASSERT_EQ(ZX_OK, zx_object_set_property(zx_process_self(), ZX_PROP_NUMA_NODE,
+                                            &node, sizeof(node)),
+              "set process node");
+    ASSERT_EQ(ZX_OK, zx_vmo_create(len, 0, &vmo), "vmo_create");
+    node = ZX_NUMA_NODE_ANY;
+    EXPECT_EQ(ZX_OK, zx_object_get_property(vmo, ZX_PROP_NUMA_NODE, &node, sizeof(node)),
+              "get_property");
+    EXPECT_EQ(0u, node, "node from process");
+    EXPECT_EQ(ZX_OK, zx_handle_close(vmo), "handle_close");
+
+    node = ZX_NUMA_NODE_ANY;
+    EXPECT_EQ(ZX_OK, zx_object_set_property(zx_process_self(), ZX_PROP_NUMA_NODE,
+                                            &node, sizeof(node)),
+              "reset process node");
+
+    END_TEST;
+}
+
 bool vmo_no_resize_clone_test() {
     const size_t len = PAGE_SIZE * 4;
     zx_handle_t vmo = ZX_HANDLE_INVALID;
@@ -1801,6 +1864,7 @@ RUN_TEST(vmo_resize_hazard);
 RUN_TEST(vmo_clone_resize_clone_hazard);
 RUN_TEST(vmo_clone_resize_parent_ok);
 RUN_TEST(vmo_info_test);
+RUN_TEST(vmo_numa_node_test);
 RUN_TEST_LARGE(vmo_unmap_coherency);
 END_TEST_CASE(vmo_tests)
 